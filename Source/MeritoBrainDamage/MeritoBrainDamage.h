@@ -3,6 +3,10 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 
 /** Main log category used across the project */
-DECLARE_LOG_CATEGORY_EXTERN(LogMeritoBrainDamage, Log, All);
\ No newline at end of file
+DECLARE_LOG_CATEGORY_EXTERN(LogMeritoBrainDamage, Log, All);
+
+/** Stat group for the shooter gameplay systems. Use "stat Shooter" to display it */
+DECLARE_STATS_GROUP(TEXT("Shooter"), STATGROUP_Shooter, STATCAT_Advanced);
\ No newline at end of file
@@ -10,28 +10,39 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "MeritoBrainDamage.h"
 
-AMeritoBrainDamageCharacter::AMeritoBrainDamageCharacter()
+FName AMeritoBrainDamageCharacter::FirstPersonMeshComponentName(TEXT("First Person Mesh"));
+FName AMeritoBrainDamageCharacter::FirstPersonCameraComponentName(TEXT("First Person Camera"));
+
+AMeritoBrainDamageCharacter::AMeritoBrainDamageCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(55.f, 96.0f);
 	
 	// Create the first person mesh that will be viewed only by this character's owner
-	FirstPersonMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("First Person Mesh"));
+	FirstPersonMesh = CreateOptionalDefaultSubobject<USkeletalMeshComponent>(FirstPersonMeshComponentName);
 
-	FirstPersonMesh->SetupAttachment(GetMesh());
-	FirstPersonMesh->SetOnlyOwnerSee(true);
-	FirstPersonMesh->FirstPersonPrimitiveType = EFirstPersonPrimitiveType::FirstPerson;
-	FirstPersonMesh->SetCollisionProfileName(FName("NoCollision"));
+	if (FirstPersonMesh)
+	{
+		FirstPersonMesh->SetupAttachment(GetMesh());
+		FirstPersonMesh->SetOnlyOwnerSee(true);
+		FirstPersonMesh->FirstPersonPrimitiveType = EFirstPersonPrimitiveType::FirstPerson;
+		FirstPersonMesh->SetCollisionProfileName(FName("NoCollision"));
+	}
 
 	// Create the Camera Component	
-	FirstPersonCameraComponent = CreateDefaultSubobject<UCameraComponent>(TEXT("First Person Camera"));
-	FirstPersonCameraComponent->SetupAttachment(FirstPersonMesh, FName("head"));
-	FirstPersonCameraComponent->SetRelativeLocationAndRotation(FVector(-2.8f, 5.89f, 0.0f), FRotator(0.0f, 90.0f, -90.0f));
-	FirstPersonCameraComponent->bUsePawnControlRotation = true;
-	FirstPersonCameraComponent->bEnableFirstPersonFieldOfView = true;
-	FirstPersonCameraComponent->bEnableFirstPersonScale = true;
-	FirstPersonCameraComponent->FirstPersonFieldOfView = 70.0f;
-	FirstPersonCameraComponent->FirstPersonScale = 0.6f;
+	FirstPersonCameraComponent = CreateOptionalDefaultSubobject<UCameraComponent>(FirstPersonCameraComponentName);
+
+	if (FirstPersonCameraComponent)
+	{
+		FirstPersonCameraComponent->SetupAttachment(FirstPersonMesh ? FirstPersonMesh : GetMesh(), FName("head"));
+		FirstPersonCameraComponent->SetRelativeLocationAndRotation(FVector(-2.8f, 5.89f, 0.0f), FRotator(0.0f, 90.0f, -90.0f));
+		FirstPersonCameraComponent->bUsePawnControlRotation = true;
+		FirstPersonCameraComponent->bEnableFirstPersonFieldOfView = true;
+		FirstPersonCameraComponent->bEnableFirstPersonScale = true;
+		FirstPersonCameraComponent->FirstPersonFieldOfView = 70.0f;
+		FirstPersonCameraComponent->FirstPersonScale = 0.6f;
+	}
 
 	// configure the character comps
 	GetMesh()->SetOwnerNoSee(true);
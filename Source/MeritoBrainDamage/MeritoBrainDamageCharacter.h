@@ -50,7 +50,14 @@ protected:
 	class UInputAction* MouseLookAction;
 	
 public:
-	AMeritoBrainDamageCharacter();
+
+	/** Name of the first person mesh component. Use with DoNotCreateDefaultSubobject to skip it in subclasses */
+	static FName FirstPersonMeshComponentName;
+
+	/** Name of the first person camera component. Use with DoNotCreateDefaultSubobject to skip it in subclasses */
+	static FName FirstPersonCameraComponentName;
+
+	AMeritoBrainDamageCharacter(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
 protected:
 
@@ -84,10 +91,10 @@ protected:
 
 public:
 
-	/** Returns the first person mesh **/
+	/** Returns the first person mesh. May be null on characters that don't need a first person view **/
 	USkeletalMeshComponent* GetFirstPersonMesh() const { return FirstPersonMesh; }
 
-	/** Returns first person camera component **/
+	/** Returns first person camera component. May be null on characters that don't need a first person view **/
 	UCameraComponent* GetFirstPersonCameraComponent() const { return FirstPersonCameraComponent; }
 
 };
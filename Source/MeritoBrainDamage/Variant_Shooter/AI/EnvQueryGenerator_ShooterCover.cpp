@@ -0,0 +1,117 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "Variant_Shooter/AI/EnvQueryGenerator_ShooterCover.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Point.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "Algo/Unique.h"
+#include "EnvQueryContext_Target.h"
+#include "ShooterCoverDatabase.h"
+#include "GameFramework/Controller.h"
+#include "Engine/World.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryGenerator"
+
+UEnvQueryGenerator_ShooterCover::UEnvQueryGenerator_ShooterCover(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	ItemType = UEnvQueryItemType_Point::StaticClass();
+
+	GenerateAround = UEnvQueryContext_Querier::StaticClass();
+	ThreatContext = UEnvQueryContext_Target::StaticClass();
+
+	SearchRadius.DefaultValue = 1500.0f;
+	MinThreatDistance.DefaultValue = 300.0f;
+	MaxThreatDistance.DefaultValue = 2500.0f;
+	MinProtectionDot.DefaultValue = 0.5f;
+}
+
+void UEnvQueryGenerator_ShooterCover::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+
+	if (!QueryOwner || !QueryInstance.World)
+	{
+		return;
+	}
+
+	const UShooterCoverSubsystem* Cover = QueryInstance.World->GetSubsystem<UShooterCoverSubsystem>();
+	const UShooterCoverDatabase* Database = Cover ? Cover->GetDatabase() : nullptr;
+
+	if (!Database)
+	{
+		return;
+	}
+
+	SearchRadius.BindData(QueryOwner, QueryInstance.QueryID);
+	MinThreatDistance.BindData(QueryOwner, QueryInstance.QueryID);
+	MaxThreatDistance.BindData(QueryOwner, QueryInstance.QueryID);
+	MinProtectionDot.BindData(QueryOwner, QueryInstance.QueryID);
+
+	TArray<FVector> Origins;
+	QueryInstance.PrepareContext(GenerateAround, Origins);
+
+	TArray<FVector> Threats;
+	QueryInstance.PrepareContext(ThreatContext, Threats);
+
+	if (Origins.Num() == 0 || Threats.Num() == 0)
+	{
+		return;
+	}
+
+	FShooterCoverQuery Query;
+	Query.ThreatLocation = Threats[0];
+	Query.SearchRadius = SearchRadius.GetValue();
+	Query.MinThreatDistance = MinThreatDistance.GetValue();
+	Query.MaxThreatDistance = MaxThreatDistance.GetValue();
+	Query.MinProtectionDot = MinProtectionDot.GetValue();
+	Query.bRequireFullHeight = bRequireFullHeight;
+
+	TArray<int32> PointIndices;
+
+	for (const FVector& Origin : Origins)
+	{
+		Query.Origin = Origin;
+		Database->Query(Query, PointIndices);
+	}
+
+	// overlapping origins can return the same point twice
+	if (Origins.Num() > 1)
+	{
+		PointIndices.Sort();
+		PointIndices.SetNum(Algo::Unique(PointIndices));
+	}
+
+	// claims are held by the pawn, queries are usually run by the controller
+	const AActor* Claimant = Cast<AActor>(QueryOwner);
+
+	if (const AController* Controller = Cast<AController>(QueryOwner))
+	{
+		Claimant = Controller->GetPawn();
+	}
+
+	for (const int32 PointIndex : PointIndices)
+	{
+		if (bSkipClaimedCover && Cover->IsCoverClaimed(PointIndex, Claimant))
+		{
+			continue;
+		}
+
+		QueryInstance.AddItemData<UEnvQueryItemType_Point>(FVector(Database->GetPoint(PointIndex).Location));
+	}
+}
+
+FText UEnvQueryGenerator_ShooterCover::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("ShooterCoverDescriptionTitle", "{0}: around {1} from {2}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(GenerateAround), UEnvQueryTypes::DescribeContext(ThreatContext));
+}
+
+FText UEnvQueryGenerator_ShooterCover::GetDescriptionDetails() const
+{
+	return FText::Format(LOCTEXT("ShooterCoverDescriptionDetails", "radius: {0}, threat distance: {1} to {2}, protection: {3}"),
+		FText::FromString(SearchRadius.ToString()), FText::FromString(MinThreatDistance.ToString()),
+		FText::FromString(MaxThreatDistance.ToString()), FText::FromString(MinProtectionDot.ToString()));
+}
+
+#undef LOCTEXT_NAMESPACE
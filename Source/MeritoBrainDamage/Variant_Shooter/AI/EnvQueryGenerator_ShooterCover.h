@@ -0,0 +1,66 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "DataProviders/AIDataProvider.h"
+#include "EnvQueryGenerator_ShooterCover.generated.h"
+
+class UEnvQueryContext;
+
+/**
+ *  Custom EnvQuery Generator that returns cover points from the baked cover database
+ *  Only points that protect from the threat context are generated, so no traces are needed
+ */
+UCLASS(meta = (DisplayName = "Shooter Cover Points"))
+class MERITOBRAINDAMAGE_API UEnvQueryGenerator_ShooterCover : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Context to search for cover around */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	TSubclassOf<UEnvQueryContext> GenerateAround;
+
+	/** Context to take cover from */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	TSubclassOf<UEnvQueryContext> ThreatContext;
+
+	/** Max distance from the search context */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	FAIDataProviderFloatValue SearchRadius;
+
+	/** Min distance from the cover to the threat */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	FAIDataProviderFloatValue MinThreatDistance;
+
+	/** Max distance from the cover to the threat */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	FAIDataProviderFloatValue MaxThreatDistance;
+
+	/** Min dot product between the cover's protected direction and the direction to the threat */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	FAIDataProviderFloatValue MinProtectionDot;
+
+	/** If true, only full height cover is generated */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	bool bRequireFullHeight = false;
+
+	/** If true, cover claimed by other NPCs is skipped */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	bool bSkipClaimedCover = true;
+
+public:
+
+	/** Constructor */
+	UEnvQueryGenerator_ShooterCover(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Adds the matching cover points to the query */
+	virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+
+	/** Editor descriptions */
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+};
@@ -0,0 +1,60 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "Variant_Shooter/AI/EnvQueryTest_ShooterDanger.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_VectorBase.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterInfluence.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryTest"
+
+UEnvQueryTest_ShooterDanger::UEnvQueryTest_ShooterDanger(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Cost = EEnvTestCost::Low;
+	ValidItemType = UEnvQueryItemType_VectorBase::StaticClass();
+	SetWorkOnFloatValues(true);
+
+	// safer locations score higher by default
+	ScoringEquation = EEnvTestScoreEquation::InverseLinear;
+}
+
+void UEnvQueryTest_ShooterDanger::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+
+	if (!QueryOwner || !QueryInstance.World)
+	{
+		return;
+	}
+
+	FloatValueMin.BindData(QueryOwner, QueryInstance.QueryID);
+	FloatValueMax.BindData(QueryOwner, QueryInstance.QueryID);
+
+	const float MinThresholdValue = FloatValueMin.GetValue();
+	const float MaxThresholdValue = FloatValueMax.GetValue();
+
+	const UShooterInfluenceSubsystem* Influence = QueryInstance.World->GetSubsystem<UShooterInfluenceSubsystem>();
+
+	// the controller and its pawn share the team, so either can be the querier
+	const uint8 Team = FGenericTeamId::GetTeamIdentifier(Cast<AActor>(QueryOwner)).GetId();
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const float Danger = Influence ? Influence->GetDanger(Team, GetItemLocation(QueryInstance, It.GetIndex())) : 0.0f;
+
+		It.SetScore(TestPurpose, FilterType, Danger, MinThresholdValue, MaxThresholdValue);
+	}
+}
+
+FText UEnvQueryTest_ShooterDanger::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("ShooterDangerDescriptionTitle", "{0}: influence map"), Super::GetDescriptionTitle());
+}
+
+FText UEnvQueryTest_ShooterDanger::GetDescriptionDetails() const
+{
+	return DescribeFloatTestParams();
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,29 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "EnvQueryTest_ShooterDanger.generated.h"
+
+/**
+ *  Custom EnvQuery Test that scores items by the influence map danger for the querier's team
+ *  Each item is a single grid lookup, so it's cheap enough to run on every generated point
+ */
+UCLASS(meta = (DisplayName = "Shooter Danger"))
+class MERITOBRAINDAMAGE_API UEnvQueryTest_ShooterDanger : public UEnvQueryTest
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Constructor */
+	UEnvQueryTest_ShooterDanger(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Scores the items by danger */
+	virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+
+	/** Editor descriptions */
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+};
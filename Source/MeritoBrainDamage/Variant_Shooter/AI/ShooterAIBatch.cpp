@@ -0,0 +1,458 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAIBatch.h"
+#include "ShooterAIController.h"
+#include "ShooterNPC.h"
+#include "ShooterVisibility.h"
+#include "Components/StateTreeAIComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Batch Line of Sight"), STAT_ShooterAIBatchLineOfSight, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("AI Batch StateTrees"), STAT_ShooterAIBatchStateTrees, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("AI Batch Commands"), STAT_ShooterAIBatchCommands, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("AI Batch Commands Applied"), STAT_ShooterAIBatchCommandsApplied, STATGROUP_Shooter);
+
+namespace ShooterAIBatch
+{
+	static TAutoConsoleVariable<bool> CVarBatch(
+		TEXT("Shooter.AI.Batch"),
+		false,
+		TEXT("If true, shooter AI line of sight is traced in parallel, StateTrees are ticked in one batch and their actor commands are deferred to a single pass."),
+		ECVF_Default);
+
+	/** Number of vertical line of sight traces to run against the target */
+	static constexpr int32 NumLineOfSightChecks = 4;
+
+	/** Below this many requests the traces run on the game thread, as task overhead would outweigh the work */
+	static constexpr int32 MinParallelRequests = 8;
+}
+
+bool UShooterAIBatchSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterAIBatchSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAIBatchSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterAIBatchSubsystem::RegisterController(AShooterAIController* Controller)
+{
+	Controllers.AddUnique(Controller);
+
+	// hand the StateTree over to the batch if it's already running
+	if (bBatching)
+	{
+		Controller->GetStateTreeAI()->SetComponentTickEnabled(false);
+	}
+}
+
+void UShooterAIBatchSubsystem::UnregisterController(AShooterAIController* Controller)
+{
+	Controllers.RemoveSwap(Controller);
+}
+
+void UShooterAIBatchSubsystem::Tick(float DeltaTime)
+{
+	// drop any controllers that were destroyed while registered
+	Controllers.RemoveAllSwap([](const TWeakObjectPtr<AShooterAIController>& Controller) { return !Controller.IsValid(); });
+
+	// follow the console variable
+	if (bBatching != ShooterAIBatch::CVarBatch.GetValueOnGameThread())
+	{
+		SetBatching(!bBatching);
+	}
+
+	if (!bBatching)
+	{
+		// apply anything emitted while we were switching modes
+		FlushCommands();
+		return;
+	}
+
+	// refresh the line of sight for every NPC in parallel
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterAIBatchLineOfSight);
+
+		GatherLineOfSightRequests();
+		TraceLineOfSightRequests();
+
+		// store the results on the NPCs so the StateTree conditions and the aim solver can read them
+		for (int32 i = 0; i < LineOfSightRequests.Num(); ++i)
+		{
+			if (AShooterAIController* Controller = RequestControllers[i].Get())
+			{
+				if (AShooterNPC* NPC = Cast<AShooterNPC>(Controller->GetPawn()))
+				{
+					NPC->CacheLineOfSight(Controller->GetCurrentTarget(), LineOfSightRequests[i].bClear);
+				}
+			}
+		}
+	}
+
+	// tick the StateTrees. The StateTree execution context and its property bindings aren't thread safe,
+	// so this stays on the game thread, but the tasks only read snapshots and emit deferred commands
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterAIBatchStateTrees);
+
+		for (const TWeakObjectPtr<AShooterAIController>& Controller : Controllers)
+		{
+			UStateTreeAIComponent* StateTreeAI = Controller->GetStateTreeAI();
+
+			// the StateTree may reschedule its own tick, so keep it switched off while batching
+			if (StateTreeAI->IsComponentTickEnabled())
+			{
+				StateTreeAI->SetComponentTickEnabled(false);
+			}
+
+			if (StateTreeAI->IsRegistered() && StateTreeAI->IsRunning())
+			{
+				StateTreeAI->TickComponent(DeltaTime, LEVELTICK_All, &StateTreeAI->PrimaryComponentTick);
+			}
+		}
+	}
+
+	// apply all actor commands in one pass
+	FlushCommands();
+}
+
+void UShooterAIBatchSubsystem::SetBatching(bool bEnabled)
+{
+	bBatching = bEnabled;
+
+	// the StateTrees are ticked by the subsystem while batching
+	for (const TWeakObjectPtr<AShooterAIController>& Controller : Controllers)
+	{
+		Controller->GetStateTreeAI()->SetComponentTickEnabled(!bEnabled);
+	}
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Shooter AI batching %s for %d controllers"), bEnabled ? TEXT("enabled") : TEXT("disabled"), Controllers.Num());
+}
+
+void UShooterAIBatchSubsystem::GatherLineOfSightRequests()
+{
+	RequestControllers.Reset();
+	LineOfSightRequests.Reset();
+
+	for (const TWeakObjectPtr<AShooterAIController>& Controller : Controllers)
+	{
+		const AShooterNPC* NPC = Cast<AShooterNPC>(Controller->GetPawn());
+		const AActor* Target = Controller->GetCurrentTarget();
+
+		if (!NPC || !IsValid(Target))
+		{
+			continue;
+		}
+
+		FShooterAILineOfSightRequest& Request = LineOfSightRequests.AddDefaulted_GetRef();
+		RequestControllers.Add(Controller);
+
+		FVector Extent;
+		Target->GetActorBounds(true, Request.TargetCenter, Extent, false);
+
+		Request.Start = NPC->GetPawnViewLocation();
+		Request.TargetExtentZ = Extent.Z;
+		Request.QueryParams.AddIgnoredActor(NPC);
+		Request.QueryParams.AddIgnoredActor(Target);
+
+		// the visibility lookups aren't thread safe, so do them here instead of on the workers
+		Request.TraceChannel = UShooterVisibilitySubsystem::GetTraceChannel(GetWorld());
+		Request.bPotentiallyVisible = UShooterVisibilitySubsystem::CanPossiblySee(GetWorld(), Request.Start, Request.TargetCenter);
+	}
+}
+
+void UShooterAIBatchSubsystem::TraceLineOfSightRequests(int32 NumChunks)
+{
+	const int32 NumRequests = LineOfSightRequests.Num();
+
+	if (NumRequests == 0)
+	{
+		return;
+	}
+
+	if (NumChunks <= 0)
+	{
+		ParallelFor(NumRequests, [this](int32 Index)
+		{
+			TraceLineOfSight(LineOfSightRequests[Index]);
+
+		}, NumRequests < ShooterAIBatch::MinParallelRequests ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+		return;
+	}
+
+	// split into a fixed number of chunks, so at most that many workers run at once
+	NumChunks = FMath::Min(NumChunks, NumRequests);
+	const int32 ChunkSize = FMath::DivideAndRoundUp(NumRequests, NumChunks);
+
+	ParallelFor(NumChunks, [this, ChunkSize, NumRequests](int32 ChunkIndex)
+	{
+		const int32 First = ChunkIndex * ChunkSize;
+		const int32 Last = FMath::Min(First + ChunkSize, NumRequests);
+
+		for (int32 i = First; i < Last; ++i)
+		{
+			TraceLineOfSight(LineOfSightRequests[i]);
+		}
+
+	}, NumChunks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced);
+}
+
+void UShooterAIBatchSubsystem::TraceLineOfSight(FShooterAILineOfSightRequest& Request) const
+{
+	if (!Request.bPotentiallyVisible)
+	{
+		Request.bClear = false;
+		return;
+	}
+
+	const float ExtentZOffset = Request.TargetExtentZ * 2.0f / ShooterAIBatch::NumLineOfSightChecks;
+
+	FHitResult OutHit;
+
+	// run a number of vertically offset line traces to the target, same as the line of sight condition
+	for (int32 i = 0; i < ShooterAIBatch::NumLineOfSightChecks; ++i)
+	{
+		const FVector End = Request.TargetCenter + FVector(0.0f, 0.0f, Request.TargetExtentZ - ExtentZOffset * i);
+
+		if (!GetWorld()->LineTraceSingleByChannel(OutHit, Request.Start, End, Request.TraceChannel, Request.QueryParams))
+		{
+			Request.bClear = true;
+			return;
+		}
+	}
+
+	Request.bClear = false;
+}
+
+void UShooterAIBatchSubsystem::SubmitCommand(const UWorld* World, FShooterAICommand&& Command)
+{
+	UShooterAIBatchSubsystem* Batch = World ? World->GetSubsystem<UShooterAIBatchSubsystem>() : nullptr;
+
+	// not batching, so apply right away
+	if (!Batch || !Batch->IsBatching())
+	{
+		ApplyCommand(Command);
+		return;
+	}
+
+	FScopeLock Lock(&Batch->CommandLock);
+	Batch->PendingCommands.Add(MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::SetFocus(AAIController* Controller, AActor* Actor)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::SetFocus;
+	Command.Controller = Controller;
+	Command.Actor = Actor;
+
+	SubmitCommand(Controller->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::SetFocalPoint(AAIController* Controller, const FVector& Location)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::SetFocalPoint;
+	Command.Controller = Controller;
+	Command.Location = Location;
+
+	SubmitCommand(Controller->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::ClearFocus(AAIController* Controller)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::ClearFocus;
+	Command.Controller = Controller;
+
+	SubmitCommand(Controller->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::StartShooting(AShooterNPC* Character, AActor* Target)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::StartShooting;
+	Command.Character = Character;
+	Command.Actor = Target;
+
+	SubmitCommand(Character->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::StopShooting(AShooterNPC* Character)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::StopShooting;
+	Command.Character = Character;
+
+	SubmitCommand(Character->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::MoveToLocation(AAIController* Controller, const FVector& Location, float AcceptanceRadius)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::MoveToLocation;
+	Command.Controller = Controller;
+	Command.Location = Location;
+	Command.AcceptanceRadius = AcceptanceRadius;
+
+	SubmitCommand(Controller->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::StopMovement(AAIController* Controller)
+{
+	FShooterAICommand Command;
+	Command.Type = EShooterAICommandType::StopMovement;
+	Command.Controller = Controller;
+
+	SubmitCommand(Controller->GetWorld(), MoveTemp(Command));
+}
+
+void UShooterAIBatchSubsystem::FlushCommands()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAIBatchCommands);
+
+	TArray<FShooterAICommand> Commands;
+
+	{
+		FScopeLock Lock(&CommandLock);
+		Commands = MoveTemp(PendingCommands);
+	}
+
+	// apply in the order they were emitted, so a stop followed by a start in the same frame behaves as expected
+	for (const FShooterAICommand& Command : Commands)
+	{
+		ApplyCommand(Command);
+	}
+
+	SET_DWORD_STAT(STAT_ShooterAIBatchCommandsApplied, Commands.Num());
+}
+
+void UShooterAIBatchSubsystem::ApplyCommand(const FShooterAICommand& Command)
+{
+	AAIController* Controller = Command.Controller.Get();
+	AShooterNPC* Character = Command.Character.Get();
+
+	switch (Command.Type)
+	{
+	case EShooterAICommandType::SetFocus:
+		if (Controller)
+		{
+			Controller->SetFocus(Command.Actor.Get());
+		}
+		break;
+
+	case EShooterAICommandType::SetFocalPoint:
+		if (Controller)
+		{
+			Controller->SetFocalPoint(Command.Location);
+		}
+		break;
+
+	case EShooterAICommandType::ClearFocus:
+		if (Controller)
+		{
+			Controller->ClearFocus(EAIFocusPriority::Gameplay);
+		}
+		break;
+
+	case EShooterAICommandType::StartShooting:
+		if (IsValid(Character))
+		{
+			Character->StartShooting(Command.Actor.Get());
+		}
+		break;
+
+	case EShooterAICommandType::StopShooting:
+		if (IsValid(Character))
+		{
+			Character->StopShooting();
+		}
+		break;
+
+	case EShooterAICommandType::MoveToLocation:
+		if (Controller)
+		{
+			Controller->MoveToLocation(Command.Location, Command.AcceptanceRadius);
+		}
+		break;
+
+	case EShooterAICommandType::StopMovement:
+		if (Controller)
+		{
+			Controller->StopMovement();
+		}
+		break;
+	}
+}
+
+namespace ShooterAIBatch
+{
+	/** Times the parallel line of sight pass at increasing core counts */
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UShooterAIBatchSubsystem* Batch = World ? World->GetSubsystem<UShooterAIBatchSubsystem>() : nullptr;
+
+		if (!Batch)
+		{
+			Ar.Log(TEXT("Shooter.AI.Benchmark must be run in a game world"));
+			return;
+		}
+
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 20;
+
+		Batch->GatherLineOfSightRequests();
+
+		if (Batch->GetNumLineOfSightRequests() == 0)
+		{
+			Ar.Log(TEXT("No NPCs with a target to benchmark. Let them spot the player first"));
+			return;
+		}
+
+		// double the cores each step, finishing with every worker plus the game thread
+		const int32 MaxChunks = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+
+		TArray<int32> CoreCounts;
+
+		for (int32 NumChunks = 1; NumChunks < MaxChunks; NumChunks *= 2)
+		{
+			CoreCounts.Add(NumChunks);
+		}
+
+		CoreCounts.Add(MaxChunks);
+
+		double SingleCoreTime = 0.0;
+
+		Ar.Logf(TEXT("Line of sight for %d NPCs, %d iterations"), Batch->GetNumLineOfSightRequests(), Iterations);
+
+		for (const int32 NumChunks : CoreCounts)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+
+			for (int32 i = 0; i < Iterations; ++i)
+			{
+				Batch->TraceLineOfSightRequests(NumChunks);
+			}
+
+			const double AverageTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+			if (NumChunks == 1)
+			{
+				SingleCoreTime = AverageTime;
+			}
+
+			Ar.Logf(TEXT("  %2d cores: %.3f ms (%.2fx)"), NumChunks, AverageTime, AverageTime > 0.0 ? SingleCoreTime / AverageTime : 0.0);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchmarkCommand(
+		TEXT("Shooter.AI.Benchmark"),
+		TEXT("Times the batched AI line of sight pass from 1 to N cores. Usage: Shooter.AI.Benchmark [Iterations]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&RunBenchmark));
+}
@@ -0,0 +1,161 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CollisionQueryParams.h"
+#include "ShooterAIBatch.generated.h"
+
+class AAIController;
+class AShooterAIController;
+class AShooterNPC;
+
+/**
+ *  Types of deferred AI commands
+ */
+enum class EShooterAICommandType : uint8
+{
+	SetFocus,
+	SetFocalPoint,
+	ClearFocus,
+	StartShooting,
+	StopShooting,
+	MoveToLocation,
+	StopMovement
+};
+
+/**
+ *  An AI command emitted by a StateTree task and applied later on the game thread
+ */
+struct FShooterAICommand
+{
+	/** Command type */
+	EShooterAICommandType Type = EShooterAICommandType::ClearFocus;
+
+	/** Controller the command applies to */
+	TWeakObjectPtr<AAIController> Controller;
+
+	/** NPC the command applies to, for shooting commands */
+	TWeakObjectPtr<AShooterNPC> Character;
+
+	/** Actor parameter, if any */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Location parameter, if any */
+	FVector Location = FVector::ZeroVector;
+
+	/** Acceptance radius for move commands */
+	float AcceptanceRadius = 0.0f;
+};
+
+/**
+ *  Line of sight snapshot for one NPC, gathered on the game thread and traced on worker threads
+ */
+struct FShooterAILineOfSightRequest
+{
+	/** NPC eye location */
+	FVector Start = FVector::ZeroVector;
+
+	/** Target bounds center */
+	FVector TargetCenter = FVector::ZeroVector;
+
+	/** Target bounds half height */
+	float TargetExtentZ = 0.0f;
+
+	/** Ignores the NPC and its target */
+	FCollisionQueryParams QueryParams;
+
+	/** Channel to trace on */
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** False if the baked visibility data says the target can't be seen from here, so no traces are needed */
+	bool bPotentiallyVisible = true;
+
+	/** Output. True if any trace reached the target */
+	bool bClear = false;
+};
+
+/**
+ *  Batches shooter AI updates
+ *  When Shooter.AI.Batch is enabled, the line of sight checks for all NPCs are traced in parallel from snapshots,
+ *  the StateTrees are ticked from here and the commands they emit are applied to the actors in a single pass
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterAIBatchSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Registered AI controllers */
+	TArray<TWeakObjectPtr<AShooterAIController>> Controllers;
+
+	/** Controllers matching the line of sight requests for this frame */
+	TArray<TWeakObjectPtr<AShooterAIController>> RequestControllers;
+
+	/** Per-frame line of sight requests, kept around to avoid reallocating */
+	TArray<FShooterAILineOfSightRequest> LineOfSightRequests;
+
+	/** Commands waiting to be applied */
+	TArray<FShooterAICommand> PendingCommands;
+
+	/** Guards the pending commands so tasks may emit from any thread */
+	FCriticalSection CommandLock;
+
+	/** True if the StateTrees are currently ticked by this subsystem */
+	bool bBatching = false;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Runs the batched AI update */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Adds a controller to the batch */
+	void RegisterController(AShooterAIController* Controller);
+
+	/** Removes a controller from the batch */
+	void UnregisterController(AShooterAIController* Controller);
+
+	/** Returns true if AI commands are currently deferred */
+	bool IsBatching() const { return bBatching; };
+
+	/** Queues a command, or applies it right away if not batching */
+	static void SubmitCommand(const UWorld* World, FShooterAICommand&& Command);
+
+	/** Command helpers for StateTree tasks */
+	static void SetFocus(AAIController* Controller, AActor* Actor);
+	static void SetFocalPoint(AAIController* Controller, const FVector& Location);
+	static void ClearFocus(AAIController* Controller);
+	static void StartShooting(AShooterNPC* Character, AActor* Target);
+	static void StopShooting(AShooterNPC* Character);
+	static void MoveToLocation(AAIController* Controller, const FVector& Location, float AcceptanceRadius);
+	static void StopMovement(AAIController* Controller);
+
+	/** Gathers the line of sight snapshots for all registered controllers with a target */
+	void GatherLineOfSightRequests();
+
+	/** Traces the gathered requests split into the given number of parallel chunks. Zero lets the task graph decide */
+	void TraceLineOfSightRequests(int32 NumChunks = 0);
+
+	/** Returns the number of gathered line of sight requests */
+	int32 GetNumLineOfSightRequests() const { return LineOfSightRequests.Num(); };
+
+protected:
+
+	/** Enables or disables component ticking on the registered StateTrees */
+	void SetBatching(bool bEnabled);
+
+	/** Traces a single line of sight request. Only reads the physics scene, so it's safe on worker threads */
+	void TraceLineOfSight(FShooterAILineOfSightRequest& Request) const;
+
+	/** Applies all pending commands */
+	void FlushCommands();
+
+	/** Applies a single command */
+	static void ApplyCommand(const FShooterAICommand& Command);
+};
@@ -3,10 +3,27 @@
 
 #include "Variant_Shooter/AI/ShooterAIController.h"
 #include "ShooterNPC.h"
+#include "ShooterTeamKnowledge.h"
+#include "ShooterAIBatch.h"
+#include "ShooterSightSense.h"
+#include "ShooterNoise.h"
 #include "Components/StateTreeAIComponent.h"
 #include "Perception/AIPerceptionComponent.h"
+#include "Perception/AISense_Sight.h"
+#include "Perception/AISenseConfig_Sight.h"
+#include "Perception/AISenseConfig_Hearing.h"
 #include "Navigation/PathFollowingComponent.h"
 #include "AI/Navigation/PathFollowingAgentInterface.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+namespace ShooterTeamFilter
+{
+	/** Non-hostile stimuli that still reached a controller since the last reset */
+	static int32 NonHostileStimuliDelivered = 0;
+}
 
 AShooterAIController::AShooterAIController()
 {
@@ -31,8 +48,28 @@ void AShooterAIController::OnPossess(APawn* InPawn)
 		// add the team tag to the pawn
 		NPC->Tags.Add(TeamTag);
 
+		// take the team from the pawn so perception can filter by affiliation
+		SetGenericTeamId(NPC->GetGenericTeamId());
+
+		if (bOnlySenseEnemies)
+		{
+			ConfigureSenseAffiliation();
+		}
+
 		// subscribe to the pawn's OnDeath delegate
 		NPC->OnPawnDeath.AddDynamic(this, &AShooterAIController::OnPawnDeath);
+
+		// join the batched AI update
+		if (UShooterAIBatchSubsystem* Batch = GetWorld()->GetSubsystem<UShooterAIBatchSubsystem>())
+		{
+			Batch->RegisterController(this);
+		}
+
+		// listen for aggregated noises
+		if (UShooterNoiseSubsystem* Noise = GetWorld()->GetSubsystem<UShooterNoiseSubsystem>())
+		{
+			Noise->RegisterListener(this);
+		}
 	}
 }
 
@@ -44,6 +81,18 @@ void AShooterAIController::OnPawnDeath()
 	// stop StateTree logic
 	StateTreeAI->StopLogic(FString(""));
 
+	// leave the batched AI update
+	if (UShooterAIBatchSubsystem* Batch = GetWorld()->GetSubsystem<UShooterAIBatchSubsystem>())
+	{
+		Batch->UnregisterController(this);
+	}
+
+	// stop listening for aggregated noises
+	if (UShooterNoiseSubsystem* Noise = GetWorld()->GetSubsystem<UShooterNoiseSubsystem>())
+	{
+		Noise->UnregisterListener(this);
+	}
+
 	// unpossess the pawn
 	UnPossess();
 
@@ -51,6 +100,84 @@ void AShooterAIController::OnPawnDeath()
 	Destroy();
 }
 
+void AShooterAIController::ConfigureSenseAffiliation()
+{
+	FAISenseAffiliationFilter EnemiesOnly;
+	EnemiesOnly.bDetectEnemies = true;
+	EnemiesOnly.bDetectNeutrals = false;
+	EnemiesOnly.bDetectFriendlies = false;
+
+	// the sense configs are set up in BP, so override their affiliation here
+	for (auto It = AIPerception->GetSensesConfigIterator(); It; ++It)
+	{
+		if (UAISenseConfig_Sight* SightConfig = Cast<UAISenseConfig_Sight>(*It))
+		{
+			SightConfig->DetectionByAffiliation = EnemiesOnly;
+
+		} else if (UAISenseConfig_Hearing* HearingConfig = Cast<UAISenseConfig_Hearing>(*It)) {
+
+			HearingConfig->DetectionByAffiliation = EnemiesOnly;
+
+		} else if (UAISenseConfig_ShooterSight* ShooterSightConfig = Cast<UAISenseConfig_ShooterSight>(*It)) {
+
+			ShooterSightConfig->DetectionByAffiliation = EnemiesOnly;
+		}
+	}
+
+	// let the perception system pick up the new team and filters
+	AIPerception->RequestStimuliListenerUpdate();
+}
+
+void AShooterAIController::SetDormant(bool bDormant)
+{
+	UShooterAIBatchSubsystem* Batch = GetWorld()->GetSubsystem<UShooterAIBatchSubsystem>();
+	UShooterNoiseSubsystem* Noise = GetWorld()->GetSubsystem<UShooterNoiseSubsystem>();
+
+	if (bDormant)
+	{
+		// stop movement and StateTree logic
+		GetPathFollowingComponent()->AbortMove(*this, FPathFollowingResultFlags::UserAbort);
+		StateTreeAI->StopLogic(FString("Dormant"));
+
+		// forget everything we knew
+		ClearCurrentTarget();
+		AIPerception->ForgetAll();
+
+		// leave the batched AI update and noise aggregation
+		if (Batch)
+		{
+			Batch->UnregisterController(this);
+		}
+
+		if (Noise)
+		{
+			Noise->UnregisterListener(this);
+		}
+
+	} else {
+
+		// rejoin the batched AI update and noise aggregation
+		if (Batch)
+		{
+			Batch->RegisterController(this);
+		}
+
+		if (Noise)
+		{
+			Noise->RegisterListener(this);
+		}
+
+		// start the StateTree from the beginning
+		StateTreeAI->RestartLogic();
+	}
+
+	// dormant controllers don't need the perception system to update them
+	for (auto It = AIPerception->GetSensesConfigIterator(); It; ++It)
+	{
+		AIPerception->SetSenseEnabled((*It)->GetSenseImplementation(), !bDormant);
+	}
+}
+
 void AShooterAIController::SetCurrentTarget(AActor* Target)
 {
 	TargetEnemy = Target;
@@ -63,12 +190,96 @@ void AShooterAIController::ClearCurrentTarget()
 
 void AShooterAIController::OnPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus)
 {
+	// merge the perception into the shared team knowledge
+	const AShooterNPC* NPC = Cast<AShooterNPC>(GetPawn());
+	UShooterTeamKnowledgeSubsystem* TeamKnowledge = GetWorld()->GetSubsystem<UShooterTeamKnowledgeSubsystem>();
+
+	const bool bHostile = Actor && GetTeamAttitudeTowards(*Actor) == ETeamAttitude::Hostile;
+
+	// the senses should have filtered these out already
+	if (!bHostile)
+	{
+		++ShooterTeamFilter::NonHostileStimuliDelivered;
+	}
+
+	if (NPC && TeamKnowledge && bHostile)
+	{
+		// the sight senses already trace for visibility, so a successful sight stimulus counts as direct line of sight
+		const bool bDirectLineOfSight = Stimulus.WasSuccessfullySensed()
+			&& (Stimulus.Type == UAISense::GetSenseID<UAISense_Sight>() || Stimulus.Type == UAISense::GetSenseID<UAISense_ShooterSight>());
+
+		TeamKnowledge->ReportEnemySensed(NPC->GetTeamByte(), this, Actor, Stimulus.StimulusLocation, Stimulus.Strength, bDirectLineOfSight);
+
+		// a failed sight stimulus means this member just lost sight
+		if (!Stimulus.WasSuccessfullySensed() && (Stimulus.Type == UAISense::GetSenseID<UAISense_Sight>() || Stimulus.Type == UAISense::GetSenseID<UAISense_ShooterSight>()))
+		{
+			TeamKnowledge->ReportEnemyLost(NPC->GetTeamByte(), this, Actor);
+		}
+	}
+
 	// pass the data to the StateTree delegate hook
 	OnShooterPerceptionUpdated.ExecuteIfBound(Actor, Stimulus);
 }
 
 void AShooterAIController::OnPerceptionForgotten(AActor* Actor)
 {
+	// let the team knowledge know this member lost track of the actor
+	const AShooterNPC* NPC = Cast<AShooterNPC>(GetPawn());
+	UShooterTeamKnowledgeSubsystem* TeamKnowledge = GetWorld()->GetSubsystem<UShooterTeamKnowledgeSubsystem>();
+
+	if (NPC && TeamKnowledge)
+	{
+		TeamKnowledge->ReportEnemyForgotten(NPC->GetTeamByte(), this, Actor);
+	}
+
 	// pass the data to the StateTree delegate hook
 	OnShooterPerceptionForgotten.ExecuteIfBound(Actor);
 }
+
+namespace ShooterTeamFilter
+{
+	/** Logs how many perception pairs the affiliation filter removes */
+	static void ReportTeamFilter(const TArray<FString>& Args, UWorld* World)
+	{
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			NonHostileStimuliDelivered = 0;
+			return;
+		}
+
+		int32 NumListeners = 0;
+		int32 HostilePairs = 0;
+		int32 FilteredPairs = 0;
+
+		// every pawn is a sight source, so each non-hostile listener/pawn pair is a query the sight sense no longer runs
+		for (TActorIterator<AShooterAIController> ControllerIt(World); ControllerIt; ++ControllerIt)
+		{
+			++NumListeners;
+
+			for (TActorIterator<APawn> PawnIt(World); PawnIt; ++PawnIt)
+			{
+				if (*PawnIt == ControllerIt->GetPawn())
+				{
+					continue;
+				}
+
+				if (ControllerIt->GetTeamAttitudeTowards(**PawnIt) == ETeamAttitude::Hostile)
+				{
+					++HostilePairs;
+
+				} else {
+
+					++FilteredPairs;
+				}
+			}
+		}
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Team filter: %d listeners, %d hostile pairs sensed, %d friendly or neutral pairs filtered per sight update"), NumListeners, HostilePairs, FilteredPairs);
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Team filter: %d non-hostile stimuli delivered since the last reset"), NonHostileStimuliDelivered);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Shooter.AI.TeamFilter"),
+		TEXT("Logs the perception pairs eliminated by team affiliation and any non-hostile stimuli that still got through. Pass 'reset' to clear the delivered count"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportTeamFilter));
+}
@@ -35,6 +35,10 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Shooter")
 	FName TeamTag = FName("Enemy");
 
+	/** If true, the perception senses are set to only detect hostile actors, so friendly stimuli are never generated */
+	UPROPERTY(EditAnywhere, Category="Shooter")
+	bool bOnlySenseEnemies = true;
+
 	/** Enemy currently being targeted */
 	TObjectPtr<AActor> TargetEnemy;
 
@@ -62,6 +66,9 @@ protected:
 	UFUNCTION()
 	void OnPawnDeath();
 
+	/** Sets the detection by affiliation on all perception senses to enemies only */
+	void ConfigureSenseAffiliation();
+
 public:
 
 	/** Sets the targeted enemy */
@@ -70,9 +77,18 @@ public:
 	/** Clears the targeted enemy */
 	void ClearCurrentTarget();
 
+	/** Stops or resumes the StateTree, perception and batched updates while the pawn is parked in the dormant actor pool */
+	void SetDormant(bool bDormant);
+
 	/** Returns the targeted enemy */
 	AActor* GetCurrentTarget() const { return TargetEnemy; };
 
+	/** Returns the AI perception component */
+	UAIPerceptionComponent* GetShooterPerception() const { return AIPerception; };
+
+	/** Returns the StateTree component */
+	UStateTreeAIComponent* GetStateTreeAI() const { return StateTreeAI; };
+
 protected:
 
 	/** Called when the AI perception component updates a perception on a given actor */
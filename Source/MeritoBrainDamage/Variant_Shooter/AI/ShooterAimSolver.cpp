@@ -0,0 +1,166 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAimSolver.h"
+#include "ShooterNPC.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Aim Solver"), STAT_ShooterAimSolver, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aim Solver NPCs"), STAT_ShooterAimSolverNPCs, STATGROUP_Shooter);
+
+namespace ShooterAimSolver
+{
+	/** Below this many requests the solve runs on the game thread, as task overhead would outweigh the work */
+	static constexpr int32 MinParallelRequests = 16;
+}
+
+bool UShooterAimSolverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterAimSolverSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAimSolverSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterAimSolverSubsystem::RegisterShooter(AShooterNPC* Shooter)
+{
+	Shooters.AddUnique(Shooter);
+}
+
+void UShooterAimSolverSubsystem::UnregisterShooter(AShooterNPC* Shooter)
+{
+	Shooters.RemoveSwap(Shooter);
+}
+
+void UShooterAimSolverSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAimSolver);
+
+	// drop any NPCs that were destroyed while registered
+	Shooters.RemoveAllSwap([](const TWeakObjectPtr<AShooterNPC>& Shooter) { return !Shooter.IsValid(); });
+
+	// only solve the NPCs whose weapon is going to use the aim. Out of ammo, dead or dormant NPCs are left out
+	ActiveShooters.Reset();
+
+	for (const TWeakObjectPtr<AShooterNPC>& Shooter : Shooters)
+	{
+		if (Shooter->IsFiringWeapon())
+		{
+			ActiveShooters.Add(Shooter.Get());
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterAimSolverNPCs, ActiveShooters.Num());
+
+	if (ActiveShooters.Num() == 0)
+	{
+		return;
+	}
+
+	// gather the snapshots on the game thread
+	Requests.SetNum(ActiveShooters.Num(), EAllowShrinking::No);
+	Results.SetNum(ActiveShooters.Num(), EAllowShrinking::No);
+
+	for (int32 i = 0; i < ActiveShooters.Num(); ++i)
+	{
+		ActiveShooters[i]->FillAimRequest(Requests[i]);
+	}
+
+	// solve every NPC in parallel. Requests only hold plain data, so this is safe off the game thread
+	ParallelFor(Requests.Num(), [this](int32 Index)
+	{
+		Results[Index] = SolveAim(Requests[Index]);
+
+	}, Requests.Num() < ShooterAimSolver::MinParallelRequests ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	// hand the results back to the NPCs
+	for (int32 i = 0; i < ActiveShooters.Num(); ++i)
+	{
+		ActiveShooters[i]->ApplyAimResult(Results[i], Requests[i].RandomStream);
+	}
+}
+
+FShooterAimResult UShooterAimSolverSubsystem::SolveAim(FShooterAimRequest& Request)
+{
+	FShooterAimResult Result;
+
+	FVector AimDir;
+	float AimDistance = Request.AimRange;
+
+	if (Request.bHasTarget)
+	{
+		FVector AimTarget = Request.TargetLocation;
+
+		// lead the target by the projectile flight time
+		if (Request.ProjectileSpeed > 0.0f)
+		{
+			const float InterceptTime = CalculateInterceptTime(Request.Source, Request.TargetLocation, Request.TargetVelocity, Request.ProjectileSpeed);
+
+			if (InterceptTime > 0.0f)
+			{
+				AimTarget += Request.TargetVelocity * InterceptTime;
+			}
+		}
+
+		// apply a vertical offset to target head/feet
+		AimTarget.Z += Request.RandomStream.FRandRange(Request.MinOffsetZ, Request.MaxOffsetZ);
+
+		// get the aim direction and apply randomness in a cone
+		const FVector ToTarget = AimTarget - Request.Source;
+		AimDir = Request.RandomStream.VRandCone(ToTarget.GetSafeNormal(), FMath::DegreesToRadians(Request.VarianceHalfAngle));
+
+		// with clear line of sight we can aim straight at the target distance and skip the obstruction trace
+		if (Request.bHasLineOfSight)
+		{
+			AimDistance = FMath::Min(ToTarget.Size(), Request.AimRange);
+			Result.bSkipTrace = true;
+		}
+
+	} else {
+
+		// no aim target, so just use the aim facing
+		AimDir = Request.RandomStream.VRandCone(Request.Forward, FMath::DegreesToRadians(Request.VarianceHalfAngle));
+	}
+
+	Result.AimPoint = Request.Source + AimDir * AimDistance;
+
+	return Result;
+}
+
+float UShooterAimSolverSubsystem::CalculateInterceptTime(const FVector& Source, const FVector& TargetLocation, const FVector& TargetVelocity, float ProjectileSpeed)
+{
+	// solve |D + V * t| = S * t for the smallest positive t
+	const FVector D = TargetLocation - Source;
+
+	const double A = TargetVelocity.SizeSquared() - FMath::Square(ProjectileSpeed);
+	const double B = 2.0 * FVector::DotProduct(D, TargetVelocity);
+	const double C = D.SizeSquared();
+
+	// target and projectile move at the same speed, so the equation is linear
+	if (FMath::IsNearlyZero(A))
+	{
+		return B < 0.0 ? float(-C / B) : -1.0f;
+	}
+
+	const double Discriminant = B * B - 4.0 * A * C;
+
+	if (Discriminant < 0.0)
+	{
+		return -1.0f;
+	}
+
+	const double SqrtDiscriminant = FMath::Sqrt(Discriminant);
+	const double T1 = (-B - SqrtDiscriminant) / (2.0 * A);
+	const double T2 = (-B + SqrtDiscriminant) / (2.0 * A);
+
+	if (T1 > 0.0 && T2 > 0.0)
+	{
+		return float(FMath::Min(T1, T2));
+	}
+
+	return float(FMath::Max(T1, T2));
+}
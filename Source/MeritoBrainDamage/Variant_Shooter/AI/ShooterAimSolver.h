@@ -0,0 +1,105 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterRandom.h"
+#include "ShooterAimSolver.generated.h"
+
+class AShooterNPC;
+
+/**
+ *  Snapshot of everything needed to solve one NPC's aim, gathered on the game thread
+ */
+struct FShooterAimRequest
+{
+	/** Eye location the NPC aims from */
+	FVector Source = FVector::ZeroVector;
+
+	/** Current aim facing, used when there's no target */
+	FVector Forward = FVector::ForwardVector;
+
+	/** Current target location */
+	FVector TargetLocation = FVector::ZeroVector;
+
+	/** Current target velocity */
+	FVector TargetVelocity = FVector::ZeroVector;
+
+	/** Speed of the projectiles shot by the NPC's weapon. Zero disables leading */
+	float ProjectileSpeed = 0.0f;
+
+	/** Max range for aiming */
+	float AimRange = 10000.0f;
+
+	/** Cone half angle for aim variance, in degrees */
+	float VarianceHalfAngle = 0.0f;
+
+	/** Vertical aim offset range */
+	float MinOffsetZ = 0.0f;
+	float MaxOffsetZ = 0.0f;
+
+	/** True if the NPC has a target */
+	bool bHasTarget = false;
+
+	/** True if the NPC's cached line of sight to the target is recent and clear */
+	bool bHasLineOfSight = false;
+
+	/** Copy of the NPC's random stream. The advanced copy is only kept if a shot uses the solved aim */
+	FShooterRandomStream RandomStream;
+};
+
+/**
+ *  Solved aim for one NPC
+ */
+struct FShooterAimResult
+{
+	/** Point to aim the weapon at */
+	FVector AimPoint = FVector::ZeroVector;
+
+	/** If true, line of sight is already known to be clear and no obstruction trace is needed */
+	bool bSkipTrace = false;
+};
+
+/**
+ *  Solves lead aim points for every shooting NPC in a single parallel pass per frame
+ *  NPCs register while shooting and read back their solved aim point when their weapon fires
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterAimSolverSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** NPCs currently shooting */
+	TArray<TWeakObjectPtr<AShooterNPC>> Shooters;
+
+	/** Registered NPCs with a shot pending this frame */
+	TArray<AShooterNPC*> ActiveShooters;
+
+	/** Per-frame request and result buffers, kept around to avoid reallocating */
+	TArray<FShooterAimRequest> Requests;
+	TArray<FShooterAimResult> Results;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Solves all registered NPCs */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Adds an NPC to the solver */
+	void RegisterShooter(AShooterNPC* Shooter);
+
+	/** Removes an NPC from the solver */
+	void UnregisterShooter(AShooterNPC* Shooter);
+
+	/** Solves a single aim request. Thread safe */
+	static FShooterAimResult SolveAim(FShooterAimRequest& Request);
+
+	/** Returns the time until a projectile at the given speed intercepts a target. Negative if it can't */
+	static float CalculateInterceptTime(const FVector& Source, const FVector& TargetLocation, const FVector& TargetVelocity, float ProjectileSpeed);
+};
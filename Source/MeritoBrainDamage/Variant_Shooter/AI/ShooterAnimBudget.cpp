@@ -0,0 +1,425 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterAnimBudget.h"
+#include "ShooterNPC.h"
+#include "Animation/AnimSequence.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Anim Budget Allocation"), STAT_ShooterAnimAllocation, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Anim Budget Instances"), STAT_ShooterAnimInstances, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Full Anim NPCs"), STAT_ShooterAnimFull, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared Anim NPCs"), STAT_ShooterAnimShared, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Instanced Anim NPCs"), STAT_ShooterAnimInstanced, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Leaders"), STAT_ShooterAnimLeaders, STATGROUP_Shooter);
+
+namespace ShooterAnimBudget
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.Anim.Budget"),
+		true,
+		TEXT("If true, only the most significant NPCs evaluate their own animation. The rest share leader poses or are drawn as vertex animated instances."),
+		ECVF_Default);
+}
+
+bool UShooterAnimBudgetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterAnimBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAnimBudgetSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterAnimBudgetSubsystem::Deinitialize()
+{
+	NPCs.Reset();
+	Leaders.Reset();
+	Batches.Reset();
+	ProxyActor = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UShooterAnimBudgetSubsystem::RegisterNPC(AShooterNPC* NPC)
+{
+	if (IsValid(NPC))
+	{
+		NPCs.AddUnique(NPC);
+	}
+}
+
+void UShooterAnimBudgetSubsystem::UnregisterNPC(AShooterNPC* NPC)
+{
+	NPCs.RemoveSwap(NPC);
+}
+
+void UShooterAnimBudgetSubsystem::Tick(float DeltaTime)
+{
+	AllocationTimer -= DeltaTime;
+
+	if (AllocationTimer <= 0.0f)
+	{
+		AllocationTimer = AllocationInterval;
+
+		AllocateModes();
+	}
+
+	UpdateFollowers();
+	UpdateInstances();
+
+	SET_DWORD_STAT(STAT_ShooterAnimFull, NumFull);
+	SET_DWORD_STAT(STAT_ShooterAnimShared, NumShared);
+	SET_DWORD_STAT(STAT_ShooterAnimInstanced, NumInstanced);
+	SET_DWORD_STAT(STAT_ShooterAnimLeaders, Leaders.Num());
+}
+
+void UShooterAnimBudgetSubsystem::AllocateModes()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAnimAllocation);
+
+	NumFull = NumShared = NumInstanced = 0;
+
+	// gather the player views
+	TArray<TPair<FVector, FVector>, TInlineAllocator<4>> Views;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			Views.Emplace(ViewLocation, ViewRotation.Vector());
+		}
+	}
+
+	// rank the NPCs by significance: closer is more significant, on screen counts more than off screen
+	struct FCandidate
+	{
+		AShooterNPC* NPC;
+		float Significance;
+		float DistanceSquared;
+	};
+
+	TArray<FCandidate> Candidates;
+	Candidates.Reserve(NPCs.Num());
+
+	for (int32 i = NPCs.Num() - 1; i >= 0; --i)
+	{
+		AShooterNPC* NPC = NPCs[i].Get();
+
+		if (!NPC)
+		{
+			NPCs.RemoveAtSwap(i);
+			continue;
+		}
+
+		// dead NPCs ragdoll and dormant ones are hidden, both keep their own mesh
+		if (NPC->IsDead() || NPC->IsDormant())
+		{
+			continue;
+		}
+
+		FCandidate& Candidate = Candidates.Add_GetRef({ NPC, 0.0f, TNumericLimits<float>::Max() });
+
+		for (const TPair<FVector, FVector>& View : Views)
+		{
+			const FVector ToNPC = NPC->GetActorLocation() - View.Key;
+			const float DistanceSquared = ToNPC.SizeSquared();
+			const bool bOnScreen = FVector::DotProduct(ToNPC.GetSafeNormal(), View.Value) >= OnScreenCosine;
+
+			Candidate.DistanceSquared = FMath::Min(Candidate.DistanceSquared, DistanceSquared);
+			Candidate.Significance = FMath::Max(Candidate.Significance, (bOnScreen ? 1.0f : OffScreenSignificance) / (1.0f + FMath::Sqrt(DistanceSquared)));
+		}
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.Significance > B.Significance; });
+
+	for (FShooterAnimLeader& Leader : Leaders)
+	{
+		Leader.NumFollowers = 0;
+	}
+
+	const bool bBudgetEnabled = ShooterAnimBudget::CVarEnable.GetValueOnGameThread();
+	const float InstancedDistanceSquared = FMath::Square(InstancedDistance);
+
+	for (const FCandidate& Candidate : Candidates)
+	{
+		AShooterNPC* NPC = Candidate.NPC;
+
+		const bool bCanInstance = NPC->GetVertexAnimationMesh() != nullptr;
+		USkeletalMesh* Mesh = NPC->GetMesh()->GetSkeletalMeshAsset();
+		UAnimSequence* SharedAnimation = NPC->GetSharedAnimation(NPC->GetSharedAnimState());
+
+		EShooterAnimMode Mode = EShooterAnimMode::Full;
+
+		if (bBudgetEnabled)
+		{
+			if (bCanInstance && Candidate.DistanceSquared > InstancedDistanceSquared)
+			{
+				Mode = EShooterAnimMode::Instanced;
+
+			} else if (NumFull >= MaxFullNPCs) {
+
+				// over the full budget, share a pose while there's room, then fall back to instancing
+				if (SharedAnimation && Mesh && (NumShared < MaxSharedNPCs || !bCanInstance))
+				{
+					Mode = EShooterAnimMode::Shared;
+
+				} else if (bCanInstance) {
+
+					Mode = EShooterAnimMode::Instanced;
+				}
+			}
+		}
+
+		switch (Mode)
+		{
+		case EShooterAnimMode::Shared:
+			++NumShared;
+			NPC->SetAnimMode(Mode, FindOrAddLeader(Mesh, SharedAnimation));
+			break;
+
+		case EShooterAnimMode::Instanced:
+			{
+				++NumInstanced;
+				NPC->SetAnimMode(Mode);
+
+				FShooterAnimInstanceBatch& Batch = FindOrAddBatch(NPC->GetVertexAnimationMesh());
+				Batch.NPCs.AddUnique(NPC);
+			}
+			break;
+
+		default:
+			++NumFull;
+			NPC->SetAnimMode(Mode);
+			break;
+		}
+	}
+
+	// leaders without followers stop evaluating
+	for (FShooterAnimLeader& Leader : Leaders)
+	{
+		if (Leader.Component)
+		{
+			Leader.Component->SetComponentTickEnabled(Leader.NumFollowers > 0);
+		}
+	}
+}
+
+void UShooterAnimBudgetSubsystem::UpdateFollowers()
+{
+	// followers change leader as soon as their state changes, without waiting for the next allocation
+	for (const TWeakObjectPtr<AShooterNPC>& WeakNPC : NPCs)
+	{
+		AShooterNPC* NPC = WeakNPC.Get();
+
+		if (!NPC || NPC->GetAnimMode() != EShooterAnimMode::Shared)
+		{
+			continue;
+		}
+
+		UAnimSequence* SharedAnimation = NPC->GetSharedAnimation(NPC->GetSharedAnimState());
+
+		if (SharedAnimation)
+		{
+			NPC->SetAnimMode(EShooterAnimMode::Shared, FindOrAddLeader(NPC->GetMesh()->GetSkeletalMeshAsset(), SharedAnimation));
+		}
+	}
+}
+
+void UShooterAnimBudgetSubsystem::UpdateInstances()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterAnimInstances);
+
+	TArray<int32> ChangedInstances;
+
+	for (FShooterAnimInstanceBatch& Batch : Batches)
+	{
+		// drop the NPCs that left instanced mode
+		const int32 NumRemoved = Batch.NPCs.RemoveAll([&Batch](const TWeakObjectPtr<AShooterNPC>& WeakNPC)
+		{
+			const AShooterNPC* NPC = WeakNPC.Get();
+			return !NPC || NPC->GetAnimMode() != EShooterAnimMode::Instanced || NPC->GetVertexAnimationMesh() != Batch.Mesh;
+		});
+
+		if (!Batch.Component)
+		{
+			continue;
+		}
+
+		// removals shift the instances after them, so rebuild them all
+		if (NumRemoved > 0)
+		{
+			Batch.Component->ClearInstances();
+			Batch.Transforms.Reset();
+			Batch.States.Reset();
+		}
+
+		// add instances for the NPCs that joined since the last update
+		const int32 FirstNew = Batch.Transforms.Num();
+
+		if (Batch.NPCs.Num() > FirstNew)
+		{
+			for (int32 i = FirstNew; i < Batch.NPCs.Num(); ++i)
+			{
+				const AShooterNPC* NPC = Batch.NPCs[i].Get();
+
+				Batch.Transforms.Add(NPC->GetMesh()->GetComponentTransform());
+				Batch.States.Add(NPC->GetSharedAnimState());
+			}
+
+			Batch.Component->AddInstances(TArray<FTransform>(Batch.Transforms.GetData() + FirstNew, Batch.Transforms.Num() - FirstNew), false, true);
+
+			// the vertex animation material picks the clip from the state and offsets it by the phase, which never changes
+			for (int32 i = FirstNew; i < Batch.NPCs.Num(); ++i)
+			{
+				Batch.Component->SetCustomDataValue(i, 0, static_cast<float>(Batch.States[i]), false);
+				Batch.Component->SetCustomDataValue(i, 1, static_cast<float>(Batch.NPCs[i]->GetUniqueID() % 64) / 64.0f, i == Batch.NPCs.Num() - 1);
+			}
+		}
+
+		// only send the instances that moved or changed state
+		ChangedInstances.Reset();
+
+		for (int32 i = 0; i < FirstNew; ++i)
+		{
+			const AShooterNPC* NPC = Batch.NPCs[i].Get();
+			const FTransform& Transform = NPC->GetMesh()->GetComponentTransform();
+			const EShooterAnimState State = NPC->GetSharedAnimState();
+
+			if (!Transform.Equals(Batch.Transforms[i]) || State != Batch.States[i])
+			{
+				Batch.Transforms[i] = Transform;
+				Batch.States[i] = State;
+				ChangedInstances.Add(i);
+			}
+		}
+
+		// the last update marks the render state dirty once for the whole batch
+		for (int32 Changed = 0; Changed < ChangedInstances.Num(); ++Changed)
+		{
+			const int32 Index = ChangedInstances[Changed];
+			const bool bLast = Changed == ChangedInstances.Num() - 1;
+
+			Batch.Component->SetCustomDataValue(Index, 0, static_cast<float>(Batch.States[Index]), false);
+			Batch.Component->UpdateInstanceTransform(Index, Batch.Transforms[Index], true, bLast, true);
+		}
+	}
+}
+
+USkeletalMeshComponent* UShooterAnimBudgetSubsystem::FindOrAddLeader(USkeletalMesh* Mesh, UAnimSequence* Animation)
+{
+	if (FShooterAnimLeader* Leader = Leaders.FindByPredicate([Mesh, Animation](const FShooterAnimLeader& Existing) { return Existing.Mesh == Mesh && Existing.Animation == Animation; }))
+	{
+		// wake a leader that had no followers on the last allocation
+		if (Leader->NumFollowers++ == 0 && Leader->Component)
+		{
+			Leader->Component->SetComponentTickEnabled(true);
+		}
+
+		return Leader->Component;
+	}
+
+	AActor* Owner = GetProxyActor();
+
+	if (!Owner)
+	{
+		return nullptr;
+	}
+
+	// the leader is never drawn, but keeps evaluating for its followers
+	USkeletalMeshComponent* Component = NewObject<USkeletalMeshComponent>(Owner);
+	Component->SetSkeletalMesh(Mesh);
+	Component->SetHiddenInGame(true);
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	Component->SetupAttachment(Owner->GetRootComponent());
+	Component->RegisterComponent();
+	Component->PlayAnimation(Animation, true);
+
+	FShooterAnimLeader& Leader = Leaders.AddDefaulted_GetRef();
+	Leader.Mesh = Mesh;
+	Leader.Animation = Animation;
+	Leader.Component = Component;
+	Leader.NumFollowers = 1;
+
+	return Component;
+}
+
+FShooterAnimInstanceBatch& UShooterAnimBudgetSubsystem::FindOrAddBatch(UStaticMesh* Mesh)
+{
+	if (FShooterAnimInstanceBatch* Batch = Batches.FindByPredicate([Mesh](const FShooterAnimInstanceBatch& Existing) { return Existing.Mesh == Mesh; }))
+	{
+		return *Batch;
+	}
+
+	FShooterAnimInstanceBatch& Batch = Batches.AddDefaulted_GetRef();
+	Batch.Mesh = Mesh;
+
+	if (AActor* Owner = GetProxyActor())
+	{
+		UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(Owner);
+		Component->SetStaticMesh(Mesh);
+		Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Component->NumCustomDataFloats = 2;
+		Component->SetupAttachment(Owner->GetRootComponent());
+		Component->RegisterComponent();
+
+		Batch.Component = Component;
+	}
+
+	return Batch;
+}
+
+AActor* UShooterAnimBudgetSubsystem::GetProxyActor()
+{
+	if (!ProxyActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		ProxyActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+
+		if (ProxyActor)
+		{
+			USceneComponent* Root = NewObject<USceneComponent>(ProxyActor);
+			ProxyActor->SetRootComponent(Root);
+			Root->RegisterComponent();
+		}
+	}
+
+	return ProxyActor;
+}
+
+namespace ShooterAnimBudget
+{
+	/** Logs the NPC counts per animation mode */
+	static void ReportBudget(const TArray<FString>& Args, UWorld* World)
+	{
+		const UShooterAnimBudgetSubsystem* AnimBudget = World ? World->GetSubsystem<UShooterAnimBudgetSubsystem>() : nullptr;
+
+		if (!AnimBudget)
+		{
+			return;
+		}
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Anim budget: %d full, %d sharing %d leader poses, %d vertex animated instances"),
+			AnimBudget->GetNumFull(), AnimBudget->GetNumShared(), AnimBudget->GetNumLeaders(), AnimBudget->GetNumInstanced());
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Shooter.Anim.BudgetStats"),
+		TEXT("Logs how many NPCs evaluate their own animation, share a leader pose or are drawn as vertex animated instances"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportBudget));
+}
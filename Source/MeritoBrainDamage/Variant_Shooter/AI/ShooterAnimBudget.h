@@ -0,0 +1,197 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterAnimBudget.generated.h"
+
+class AShooterNPC;
+class UAnimSequence;
+class USkeletalMesh;
+class USkeletalMeshComponent;
+class UStaticMesh;
+class UInstancedStaticMeshComponent;
+
+/**
+ *  How an NPC's world mesh is animated
+ */
+enum class EShooterAnimMode : uint8
+{
+	/** Evaluates its own anim instance */
+	Full,
+
+	/** Copies the pose of a shared leader playing the same state */
+	Shared,
+
+	/** Hidden and drawn as a vertex animated instance, with no skeletal evaluation */
+	Instanced
+};
+
+/**
+ *  Common NPC states that can share a pose
+ */
+enum class EShooterAnimState : uint8
+{
+	Idle,
+	Run,
+	Shoot,
+
+	Num
+};
+
+/**
+ *  Hidden skeletal mesh looping one animation for every follower in that state
+ */
+USTRUCT()
+struct FShooterAnimLeader
+{
+	GENERATED_BODY()
+
+	/** Mesh the followers use */
+	UPROPERTY()
+	TObjectPtr<USkeletalMesh> Mesh;
+
+	/** Animation the leader loops */
+	UPROPERTY()
+	TObjectPtr<UAnimSequence> Animation;
+
+	/** Leader pose component */
+	UPROPERTY()
+	TObjectPtr<USkeletalMeshComponent> Component;
+
+	/** Followers assigned since the last allocation */
+	int32 NumFollowers = 0;
+};
+
+/**
+ *  Instanced vertex animation mesh and the NPCs drawn with it
+ */
+USTRUCT()
+struct FShooterAnimInstanceBatch
+{
+	GENERATED_BODY()
+
+	/** Mesh with a vertex animation texture material */
+	UPROPERTY()
+	TObjectPtr<UStaticMesh> Mesh;
+
+	/** Instances, one per NPC */
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Component;
+
+	/** NPCs drawn by each instance */
+	TArray<TWeakObjectPtr<AShooterNPC>> NPCs;
+
+	/** Transform last sent to each instance */
+	TArray<FTransform> Transforms;
+
+	/** Anim state last sent to each instance */
+	TArray<EShooterAnimState> States;
+};
+
+/**
+ *  Animation budget for NPC crowds
+ *  Ranks the NPCs by significance and gives only the most significant ones their own anim instance.
+ *  The rest copy the pose of a shared leader for their current state, and distant ones are drawn as vertex animated instances
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterAnimBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Shared pose leaders */
+	UPROPERTY()
+	TArray<FShooterAnimLeader> Leaders;
+
+	/** Vertex animation batches */
+	UPROPERTY()
+	TArray<FShooterAnimInstanceBatch> Batches;
+
+	/** Actor owning the leaders and the instanced meshes */
+	UPROPERTY()
+	TObjectPtr<AActor> ProxyActor;
+
+	/** NPCs managed by the budget */
+	TArray<TWeakObjectPtr<AShooterNPC>> NPCs;
+
+	/** Time left until the next allocation */
+	float AllocationTimer = 0.0f;
+
+	/** NPC counts per mode on the last allocation */
+	int32 NumFull = 0;
+	int32 NumShared = 0;
+	int32 NumInstanced = 0;
+
+protected:
+
+	/** Most significant NPCs that keep their own anim instance */
+	UPROPERTY(Config)
+	int32 MaxFullNPCs = 24;
+
+	/** NPCs that can copy a leader pose. The rest are instanced if they have a vertex animation mesh */
+	UPROPERTY(Config)
+	int32 MaxSharedNPCs = 150;
+
+	/** NPCs farther than this from every view are instanced if they have a vertex animation mesh */
+	UPROPERTY(Config)
+	float InstancedDistance = 4000.0f;
+
+	/** Cosine of the half angle of the view cone that counts as on screen */
+	UPROPERTY(Config)
+	float OnScreenCosine = 0.5f;
+
+	/** Significance multiplier for NPCs outside the view cone */
+	UPROPERTY(Config)
+	float OffScreenSignificance = 0.25f;
+
+	/** Time between allocations */
+	UPROPERTY(Config)
+	float AllocationInterval = 0.25f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Assigns the animation modes and keeps the followers and instances up to date */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Releases the leaders and instances */
+	virtual void Deinitialize() override;
+
+	/** Adds an NPC to the budget */
+	void RegisterNPC(AShooterNPC* NPC);
+
+	/** Removes an NPC from the budget */
+	void UnregisterNPC(AShooterNPC* NPC);
+
+	/** Returns the NPC counts per mode on the last allocation */
+	int32 GetNumFull() const { return NumFull; }
+	int32 GetNumShared() const { return NumShared; }
+	int32 GetNumInstanced() const { return NumInstanced; }
+	int32 GetNumLeaders() const { return Leaders.Num(); }
+
+protected:
+
+	/** Ranks the NPCs by significance and assigns their modes */
+	void AllocateModes();
+
+	/** Moves shared NPCs to the leader of their current state */
+	void UpdateFollowers();
+
+	/** Moves the vertex animated instances to their NPCs */
+	void UpdateInstances();
+
+	/** Returns the leader for a mesh and animation, creating it if needed */
+	USkeletalMeshComponent* FindOrAddLeader(USkeletalMesh* Mesh, UAnimSequence* Animation);
+
+	/** Returns the instance batch for a mesh, creating it if needed */
+	FShooterAnimInstanceBatch& FindOrAddBatch(UStaticMesh* Mesh);
+
+	/** Returns the actor owning the proxy components, spawning it if needed */
+	AActor* GetProxyActor();
+};
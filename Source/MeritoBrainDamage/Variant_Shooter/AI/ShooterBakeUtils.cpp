@@ -0,0 +1,154 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterBakeUtils.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "MeritoBrainDamage.h"
+
+#if WITH_EDITOR
+#include "UObject/SavePackage.h"
+#include "NavigationSystem.h"
+#endif
+
+FSoftObjectPath ShooterBake::GetBakeAssetPath(const FString& MapPackageName, const TCHAR* Folder, const TCHAR* Suffix)
+{
+	const FString AssetName = FString::Printf(TEXT("%s_%s"), *FPackageName::GetShortName(MapPackageName), Suffix);
+
+	return FSoftObjectPath(FString::Printf(TEXT("/Game/AI/%s/%s.%s"), Folder, *AssetName, *AssetName));
+}
+
+FSoftObjectPath ShooterBake::GetBakeAssetPath(const UWorld* World, const TCHAR* Folder, const TCHAR* Suffix)
+{
+	if (!World)
+	{
+		return FSoftObjectPath();
+	}
+
+	// PIE worlds are renamed with a per-instance prefix
+	return GetBakeAssetPath(UWorld::RemovePIEPrefix(World->GetOutermost()->GetName()), Folder, Suffix);
+}
+
+#if WITH_EDITOR
+
+TArray<FString> ShooterBake::GetBakeMapPaths(const FString& Params)
+{
+	TArray<FString> MapPaths;
+
+	FString MapsSwitch;
+
+	if (FParse::Value(*Params, TEXT("Maps="), MapsSwitch))
+	{
+		MapsSwitch.ParseIntoArray(MapPaths, TEXT("+"));
+
+	} else {
+
+		MapPaths.Add(TEXT("Lvl_Classroom"));
+		MapPaths.Add(TEXT("Lvl_Computer_Classroom"));
+	}
+
+	// allow short map names for the maps folder
+	for (FString& MapPath : MapPaths)
+	{
+		if (!FPackageName::IsValidLongPackageName(MapPath))
+		{
+			MapPath = TEXT("/Game/Maps/") + MapPath;
+		}
+	}
+
+	return MapPaths;
+}
+
+UWorld* ShooterBake::LoadBakeWorld(const FString& MapPackageName)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapPackageName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+
+	if (!World)
+	{
+		UE_LOG(LogMeritoBrainDamage, Error, TEXT("Bake: could not load map %s"), *MapPackageName);
+		return nullptr;
+	}
+
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+
+	// only collision and navigation are needed for the bakes
+	UWorld::InitializationValues InitValues;
+	InitValues.AllowAudioPlayback(false)
+		.RequiresHitProxies(false)
+		.CreatePhysicsScene(true)
+		.CreateNavigation(true)
+		.CreateAISystem(false)
+		.ShouldSimulatePhysics(false)
+		.EnableTraceCollision(true)
+		.CreateFXSystem(false);
+
+	World->InitWorld(InitValues);
+	World->UpdateWorldComponents(true, false);
+
+	// make sure the navmesh matches the level geometry
+	FNavigationSystem::AddNavigationSystemToWorld(*World, FNavigationSystemRunMode::EditorMode);
+
+	if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World))
+	{
+		NavSys->Build();
+	}
+
+	return World;
+}
+
+void ShooterBake::UnloadBakeWorld(UWorld* World)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	World->RemoveFromRoot();
+	World->DestroyWorld(false);
+
+	CollectGarbage(RF_NoFlags);
+}
+
+UObject* ShooterBake::FindOrCreateBakeAsset(const FSoftObjectPath& AssetPath, UClass* AssetClass)
+{
+	// overwrite the previous bake if there is one
+	if (UObject* Existing = StaticLoadObject(AssetClass, nullptr, *AssetPath.ToString(), nullptr, LOAD_NoWarn | LOAD_Quiet))
+	{
+		return Existing;
+	}
+
+	UPackage* Package = CreatePackage(*AssetPath.GetLongPackageName());
+
+	return NewObject<UObject>(Package, AssetClass, *AssetPath.GetAssetName(), RF_Public | RF_Standalone);
+}
+
+bool ShooterBake::SaveBakeAsset(UObject* Asset)
+{
+	if (!Asset)
+	{
+		return false;
+	}
+
+	UPackage* Package = Asset->GetPackage();
+	Package->MarkPackageDirty();
+
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.SaveFlags = SAVE_NoError;
+
+	if (!UPackage::SavePackage(Package, Asset, *Filename, SaveArgs))
+	{
+		UE_LOG(LogMeritoBrainDamage, Error, TEXT("Bake: could not save %s"), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogMeritoBrainDamage, Display, TEXT("Bake: saved %s"), *Filename);
+	return true;
+}
+
+#endif // WITH_EDITOR
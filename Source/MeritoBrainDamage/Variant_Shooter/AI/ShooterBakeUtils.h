@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+
+class UWorld;
+
+/**
+ *  Shared helpers for the offline AI data bakes
+ *  Baked assets live in /Game/AI/<Folder>/<Map>_<Suffix> so they can be found from the map at runtime
+ */
+namespace ShooterBake
+{
+	/** Returns the baked asset path for a map package name */
+	MERITOBRAINDAMAGE_API FSoftObjectPath GetBakeAssetPath(const FString& MapPackageName, const TCHAR* Folder, const TCHAR* Suffix);
+
+	/** Returns the baked asset path for a world, ignoring any PIE prefix */
+	MERITOBRAINDAMAGE_API FSoftObjectPath GetBakeAssetPath(const UWorld* World, const TCHAR* Folder, const TCHAR* Suffix);
+
+#if WITH_EDITOR
+
+	/** Returns the maps to bake from a -Maps=A+B commandlet switch, or the default shooter maps */
+	MERITOBRAINDAMAGE_API TArray<FString> GetBakeMapPaths(const FString& Params);
+
+	/** Loads and initializes a map with collision and navigation so it can be queried */
+	MERITOBRAINDAMAGE_API UWorld* LoadBakeWorld(const FString& MapPackageName);
+
+	/** Tears down a world loaded with LoadBakeWorld */
+	MERITOBRAINDAMAGE_API void UnloadBakeWorld(UWorld* World);
+
+	/** Loads the baked asset if it exists, or creates it in a new package */
+	MERITOBRAINDAMAGE_API UObject* FindOrCreateBakeAsset(const FSoftObjectPath& AssetPath, UClass* AssetClass);
+
+	/** Saves a baked asset to its package file */
+	MERITOBRAINDAMAGE_API bool SaveBakeAsset(UObject* Asset);
+
+	template<typename T>
+	T* FindOrCreateBakeAsset(const FSoftObjectPath& AssetPath)
+	{
+		return Cast<T>(FindOrCreateBakeAsset(AssetPath, T::StaticClass()));
+	}
+
+#endif // WITH_EDITOR
+}
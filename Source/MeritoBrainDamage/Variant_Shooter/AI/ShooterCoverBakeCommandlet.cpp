@@ -0,0 +1,199 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterCoverBakeCommandlet.h"
+#include "ShooterBakeUtils.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+#include "MeritoBrainDamage.h"
+
+UShooterCoverBakeCommandlet::UShooterCoverBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Bakes the AI cover databases for the shooter maps");
+	HelpUsage = TEXT("-run=ShooterCoverBake [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]");
+}
+
+int32 UShooterCoverBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	int32 NumFailed = 0;
+
+	for (const FString& MapPath : ShooterBake::GetBakeMapPaths(Params))
+	{
+		UWorld* World = ShooterBake::LoadBakeWorld(MapPath);
+
+		if (!World)
+		{
+			++NumFailed;
+			continue;
+		}
+
+		TArray<FShooterCoverPoint> Points;
+		BakeCoverPoints(World, Points);
+
+		const int32 NumPoints = Points.Num();
+
+		UShooterCoverDatabase* Database = ShooterBake::FindOrCreateBakeAsset<UShooterCoverDatabase>(ShooterBake::GetBakeAssetPath(MapPath, TEXT("Cover"), TEXT("Cover")));
+
+		if (Database)
+		{
+			Database->Build(MoveTemp(Points), CellSize);
+		}
+
+		if (!ShooterBake::SaveBakeAsset(Database))
+		{
+			++NumFailed;
+		}
+
+		ShooterBake::UnloadBakeWorld(World);
+
+		UE_LOG(LogMeritoBrainDamage, Display, TEXT("Cover bake: %s has %d cover points"), *MapPath, NumPoints);
+	}
+
+	return NumFailed > 0 ? 1 : 0;
+
+#else
+
+	UE_LOG(LogMeritoBrainDamage, Error, TEXT("Cover bake: requires an editor build"));
+	return 1;
+
+#endif // WITH_EDITOR
+}
+
+void UShooterCoverBakeCommandlet::BakeCoverPoints(UWorld* World, TArray<FShooterCoverPoint>& OutPoints) const
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	const ARecastNavMesh* NavMesh = NavSys ? Cast<ARecastNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate)) : nullptr;
+
+	if (!NavMesh)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Cover bake: %s has no recast navmesh"), *World->GetName());
+		return;
+	}
+
+	TMap<FIntVector, TArray<int32>> MergeGrid;
+
+	for (int32 TileIndex = 0; TileIndex < NavMesh->GetNavMeshTilesCount(); ++TileIndex)
+	{
+		// the boundary edges of the navmesh are where walkable space meets an obstacle or a drop
+		FRecastDebugGeometry Geometry;
+		Geometry.bGatherNavMeshEdges = true;
+
+		NavMesh->GetDebugGeometryForTile(Geometry, TileIndex);
+
+		for (int32 EdgeIndex = 0; EdgeIndex + 1 < Geometry.NavMeshEdges.Num(); EdgeIndex += 2)
+		{
+			const FVector EdgeStart = Geometry.NavMeshEdges[EdgeIndex];
+			const FVector EdgeEnd = Geometry.NavMeshEdges[EdgeIndex + 1];
+
+			const FVector EdgeDir = (EdgeEnd - EdgeStart).GetSafeNormal2D();
+
+			if (EdgeDir.IsNearlyZero())
+			{
+				continue;
+			}
+
+			// the obstacle can be on either side of the edge
+			const FVector Side(-EdgeDir.Y, EdgeDir.X, 0.0f);
+
+			const float EdgeLength = FVector::Dist2D(EdgeStart, EdgeEnd);
+			const int32 NumSamples = FMath::Max(1, FMath::FloorToInt32(EdgeLength / SampleSpacing));
+
+			for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+			{
+				// sample at the middle of each span so edge corners aren't counted twice
+				const FVector Sample = FMath::Lerp(EdgeStart, EdgeEnd, (SampleIndex + 0.5f) / NumSamples);
+
+				FShooterCoverPoint Point;
+
+				if (ProbeCover(World, Sample, Side, Point) || ProbeCover(World, Sample, -Side, Point))
+				{
+					AddUniquePoint(Point, OutPoints, MergeGrid);
+				}
+			}
+		}
+	}
+}
+
+bool UShooterCoverBakeCommandlet::ProbeCover(UWorld* World, const FVector& Location, const FVector& Direction, FShooterCoverPoint& OutPoint) const
+{
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterCoverBake), false);
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+
+	// low obstacle check
+	const FVector LowStart = Location + FVector::UpVector * LowCoverHeight;
+
+	FHitResult LowHit;
+
+	if (!World->LineTraceSingleByObjectType(LowHit, LowStart, LowStart + Direction * ProbeDistance, ObjectParams, QueryParams)
+		|| FMath::Abs(LowHit.ImpactNormal.Z) > MaxObstacleNormalZ)
+	{
+		return false;
+	}
+
+	// the point is protected from whatever is on the other side of the obstacle
+	const FVector ProtectedDir = -LowHit.ImpactNormal.GetSafeNormal2D();
+
+	OutPoint.Location = FVector3f(Location);
+	OutPoint.ProtectedYaw = UShooterCoverDatabase::QuantizeYaw(ProtectedDir.Rotation().Yaw);
+	OutPoint.Flags = 0;
+
+	// full height check
+	const FVector HighStart = Location + FVector::UpVector * FullCoverHeight;
+
+	FHitResult HighHit;
+
+	if (World->LineTraceSingleByObjectType(HighHit, HighStart, HighStart + ProtectedDir * ProbeDistance * 1.5f, ObjectParams, QueryParams)
+		&& FMath::Abs(HighHit.ImpactNormal.Z) <= MaxObstacleNormalZ)
+	{
+		OutPoint.Flags |= ShooterCoverFlags::FullHeight;
+	}
+
+	return true;
+}
+
+void UShooterCoverBakeCommandlet::AddUniquePoint(const FShooterCoverPoint& Point, TArray<FShooterCoverPoint>& OutPoints, TMap<FIntVector, TArray<int32>>& MergeGrid) const
+{
+	const FIntVector Cell(FMath::FloorToInt32(Point.Location.X / MergeDistance), FMath::FloorToInt32(Point.Location.Y / MergeDistance), FMath::FloorToInt32(Point.Location.Z / MergeDistance));
+	const float MergeDistanceSq = FMath::Square(MergeDistance);
+
+	// look for a similar point in the neighboring cells
+	for (int32 X = -1; X <= 1; ++X)
+	{
+		for (int32 Y = -1; Y <= 1; ++Y)
+		{
+			for (int32 Z = -1; Z <= 1; ++Z)
+			{
+				const TArray<int32>* Neighbors = MergeGrid.Find(Cell + FIntVector(X, Y, Z));
+
+				if (!Neighbors)
+				{
+					continue;
+				}
+
+				for (const int32 NeighborIndex : *Neighbors)
+				{
+					FShooterCoverPoint& Neighbor = OutPoints[NeighborIndex];
+
+					// yaw difference wrapped to the 256 step range
+					const int32 YawDelta = FMath::Abs(static_cast<int8>(Neighbor.ProtectedYaw - Point.ProtectedYaw));
+
+					if (YawDelta <= 16 && FVector3f::DistSquared(Neighbor.Location, Point.Location) <= MergeDistanceSq)
+					{
+						// keep the strongest cover of the two
+						Neighbor.Flags |= Point.Flags;
+						return;
+					}
+				}
+			}
+		}
+	}
+
+	MergeGrid.FindOrAdd(Cell).Add(OutPoints.Add(Point));
+}
@@ -0,0 +1,62 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ShooterCoverDatabase.h"
+#include "ShooterCoverBakeCommandlet.generated.h"
+
+class UWorld;
+
+/**
+ *  Bakes the cover database for each map from its navmesh boundary edges and the surrounding geometry
+ *  Usage: UnrealEditor-Cmd <Project> -run=ShooterCoverBake [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterCoverBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Distance between cover samples along a navmesh edge */
+	float SampleSpacing = 100.0f;
+
+	/** Height above the navmesh of the low cover probe */
+	float LowCoverHeight = 60.0f;
+
+	/** Height above the navmesh of the full height cover probe */
+	float FullCoverHeight = 150.0f;
+
+	/** Max distance from the edge to the obstacle */
+	float ProbeDistance = 80.0f;
+
+	/** Max vertical component of an obstacle normal, so only walls count as cover */
+	float MaxObstacleNormalZ = 0.3f;
+
+	/** Cover points closer than this and facing the same way are merged */
+	float MergeDistance = 75.0f;
+
+	/** Grid cell size of the baked database */
+	float CellSize = 500.0f;
+
+public:
+
+	/** Constructor */
+	UShooterCoverBakeCommandlet();
+
+	/** Bakes every requested map */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+
+	/** Samples the navmesh edges of a loaded world for cover */
+	void BakeCoverPoints(UWorld* World, TArray<FShooterCoverPoint>& OutPoints) const;
+
+	/** Probes for an obstacle from an edge sample in one direction */
+	bool ProbeCover(UWorld* World, const FVector& Location, const FVector& Direction, FShooterCoverPoint& OutPoint) const;
+
+	/** Appends a cover point unless a similar one already exists nearby */
+	void AddUniquePoint(const FShooterCoverPoint& Point, TArray<FShooterCoverPoint>& OutPoints, TMap<FIntVector, TArray<int32>>& MergeGrid) const;
+};
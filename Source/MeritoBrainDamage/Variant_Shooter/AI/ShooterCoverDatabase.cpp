@@ -0,0 +1,270 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterCoverDatabase.h"
+#include "ShooterBakeUtils.h"
+#include "Algo/LowerBound.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cover Query"), STAT_ShooterCoverQuery, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover Queries"), STAT_ShooterCoverQueries, STATGROUP_Shooter);
+
+namespace ShooterCover
+{
+	/** Unit directions for every quantized yaw */
+	struct FYawTable
+	{
+		FVector2f Directions[256];
+
+		FYawTable()
+		{
+			for (int32 i = 0; i < 256; ++i)
+			{
+				float Sin, Cos;
+				FMath::SinCos(&Sin, &Cos, i * UE_TWO_PI / 256.0f);
+
+				Directions[i] = FVector2f(Cos, Sin);
+			}
+		}
+	};
+
+	static const FYawTable YawTable;
+}
+
+void UShooterCoverDatabase::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	// the packed arrays are stored as raw blocks
+	Points.BulkSerialize(Ar);
+	Cells.BulkSerialize(Ar);
+}
+
+void UShooterCoverDatabase::Build(TArray<FShooterCoverPoint>&& InPoints, float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 100.0f);
+	Points = MoveTemp(InPoints);
+	Cells.Reset();
+
+	auto GetCell = [this](const FShooterCoverPoint& Point)
+	{
+		return FIntPoint(FMath::FloorToInt32(Point.Location.X / CellSize), FMath::FloorToInt32(Point.Location.Y / CellSize));
+	};
+
+	// sort the points by row and column so each cell is a contiguous range
+	Points.Sort([&GetCell](const FShooterCoverPoint& A, const FShooterCoverPoint& B)
+	{
+		const FIntPoint CellA = GetCell(A);
+		const FIntPoint CellB = GetCell(B);
+
+		return CellA.Y != CellB.Y ? CellA.Y < CellB.Y : CellA.X < CellB.X;
+	});
+
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		const FIntPoint Cell = GetCell(Points[i]);
+
+		if (Cells.Num() == 0 || Cells.Last().X != Cell.X || Cells.Last().Y != Cell.Y)
+		{
+			FShooterCoverCell& NewCell = Cells.AddDefaulted_GetRef();
+			NewCell.X = Cell.X;
+			NewCell.Y = Cell.Y;
+			NewCell.FirstPoint = i;
+		}
+
+		++Cells.Last().NumPoints;
+	}
+
+	NumPoints = Points.Num();
+}
+
+int32 UShooterCoverDatabase::Query(const FShooterCoverQuery& Params, TArray<int32>& OutPoints) const
+{
+	const int32 NumBefore = OutPoints.Num();
+
+	ForEachCandidate(Params, [&OutPoints](int32 PointIndex, double DistSq)
+	{
+		OutPoints.Add(PointIndex);
+	});
+
+	return OutPoints.Num() - NumBefore;
+}
+
+int32 UShooterCoverDatabase::FindBestCover(const FShooterCoverQuery& Params, TFunctionRef<bool(int32)> Filter) const
+{
+	int32 BestPoint = INDEX_NONE;
+	double BestDistSq = TNumericLimits<double>::Max();
+
+	ForEachCandidate(Params, [&](int32 PointIndex, double DistSq)
+	{
+		if (DistSq < BestDistSq && Filter(PointIndex))
+		{
+			BestPoint = PointIndex;
+			BestDistSq = DistSq;
+		}
+	});
+
+	return BestPoint;
+}
+
+FVector UShooterCoverDatabase::GetProtectedDirection(const FShooterCoverPoint& Point)
+{
+	const FVector2f& Direction = ShooterCover::YawTable.Directions[Point.ProtectedYaw];
+
+	return FVector(Direction.X, Direction.Y, 0.0f);
+}
+
+uint8 UShooterCoverDatabase::QuantizeYaw(float YawDegrees)
+{
+	return static_cast<uint8>(FMath::RoundToInt32(FRotator::ClampAxis(YawDegrees) * 256.0f / 360.0f) & 0xFF);
+}
+
+void UShooterCoverDatabase::ForEachCandidate(const FShooterCoverQuery& Params, TFunctionRef<void(int32, double)> Visitor) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterCoverQuery);
+	INC_DWORD_STAT(STAT_ShooterCoverQueries);
+
+	if (Cells.Num() == 0)
+	{
+		return;
+	}
+
+	const FVector3f Origin(Params.Origin);
+	const FVector3f Threat(Params.ThreatLocation);
+
+	const float SearchRadiusSq = FMath::Square(Params.SearchRadius);
+	const float MinThreatDistSq = FMath::Square(Params.MinThreatDistance);
+	const float MaxThreatDistSq = FMath::Square(Params.MaxThreatDistance);
+
+	const int32 MinX = FMath::FloorToInt32((Origin.X - Params.SearchRadius) / CellSize);
+	const int32 MaxX = FMath::FloorToInt32((Origin.X + Params.SearchRadius) / CellSize);
+	const int32 MinY = FMath::FloorToInt32((Origin.Y - Params.SearchRadius) / CellSize);
+	const int32 MaxY = FMath::FloorToInt32((Origin.Y + Params.SearchRadius) / CellSize);
+
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		// find the first cell in the row inside the search range
+		int32 CellIndex = Algo::LowerBound(Cells, FIntPoint(MinX, Y), [](const FShooterCoverCell& Cell, const FIntPoint& Key)
+		{
+			return Cell.Y != Key.Y ? Cell.Y < Key.Y : Cell.X < Key.X;
+		});
+
+		for (; CellIndex < Cells.Num() && Cells[CellIndex].Y == Y && Cells[CellIndex].X <= MaxX; ++CellIndex)
+		{
+			const FShooterCoverCell& Cell = Cells[CellIndex];
+
+			for (int32 PointIndex = Cell.FirstPoint; PointIndex < Cell.FirstPoint + Cell.NumPoints; ++PointIndex)
+			{
+				const FShooterCoverPoint& Point = Points[PointIndex];
+
+				if (Params.bRequireFullHeight && !(Point.Flags & ShooterCoverFlags::FullHeight))
+				{
+					continue;
+				}
+
+				const float DistSq = FVector3f::DistSquared(Point.Location, Origin);
+
+				if (DistSq > SearchRadiusSq)
+				{
+					continue;
+				}
+
+				const FVector2f ToThreat(Threat.X - Point.Location.X, Threat.Y - Point.Location.Y);
+				const float ThreatDistSq = ToThreat.SizeSquared();
+
+				if (ThreatDistSq < MinThreatDistSq || ThreatDistSq > MaxThreatDistSq)
+				{
+					continue;
+				}
+
+				// the obstacle must be between the point and the threat
+				const float ProtectionDot = FVector2f::DotProduct(ToThreat * FMath::InvSqrt(FMath::Max(ThreatDistSq, UE_KINDA_SMALL_NUMBER)), ShooterCover::YawTable.Directions[Point.ProtectedYaw]);
+
+				if (ProtectionDot < Params.MinProtectionDot)
+				{
+					continue;
+				}
+
+				Visitor(PointIndex, DistSq);
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool UShooterCoverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterCoverSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const FSoftObjectPath AssetPath = ShooterBake::GetBakeAssetPath(&InWorld, TEXT("Cover"), TEXT("Cover"));
+
+	// maps without a bake just have no cover data
+	if (!FPackageName::DoesPackageExist(AssetPath.GetLongPackageName()))
+	{
+		UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("No cover database for this map at %s"), *AssetPath.ToString());
+		return;
+	}
+
+	UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetPath, FStreamableDelegate::CreateUObject(this, &UShooterCoverSubsystem::OnDatabaseLoaded, AssetPath));
+}
+
+void UShooterCoverSubsystem::OnDatabaseLoaded(FSoftObjectPath AssetPath)
+{
+	Database = Cast<UShooterCoverDatabase>(AssetPath.ResolveObject());
+
+	if (Database)
+	{
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Loaded cover database %s with %d points"), *AssetPath.ToString(), Database->GetNumPoints());
+	}
+}
+
+int32 UShooterCoverSubsystem::FindCover(const FShooterCoverQuery& Params, const AActor* Claimant) const
+{
+	if (!Database)
+	{
+		return INDEX_NONE;
+	}
+
+	// skip points claimed by anybody else
+	return Database->FindBestCover(Params, [this, Claimant](int32 PointIndex)
+	{
+		return !IsCoverClaimed(PointIndex, Claimant);
+	});
+}
+
+bool UShooterCoverSubsystem::IsCoverClaimed(int32 PointIndex, const AActor* Claimant) const
+{
+	const TWeakObjectPtr<const AActor>* Owner = ClaimedPoints.Find(PointIndex);
+
+	return Owner && Owner->IsValid() && Owner->Get() != Claimant;
+}
+
+void UShooterCoverSubsystem::ClaimCover(const AActor* Claimant, int32 PointIndex)
+{
+	ReleaseCover(Claimant);
+
+	if (Claimant && PointIndex != INDEX_NONE)
+	{
+		Claims.Add(Claimant, PointIndex);
+		ClaimedPoints.Add(PointIndex, Claimant);
+	}
+}
+
+void UShooterCoverSubsystem::ReleaseCover(const AActor* Claimant)
+{
+	int32 PointIndex = INDEX_NONE;
+
+	if (Claims.RemoveAndCopyValue(Claimant, PointIndex))
+	{
+		ClaimedPoints.Remove(PointIndex);
+	}
+}
@@ -0,0 +1,196 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterCoverDatabase.generated.h"
+
+/** Cover point flags */
+namespace ShooterCoverFlags
+{
+	/** The obstacle is tall enough to stand behind */
+	constexpr uint8 FullHeight = 1 << 0;
+}
+
+/**
+ *  A baked cover point. Packed so the point array can be bulk serialized
+ */
+struct FShooterCoverPoint
+{
+	/** Navmesh location to take cover at */
+	FVector3f Location = FVector3f::ZeroVector;
+
+	/** Yaw pointing from the point towards the obstacle, quantized to 256 steps */
+	uint8 ProtectedYaw = 0;
+
+	/** ShooterCoverFlags */
+	uint8 Flags = 0;
+
+	/** Keeps the struct free of uninitialized padding */
+	uint16 Reserved = 0;
+
+	/** Serializer, required for bulk serialization */
+	friend FArchive& operator<<(FArchive& Ar, FShooterCoverPoint& Point)
+	{
+		Ar << Point.Location << Point.ProtectedYaw << Point.Flags << Point.Reserved;
+		return Ar;
+	}
+};
+
+/**
+ *  A grid cell of the cover database, pointing at a contiguous range of points
+ *  Cells are sorted by row and column so a row range can be found with a binary search
+ */
+struct FShooterCoverCell
+{
+	/** Cell coordinates */
+	int32 X = 0;
+	int32 Y = 0;
+
+	/** First point in the cell */
+	int32 FirstPoint = 0;
+
+	/** Number of points in the cell */
+	int32 NumPoints = 0;
+
+	/** Serializer, required for bulk serialization */
+	friend FArchive& operator<<(FArchive& Ar, FShooterCoverCell& Cell)
+	{
+		Ar << Cell.X << Cell.Y << Cell.FirstPoint << Cell.NumPoints;
+		return Ar;
+	}
+};
+
+/**
+ *  Parameters for a cover query
+ */
+struct FShooterCoverQuery
+{
+	/** Location to search around, usually the querier */
+	FVector Origin = FVector::ZeroVector;
+
+	/** Max distance from the origin */
+	float SearchRadius = 1500.0f;
+
+	/** Location to take cover from */
+	FVector ThreatLocation = FVector::ZeroVector;
+
+	/** Min distance between the cover and the threat */
+	float MinThreatDistance = 300.0f;
+
+	/** Max distance between the cover and the threat */
+	float MaxThreatDistance = 2500.0f;
+
+	/** Min dot product between the protected direction and the direction to the threat */
+	float MinProtectionDot = 0.5f;
+
+	/** If true, only full height cover is accepted */
+	bool bRequireFullHeight = false;
+};
+
+/**
+ *  Cover points baked offline for a map by the ShooterCoverBake commandlet
+ *  Points are bucketed into a sorted 2D grid and bulk serialized, so queries need no traces
+ */
+UCLASS(BlueprintType)
+class MERITOBRAINDAMAGE_API UShooterCoverDatabase : public UDataAsset
+{
+	GENERATED_BODY()
+
+	/** Cover points, grouped by cell */
+	TArray<FShooterCoverPoint> Points;
+
+	/** Non-empty grid cells, sorted by row then column */
+	TArray<FShooterCoverCell> Cells;
+
+protected:
+
+	/** Size of the grid cells */
+	UPROPERTY(VisibleAnywhere, Category="Cover", meta = (Units = "cm"))
+	float CellSize = 500.0f;
+
+	/** Number of baked points, for display in the editor */
+	UPROPERTY(VisibleAnywhere, Category="Cover")
+	int32 NumPoints = 0;
+
+public:
+
+	/** Serializes the packed point and cell arrays */
+	virtual void Serialize(FArchive& Ar) override;
+
+	/** Replaces the database contents, sorting the points into grid cells */
+	void Build(TArray<FShooterCoverPoint>&& InPoints, float InCellSize);
+
+	/** Appends the indices of all points that pass the query, returns the number added */
+	int32 Query(const FShooterCoverQuery& Params, TArray<int32>& OutPoints) const;
+
+	/** Returns the point that passes the query closest to the origin, or INDEX_NONE. Points rejected by the filter are skipped */
+	int32 FindBestCover(const FShooterCoverQuery& Params, TFunctionRef<bool(int32)> Filter) const;
+
+	/** Returns a cover point */
+	const FShooterCoverPoint& GetPoint(int32 Index) const { return Points[Index]; }
+
+	/** Returns the number of cover points */
+	int32 GetNumPoints() const { return Points.Num(); }
+
+	/** Returns the protected direction of a cover point */
+	static FVector GetProtectedDirection(const FShooterCoverPoint& Point);
+
+	/** Quantizes a yaw in degrees to the cover point yaw */
+	static uint8 QuantizeYaw(float YawDegrees);
+
+protected:
+
+	/** Calls the visitor for every point within the query radius that passes the height and protection tests */
+	void ForEachCandidate(const FShooterCoverQuery& Params, TFunctionRef<void(int32, double)> Visitor) const;
+};
+
+/**
+ *  Loads the baked cover database for the current map and hands out cover points
+ *  Keeps track of claimed points so NPCs don't pick the same cover
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterCoverSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Cover database for the current map */
+	UPROPERTY()
+	TObjectPtr<UShooterCoverDatabase> Database;
+
+	/** Claimed cover points by claimant */
+	TMap<TWeakObjectPtr<const AActor>, int32> Claims;
+
+	/** Claimants by claimed cover point */
+	TMap<int32, TWeakObjectPtr<const AActor>> ClaimedPoints;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Starts loading the cover database */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Returns the loaded cover database, if any */
+	const UShooterCoverDatabase* GetDatabase() const { return Database; }
+
+	/** Finds the best unclaimed cover point, returns INDEX_NONE if there's none or the database isn't loaded */
+	int32 FindCover(const FShooterCoverQuery& Params, const AActor* Claimant) const;
+
+	/** Returns true if the cover point is claimed by anybody other than the claimant */
+	bool IsCoverClaimed(int32 PointIndex, const AActor* Claimant) const;
+
+	/** Claims a cover point, releasing any previous claim */
+	void ClaimCover(const AActor* Claimant, int32 PointIndex);
+
+	/** Releases a claimed cover point */
+	void ReleaseCover(const AActor* Claimant);
+
+protected:
+
+	/** Called when the cover database finishes loading */
+	void OnDatabaseLoaded(FSoftObjectPath AssetPath);
+};
@@ -0,0 +1,558 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterDormancy.h"
+#include "ShooterNPC.h"
+#include "ShooterAIController.h"
+#include "ShooterWeapon.h"
+#include "MassEntitySubsystem.h"
+#include "MassEntityManager.h"
+#include "MassExecutionContext.h"
+#include "NavigationSystem.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Dormant Patrol"), STAT_ShooterDormantPatrol, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Dormancy Swaps"), STAT_ShooterDormancySwaps, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dormant NPCs"), STAT_ShooterDormantNPCs, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Active NPCs"), STAT_ShooterActiveNPCs, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pooled NPCs"), STAT_ShooterPooledNPCs, STATGROUP_Shooter);
+
+namespace ShooterDormancy
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.AI.Dormancy"),
+		true,
+		TEXT("If true, idle NPCs far from every player are turned into dormant entities. Dormant entities are still turned back into actors when disabled."),
+		ECVF_Default);
+
+	/** Extent used to put dormant NPCs back on the navmesh */
+	static const FVector ProjectExtent(200.0f, 200.0f, 300.0f);
+
+	/** Returns the entity manager of a world, if Mass is running */
+	static FMassEntityManager* GetEntityManager(const UWorld* World)
+	{
+		UMassEntitySubsystem* EntitySubsystem = World ? World->GetSubsystem<UMassEntitySubsystem>() : nullptr;
+		return EntitySubsystem ? &EntitySubsystem->GetMutableEntityManager() : nullptr;
+	}
+
+	/** Returns the capsule half height of an NPC class */
+	static float GetHalfHeight(TSubclassOf<AShooterNPC> NPCClass)
+	{
+		const AShooterNPC* CDO = NPCClass ? NPCClass->GetDefaultObject<AShooterNPC>() : nullptr;
+		return CDO ? CDO->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() : 0.0f;
+	}
+}
+
+bool UShooterDormancySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterDormancySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterDormancySubsystem, STATGROUP_Tickables);
+}
+
+void UShooterDormancySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	RandomStream.Initialize(FShooterRandomStream::MakeSeed(this));
+
+	FMassEntityManager* EntityManager = ShooterDormancy::GetEntityManager(&InWorld);
+
+	if (!EntityManager)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("NPC dormancy disabled, no Mass entity manager in this world"));
+		return;
+	}
+
+	DormantArchetype = EntityManager->CreateArchetype(TArray<const UScriptStruct*>{
+		FShooterDormantTransformFragment::StaticStruct(),
+		FShooterDormantNPCFragment::StaticStruct(),
+		FShooterDormantPatrolFragment::StaticStruct() });
+
+	DormantQuery = FMassEntityQuery(EntityManager->AsShared());
+	DormantQuery.AddRequirement<FShooterDormantTransformFragment>(EMassFragmentAccess::ReadWrite);
+	DormantQuery.AddRequirement<FShooterDormantNPCFragment>(EMassFragmentAccess::ReadOnly);
+	DormantQuery.AddRequirement<FShooterDormantPatrolFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void UShooterDormancySubsystem::Deinitialize()
+{
+	// the entities go away with the world's entity manager
+	ActiveNPCs.Reset();
+	Pool.Reset();
+	Profiles.Reset();
+	DormantWaveCounts.Reset();
+	NumDormant = 0;
+
+	Super::Deinitialize();
+}
+
+void UShooterDormancySubsystem::Tick(float DeltaTime)
+{
+	if (!HasEntities())
+	{
+		return;
+	}
+
+	UpdatePatrol(DeltaTime);
+
+	CheckTimer -= DeltaTime;
+
+	if (CheckTimer <= 0.0f)
+	{
+		CheckTimer = CheckInterval;
+
+		UpdateActivation();
+	}
+
+	SET_DWORD_STAT(STAT_ShooterDormantNPCs, NumDormant);
+	SET_DWORD_STAT(STAT_ShooterActiveNPCs, ActiveNPCs.Num());
+	SET_DWORD_STAT(STAT_ShooterPooledNPCs, Pool.Num());
+}
+
+void UShooterDormancySubsystem::RegisterNPC(AShooterNPC* NPC)
+{
+	if (IsValid(NPC) && !NPC->IsDormant())
+	{
+		ActiveNPCs.AddUnique(NPC);
+	}
+}
+
+void UShooterDormancySubsystem::UnregisterNPC(AShooterNPC* NPC)
+{
+	ActiveNPCs.RemoveSwap(NPC);
+	Pool.RemoveSwap(NPC);
+}
+
+int32 UShooterDormancySubsystem::FindOrAddProfile(TSubclassOf<AShooterNPC> NPCClass, TSubclassOf<AShooterWeapon> WeaponClass, uint8 Team)
+{
+	const int32 Index = Profiles.IndexOfByPredicate([&](const FShooterDormantProfile& Profile)
+	{
+		return Profile.NPCClass == NPCClass && Profile.WeaponClass == WeaponClass && Profile.Team == Team;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		return Index;
+	}
+
+	FShooterDormantProfile& Profile = Profiles.AddDefaulted_GetRef();
+	Profile.NPCClass = NPCClass;
+	Profile.WeaponClass = WeaponClass;
+	Profile.Team = Team;
+
+	return Profiles.Num() - 1;
+}
+
+bool UShooterDormancySubsystem::AddDormantNPC(TSubclassOf<AShooterNPC> NPCClass, TSubclassOf<AShooterWeapon> WeaponClass, uint8 Team, const FVector& Location, float Yaw, float HP, int32 WaveId)
+{
+	FMassEntityManager* EntityManager = ShooterDormancy::GetEntityManager(GetWorld());
+
+	if (!EntityManager || !HasEntities() || !NPCClass)
+	{
+		return false;
+	}
+
+	const FMassEntityHandle Entity = EntityManager->CreateEntity(DormantArchetype);
+
+	FShooterDormantTransformFragment& Transform = EntityManager->GetFragmentDataChecked<FShooterDormantTransformFragment>(Entity);
+	Transform.Location = Location;
+	Transform.Yaw = Yaw;
+
+	FShooterDormantNPCFragment& State = EntityManager->GetFragmentDataChecked<FShooterDormantNPCFragment>(Entity);
+	State.ProfileIndex = FindOrAddProfile(NPCClass, WeaponClass, Team);
+	State.HP = HP;
+	State.WaveId = WaveId;
+
+	if (WaveId != INDEX_NONE)
+	{
+		++DormantWaveCounts.FindOrAdd(WaveId);
+	}
+
+	FShooterDormantPatrolFragment& Patrol = EntityManager->GetFragmentDataChecked<FShooterDormantPatrolFragment>(Entity);
+	Patrol.Home = Location;
+	Patrol.Goal = Location;
+	Patrol.bNeedsGoal = true;
+
+	++NumDormant;
+
+	return true;
+}
+
+void UShooterDormancySubsystem::Deactivate(AShooterNPC* NPC)
+{
+	// entities are stored at ground level
+	const FVector Feet = NPC->GetActorLocation() - FVector(0.0f, 0.0f, NPC->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+
+	if (!AddDormantNPC(NPC->GetClass(), NPC->GetWeaponClass(), NPC->GetTeamByte(), Feet, NPC->GetActorRotation().Yaw, NPC->CurrentHP, NPC->GetWaveId()))
+	{
+		return;
+	}
+
+	ActiveNPCs.RemoveSwap(NPC);
+
+	NPC->EnterDormancy();
+
+	// park the actor for reuse, or get rid of it if the pool is full
+	if (Pool.Num() < MaxPoolSize)
+	{
+		Pool.Add(NPC);
+
+	} else {
+
+		if (AController* Controller = NPC->GetController())
+		{
+			Controller->Destroy();
+		}
+
+		NPC->Destroy();
+	}
+}
+
+bool UShooterDormancySubsystem::Activate(const FMassEntityHandle& Entity)
+{
+	FMassEntityManager* EntityManager = ShooterDormancy::GetEntityManager(GetWorld());
+
+	if (!EntityManager || !EntityManager->IsEntityValid(Entity))
+	{
+		return false;
+	}
+
+	const FShooterDormantTransformFragment Transform = EntityManager->GetFragmentDataChecked<FShooterDormantTransformFragment>(Entity);
+	const FShooterDormantNPCFragment State = EntityManager->GetFragmentDataChecked<FShooterDormantNPCFragment>(Entity);
+	const FVector Home = EntityManager->GetFragmentDataChecked<FShooterDormantPatrolFragment>(Entity).Home;
+	const FShooterDormantProfile Profile = Profiles[State.ProfileIndex];
+
+	// the dormant patrol walks in straight lines, so put the NPC back on the navmesh
+	FVector Location = Home;
+	FNavLocation NavLocation;
+
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	if (NavSys && NavSys->ProjectPointToNavigation(Transform.Location, NavLocation, ShooterDormancy::ProjectExtent))
+	{
+		Location = NavLocation.Location;
+	}
+
+	const FRotator Rotation(0.0f, Transform.Yaw, 0.0f);
+
+	// reuse a parked actor with the same class, weapon and team if we have one
+	const int32 PoolIndex = Pool.IndexOfByPredicate([&Profile](const AShooterNPC* Pooled)
+	{
+		return IsValid(Pooled) && Pooled->GetClass() == Profile.NPCClass && Pooled->GetWeaponClass() == Profile.WeaponClass && Pooled->GetTeamByte() == Profile.Team;
+	});
+
+	AShooterNPC* NPC = nullptr;
+
+	if (PoolIndex != INDEX_NONE)
+	{
+		NPC = Pool[PoolIndex];
+		Pool.RemoveAtSwap(PoolIndex);
+
+		NPC->SetWaveId(State.WaveId);
+		NPC->ExitDormancy(Location + FVector(0.0f, 0.0f, NPC->GetCapsuleComponent()->GetScaledCapsuleHalfHeight()), Rotation, State.HP);
+		RegisterNPC(NPC);
+
+	} else {
+
+		const FTransform SpawnTransform(Rotation, Location + FVector(0.0f, 0.0f, ShooterDormancy::GetHalfHeight(Profile.NPCClass)));
+
+		NPC = GetWorld()->SpawnActorDeferred<AShooterNPC>(Profile.NPCClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+
+		if (!NPC)
+		{
+			return false;
+		}
+
+		NPC->SetSpawnProfile(Profile.WeaponClass, Profile.Team);
+		NPC->SetWaveId(State.WaveId);
+		NPC->CurrentHP = State.HP;
+		NPC->FinishSpawning(SpawnTransform);
+
+		// the NPC registers itself on begin play, but still needs a controller if the class doesn't auto possess spawned pawns
+		if (!NPC->GetController())
+		{
+			NPC->SpawnDefaultController();
+		}
+	}
+
+	EntityManager->DestroyEntity(Entity);
+	--NumDormant;
+
+	if (State.WaveId != INDEX_NONE)
+	{
+		int32& WaveCount = DormantWaveCounts.FindChecked(State.WaveId);
+
+		if (--WaveCount <= 0)
+		{
+			DormantWaveCounts.Remove(State.WaveId);
+		}
+	}
+
+	OnNPCActivated.Broadcast(NPC);
+
+	return true;
+}
+
+void UShooterDormancySubsystem::UpdatePatrol(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterDormantPatrol);
+
+	FMassEntityManager* EntityManager = ShooterDormancy::GetEntityManager(GetWorld());
+
+	if (!EntityManager || NumDormant == 0)
+	{
+		return;
+	}
+
+	TArray<FMassEntityHandle> NeedGoals;
+	const float MaxStep = PatrolSpeed * DeltaTime;
+
+	FMassExecutionContext ExecutionContext(*EntityManager, DeltaTime);
+
+	DormantQuery.ForEachEntityChunk(ExecutionContext, [&](FMassExecutionContext& Context)
+	{
+		const TArrayView<FShooterDormantTransformFragment> Transforms = Context.GetMutableFragmentView<FShooterDormantTransformFragment>();
+		const TArrayView<FShooterDormantPatrolFragment> Patrols = Context.GetMutableFragmentView<FShooterDormantPatrolFragment>();
+
+		for (int32 i = 0; i < Context.GetNumEntities(); ++i)
+		{
+			FShooterDormantTransformFragment& Transform = Transforms[i];
+			FShooterDormantPatrolFragment& Patrol = Patrols[i];
+
+			// goals are picked on the navmesh after the loop, a few per frame
+			if (Patrol.bNeedsGoal)
+			{
+				if (NeedGoals.Num() < MaxPatrolGoalsPerFrame)
+				{
+					NeedGoals.Add(Context.GetEntity(i));
+				}
+
+				continue;
+			}
+
+			if (Patrol.WaitTime > 0.0f)
+			{
+				Patrol.WaitTime -= DeltaTime;
+				Patrol.bNeedsGoal = Patrol.WaitTime <= 0.0f;
+				continue;
+			}
+
+			const FVector ToGoal = Patrol.Goal - Transform.Location;
+			const float Distance = ToGoal.Size2D();
+
+			if (Distance <= MaxStep)
+			{
+				// arrived, wait a bit before the next goal
+				Transform.Location = Patrol.Goal;
+				Patrol.WaitTime = RandomStream.FRandRange(2.0f, 6.0f);
+
+			} else {
+
+				Transform.Location += ToGoal * (MaxStep / Distance);
+				Transform.Yaw = FMath::RadiansToDegrees(FMath::Atan2(ToGoal.Y, ToGoal.X));
+			}
+		}
+	});
+
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	for (const FMassEntityHandle& Entity : NeedGoals)
+	{
+		FShooterDormantPatrolFragment& Patrol = EntityManager->GetFragmentDataChecked<FShooterDormantPatrolFragment>(Entity);
+
+		FNavLocation Goal;
+
+		Patrol.Goal = NavSys && NavSys->GetRandomReachablePointInRadius(Patrol.Home, PatrolRadius, Goal) ? Goal.Location : Patrol.Home;
+		Patrol.bNeedsGoal = false;
+	}
+}
+
+void UShooterDormancySubsystem::UpdateActivation()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterDormancySwaps);
+
+	UWorld* World = GetWorld();
+
+	// only the players make NPCs significant
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APawn* Pawn = It->Get() ? It->Get()->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+
+	if (PlayerLocations.Num() == 0)
+	{
+		return;
+	}
+
+	auto GetMinDistanceSquared = [&PlayerLocations](const FVector& Location)
+	{
+		float MinDistanceSquared = TNumericLimits<float>::Max();
+
+		for (const FVector& PlayerLocation : PlayerLocations)
+		{
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(Location, PlayerLocation));
+		}
+
+		return MinDistanceSquared;
+	};
+
+	// put idle NPCs far from every player to sleep
+	if (ShooterDormancy::CVarEnable.GetValueOnGameThread())
+	{
+		const float DeactivationRadiusSquared = FMath::Square(DeactivationRadius);
+		int32 NumDeactivated = 0;
+
+		for (int32 i = ActiveNPCs.Num() - 1; i >= 0 && NumDeactivated < MaxDeactivationsPerCheck; --i)
+		{
+			AShooterNPC* NPC = ActiveNPCs[i].Get();
+
+			if (!NPC)
+			{
+				ActiveNPCs.RemoveAtSwap(i);
+				continue;
+			}
+
+			// NPCs in combat stay awake wherever they are
+			const AShooterAIController* Controller = Cast<AShooterAIController>(NPC->GetController());
+
+			if (NPC->IsDead() || (Controller && Controller->GetCurrentTarget()))
+			{
+				continue;
+			}
+
+			if (GetMinDistanceSquared(NPC->GetActorLocation()) > DeactivationRadiusSquared)
+			{
+				Deactivate(NPC);
+				++NumDeactivated;
+			}
+		}
+	}
+
+	// wake the closest dormant NPCs within the activation radius
+	const int32 Budget = FMath::Min(MaxActivationsPerCheck, MaxActiveNPCs - ActiveNPCs.Num());
+
+	if (Budget <= 0 || NumDormant == 0)
+	{
+		return;
+	}
+
+	FMassEntityManager* EntityManager = ShooterDormancy::GetEntityManager(World);
+
+	if (!EntityManager)
+	{
+		return;
+	}
+
+	const float ActivationRadiusSquared = FMath::Square(ActivationRadius);
+
+	TArray<TPair<float, FMassEntityHandle>> Candidates;
+
+	FMassExecutionContext ExecutionContext(*EntityManager);
+
+	DormantQuery.ForEachEntityChunk(ExecutionContext, [&](FMassExecutionContext& Context)
+	{
+		const TConstArrayView<FShooterDormantTransformFragment> Transforms = Context.GetFragmentView<FShooterDormantTransformFragment>();
+
+		for (int32 i = 0; i < Context.GetNumEntities(); ++i)
+		{
+			const float DistanceSquared = GetMinDistanceSquared(Transforms[i].Location);
+
+			if (DistanceSquared <= ActivationRadiusSquared)
+			{
+				Candidates.Emplace(DistanceSquared, Context.GetEntity(i));
+			}
+		}
+	});
+
+	Candidates.Sort([](const TPair<float, FMassEntityHandle>& A, const TPair<float, FMassEntityHandle>& B) { return A.Key < B.Key; });
+
+	for (int32 i = 0, NumActivated = 0; i < Candidates.Num() && NumActivated < Budget; ++i)
+	{
+		if (Activate(Candidates[i].Value))
+		{
+			++NumActivated;
+		}
+	}
+}
+
+namespace ShooterDormancy
+{
+	/** Logs the NPC representation counts */
+	static void ReportDormancy(const TArray<FString>& Args, UWorld* World)
+	{
+		const UShooterDormancySubsystem* Dormancy = World ? World->GetSubsystem<UShooterDormancySubsystem>() : nullptr;
+
+		if (!Dormancy)
+		{
+			return;
+		}
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Dormancy: %d NPC actors in play, %d parked in the pool, %d dormant entities"),
+			Dormancy->GetNumActive(), Dormancy->GetNumPooled(), Dormancy->GetNumDormant());
+	}
+
+	/** Scatters dormant copies of an NPC in play around the player */
+	static void SpawnDormant(const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterDormancySubsystem* Dormancy = World ? World->GetSubsystem<UShooterDormancySubsystem>() : nullptr;
+		const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+		const APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		const APawn* Player = PlayerController ? PlayerController->GetPawn() : nullptr;
+
+		// copy the first NPC in the world
+		const AShooterNPC* Template = nullptr;
+
+		for (TActorIterator<AShooterNPC> It(World); It && !Template; ++It)
+		{
+			Template = *It;
+		}
+
+		if (!Dormancy || !NavSys || !Player || !Template)
+		{
+			UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Shooter.AI.SpawnDormant needs a game world with a navmesh, a player pawn and at least one NPC"));
+			return;
+		}
+
+		const int32 Count = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+		const float Radius = Args.Num() > 1 ? FMath::Max(100.0f, FCString::Atof(*Args[1])) : 20000.0f;
+
+		int32 NumSpawned = 0;
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			FNavLocation Location;
+
+			if (NavSys->GetRandomReachablePointInRadius(Player->GetActorLocation(), Radius, Location)
+				&& Dormancy->AddDormantNPC(Template->GetClass(), Template->GetWeaponClass(), Template->GetTeamByte(), Location.Location, Dormancy->GetRandomStream().FRandRange(-180.0f, 180.0f), Template->CurrentHP))
+			{
+				++NumSpawned;
+			}
+		}
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Dormancy: added %d dormant %s"), NumSpawned, *Template->GetClass()->GetName());
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Shooter.AI.DormancyStats"),
+		TEXT("Logs how many NPCs are in play as actors, parked in the pool and dormant as entities"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportDormancy));
+
+	static FAutoConsoleCommandWithWorldAndArgs SpawnCommand(
+		TEXT("Shooter.AI.SpawnDormant"),
+		TEXT("Adds dormant copies of the first NPC in the world around the player. Usage: Shooter.AI.SpawnDormant [Count] [Radius]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SpawnDormant));
+}
@@ -0,0 +1,239 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MassEntityTypes.h"
+#include "MassEntityQuery.h"
+#include "ShooterRandom.h"
+#include "ShooterDormancy.generated.h"
+
+class AShooterNPC;
+class AShooterWeapon;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FShooterNPCActivatedDelegate, AShooterNPC*);
+
+/**
+ *  Position and facing of a dormant NPC
+ */
+USTRUCT()
+struct FShooterDormantTransformFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** World location on the ground */
+	FVector Location = FVector::ZeroVector;
+
+	/** Facing yaw in degrees */
+	float Yaw = 0.0f;
+};
+
+/**
+ *  Gameplay state a dormant NPC keeps until it's turned back into an actor
+ */
+USTRUCT()
+struct FShooterDormantNPCFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Index of the NPC class, weapon type and team in the dormancy subsystem's profiles */
+	int32 ProfileIndex = INDEX_NONE;
+
+	/** Remaining HP */
+	float HP = 100.0f;
+
+	/** Encounter wave the NPC belongs to, INDEX_NONE if none */
+	int32 WaveId = INDEX_NONE;
+};
+
+/**
+ *  Simplified patrol for dormant NPCs: walk in a straight line to a goal near home, wait, pick another
+ */
+USTRUCT()
+struct FShooterDormantPatrolFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Center of the patrol area */
+	FVector Home = FVector::ZeroVector;
+
+	/** Current goal */
+	FVector Goal = FVector::ZeroVector;
+
+	/** Time left to wait at the goal */
+	float WaitTime = 0.0f;
+
+	/** Set when the NPC is waiting for a new goal */
+	bool bNeedsGoal = true;
+};
+
+/**
+ *  NPC class, weapon type and team shared by many dormant NPCs
+ */
+USTRUCT()
+struct FShooterDormantProfile
+{
+	GENERATED_BODY()
+
+	/** Class to spawn when rehydrating */
+	UPROPERTY()
+	TSubclassOf<AShooterNPC> NPCClass;
+
+	/** Weapon the NPC carries */
+	UPROPERTY()
+	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Team of the NPC */
+	UPROPERTY()
+	uint8 Team = 1;
+};
+
+/**
+ *  Hybrid NPC representation
+ *  NPCs far from every player are turned into lightweight Mass entities holding their position, team, HP and weapon type,
+ *  with a simplified patrol. Entities that come within the activation radius are turned back into full NPC and controller actors,
+ *  reusing parked actors from a pool, so a map can hold thousands of enemies at the cost of a few hundred actors
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterDormancySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** NPC classes, weapons and teams the entities point to */
+	UPROPERTY()
+	TArray<FShooterDormantProfile> Profiles;
+
+	/** Parked NPCs waiting to be reused */
+	UPROPERTY()
+	TArray<TObjectPtr<AShooterNPC>> Pool;
+
+	/** NPCs currently in play as actors */
+	TArray<TWeakObjectPtr<AShooterNPC>> ActiveNPCs;
+
+	/** Archetype of the dormant entities */
+	FMassArchetypeHandle DormantArchetype;
+
+	/** Query over every dormant entity */
+	FMassEntityQuery DormantQuery;
+
+	/** Number of dormant entities */
+	int32 NumDormant = 0;
+
+	/** Number of dormant entities in each encounter wave */
+	TMap<int32, int32> DormantWaveCounts;
+
+	/** Time left until the next activation check */
+	float CheckTimer = 0.0f;
+
+	/** Random stream for the dormant patrol and dormant spawns */
+	FShooterRandomStream RandomStream;
+
+protected:
+
+	/** Dormant NPCs closer than this to a player are turned back into actors */
+	UPROPERTY(Config)
+	float ActivationRadius = 6000.0f;
+
+	/** Idle NPCs farther than this from every player are turned into entities. Larger than the activation radius to avoid flicker */
+	UPROPERTY(Config)
+	float DeactivationRadius = 8000.0f;
+
+	/** Upper limit on NPC actors in play */
+	UPROPERTY(Config)
+	int32 MaxActiveNPCs = 200;
+
+	/** Upper limit on parked NPC actors. Extra actors are destroyed */
+	UPROPERTY(Config)
+	int32 MaxPoolSize = 32;
+
+	/** Max NPCs turned back into actors each check */
+	UPROPERTY(Config)
+	int32 MaxActivationsPerCheck = 4;
+
+	/** Max NPCs turned into entities each check */
+	UPROPERTY(Config)
+	int32 MaxDeactivationsPerCheck = 8;
+
+	/** Time between activation checks */
+	UPROPERTY(Config)
+	float CheckInterval = 0.2f;
+
+	/** Radius of the dormant patrol around home */
+	UPROPERTY(Config)
+	float PatrolRadius = 800.0f;
+
+	/** Walk speed of dormant NPCs */
+	UPROPERTY(Config)
+	float PatrolSpeed = 150.0f;
+
+	/** Max patrol goals projected onto the navmesh each frame */
+	UPROPERTY(Config)
+	int32 MaxPatrolGoalsPerFrame = 16;
+
+public:
+
+	/** Called when a dormant entity is turned back into an NPC actor, pooled or newly spawned */
+	FShooterNPCActivatedDelegate OnNPCActivated;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Sets up the entity archetype and query */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Runs the dormant patrol and swaps NPCs between actors and entities */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Releases the entities and the pool */
+	virtual void Deinitialize() override;
+
+	/** Adds an NPC actor that can be made dormant */
+	void RegisterNPC(AShooterNPC* NPC);
+
+	/** Removes an NPC actor */
+	void UnregisterNPC(AShooterNPC* NPC);
+
+	/** Adds an NPC that starts as a dormant entity. Returns false if the entity couldn't be created */
+	bool AddDormantNPC(TSubclassOf<AShooterNPC> NPCClass, TSubclassOf<AShooterWeapon> WeaponClass, uint8 Team, const FVector& Location, float Yaw, float HP, int32 WaveId = INDEX_NONE);
+
+	/** Returns the number of dormant entities */
+	int32 GetNumDormant() const { return NumDormant; }
+
+	/** Returns the number of dormant entities belonging to an encounter wave */
+	int32 GetNumDormantInWave(int32 WaveId) const { return DormantWaveCounts.FindRef(WaveId); }
+
+	/** Returns the number of NPC actors in play */
+	int32 GetNumActive() const { return ActiveNPCs.Num(); }
+
+	/** Returns the number of parked NPC actors */
+	int32 GetNumPooled() const { return Pool.Num(); }
+
+	/** Returns the random stream for the dormant patrol and dormant spawns */
+	FShooterRandomStream& GetRandomStream() { return RandomStream; }
+
+protected:
+
+	/** Turns an NPC actor into a dormant entity and parks or destroys the actor */
+	void Deactivate(AShooterNPC* NPC);
+
+	/** Turns a dormant entity back into an NPC actor. Returns false if no actor could be spawned */
+	bool Activate(const FMassEntityHandle& Entity);
+
+	/** Advances the dormant patrol of every entity */
+	void UpdatePatrol(float DeltaTime);
+
+	/** Swaps NPCs between actors and entities depending on their distance to the players */
+	void UpdateActivation();
+
+	/** Returns the index of a profile, adding it if needed */
+	int32 FindOrAddProfile(TSubclassOf<AShooterNPC> NPCClass, TSubclassOf<AShooterWeapon> WeaponClass, uint8 Team);
+
+	/** Returns true if the entity manager and archetype are ready */
+	bool HasEntities() const { return DormantArchetype.IsValid(); }
+};
@@ -0,0 +1,405 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterEQSBroker.h"
+#include "ShooterAIController.h"
+#include "ShooterNPC.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "EnvironmentQuery/EnvQueryManager.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EQS Queries Run"), STAT_ShooterEQSRun, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EQS Queries Shared"), STAT_ShooterEQSShared, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Queries Pending"), STAT_ShooterEQSPending, STATGROUP_Shooter);
+
+namespace ShooterEQSBroker
+{
+	static TAutoConsoleVariable<bool> CVarShare(
+		TEXT("Shooter.AI.EQSShare"),
+		true,
+		TEXT("If true, AI environment queries with the same template, target and rounded location share one result."),
+		ECVF_Default);
+}
+
+bool UShooterEQSBroker::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterEQSBroker::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterEQSBroker, STATGROUP_Tickables);
+}
+
+void UShooterEQSBroker::Deinitialize()
+{
+	if (UEnvQueryManager* QueryManager = UEnvQueryManager::GetCurrent(GetWorld()))
+	{
+		for (const TPair<int32, FShooterEQSQueryKey>& Running : RunningQueries)
+		{
+			QueryManager->AbortQuery(Running.Key);
+		}
+	}
+
+	RunningQueries.Reset();
+	PendingKeys.Reset();
+	ReadyResults.Reset();
+	Entries.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShooterEQSBroker::Tick(float DeltaTime)
+{
+	// hand out the shared results from the previous frame
+	TArray<TPair<FShooterEQSWaiter, TSharedPtr<FEnvQueryResult>>> Ready = MoveTemp(ReadyResults);
+
+	for (TPair<FShooterEQSWaiter, TSharedPtr<FEnvQueryResult>>& Pair : Ready)
+	{
+		Pair.Key.OnFinished.ExecuteIfBound(Pair.Value, Pair.Key.ItemIndex);
+	}
+
+	RehomeOrphanedQueries();
+
+	// drop the expired results
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Result.IsValid() && Now - It->Value.FinishTime > ResultLifetime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	StartPendingQueries();
+
+	SET_DWORD_STAT(STAT_ShooterEQSPending, PendingKeys.Num());
+}
+
+FShooterEQSQueryKey UShooterEQSBroker::MakeKey(UEnvQuery* Template, const AShooterAIController* Querier, EEnvQueryRunMode::Type RunMode) const
+{
+	const APawn* Pawn = Querier->GetPawn();
+	const FVector Location = Pawn ? Pawn->GetActorLocation() : Querier->GetActorLocation();
+
+	FShooterEQSQueryKey Key;
+	Key.Template = Template;
+	Key.Target = Querier->GetCurrentTarget();
+	Key.Location = FIntVector(FMath::RoundToInt32(Location.X / LocationGrid), FMath::RoundToInt32(Location.Y / LocationGrid), FMath::RoundToInt32(Location.Z / LocationGrid));
+	Key.RunMode = static_cast<uint8>(RunMode);
+
+	return Key;
+}
+
+int32 UShooterEQSBroker::RunQuery(UEnvQuery* Template, AShooterAIController* Querier, EEnvQueryRunMode::Type RunMode, const FShooterEQSResultDelegate& OnFinished)
+{
+	if (!Template || !IsValid(Querier))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 RequestId = ++LastRequestId;
+
+	FShooterEQSQueryKey Key = MakeKey(Template, Querier, RunMode);
+
+	if (!ShooterEQSBroker::CVarShare.GetValueOnGameThread())
+	{
+		Key.Unique = RequestId;
+	}
+
+	FShooterEQSWaiter Waiter;
+	Waiter.RequestId = RequestId;
+	Waiter.Querier = Querier;
+	Waiter.OnFinished = OnFinished;
+
+	if (FShooterEQSEntry* Entry = Entries.Find(Key))
+	{
+		++NumShared;
+		INC_DWORD_STAT(STAT_ShooterEQSShared);
+
+		if (Entry->Result.IsValid())
+		{
+			// the result is still fresh, claim our item now and hand it out on the next tick
+			ClaimItem(*Entry, Waiter);
+			ReadyResults.Emplace(MoveTemp(Waiter), Entry->Result);
+
+		} else {
+
+			// the query is pending or running, wait for it
+			Entry->Waiters.Add(MoveTemp(Waiter));
+		}
+
+		return RequestId;
+	}
+
+	FShooterEQSEntry& Entry = Entries.Add(Key);
+	Entry.Querier = Querier;
+	Entry.Waiters.Add(MoveTemp(Waiter));
+
+	PendingKeys.Add(Key);
+
+	StartPendingQueries();
+
+	return RequestId;
+}
+
+void UShooterEQSBroker::AbortRequest(int32 RequestId)
+{
+	if (RequestId == INDEX_NONE)
+	{
+		return;
+	}
+
+	ReadyResults.RemoveAll([RequestId](const TPair<FShooterEQSWaiter, TSharedPtr<FEnvQueryResult>>& Pair) { return Pair.Key.RequestId == RequestId; });
+
+	for (TPair<FShooterEQSQueryKey, FShooterEQSEntry>& Pair : Entries)
+	{
+		if (Pair.Value.Waiters.RemoveAll([RequestId](const FShooterEQSWaiter& Waiter) { return Waiter.RequestId == RequestId; }) > 0)
+		{
+			return;
+		}
+	}
+}
+
+void UShooterEQSBroker::StartPendingQueries()
+{
+	if (StartFrame != GFrameCounter)
+	{
+		StartFrame = GFrameCounter;
+		NumStartedThisFrame = 0;
+	}
+
+	while (PendingKeys.Num() > 0 && NumStartedThisFrame < MaxQueriesStartedPerFrame)
+	{
+		const FShooterEQSQueryKey Key = PendingKeys[0];
+		PendingKeys.RemoveAt(0, EAllowShrinking::No);
+
+		FShooterEQSEntry* Entry = Entries.Find(Key);
+
+		if (!Entry)
+		{
+			continue;
+		}
+
+		// everyone gave up on this one before it started
+		if (Entry->Waiters.Num() == 0)
+		{
+			Entries.Remove(Key);
+			continue;
+		}
+
+		if (!StartQuery(Key, *Entry))
+		{
+			// fail the waiters on the next tick
+			for (FShooterEQSWaiter& Waiter : Entry->Waiters)
+			{
+				ReadyResults.Emplace(MoveTemp(Waiter), nullptr);
+			}
+
+			Entries.Remove(Key);
+			continue;
+		}
+
+		++NumStartedThisFrame;
+	}
+}
+
+bool UShooterEQSBroker::StartQuery(const FShooterEQSQueryKey& Key, FShooterEQSEntry& Entry)
+{
+	if (!Key.Template.IsValid())
+	{
+		return false;
+	}
+
+	// the querier may be gone by the time the query starts, so run it for another waiter
+	if (!IsQuerierAlive(Entry.Querier) && !RehomeEntry(Entry))
+	{
+		return false;
+	}
+
+	FEnvQueryRequest Request(Key.Template.Get(), Entry.Querier.Get());
+
+	// single result queries only return the best item, so shared ones return them all and every sharer claims its own
+	EEnvQueryRunMode::Type RunMode = static_cast<EEnvQueryRunMode::Type>(Key.RunMode);
+
+	if (RunMode == EEnvQueryRunMode::SingleResult && Key.Unique == 0)
+	{
+		RunMode = EEnvQueryRunMode::AllMatching;
+	}
+
+	Entry.QueryId = Request.Execute(RunMode, FQueryFinishedSignature::CreateUObject(this, &UShooterEQSBroker::OnQueryFinished));
+
+	if (Entry.QueryId == INDEX_NONE)
+	{
+		return false;
+	}
+
+	RunningQueries.Add(Entry.QueryId, Key);
+
+	++NumRun;
+	INC_DWORD_STAT(STAT_ShooterEQSRun);
+
+	return true;
+}
+
+void UShooterEQSBroker::RehomeOrphanedQueries()
+{
+	UEnvQueryManager* QueryManager = UEnvQueryManager::GetCurrent(GetWorld());
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FShooterEQSEntry& Entry = It->Value;
+
+		if (Entry.QueryId == INDEX_NONE || IsQuerierAlive(Entry.Querier))
+		{
+			continue;
+		}
+
+		// forget the query before aborting it, so its finished callback is ignored
+		RunningQueries.Remove(Entry.QueryId);
+
+		if (QueryManager)
+		{
+			QueryManager->AbortQuery(Entry.QueryId);
+		}
+
+		Entry.QueryId = INDEX_NONE;
+
+		if (RehomeEntry(Entry))
+		{
+			// start over for the new querier, ahead of the newer queries
+			PendingKeys.Insert(It->Key, 0);
+			continue;
+		}
+
+		// fail the waiters on the next tick
+		for (FShooterEQSWaiter& Waiter : Entry.Waiters)
+		{
+			ReadyResults.Emplace(MoveTemp(Waiter), nullptr);
+		}
+
+		It.RemoveCurrent();
+	}
+}
+
+bool UShooterEQSBroker::RehomeEntry(FShooterEQSEntry& Entry) const
+{
+	for (const FShooterEQSWaiter& Waiter : Entry.Waiters)
+	{
+		if (IsQuerierAlive(Waiter.Querier))
+		{
+			Entry.Querier = Waiter.Querier;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool UShooterEQSBroker::IsQuerierAlive(const TWeakObjectPtr<AShooterAIController>& Querier)
+{
+	if (!Querier.IsValid())
+	{
+		return false;
+	}
+
+	// dead or dormant NPCs keep their controller, but shouldn't drive the squad's queries
+	const AShooterNPC* NPC = Cast<AShooterNPC>(Querier->GetPawn());
+
+	return NPC && !NPC->IsDead() && !NPC->IsDormant();
+}
+
+void UShooterEQSBroker::ClaimItem(FShooterEQSEntry& Entry, FShooterEQSWaiter& Waiter)
+{
+	const int32 NumItems = Entry.Result.IsValid() ? Entry.Result->Items.Num() : 0;
+
+	Waiter.ItemIndex = Entry.NumClaimed < NumItems ? Entry.NumClaimed++ : INDEX_NONE;
+}
+
+void UShooterEQSBroker::OnQueryFinished(TSharedPtr<FEnvQueryResult> Result)
+{
+	FShooterEQSQueryKey Key;
+
+	if (!Result.IsValid() || !RunningQueries.RemoveAndCopyValue(Result->QueryID, Key))
+	{
+		return;
+	}
+
+	FShooterEQSEntry* Entry = Entries.Find(Key);
+
+	if (!Entry)
+	{
+		return;
+	}
+
+	// the waiters may request again from inside their delegates, so take them out first
+	TArray<FShooterEQSWaiter> Waiters = MoveTemp(Entry->Waiters);
+
+	if (Result->IsSuccessful())
+	{
+		Entry->Result = Result;
+		Entry->FinishTime = GetWorld()->GetTimeSeconds();
+		Entry->QueryId = INDEX_NONE;
+
+	} else {
+
+		// only successful results are shared
+		Entries.Remove(Key);
+		Entry = nullptr;
+	}
+
+	// claim the items in request order, so the first requester gets the best one
+	for (FShooterEQSWaiter& Waiter : Waiters)
+	{
+		if (Entry && Entry->Result.IsValid())
+		{
+			ClaimItem(*Entry, Waiter);
+		}
+	}
+
+	for (FShooterEQSWaiter& Waiter : Waiters)
+	{
+		Waiter.OnFinished.ExecuteIfBound(Result, Waiter.ItemIndex);
+	}
+}
+
+void UShooterEQSBroker::ResetCounts()
+{
+	NumRun = 0;
+	NumShared = 0;
+}
+
+namespace ShooterEQSBroker
+{
+	/** Logs the queries run and shared */
+	static void ReportStats(const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterEQSBroker* Broker = World ? World->GetSubsystem<UShooterEQSBroker>() : nullptr;
+
+		if (!Broker)
+		{
+			return;
+		}
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			Broker->ResetCounts();
+			return;
+		}
+
+		const int64 NumRun = Broker->GetNumRun();
+		const int64 NumShared = Broker->GetNumShared();
+		const int64 NumRequests = NumRun + NumShared;
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("EQS broker: %lld requests, %lld queries run, %lld served from shared results (%.1f%%)"),
+			NumRequests, NumRun, NumShared, NumRequests > 0 ? 100.0 * NumShared / NumRequests : 0.0);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Shooter.AI.EQSStats"),
+		TEXT("Logs the AI environment queries run versus served from shared results. Pass 'reset' to clear the counts"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportStats));
+}
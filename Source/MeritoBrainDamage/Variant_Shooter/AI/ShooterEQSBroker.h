@@ -0,0 +1,198 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "ShooterEQSBroker.generated.h"
+
+class UEnvQuery;
+class AShooterAIController;
+
+/** Called with the shared result and the index of the item handed to this requester, or INDEX_NONE if there's none left */
+DECLARE_DELEGATE_TwoParams(FShooterEQSResultDelegate, TSharedPtr<FEnvQueryResult>, int32);
+
+/**
+ *  Identifies queries whose results can be shared: same template, same target and close enough querier locations
+ */
+struct FShooterEQSQueryKey
+{
+	/** Query template */
+	TWeakObjectPtr<UEnvQuery> Template;
+
+	/** Target of the querier, as provided by UEnvQueryContext_Target */
+	TWeakObjectPtr<AActor> Target;
+
+	/** Querier location rounded to the sharing grid */
+	FIntVector Location = FIntVector::ZeroValue;
+
+	/** Run mode of the query */
+	uint8 RunMode = 0;
+
+	/** Non-zero for requests that must not be shared */
+	int32 Unique = 0;
+
+	bool operator==(const FShooterEQSQueryKey& Other) const
+	{
+		return Template == Other.Template && Target == Other.Target && Location == Other.Location && RunMode == Other.RunMode && Unique == Other.Unique;
+	}
+
+	friend uint32 GetTypeHash(const FShooterEQSQueryKey& Key)
+	{
+		uint32 Hash = HashCombineFast(GetTypeHash(Key.Template), GetTypeHash(Key.Target));
+		Hash = HashCombineFast(Hash, GetTypeHash(Key.Location));
+		return HashCombineFast(Hash, GetTypeHash(Key.RunMode) ^ GetTypeHash(Key.Unique));
+	}
+};
+
+/**
+ *  Requester waiting on a shared query
+ */
+struct FShooterEQSWaiter
+{
+	/** ID handed out to the requester */
+	int32 RequestId = INDEX_NONE;
+
+	/** Controller of the requester, so the query can move to it if its querier goes away */
+	TWeakObjectPtr<AShooterAIController> Querier;
+
+	/** Result item claimed by the requester */
+	int32 ItemIndex = INDEX_NONE;
+
+	/** Called with the shared result */
+	FShooterEQSResultDelegate OnFinished;
+};
+
+/**
+ *  Shared query, either waiting to start, running or holding a result
+ */
+struct FShooterEQSEntry
+{
+	/** Controller the query runs for. The first requester with this key, or the next one still around if it goes away */
+	TWeakObjectPtr<AShooterAIController> Querier;
+
+	/** Requesters waiting on the result */
+	TArray<FShooterEQSWaiter> Waiters;
+
+	/** Finished result, shared until it expires */
+	TSharedPtr<FEnvQueryResult> Result;
+
+	/** Game time the result came in */
+	float FinishTime = 0.0f;
+
+	/** ID of the running query, or INDEX_NONE */
+	int32 QueryId = INDEX_NONE;
+
+	/** Result items handed out so far. Each requester gets the next one, so sharers don't all pick the same item */
+	int32 NumClaimed = 0;
+};
+
+/**
+ *  Broker for the shooter AI environment queries
+ *  Squads chasing the same target issue nearly identical queries, so requests sharing a template, target and rounded location
+ *  are merged into one query and the result is served to every requester for a short time.
+ *  New queries are started at a limited rate, while the EQS manager's time budget is set in DefaultGame.ini
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterEQSBroker : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Shared queries by key */
+	TMap<FShooterEQSQueryKey, FShooterEQSEntry> Entries;
+
+	/** Keys waiting to start, oldest first */
+	TArray<FShooterEQSQueryKey> PendingKeys;
+
+	/** Keys of the running queries by query ID */
+	TMap<int32, FShooterEQSQueryKey> RunningQueries;
+
+	/** Shared results waiting to be handed out on the next tick, with the item claimed by each waiter */
+	TArray<TPair<FShooterEQSWaiter, TSharedPtr<FEnvQueryResult>>> ReadyResults;
+
+	/** Frame the start count belongs to */
+	uint64 StartFrame = 0;
+
+	/** Queries started during StartFrame */
+	int32 NumStartedThisFrame = 0;
+
+	/** Last request ID handed out */
+	int32 LastRequestId = 0;
+
+	/** Queries run since the last reset */
+	int64 NumRun = 0;
+
+	/** Requests served by a shared query since the last reset */
+	int64 NumShared = 0;
+
+protected:
+
+	/** Querier locations closer than this share results */
+	UPROPERTY(Config)
+	float LocationGrid = 300.0f;
+
+	/** Time a finished result is shared for */
+	UPROPERTY(Config)
+	float ResultLifetime = 1.0f;
+
+	/** Max new queries started each frame. The rest wait for the next frames */
+	UPROPERTY(Config)
+	int32 MaxQueriesStartedPerFrame = 4;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Starts the pending queries and drops the expired results */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Aborts the running queries */
+	virtual void Deinitialize() override;
+
+	/**
+	 *  Requests a query for an NPC controller. The delegate is always called later, never from inside this call.
+	 *  Returns a request ID that can be used to abort, or INDEX_NONE if the query couldn't be requested
+	 */
+	int32 RunQuery(UEnvQuery* Template, AShooterAIController* Querier, EEnvQueryRunMode::Type RunMode, const FShooterEQSResultDelegate& OnFinished);
+
+	/** Stops waiting on a request. The shared query keeps running for the other requesters */
+	void AbortRequest(int32 RequestId);
+
+	/** Returns the counts since the last reset */
+	int64 GetNumRun() const { return NumRun; }
+	int64 GetNumShared() const { return NumShared; }
+
+	/** Resets the counts */
+	void ResetCounts();
+
+protected:
+
+	/** Builds the sharing key for a request */
+	FShooterEQSQueryKey MakeKey(UEnvQuery* Template, const AShooterAIController* Querier, EEnvQueryRunMode::Type RunMode) const;
+
+	/** Starts pending queries until this frame's limit is reached */
+	void StartPendingQueries();
+
+	/** Starts a shared query on the EQS manager */
+	bool StartQuery(const FShooterEQSQueryKey& Key, FShooterEQSEntry& Entry);
+
+	/** Restarts the running queries whose querier went away for one of their waiters, or fails them if nobody is left */
+	void RehomeOrphanedQueries();
+
+	/** Moves a query to the first waiter still able to run it. Returns false if there's none */
+	bool RehomeEntry(FShooterEQSEntry& Entry) const;
+
+	/** Returns true if a controller can still run queries */
+	static bool IsQuerierAlive(const TWeakObjectPtr<AShooterAIController>& Querier);
+
+	/** Claims the next unclaimed item of an entry's result for a waiter */
+	static void ClaimItem(FShooterEQSEntry& Entry, FShooterEQSWaiter& Waiter);
+
+	/** Stores a finished result and hands it to the waiting requesters */
+	void OnQueryFinished(TSharedPtr<FEnvQueryResult> Result);
+};
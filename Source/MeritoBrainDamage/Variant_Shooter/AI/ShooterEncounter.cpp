@@ -0,0 +1,489 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterEncounter.h"
+#include "ShooterNPC.h"
+#include "ShooterDormancy.h"
+#include "ShooterWeapon.h"
+#include "NavigationSystem.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Wave Spawning"), STAT_ShooterWaveSpawning, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Wave Spawns"), STAT_ShooterPendingWaveSpawns, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Wave NPCs Spawned"), STAT_ShooterWaveNPCsSpawned, STATGROUP_Shooter);
+
+namespace ShooterEncounter
+{
+	/** Extent used to put spawn points on the navmesh */
+	static const FVector ProjectExtent(200.0f, 200.0f, 300.0f);
+}
+
+bool UShooterEncounterSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterEncounterSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterEncounterSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterEncounterSubsystem::Deinitialize()
+{
+	StopEncounter();
+
+	Super::Deinitialize();
+}
+
+void UShooterEncounterSubsystem::StartEncounter(UShooterEncounterData* InEncounter)
+{
+	StopEncounter();
+
+	if (!InEncounter || InEncounter->Waves.Num() == 0)
+	{
+		return;
+	}
+
+	Encounter = InEncounter;
+	Reports.Reset();
+
+	// pick the spawn locations once, so spawning only has to cycle through them
+	BuildSpawnPoints();
+
+	if (SpawnPoints.Num() == 0)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Encounter %s has no spawn locations"), *Encounter->GetName());
+
+		Encounter = nullptr;
+		return;
+	}
+
+	// woken NPCs come back as new or reused actors, so pick them up as they appear
+	if (UShooterDormancySubsystem* Dormancy = GetWorld()->GetSubsystem<UShooterDormancySubsystem>())
+	{
+		NPCActivatedHandle = Dormancy->OnNPCActivated.AddUObject(this, &UShooterEncounterSubsystem::OnNPCActivated);
+	}
+
+	WaveIndex = 0;
+	WaveTimer = Encounter->Waves[0].StartDelay;
+	Phase = EPhase::Waiting;
+}
+
+void UShooterEncounterSubsystem::StopEncounter()
+{
+	if (LoadHandle.IsValid())
+	{
+		LoadHandle->CancelHandle();
+		LoadHandle.Reset();
+	}
+
+	if (NPCActivatedHandle.IsValid())
+	{
+		if (UShooterDormancySubsystem* Dormancy = GetWorld()->GetSubsystem<UShooterDormancySubsystem>())
+		{
+			Dormancy->OnNPCActivated.Remove(NPCActivatedHandle);
+		}
+
+		NPCActivatedHandle.Reset();
+	}
+
+	Encounter = nullptr;
+	SpawnPoints.Reset();
+	PendingSpawns.Reset();
+	WaveNPCs.Reset();
+	WaveIndex = INDEX_NONE;
+	WaveId = INDEX_NONE;
+	Phase = EPhase::Idle;
+}
+
+void UShooterEncounterSubsystem::Tick(float DeltaTime)
+{
+	switch (Phase)
+	{
+	case EPhase::Waiting:
+
+		WaveTimer -= DeltaTime;
+
+		if (WaveTimer <= 0.0f)
+		{
+			BeginWave();
+		}
+
+		break;
+
+	case EPhase::Spawning:
+
+		SpawnPending();
+		break;
+
+	case EPhase::Fighting:
+
+		CheckWaveCleared();
+		break;
+
+	default:
+		break;
+	}
+
+	SET_DWORD_STAT(STAT_ShooterPendingWaveSpawns, PendingSpawns.Num());
+}
+
+void UShooterEncounterSubsystem::BeginWave()
+{
+	Phase = EPhase::Loading;
+	WaveStartTime = FPlatformTime::Seconds();
+
+	CurrentReport = FShooterWaveReport();
+	CurrentReport.WaveIndex = WaveIndex;
+
+	WaveId = NextWaveId++;
+
+	// release the previous wave's classes, unless this wave uses them too
+	TSharedPtr<FStreamableHandle> PreviousHandle = MoveTemp(LoadHandle);
+
+	TArray<FSoftObjectPath> ClassesToLoad;
+
+	for (const FShooterWaveSpawn& Spawn : Encounter->Waves[WaveIndex].Spawns)
+	{
+		if (!Spawn.NPCClass.IsNull())
+		{
+			ClassesToLoad.AddUnique(Spawn.NPCClass.ToSoftObjectPath());
+		}
+
+		if (!Spawn.WeaponClass.IsNull())
+		{
+			ClassesToLoad.AddUnique(Spawn.WeaponClass.ToSoftObjectPath());
+		}
+	}
+
+	// the callback can run right away if everything is already loaded
+	LoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassesToLoad, FStreamableDelegate::CreateUObject(this, &UShooterEncounterSubsystem::OnWaveClassesLoaded, WaveIndex));
+
+	if (PreviousHandle.IsValid())
+	{
+		PreviousHandle->ReleaseHandle();
+	}
+
+	// nothing to load means nothing to spawn either
+	if (!LoadHandle.IsValid() && Phase == EPhase::Loading)
+	{
+		OnWaveClassesLoaded(WaveIndex);
+	}
+}
+
+void UShooterEncounterSubsystem::OnWaveClassesLoaded(int32 LoadedWaveIndex)
+{
+	// ignore loads for a wave or encounter we already stopped
+	if (Phase != EPhase::Loading || LoadedWaveIndex != WaveIndex)
+	{
+		return;
+	}
+
+	CurrentReport.LoadTime = FPlatformTime::Seconds() - WaveStartTime;
+
+	// queue the wave's NPCs, interleaving the groups so a wave doesn't arrive one type at a time
+	const TArray<FShooterWaveSpawn>& Spawns = Encounter->Waves[WaveIndex].Spawns;
+
+	int32 MaxCount = 0;
+
+	for (const FShooterWaveSpawn& Spawn : Spawns)
+	{
+		MaxCount = FMath::Max(MaxCount, Spawn.Count);
+	}
+
+	for (int32 i = 0; i < MaxCount; ++i)
+	{
+		for (const FShooterWaveSpawn& Spawn : Spawns)
+		{
+			TSubclassOf<AShooterNPC> NPCClass = Spawn.NPCClass.Get();
+
+			if (i >= Spawn.Count || !NPCClass)
+			{
+				continue;
+			}
+
+			FPendingSpawn& Pending = PendingSpawns.AddDefaulted_GetRef();
+			Pending.NPCClass = NPCClass;
+			Pending.WeaponClass = Spawn.WeaponClass.IsNull() ? NPCClass->GetDefaultObject<AShooterNPC>()->GetWeaponClass() : TSubclassOf<AShooterWeapon>(Spawn.WeaponClass.Get());
+			Pending.Team = Spawn.Team;
+		}
+	}
+
+	Phase = EPhase::Spawning;
+}
+
+void UShooterEncounterSubsystem::SpawnPending()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterWaveSpawning);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = SpawnBudgetMs * 0.001;
+
+	int32 NumSpawned = 0;
+	int32 NumProcessed = 0;
+
+	// always make progress, then keep going while there's budget left
+	while (NumProcessed < PendingSpawns.Num() && NumSpawned < MaxSpawnsPerFrame
+		&& (NumProcessed == 0 || FPlatformTime::Seconds() - StartTime < Budget))
+	{
+		if (SpawnNPC(PendingSpawns[NumProcessed]))
+		{
+			++NumSpawned;
+		}
+
+		++NumProcessed;
+	}
+
+	PendingSpawns.RemoveAt(0, NumProcessed, EAllowShrinking::No);
+
+	const double FrameTime = FPlatformTime::Seconds() - StartTime;
+
+	if (NumSpawned > 0)
+	{
+		CurrentReport.NumSpawned += NumSpawned;
+		++CurrentReport.NumSpawnFrames;
+		CurrentReport.MaxFrameSpawnTime = FMath::Max(CurrentReport.MaxFrameSpawnTime, FrameTime);
+
+		INC_DWORD_STAT_BY(STAT_ShooterWaveNPCsSpawned, NumSpawned);
+	}
+
+	if (PendingSpawns.Num() > 0)
+	{
+		return;
+	}
+
+	// the whole wave is in play
+	CurrentReport.TotalTime = FPlatformTime::Seconds() - WaveStartTime;
+	Reports.Add(CurrentReport);
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Wave %d spawned %d NPCs in %.1f ms (load %.1f ms, %d frames, worst frame %.2f ms)"),
+		WaveIndex, CurrentReport.NumSpawned, CurrentReport.TotalTime * 1000.0, CurrentReport.LoadTime * 1000.0, CurrentReport.NumSpawnFrames, CurrentReport.MaxFrameSpawnTime * 1000.0);
+
+	Phase = EPhase::Fighting;
+}
+
+bool UShooterEncounterSubsystem::SpawnNPC(const FPendingSpawn& Pending)
+{
+	FVector Location;
+
+	if (!PickSpawnPoint(Location))
+	{
+		return false;
+	}
+
+	const AShooterNPC* CDO = Pending.NPCClass->GetDefaultObject<AShooterNPC>();
+	const FTransform SpawnTransform(FRotator(0.0f, FMath::FRandRange(-180.0f, 180.0f), 0.0f), Location + FVector(0.0f, 0.0f, CDO->GetCapsuleComponent()->GetScaledCapsuleHalfHeight()));
+
+	// set the weapon and team before begin play spawns the weapon
+	AShooterNPC* NPC = GetWorld()->SpawnActorDeferred<AShooterNPC>(Pending.NPCClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+
+	if (!NPC)
+	{
+		return false;
+	}
+
+	NPC->SetSpawnProfile(Pending.WeaponClass, Pending.Team);
+	NPC->SetWaveId(WaveId);
+	NPC->FinishSpawning(SpawnTransform);
+
+	// spawned pawns only get a controller if their class auto possesses them
+	if (!NPC->GetController())
+	{
+		NPC->SpawnDefaultController();
+	}
+
+	WaveNPCs.Add(NPC);
+
+	return true;
+}
+
+void UShooterEncounterSubsystem::CheckWaveCleared()
+{
+	// drop dead NPCs and the actors that went dormant. A dormant NPC lives on as an entity tagged with the wave,
+	// and its actor may be destroyed or reused for another NPC, so it's counted through the dormancy subsystem instead
+	WaveNPCs.RemoveAllSwap([this](const TWeakObjectPtr<AShooterNPC>& NPC)
+	{
+		return !NPC.IsValid() || NPC->IsDead() || NPC->IsDormant() || NPC->GetWaveId() != WaveId;
+	});
+
+	const UShooterDormancySubsystem* Dormancy = GetWorld()->GetSubsystem<UShooterDormancySubsystem>();
+	const int32 NumRemaining = WaveNPCs.Num() + (Dormancy ? Dormancy->GetNumDormantInWave(WaveId) : 0);
+
+	if (NumRemaining > Encounter->Waves[WaveIndex].ClearedAtRemaining)
+	{
+		return;
+	}
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Wave %d of %s cleared"), WaveIndex, *Encounter->GetName());
+
+	WaveNPCs.Reset();
+
+	if (++WaveIndex < Encounter->Waves.Num())
+	{
+		WaveTimer = Encounter->Waves[WaveIndex].StartDelay;
+		Phase = EPhase::Waiting;
+
+	} else {
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Encounter %s finished"), *Encounter->GetName());
+
+		// keep the reports around for the stats command
+		TArray<FShooterWaveReport> FinishedReports = MoveTemp(Reports);
+		StopEncounter();
+		Reports = MoveTemp(FinishedReports);
+	}
+}
+
+void UShooterEncounterSubsystem::OnNPCActivated(AShooterNPC* NPC)
+{
+	if (NPC && WaveId != INDEX_NONE && NPC->GetWaveId() == WaveId)
+	{
+		WaveNPCs.AddUnique(NPC);
+	}
+}
+
+void UShooterEncounterSubsystem::BuildSpawnPoints()
+{
+	SpawnPoints.Reset();
+	NextSpawnPoint = 0;
+
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	if (!NavSys)
+	{
+		return;
+	}
+
+	// use the designer placed spawn points if the map has any
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		FNavLocation NavLocation;
+
+		if (It->ActorHasTag(Encounter->SpawnPointTag) && NavSys->ProjectPointToNavigation(It->GetActorLocation(), NavLocation, ShooterEncounter::ProjectExtent))
+		{
+			SpawnPoints.Add(NavLocation.Location);
+		}
+	}
+
+	// otherwise sample the navmesh around the first player
+	if (SpawnPoints.Num() == 0)
+	{
+		const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+		const APawn* Player = PlayerController ? PlayerController->GetPawn() : nullptr;
+
+		for (int32 i = 0; Player && i < NumSampledSpawnPoints; ++i)
+		{
+			FNavLocation NavLocation;
+
+			if (NavSys->GetRandomReachablePointInRadius(Player->GetActorLocation(), SampleRadius, NavLocation))
+			{
+				SpawnPoints.Add(NavLocation.Location);
+			}
+		}
+	}
+
+	// shuffle so consecutive spawns spread out
+	for (int32 i = SpawnPoints.Num() - 1; i > 0; --i)
+	{
+		SpawnPoints.Swap(i, FMath::RandRange(0, i));
+	}
+}
+
+bool UShooterEncounterSubsystem::PickSpawnPoint(FVector& OutLocation)
+{
+	// gather the player locations
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APawn* Player = It->Get() ? It->Get()->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Player->GetActorLocation());
+		}
+	}
+
+	const float MinDistanceSquared = FMath::Square(MinPlayerDistance);
+
+	// cycle through the spawn points, skipping the ones too close to a player
+	for (int32 Tries = 0; Tries < SpawnPoints.Num(); ++Tries)
+	{
+		const FVector& Candidate = SpawnPoints[NextSpawnPoint];
+		NextSpawnPoint = (NextSpawnPoint + 1) % SpawnPoints.Num();
+
+		const bool bTooClose = PlayerLocations.ContainsByPredicate([&Candidate, MinDistanceSquared](const FVector& PlayerLocation)
+		{
+			return FVector::DistSquared(Candidate, PlayerLocation) < MinDistanceSquared;
+		});
+
+		if (!bTooClose)
+		{
+			OutLocation = Candidate;
+			return true;
+		}
+	}
+
+	// every point is close to a player, so use the next one anyway rather than stall the wave
+	if (SpawnPoints.Num() > 0)
+	{
+		OutLocation = SpawnPoints[NextSpawnPoint];
+		NextSpawnPoint = (NextSpawnPoint + 1) % SpawnPoints.Num();
+		return true;
+	}
+
+	return false;
+}
+
+namespace ShooterEncounter
+{
+	/** Starts an encounter from a data asset path */
+	static void StartEncounter(const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterEncounterSubsystem* Director = World ? World->GetSubsystem<UShooterEncounterSubsystem>() : nullptr;
+		UShooterEncounterData* Data = Args.Num() > 0 ? LoadObject<UShooterEncounterData>(nullptr, *Args[0]) : nullptr;
+
+		if (!Director || !Data)
+		{
+			UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Usage: Shooter.AI.StartEncounter /Game/Path/To/EncounterData"));
+			return;
+		}
+
+		Director->StartEncounter(Data);
+	}
+
+	/** Reports the spawn timings of the encounter's waves */
+	static void ReportEncounter(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const UShooterEncounterSubsystem* Director = World ? World->GetSubsystem<UShooterEncounterSubsystem>() : nullptr;
+
+		if (!Director)
+		{
+			return;
+		}
+
+		Ar.Logf(TEXT("Encounter %s, wave %d"), Director->IsEncounterRunning() ? TEXT("running") : TEXT("idle"), Director->GetWaveIndex());
+
+		for (const FShooterWaveReport& Report : Director->GetReports())
+		{
+			Ar.Logf(TEXT("  wave %d: %d NPCs, load %.1f ms, spawned in %.1f ms over %d frames, worst frame %.2f ms"),
+				Report.WaveIndex, Report.NumSpawned, Report.LoadTime * 1000.0, Report.TotalTime * 1000.0, Report.NumSpawnFrames, Report.MaxFrameSpawnTime * 1000.0);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs StartCommand(
+		TEXT("Shooter.AI.StartEncounter"),
+		TEXT("Starts an encounter from a data asset. Usage: Shooter.AI.StartEncounter /Game/Path/To/EncounterData"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartEncounter));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice ReportCommand(
+		TEXT("Shooter.AI.EncounterStats"),
+		TEXT("Reports how long each wave of the current encounter took to load and spawn"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&ReportEncounter));
+}
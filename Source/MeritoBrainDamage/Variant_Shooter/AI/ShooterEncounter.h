@@ -0,0 +1,257 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterEncounter.generated.h"
+
+class AShooterNPC;
+class AShooterWeapon;
+struct FStreamableHandle;
+
+/**
+ *  Group of identical NPCs spawned by a wave
+ */
+USTRUCT(BlueprintType)
+struct FShooterWaveSpawn
+{
+	GENERATED_BODY()
+
+	/** NPC class to spawn */
+	UPROPERTY(EditAnywhere, Category="Wave")
+	TSoftClassPtr<AShooterNPC> NPCClass;
+
+	/** Weapon the NPCs carry. Uses the NPC class default if not set */
+	UPROPERTY(EditAnywhere, Category="Wave")
+	TSoftClassPtr<AShooterWeapon> WeaponClass;
+
+	/** Number of NPCs to spawn */
+	UPROPERTY(EditAnywhere, Category="Wave", meta = (ClampMin = 1))
+	int32 Count = 1;
+
+	/** Team of the NPCs */
+	UPROPERTY(EditAnywhere, Category="Wave")
+	uint8 Team = 1;
+};
+
+/**
+ *  One wave of an encounter
+ */
+USTRUCT(BlueprintType)
+struct FShooterWaveDefinition
+{
+	GENERATED_BODY()
+
+	/** NPCs to spawn */
+	UPROPERTY(EditAnywhere, Category="Wave")
+	TArray<FShooterWaveSpawn> Spawns;
+
+	/** Time to wait after the previous wave is cleared before starting this one */
+	UPROPERTY(EditAnywhere, Category="Wave", meta = (ClampMin = 0, Units = "s"))
+	float StartDelay = 2.0f;
+
+	/** The wave counts as cleared once this many of its NPCs or fewer are left alive */
+	UPROPERTY(EditAnywhere, Category="Wave", meta = (ClampMin = 0))
+	int32 ClearedAtRemaining = 0;
+};
+
+/**
+ *  Waves of NPCs for an encounter, run by the encounter director
+ */
+UCLASS(BlueprintType)
+class MERITOBRAINDAMAGE_API UShooterEncounterData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Waves, in order */
+	UPROPERTY(EditAnywhere, Category="Encounter")
+	TArray<FShooterWaveDefinition> Waves;
+
+	/** Actors with this tag mark the spawn locations. If none are found, locations are sampled from the navmesh around the player */
+	UPROPERTY(EditAnywhere, Category="Encounter")
+	FName SpawnPointTag = FName("EncounterSpawn");
+};
+
+/**
+ *  Spawn timings for one wave
+ */
+struct FShooterWaveReport
+{
+	/** Index of the wave in the encounter */
+	int32 WaveIndex = INDEX_NONE;
+
+	/** Number of NPCs spawned */
+	int32 NumSpawned = 0;
+
+	/** Frames that spawned at least one NPC */
+	int32 NumSpawnFrames = 0;
+
+	/** Time from the wave start until the classes finished loading */
+	double LoadTime = 0.0;
+
+	/** Time from the wave start until the last NPC spawned */
+	double TotalTime = 0.0;
+
+	/** Most time spent spawning in a single frame */
+	double MaxFrameSpawnTime = 0.0;
+};
+
+/**
+ *  Encounter director
+ *  Runs the waves of an encounter data asset. Each wave async loads its NPC and weapon classes, then spawns
+ *  its NPC, controller and weapon triples a few per frame from a set of spawn locations chosen when the encounter starts,
+ *  so a large wave doesn't hitch the game thread
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterEncounterSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** NPC waiting to be spawned */
+	struct FPendingSpawn
+	{
+		TSubclassOf<AShooterNPC> NPCClass;
+		TSubclassOf<AShooterWeapon> WeaponClass;
+		uint8 Team = 1;
+	};
+
+	/** Wave progress */
+	enum class EPhase : uint8
+	{
+		Idle,
+		Waiting,
+		Loading,
+		Spawning,
+		Fighting
+	};
+
+	/** Encounter being run */
+	UPROPERTY()
+	TObjectPtr<UShooterEncounterData> Encounter;
+
+	/** Keeps the current wave's classes loaded */
+	TSharedPtr<FStreamableHandle> LoadHandle;
+
+	/** Precomputed spawn locations on the ground */
+	TArray<FVector> SpawnPoints;
+
+	/** Next spawn location to try */
+	int32 NextSpawnPoint = 0;
+
+	/** NPCs left to spawn in the current wave */
+	TArray<FPendingSpawn> PendingSpawns;
+
+	/** Awake NPCs of the current wave. Its dormant NPCs are counted by the dormancy subsystem */
+	TArray<TWeakObjectPtr<AShooterNPC>> WaveNPCs;
+
+	/** Dormancy activation binding, to pick up the wave's NPCs when they wake up */
+	FDelegateHandle NPCActivatedHandle;
+
+	/** Timings of the finished waves */
+	TArray<FShooterWaveReport> Reports;
+
+	/** Timings of the current wave */
+	FShooterWaveReport CurrentReport;
+
+	/** Time the current wave started */
+	double WaveStartTime = 0.0;
+
+	/** Current wave progress */
+	EPhase Phase = EPhase::Idle;
+
+	/** Index of the current wave */
+	int32 WaveIndex = INDEX_NONE;
+
+	/** ID tagged on the current wave's NPCs, unique across encounters so they survive dormancy without mixing up waves */
+	int32 WaveId = INDEX_NONE;
+
+	/** ID the next wave gets */
+	int32 NextWaveId = 0;
+
+	/** Time left before the next wave starts */
+	float WaveTimer = 0.0f;
+
+protected:
+
+	/** Max NPCs spawned per frame */
+	UPROPERTY(Config)
+	int32 MaxSpawnsPerFrame = 2;
+
+	/** Time budget for spawning each frame. At least one NPC is spawned every frame while a wave is spawning */
+	UPROPERTY(Config)
+	float SpawnBudgetMs = 2.0f;
+
+	/** Spawn locations closer than this to a player are skipped */
+	UPROPERTY(Config)
+	float MinPlayerDistance = 1500.0f;
+
+	/** Number of navmesh locations to sample when the map has no tagged spawn points */
+	UPROPERTY(Config)
+	int32 NumSampledSpawnPoints = 64;
+
+	/** Radius around the player to sample navmesh spawn locations from */
+	UPROPERTY(Config)
+	float SampleRadius = 6000.0f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Runs the wave timers, spawning and clear checks */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Releases the loaded classes */
+	virtual void Deinitialize() override;
+
+	/** Starts running an encounter from its first wave, replacing any encounter in progress */
+	UFUNCTION(BlueprintCallable, Category="Encounter")
+	void StartEncounter(UShooterEncounterData* InEncounter);
+
+	/** Stops the encounter in progress. NPCs already spawned stay in play */
+	UFUNCTION(BlueprintCallable, Category="Encounter")
+	void StopEncounter();
+
+	/** Returns true while an encounter is running */
+	UFUNCTION(BlueprintPure, Category="Encounter")
+	bool IsEncounterRunning() const { return Phase != EPhase::Idle; }
+
+	/** Returns the index of the current wave */
+	int32 GetWaveIndex() const { return WaveIndex; }
+
+	/** Returns the timings of the finished waves */
+	const TArray<FShooterWaveReport>& GetReports() const { return Reports; }
+
+protected:
+
+	/** Starts loading the classes of the current wave */
+	void BeginWave();
+
+	/** Called when the current wave's classes finish loading */
+	void OnWaveClassesLoaded(int32 LoadedWaveIndex);
+
+	/** Spawns pending NPCs within the frame budget */
+	void SpawnPending();
+
+	/** Spawns one NPC with its controller and weapon. Returns false if it couldn't be spawned */
+	bool SpawnNPC(const FPendingSpawn& Pending);
+
+	/** Moves to the next wave once the current one is cleared */
+	void CheckWaveCleared();
+
+	/** Tracks a woken NPC again if it belongs to the current wave */
+	void OnNPCActivated(AShooterNPC* NPC);
+
+	/** Collects the spawn locations for the encounter */
+	void BuildSpawnPoints();
+
+	/** Returns the next spawn location away from the players */
+	bool PickSpawnPoint(FVector& OutLocation);
+};
@@ -0,0 +1,575 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterFlowField.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Flow Field Build"), STAT_ShooterFlowFieldBuild, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flow Fields"), STAT_ShooterFlowFields, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Flow Field Tile Relaxations"), STAT_ShooterFlowFieldTiles, STATGROUP_Shooter);
+
+namespace ShooterFlowField
+{
+	/** Neighbor offsets. The first four are orthogonal */
+	static const FIntPoint Offsets[8] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+	/** Opposite of each neighbor direction */
+	static const int32 Opposite[8] = { 1, 0, 3, 2, 7, 6, 5, 4 };
+
+	/** Cost of moving to each neighbor */
+	static const float Costs[8] = { 1.0f, 1.0f, 1.0f, 1.0f, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2, UE_SQRT_2 };
+
+	/** Direction value for cells without a way to the target */
+	static constexpr uint8 NoDirection = 255;
+
+	/** Integration value for unreached cells */
+	static constexpr float Unreached = TNumericLimits<float>::Max();
+}
+
+bool UShooterFlowFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterFlowFieldSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterFlowFieldSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	BuildWalkableGrid();
+}
+
+void UShooterFlowFieldSubsystem::BuildWalkableGrid()
+{
+	Links.Reset();
+
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance() : nullptr;
+	const FBox NavBounds = NavData ? NavSys->GetNavigableWorldBounds() : FBox(ForceInit);
+
+	if (!NavBounds.IsValid)
+	{
+		UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("Flow fields disabled, no navigable bounds in this world"));
+		return;
+	}
+
+	const FVector Size = NavBounds.GetSize();
+
+	// grow the cells until the grid fits the budget
+	CellSize = FMath::Max(CellSize, FMath::Sqrt(Size.X * Size.Y / MaxCells));
+
+	GridOrigin = NavBounds.Min;
+	GridSize = FIntPoint(FMath::CeilToInt32(Size.X / CellSize), FMath::CeilToInt32(Size.Y / CellSize));
+	NumTiles = FIntPoint(FMath::DivideAndRoundUp(GridSize.X, TileSize), FMath::DivideAndRoundUp(GridSize.Y, TileSize));
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+
+	Links.SetNumZeroed(NumCells);
+
+	// the grid is flat, so project through the whole height of the navigable area
+	const FVector ProjectExtent(CellSize * 0.4f, CellSize * 0.4f, Size.Z * 0.5f + 100.0f);
+	const float CenterZ = NavBounds.GetCenter().Z;
+
+	// navmesh point of every walkable cell
+	TArray<FVector> NavPoints;
+	TBitArray<> Walkable(false, NumCells);
+
+	NavPoints.SetNumUninitialized(NumCells);
+
+	int32 NumWalkable = 0;
+
+	for (int32 Y = 0; Y < GridSize.Y; ++Y)
+	{
+		for (int32 X = 0; X < GridSize.X; ++X)
+		{
+			const FVector CellCenter(GridOrigin.X + (X + 0.5f) * CellSize, GridOrigin.Y + (Y + 0.5f) * CellSize, CenterZ);
+
+			FNavLocation NavLocation;
+
+			if (NavSys->ProjectPointToNavigation(CellCenter, NavLocation, ProjectExtent))
+			{
+				Walkable[Y * GridSize.X + X] = true;
+				NavPoints[Y * GridSize.X + X] = NavLocation.Location;
+				++NumWalkable;
+			}
+		}
+	}
+
+	int32 NumLinks = 0;
+
+	auto Link = [this, &NumLinks](int32 CellIndex, int32 Dir)
+	{
+		const FIntPoint& Offset = ShooterFlowField::Offsets[Dir];
+		const int32 NeighborIndex = CellIndex + Offset.Y * GridSize.X + Offset.X;
+
+		Links[CellIndex] |= 1 << Dir;
+		Links[NeighborIndex] |= 1 << ShooterFlowField::Opposite[Dir];
+		++NumLinks;
+	};
+
+	// orthogonal neighbors are linked if the navmesh reaches from one center to the other without crossing a wall
+	for (int32 Y = 0; Y < GridSize.Y; ++Y)
+	{
+		for (int32 X = 0; X < GridSize.X; ++X)
+		{
+			const int32 CellIndex = Y * GridSize.X + X;
+
+			if (!Walkable[CellIndex])
+			{
+				continue;
+			}
+
+			// right and up, the other two come from the neighbors
+			for (const int32 Dir : { 0, 2 })
+			{
+				const int32 NX = X + ShooterFlowField::Offsets[Dir].X;
+				const int32 NY = Y + ShooterFlowField::Offsets[Dir].Y;
+
+				if (NX >= GridSize.X || NY >= GridSize.Y || !Walkable[NY * GridSize.X + NX])
+				{
+					continue;
+				}
+
+				FVector HitLocation;
+
+				if (!NavData->Raycast(NavPoints[CellIndex], NavPoints[NY * GridSize.X + NX], HitLocation, nullptr))
+				{
+					Link(CellIndex, Dir);
+				}
+			}
+		}
+	}
+
+	// diagonal neighbors are linked if both ways around the corner are, so chasers never cut through wall corners
+	for (int32 Y = 0; Y < GridSize.Y; ++Y)
+	{
+		for (int32 X = 0; X + 1 < GridSize.X; ++X)
+		{
+			const int32 CellIndex = Y * GridSize.X + X;
+			const int32 Right = CellIndex + 1;
+
+			// up right: right then up, and up then right
+			if (Y + 1 < GridSize.Y)
+			{
+				const int32 Up = CellIndex + GridSize.X;
+
+				if ((Links[CellIndex] & (1 << 0)) && (Links[CellIndex] & (1 << 2)) && (Links[Right] & (1 << 2)) && (Links[Up] & (1 << 0)))
+				{
+					Link(CellIndex, 4);
+				}
+			}
+
+			// down right: right then down, and down then right
+			if (Y > 0)
+			{
+				const int32 Down = CellIndex - GridSize.X;
+
+				if ((Links[CellIndex] & (1 << 0)) && (Links[CellIndex] & (1 << 3)) && (Links[Right] & (1 << 3)) && (Links[Down] & (1 << 0)))
+				{
+					Link(CellIndex, 5);
+				}
+			}
+		}
+	}
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Flow field grid %dx%d, %.0f cm cells, %d walkable, %d links"), GridSize.X, GridSize.Y, CellSize, NumWalkable, NumLinks);
+}
+
+void UShooterFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	// drop the fields nobody follows anymore
+	Fields.RemoveAllSwap([this, Now](const FShooterFlowField& Field)
+	{
+		return !Field.Target.IsValid() || Now - Field.RequestTime > ExpireTime;
+	});
+
+	SET_DWORD_STAT(STAT_ShooterFlowFields, Fields.Num());
+
+	if (!HasGrid())
+	{
+		return;
+	}
+
+	for (FShooterFlowField& Field : Fields)
+	{
+		// only rebuild when the target moved to another cell
+		if (!Field.bValid || (Now - Field.BuildTime >= RebuildInterval && GetCell(Field.Target->GetActorLocation()) != Field.TargetCell))
+		{
+			BuildField(Field);
+		}
+	}
+}
+
+void UShooterFlowFieldSubsystem::RequestFlowField(AActor* Target)
+{
+	if (!IsValid(Target))
+	{
+		return;
+	}
+
+	FShooterFlowField* Field = Fields.FindByPredicate([Target](const FShooterFlowField& Existing) { return Existing.Target.Get() == Target; });
+
+	if (!Field)
+	{
+		Field = &Fields.AddDefaulted_GetRef();
+		Field->Target = Target;
+	}
+
+	Field->RequestTime = GetWorld()->GetTimeSeconds();
+}
+
+const FShooterFlowField* UShooterFlowFieldSubsystem::FindField(const AActor* Target) const
+{
+	return Fields.FindByPredicate([Target](const FShooterFlowField& Existing) { return Existing.Target.Get() == Target; });
+}
+
+FIntPoint UShooterFlowFieldSubsystem::GetCell(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt32((Location.X - GridOrigin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt32((Location.Y - GridOrigin.Y) / CellSize);
+
+	if (X < 0 || Y < 0 || X >= GridSize.X || Y >= GridSize.Y)
+	{
+		return FIntPoint(INDEX_NONE, INDEX_NONE);
+	}
+
+	return FIntPoint(X, Y);
+}
+
+void UShooterFlowFieldSubsystem::BuildField(FShooterFlowField& Field) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterFlowFieldBuild);
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+
+	Field.Integration.Init(ShooterFlowField::Unreached, NumCells);
+	Field.Directions.Init(ShooterFlowField::NoDirection, NumCells);
+	Field.BuildTime = GetWorld()->GetTimeSeconds();
+	Field.bValid = true;
+
+	Field.TargetCell = Field.Target.IsValid() ? GetCell(Field.Target->GetActorLocation()) : FIntPoint(INDEX_NONE, INDEX_NONE);
+
+	if (Field.TargetCell.X == INDEX_NONE || !Links[Field.TargetCell.Y * GridSize.X + Field.TargetCell.X])
+	{
+		return;
+	}
+
+	Field.Integration[Field.TargetCell.Y * GridSize.X + Field.TargetCell.X] = 0.0f;
+
+	// tiles are relaxed in four phases so tiles running at the same time are never neighbors,
+	// and each phase only writes inside its own tiles while reading the borders of the others
+	TArray<uint8> DirtyTiles;
+	DirtyTiles.SetNumZeroed(NumTiles.X * NumTiles.Y);
+	DirtyTiles[(Field.TargetCell.Y / TileSize) * NumTiles.X + Field.TargetCell.X / TileSize] = 1;
+
+	TArray<FIntPoint> PhaseTiles;
+	TArray<uint8> BorderChanged;
+
+	bool bAnyDirty = true;
+
+	while (bAnyDirty)
+	{
+		bAnyDirty = false;
+
+		for (int32 Phase = 0; Phase < 4; ++Phase)
+		{
+			PhaseTiles.Reset();
+
+			for (int32 TileY = Phase >> 1; TileY < NumTiles.Y; TileY += 2)
+			{
+				for (int32 TileX = Phase & 1; TileX < NumTiles.X; TileX += 2)
+				{
+					if (DirtyTiles[TileY * NumTiles.X + TileX])
+					{
+						PhaseTiles.Add(FIntPoint(TileX, TileY));
+					}
+				}
+			}
+
+			if (PhaseTiles.Num() == 0)
+			{
+				continue;
+			}
+
+			INC_DWORD_STAT_BY(STAT_ShooterFlowFieldTiles, PhaseTiles.Num());
+
+			BorderChanged.SetNumZeroed(PhaseTiles.Num());
+
+			ParallelFor(PhaseTiles.Num(), [&](int32 Index)
+			{
+				const FIntPoint& Tile = PhaseTiles[Index];
+
+				DirtyTiles[Tile.Y * NumTiles.X + Tile.X] = 0;
+				BorderChanged[Index] = RelaxTile(Field, Tile.X, Tile.Y);
+
+			}, PhaseTiles.Num() == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced);
+
+			// wake the neighbors of any tile whose border improved
+			for (int32 Index = 0; Index < PhaseTiles.Num(); ++Index)
+			{
+				if (!BorderChanged[Index])
+				{
+					continue;
+				}
+
+				for (const FIntPoint& Offset : ShooterFlowField::Offsets)
+				{
+					const FIntPoint Neighbor = PhaseTiles[Index] + Offset;
+
+					if (Neighbor.X >= 0 && Neighbor.Y >= 0 && Neighbor.X < NumTiles.X && Neighbor.Y < NumTiles.Y)
+					{
+						DirtyTiles[Neighbor.Y * NumTiles.X + Neighbor.X] = 1;
+						bAnyDirty = true;
+					}
+				}
+			}
+		}
+	}
+
+	// point every reached cell at its cheapest neighbor
+	ParallelFor(GridSize.Y, [&](int32 Y)
+	{
+		for (int32 X = 0; X < GridSize.X; ++X)
+		{
+			const int32 CellIndex = Y * GridSize.X + X;
+			float BestCost = Field.Integration[CellIndex];
+
+			if (BestCost == ShooterFlowField::Unreached)
+			{
+				continue;
+			}
+
+			const uint8 CellLinks = Links[CellIndex];
+
+			// only step across linked edges, the links already keep chasers off walls and corners
+			for (int32 Dir = 0; Dir < 8; ++Dir)
+			{
+				if (!(CellLinks & (1 << Dir)))
+				{
+					continue;
+				}
+
+				const int32 NX = X + ShooterFlowField::Offsets[Dir].X;
+				const int32 NY = Y + ShooterFlowField::Offsets[Dir].Y;
+
+				const float NeighborCost = Field.Integration[NY * GridSize.X + NX];
+
+				if (NeighborCost < BestCost)
+				{
+					BestCost = NeighborCost;
+					Field.Directions[CellIndex] = static_cast<uint8>(Dir);
+				}
+			}
+		}
+	});
+}
+
+bool UShooterFlowFieldSubsystem::RelaxTile(FShooterFlowField& Field, int32 TileX, int32 TileY) const
+{
+	const int32 MinX = TileX * TileSize;
+	const int32 MinY = TileY * TileSize;
+	const int32 MaxX = FMath::Min(MinX + TileSize, GridSize.X) - 1;
+	const int32 MaxY = FMath::Min(MinY + TileSize, GridSize.Y) - 1;
+
+	float* Integration = Field.Integration.GetData();
+
+	bool bBorderChanged = false;
+
+	auto RelaxCell = [&](int32 X, int32 Y)
+	{
+		const int32 CellIndex = Y * GridSize.X + X;
+		const uint8 CellLinks = Links[CellIndex];
+
+		if (!CellLinks)
+		{
+			return false;
+		}
+
+		float Best = Integration[CellIndex];
+
+		// links are symmetric, so a cell can reach the target through any neighbor it's linked to
+		for (int32 Dir = 0; Dir < 8; ++Dir)
+		{
+			if (!(CellLinks & (1 << Dir)))
+			{
+				continue;
+			}
+
+			const int32 NX = X + ShooterFlowField::Offsets[Dir].X;
+			const int32 NY = Y + ShooterFlowField::Offsets[Dir].Y;
+
+			Best = FMath::Min(Best, Integration[NY * GridSize.X + NX] + ShooterFlowField::Costs[Dir]);
+		}
+
+		if (Best < Integration[CellIndex])
+		{
+			Integration[CellIndex] = Best;
+
+			if (X == MinX || X == MaxX || Y == MinY || Y == MaxY)
+			{
+				bBorderChanged = true;
+			}
+
+			return true;
+		}
+
+		return false;
+	};
+
+	// alternate forward and backward sweeps until the tile settles
+	bool bChanged = true;
+
+	while (bChanged)
+	{
+		bChanged = false;
+
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				bChanged |= RelaxCell(X, Y);
+			}
+		}
+
+		for (int32 Y = MaxY; Y >= MinY; --Y)
+		{
+			for (int32 X = MaxX; X >= MinX; --X)
+			{
+				bChanged |= RelaxCell(X, Y);
+			}
+		}
+	}
+
+	return bBorderChanged;
+}
+
+bool UShooterFlowFieldSubsystem::GetFlowDirection(const AActor* Target, const FVector& Location, FVector& OutDirection) const
+{
+	const FShooterFlowField* Field = FindField(Target);
+
+	return Field && GetFlowDirection(*Field, Location, OutDirection);
+}
+
+bool UShooterFlowFieldSubsystem::GetFlowDirection(const FShooterFlowField& Field, const FVector& Location, FVector& OutDirection) const
+{
+	const FIntPoint Cell = GetCell(Location);
+
+	if (!Field.bValid || !Field.Target.IsValid() || Cell.X == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// in the target's own cell, head straight for it
+	if (Cell == Field.TargetCell)
+	{
+		OutDirection = (Field.Target->GetActorLocation() - Location).GetSafeNormal2D();
+		return true;
+	}
+
+	const uint8 Dir = Field.Directions[Cell.Y * GridSize.X + Cell.X];
+
+	if (Dir == ShooterFlowField::NoDirection)
+	{
+		return false;
+	}
+
+	OutDirection = FVector(ShooterFlowField::Offsets[Dir].X, ShooterFlowField::Offsets[Dir].Y, 0.0f).GetSafeNormal();
+	return true;
+}
+
+namespace ShooterFlowField
+{
+	/** Compares per-chaser pathfinding against one shared flow field for increasing crowd sizes */
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UShooterFlowFieldSubsystem* FlowFields = World ? World->GetSubsystem<UShooterFlowFieldSubsystem>() : nullptr;
+		UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+		APawn* Player = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+
+		if (!FlowFields || !FlowFields->HasGrid() || !NavSys || !NavSys->GetDefaultNavDataInstance() || !Player)
+		{
+			Ar.Log(TEXT("Shooter.AI.FlowFieldBenchmark needs a game world with a navmesh and a player pawn"));
+			return;
+		}
+
+		const float Radius = Args.Num() > 0 ? FMath::Max(100.0f, FCString::Atof(*Args[0])) : 5000.0f;
+		const FVector Goal = Player->GetActorLocation();
+		const ANavigationData* NavData = NavSys->GetDefaultNavDataInstance();
+
+		for (const int32 NumChasers : { 50, 200, 500 })
+		{
+			// random chaser start points reachable from the player
+			TArray<FVector> Starts;
+
+			for (int32 i = 0; i < NumChasers; ++i)
+			{
+				FNavLocation Start;
+
+				if (NavSys->GetRandomReachablePointInRadius(Goal, Radius, Start))
+				{
+					Starts.Add(Start.Location);
+				}
+			}
+
+			// one path request per chaser
+			double StartTime = FPlatformTime::Seconds();
+			int32 NumPaths = 0;
+
+			for (const FVector& Start : Starts)
+			{
+				FPathFindingQuery Query(nullptr, *NavData, Start, Goal);
+
+				if (NavSys->FindPathSync(Query).IsSuccessful())
+				{
+					++NumPaths;
+				}
+			}
+
+			const double PathTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			// one field build shared by every chaser, plus a sample each
+			StartTime = FPlatformTime::Seconds();
+
+			FShooterFlowField Field;
+			Field.Target = Player;
+			FlowFields->BuildField(Field);
+
+			const double BuildTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			int32 NumSteered = 0;
+			FVector Direction;
+
+			for (const FVector& Start : Starts)
+			{
+				if (FlowFields->GetFlowDirection(Field, Start, Direction))
+				{
+					++NumSteered;
+				}
+			}
+
+			const double FlowTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			Ar.Logf(TEXT("%3d chasers: pathfinding %.3f ms (%d paths), flow field %.3f ms (build %.3f ms, %d steering)"),
+				Starts.Num(), PathTime, NumPaths, FlowTime, BuildTime, NumSteered);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchmarkCommand(
+		TEXT("Shooter.AI.FlowFieldBenchmark"),
+		TEXT("Compares per-NPC pathfinding to a shared flow field for 50, 200 and 500 chasers around the player. Usage: Shooter.AI.FlowFieldBenchmark [Radius]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&RunBenchmark));
+}
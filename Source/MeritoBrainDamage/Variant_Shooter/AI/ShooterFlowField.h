@@ -0,0 +1,121 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterFlowField.generated.h"
+
+/**
+ *  Integration and direction fields leading to one target
+ */
+struct FShooterFlowField
+{
+	/** Actor the field leads to */
+	TWeakObjectPtr<AActor> Target;
+
+	/** Cell the field was built for */
+	FIntPoint TargetCell = FIntPoint(INDEX_NONE, INDEX_NONE);
+
+	/** Path cost from every cell to the target */
+	TArray<float> Integration;
+
+	/** Index of the neighbor to move to from every cell, or 255 if there's no way to the target */
+	TArray<uint8> Directions;
+
+	/** Game time the field was last built */
+	float BuildTime = -1.0f;
+
+	/** Game time the field was last requested */
+	float RequestTime = -1.0f;
+
+	/** True once the field has been built at least once */
+	bool bValid = false;
+};
+
+/**
+ *  Flow field navigation for crowds chasing the same target
+ *  Once per target per interval a direction field is built over a walkable grid derived from the navmesh,
+ *  so any number of chasers can steer by sampling it instead of each requesting its own path.
+ *  Neighboring cells are only connected where a navmesh raycast between their centers is clear, so fields don't leak through thin walls
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterFlowFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Bit per neighbor direction for every grid cell, set if the cell connects to that neighbor over the navmesh. Zero off the navmesh */
+	TArray<uint8> Links;
+
+	/** Fields by target */
+	TArray<FShooterFlowField> Fields;
+
+	/** Min corner of the grid */
+	FVector GridOrigin = FVector::ZeroVector;
+
+	/** Number of cells on each axis */
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	/** Number of tiles on each axis */
+	FIntPoint NumTiles = FIntPoint::ZeroValue;
+
+protected:
+
+	/** Size of the grid cells */
+	float CellSize = 100.0f;
+
+	/** Upper limit on the number of cells. The cell size grows to fit large maps */
+	int32 MaxCells = 512 * 512;
+
+	/** Size of the tiles the integration is split into for parallel updates, in cells */
+	int32 TileSize = 16;
+
+	/** Min time between rebuilds of a field */
+	float RebuildInterval = 0.5f;
+
+	/** Fields not requested for this long are dropped */
+	float ExpireTime = 2.0f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Builds the walkable grid from the navmesh */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Rebuilds the requested fields whose target moved */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Keeps a field to the target alive. The field is built on the next tick if it doesn't exist yet */
+	void RequestFlowField(AActor* Target);
+
+	/** Returns the flat direction to move in from a location towards the target. False if there's no field or no way from here */
+	bool GetFlowDirection(const AActor* Target, const FVector& Location, FVector& OutDirection) const;
+
+	/** Returns the flat direction to move in from a location following a given field */
+	bool GetFlowDirection(const FShooterFlowField& Field, const FVector& Location, FVector& OutDirection) const;
+
+	/** Builds a field right away */
+	void BuildField(FShooterFlowField& Field) const;
+
+	/** Returns true if the walkable grid has been built */
+	bool HasGrid() const { return Links.Num() > 0; }
+
+protected:
+
+	/** Projects every grid cell onto the navmesh and links the neighbors that can reach each other */
+	void BuildWalkableGrid();
+
+	/** Relaxes the integration costs inside one tile. Returns true if any cell on the tile border changed */
+	bool RelaxTile(FShooterFlowField& Field, int32 TileX, int32 TileY) const;
+
+	/** Returns the cell for a location, or INDEX_NONE coordinates if outside the grid */
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/** Finds the field for a target */
+	const FShooterFlowField* FindField(const AActor* Target) const;
+};
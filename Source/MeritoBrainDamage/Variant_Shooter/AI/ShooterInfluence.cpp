@@ -0,0 +1,410 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterInfluence.h"
+#include "ShooterNPC.h"
+#include "NavigationSystem.h"
+#include "GenericTeamAgentInterface.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Influence Update"), STAT_ShooterInfluenceUpdate, STATGROUP_Shooter);
+DECLARE_CYCLE_STAT(TEXT("Influence Stamps"), STAT_ShooterInfluenceStamps, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Influence Active Layers"), STAT_ShooterInfluenceActiveLayers, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Influence Decayed Cells"), STAT_ShooterInfluenceDecayedCells, STATGROUP_Shooter);
+
+bool UShooterInfluenceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterInfluenceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterInfluenceSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterInfluenceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// keep whole vectors per row
+	GridSize = FMath::Max(4, Align(GridSize, 4));
+
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld);
+	const FBox NavBounds = NavSys ? NavSys->GetNavigableWorldBounds() : FBox(ForceInit);
+
+	// fit the square grid over the navigable area, or center it on the world origin if there's no navmesh
+	if (NavBounds.IsValid)
+	{
+		const FVector Size = NavBounds.GetSize();
+
+		CellSize = FMath::Max(FMath::Max(Size.X, Size.Y) / GridSize, 25.0f);
+		GridOrigin = FVector2D(NavBounds.GetCenter()) - FVector2D(CellSize * GridSize * 0.5f);
+
+	} else {
+
+		GridOrigin = FVector2D(-CellSize * GridSize * 0.5f);
+	}
+
+	Layers.Reset();
+}
+
+void UShooterInfluenceSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterInfluenceUpdate);
+
+	PresenceTimer -= DeltaTime;
+
+	if (PresenceTimer <= 0.0f)
+	{
+		PresenceTimer = PresenceInterval;
+		StampPawns();
+	}
+
+	// exponential decay, independent of the frame rate
+	const float Factor = FMath::Exp(-DecayRate * DeltaTime);
+
+	int32 NumActiveLayers = 0;
+
+	for (TPair<uint8, FShooterInfluenceLayer>& Layer : Layers)
+	{
+		if (Layer.Value.bActive)
+		{
+			DecayLayer(Layer.Value, Factor);
+			++NumActiveLayers;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_ShooterInfluenceActiveLayers, NumActiveLayers);
+}
+
+void UShooterInfluenceSubsystem::DecayLayer(FShooterInfluenceLayer& Layer, float Factor) const
+{
+	const VectorRegister4Float FactorVec = VectorSetFloat1(Factor);
+	const VectorRegister4Float MinVec = VectorSetFloat1(MinValue);
+	const VectorRegister4Float ZeroVec = VectorZeroFloat();
+
+	// bounds of the cells still non-zero after this decay
+	FIntRect NonZeroRect(MAX_int32, MAX_int32, 0, 0);
+
+	float* Values = Layer.Values.GetData();
+
+	for (int32 Y = Layer.ActiveRect.Min.Y; Y < Layer.ActiveRect.Max.Y; ++Y)
+	{
+		float* Row = Values + Y * GridSize;
+
+		for (int32 X = Layer.ActiveRect.Min.X; X < Layer.ActiveRect.Max.X; X += 4)
+		{
+			VectorRegister4Float Value = VectorMultiply(VectorLoadAligned(Row + X), FactorVec);
+
+			// snap tiny values to zero so the layer can go idle
+			Value = VectorSelect(VectorCompareGE(Value, MinVec), Value, ZeroVec);
+
+			VectorStoreAligned(Value, Row + X);
+
+			if (VectorMaskBits(VectorCompareGT(Value, ZeroVec)) != 0)
+			{
+				NonZeroRect.Include(FIntPoint(X, Y));
+				NonZeroRect.Max.X = FMath::Max(NonZeroRect.Max.X, X + 4);
+				NonZeroRect.Max.Y = FMath::Max(NonZeroRect.Max.Y, Y + 1);
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_ShooterInfluenceDecayedCells, Layer.ActiveRect.Area());
+
+	ShrinkActiveRect(Layer, NonZeroRect);
+}
+
+void UShooterInfluenceSubsystem::DecayLayerScalar(FShooterInfluenceLayer& Layer, float Factor) const
+{
+	FIntRect NonZeroRect(MAX_int32, MAX_int32, 0, 0);
+
+	for (int32 Y = Layer.ActiveRect.Min.Y; Y < Layer.ActiveRect.Max.Y; ++Y)
+	{
+		for (int32 X = Layer.ActiveRect.Min.X; X < Layer.ActiveRect.Max.X; ++X)
+		{
+			float& Value = Layer.Values[Y * GridSize + X];
+
+			Value *= Factor;
+
+			if (Value < MinValue)
+			{
+				Value = 0.0f;
+				continue;
+			}
+
+			NonZeroRect.Include(FIntPoint(AlignDown(X, 4), Y));
+			NonZeroRect.Max.X = FMath::Max(NonZeroRect.Max.X, Align(X + 1, 4));
+			NonZeroRect.Max.Y = FMath::Max(NonZeroRect.Max.Y, Y + 1);
+		}
+	}
+
+	ShrinkActiveRect(Layer, NonZeroRect);
+}
+
+void UShooterInfluenceSubsystem::ShrinkActiveRect(FShooterInfluenceLayer& Layer, const FIntRect& NonZeroRect)
+{
+	// stop decaying once everything is gone
+	if (NonZeroRect.Min.X >= NonZeroRect.Max.X || NonZeroRect.Min.Y >= NonZeroRect.Max.Y)
+	{
+		Layer.ActiveRect = FIntRect();
+		Layer.bActive = false;
+		return;
+	}
+
+	// only decay what's left, so a stamp long gone doesn't keep the grid wide
+	Layer.ActiveRect = NonZeroRect;
+}
+
+FShooterInfluenceLayer& UShooterInfluenceSubsystem::FindOrAddLayer(uint8 SourceTeam)
+{
+	FShooterInfluenceLayer& Layer = Layers.FindOrAdd(SourceTeam);
+
+	if (Layer.Values.Num() == 0)
+	{
+		Layer.Values.SetNumZeroed(GridSize * GridSize);
+	}
+
+	return Layer;
+}
+
+void UShooterInfluenceSubsystem::AddStamp(uint8 SourceTeam, const FVector& Location, float Radius, float Strength, bool bMax)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterInfluenceStamps);
+
+	if (Radius <= 0.0f || Strength <= 0.0f)
+	{
+		return;
+	}
+
+	StampLayer(FindOrAddLayer(SourceTeam), Location, Radius, Strength, bMax);
+}
+
+void UShooterInfluenceSubsystem::StampLayer(FShooterInfluenceLayer& Layer, const FVector& Location, float Radius, float Strength, bool bMax) const
+{
+	const float RadiusCells = Radius / CellSize;
+
+	if (RadiusCells <= 0.0f || Strength <= 0.0f)
+	{
+		return;
+	}
+
+	const float CenterX = (Location.X - GridOrigin.X) / CellSize;
+	const float CenterY = (Location.Y - GridOrigin.Y) / CellSize;
+
+	const int32 MinX = FMath::Max(0, FMath::FloorToInt32(CenterX - RadiusCells));
+	const int32 MinY = FMath::Max(0, FMath::FloorToInt32(CenterY - RadiusCells));
+	const int32 MaxX = FMath::Min(GridSize, FMath::CeilToInt32(CenterX + RadiusCells) + 1);
+	const int32 MaxY = FMath::Min(GridSize, FMath::CeilToInt32(CenterY + RadiusCells) + 1);
+
+	// entirely outside the grid
+	if (MinX >= MaxX || MinY >= MaxY)
+	{
+		return;
+	}
+
+	// linear falloff from the center
+	for (int32 Y = MinY; Y < MaxY; ++Y)
+	{
+		for (int32 X = MinX; X < MaxX; ++X)
+		{
+			const float Distance = FMath::Sqrt(FMath::Square(X + 0.5f - CenterX) + FMath::Square(Y + 0.5f - CenterY));
+			const float Value = Strength * (1.0f - Distance / RadiusCells);
+
+			if (Value <= 0.0f)
+			{
+				continue;
+			}
+
+			float& Cell = Layer.Values[Y * GridSize + X];
+			Cell = bMax ? FMath::Max(Cell, Value) : Cell + Value;
+		}
+	}
+
+	// grow the active area, keeping the X range on vector boundaries
+	const FIntRect StampRect(AlignDown(MinX, 4), MinY, Align(MaxX, 4), MaxY);
+
+	if (Layer.bActive)
+	{
+		Layer.ActiveRect.Union(StampRect);
+
+	} else {
+
+		Layer.ActiveRect = StampRect;
+		Layer.bActive = true;
+	}
+}
+
+void UShooterInfluenceSubsystem::StampPawns()
+{
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		// dead and dormant NPCs don't threaten anybody
+		const AShooterNPC* NPC = Cast<AShooterNPC>(*It);
+
+		if (NPC && (NPC->IsDead() || NPC->IsDormant()))
+		{
+			continue;
+		}
+
+		const FGenericTeamId Team = FGenericTeamId::GetTeamIdentifier(*It);
+
+		if (Team != FGenericTeamId::NoTeam)
+		{
+			// presence doesn't pile up, it just refreshes
+			AddStamp(Team.GetId(), It->GetActorLocation(), PresenceRadius, 1.0f, true);
+		}
+	}
+}
+
+int32 UShooterInfluenceSubsystem::GetCellIndex(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt32((Location.X - GridOrigin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt32((Location.Y - GridOrigin.Y) / CellSize);
+
+	if (X < 0 || Y < 0 || X >= GridSize || Y >= GridSize)
+	{
+		return INDEX_NONE;
+	}
+
+	return Y * GridSize + X;
+}
+
+float UShooterInfluenceSubsystem::GetInfluence(uint8 SourceTeam, const FVector& Location) const
+{
+	const FShooterInfluenceLayer* Layer = Layers.Find(SourceTeam);
+	const int32 CellIndex = GetCellIndex(Location);
+
+	return Layer && Layer->bActive && CellIndex != INDEX_NONE ? Layer->Values[CellIndex] : 0.0f;
+}
+
+float UShooterInfluenceSubsystem::GetDanger(uint8 Team, const FVector& Location) const
+{
+	const int32 CellIndex = GetCellIndex(Location);
+
+	if (CellIndex == INDEX_NONE)
+	{
+		return 0.0f;
+	}
+
+	float Danger = 0.0f;
+
+	// one read per team, so the cost doesn't depend on how many things were stamped
+	for (const TPair<uint8, FShooterInfluenceLayer>& Layer : Layers)
+	{
+		if (!Layer.Value.bActive)
+		{
+			continue;
+		}
+
+		// teamless danger such as explosions threatens everybody
+		if (Layer.Key == FGenericTeamId::NoTeam.GetId()
+			|| FGenericTeamId::GetAttitude(FGenericTeamId(Team), FGenericTeamId(Layer.Key)) == ETeamAttitude::Hostile)
+		{
+			Danger += Layer.Value.Values[CellIndex];
+		}
+	}
+
+	return Danger;
+}
+
+void UShooterInfluenceSubsystem::ReportGunfire(const AActor* Instigator, const FVector& Location, float Loudness)
+{
+	UShooterInfluenceSubsystem* Influence = Instigator ? Instigator->GetWorld()->GetSubsystem<UShooterInfluenceSubsystem>() : nullptr;
+
+	if (Influence)
+	{
+		Influence->AddStamp(FGenericTeamId::GetTeamIdentifier(Instigator).GetId(), Location, Influence->GunfireRadius * Loudness, Influence->GunfireStrength * Loudness);
+	}
+}
+
+void UShooterInfluenceSubsystem::ReportExplosion(const UWorld* World, const FVector& Location, float Radius)
+{
+	UShooterInfluenceSubsystem* Influence = World ? World->GetSubsystem<UShooterInfluenceSubsystem>() : nullptr;
+
+	if (Influence)
+	{
+		// the area around the blast stays dangerous for a while, even for the instigator's team
+		Influence->AddStamp(FGenericTeamId::NoTeam.GetId(), Location, Radius * 1.5f, 2.0f);
+	}
+}
+
+namespace ShooterInfluence
+{
+	/** Times the decay kernel over a fully active grid, scalar against vector */
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UShooterInfluenceSubsystem* Influence = World ? World->GetSubsystem<UShooterInfluenceSubsystem>() : nullptr;
+
+		if (!Influence)
+		{
+			Ar.Log(TEXT("Shooter.AI.InfluenceBenchmark must be run in a game world"));
+			return;
+		}
+
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 200;
+		const int32 GridSize = Influence->GetGridSize();
+
+		// a scratch layer with every cell active
+		FShooterInfluenceLayer Layer;
+		Layer.Values.SetNumUninitialized(GridSize * GridSize);
+		Layer.ActiveRect = FIntRect(0, 0, GridSize, GridSize);
+
+		auto Fill = [&Layer, GridSize]()
+		{
+			for (float& Value : Layer.Values)
+			{
+				Value = 100.0f;
+			}
+
+			Layer.ActiveRect = FIntRect(0, 0, GridSize, GridSize);
+			Layer.bActive = true;
+		};
+
+		Fill();
+		double StartTime = FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Influence->DecayLayerScalar(Layer, 0.99f);
+		}
+
+		const double ScalarTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+		Fill();
+		StartTime = FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Influence->DecayLayer(Layer, 0.99f);
+		}
+
+		const double VectorTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+		// stamping cost for a typical frame of events, into the scratch layer so the live team layers are left alone
+		StartTime = FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < Iterations; ++i)
+		{
+			Influence->StampLayer(Layer, FVector::ZeroVector, 800.0f, 1.0f, true);
+		}
+
+		const double StampTime = (FPlatformTime::Seconds() - StartTime) * 1000.0 / Iterations;
+
+		Ar.Logf(TEXT("Influence %dx%d, %d iterations"), GridSize, GridSize, Iterations);
+		Ar.Logf(TEXT("  decay scalar: %.4f ms"), ScalarTime);
+		Ar.Logf(TEXT("  decay vector: %.4f ms (%.2fx)"), VectorTime, VectorTime > 0.0 ? ScalarTime / VectorTime : 0.0);
+		Ar.Logf(TEXT("  stamp (8 m radius): %.4f ms"), StampTime);
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchmarkCommand(
+		TEXT("Shooter.AI.InfluenceBenchmark"),
+		TEXT("Times the influence map decay over the whole grid, scalar against vector, and a presence stamp. Usage: Shooter.AI.InfluenceBenchmark [Iterations]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&RunBenchmark));
+}
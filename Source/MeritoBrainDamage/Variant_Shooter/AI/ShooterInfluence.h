@@ -0,0 +1,123 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterInfluence.generated.h"
+
+/**
+ *  Influence grid for everything stamped by one team
+ */
+struct FShooterInfluenceLayer
+{
+	/** Cell values, row by row. Aligned so rows can be processed with vector loads */
+	TArray<float, TAlignedHeapAllocator<16>> Values;
+
+	/** Range of cells that may be non-zero. Grown by stamps and shrunk to the non-zero cells by each decay. X bounds are kept on vector boundaries */
+	FIntRect ActiveRect;
+
+	/** False once every cell has decayed to zero */
+	bool bActive = false;
+};
+
+/**
+ *  2D influence map over the navigable area
+ *  Pawn positions, gunfire and explosions are stamped into one layer per source team and decay over time,
+ *  so AI can read how dangerous a location is for its team with a constant time lookup
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterInfluenceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Layers by source team. Explosions without a team go to FGenericTeamId::NoTeam */
+	TMap<uint8, FShooterInfluenceLayer> Layers;
+
+	/** Min corner of the grid */
+	FVector2D GridOrigin = FVector2D::ZeroVector;
+
+	/** Size of the grid cells */
+	float CellSize = 100.0f;
+
+	/** Time left until the next pawn presence stamp */
+	float PresenceTimer = 0.0f;
+
+protected:
+
+	/** Number of cells on each side of the grid. Multiple of the vector width */
+	int32 GridSize = 256;
+
+	/** Fraction of the influence lost per second */
+	float DecayRate = 0.5f;
+
+	/** Values below this snap to zero so layers can go inactive */
+	float MinValue = 0.01f;
+
+	/** Time between pawn presence stamps */
+	float PresenceInterval = 0.25f;
+
+	/** Radius of a pawn presence stamp */
+	float PresenceRadius = 800.0f;
+
+	/** Radius of a gunfire stamp, scaled by loudness */
+	float GunfireRadius = 600.0f;
+
+	/** Strength of a gunfire stamp, scaled by loudness */
+	float GunfireStrength = 0.5f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Fits the grid to the navigable area */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Stamps pawn presence and decays all layers */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Returns the combined influence of every team hostile to the given team at a location */
+	float GetDanger(uint8 Team, const FVector& Location) const;
+
+	/** Returns the influence of a single source team at a location */
+	float GetInfluence(uint8 SourceTeam, const FVector& Location) const;
+
+	/** Adds a falloff stamp to a team's layer. If bMax is set the stamp raises cells to its value instead of adding to them */
+	void AddStamp(uint8 SourceTeam, const FVector& Location, float Radius, float Strength, bool bMax = false);
+
+	/** Adds a falloff stamp to a layer sized to the grid */
+	void StampLayer(FShooterInfluenceLayer& Layer, const FVector& Location, float Radius, float Strength, bool bMax) const;
+
+	/** Stamps gunfire danger for the instigator's team */
+	static void ReportGunfire(const AActor* Instigator, const FVector& Location, float Loudness);
+
+	/** Stamps explosion danger that threatens every team */
+	static void ReportExplosion(const UWorld* World, const FVector& Location, float Radius);
+
+	/** Decays every active cell of a layer with vector math, then shrinks its active range to the cells still non-zero */
+	void DecayLayer(FShooterInfluenceLayer& Layer, float Factor) const;
+
+	/** Decays every active cell of a layer one cell at a time. Used as the benchmark baseline */
+	void DecayLayerScalar(FShooterInfluenceLayer& Layer, float Factor) const;
+
+	/** Returns the grid size */
+	int32 GetGridSize() const { return GridSize; }
+
+protected:
+
+	/** Returns a layer, creating it if needed */
+	FShooterInfluenceLayer& FindOrAddLayer(uint8 SourceTeam);
+
+	/** Sets a decayed layer's active range to its non-zero cells, or deactivates it if there are none */
+	static void ShrinkActiveRect(FShooterInfluenceLayer& Layer, const FIntRect& NonZeroRect);
+
+	/** Stamps every live, awake pawn on a team into its team's layer */
+	void StampPawns();
+
+	/** Returns the cell index for a location, or INDEX_NONE if outside the grid */
+	int32 GetCellIndex(const FVector& Location) const;
+};
@@ -0,0 +1,225 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterMovementLOD.h"
+#include "ShooterNPC.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Movement LOD Update"), STAT_ShooterMovementLOD, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Full Movement NPCs"), STAT_ShooterMovementFull, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("NavWalking NPCs"), STAT_ShooterMovementSimplified, STATGROUP_Shooter);
+
+namespace ShooterMovementLOD
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.AI.MovementLOD"),
+		true,
+		TEXT("If true, NPCs that are off screen or far away move in NavWalking mode instead of full walking physics."),
+		ECVF_Default);
+}
+
+bool UShooterMovementLODSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterMovementLODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterMovementLODSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterMovementLODSubsystem::RegisterNPC(AShooterNPC* NPC)
+{
+	if (IsValid(NPC))
+	{
+		NPCs.AddUnique(NPC);
+	}
+}
+
+void UShooterMovementLODSubsystem::UnregisterNPC(AShooterNPC* NPC)
+{
+	NPCs.RemoveSwap(NPC);
+}
+
+void UShooterMovementLODSubsystem::GetNPCs(TArray<AShooterNPC*>& OutNPCs) const
+{
+	for (const TWeakObjectPtr<AShooterNPC>& WeakNPC : NPCs)
+	{
+		AShooterNPC* NPC = WeakNPC.Get();
+
+		if (NPC && !NPC->IsDead() && !NPC->IsDormant())
+		{
+			OutNPCs.Add(NPC);
+		}
+	}
+}
+
+void UShooterMovementLODSubsystem::Tick(float DeltaTime)
+{
+	UpdateTimer -= DeltaTime;
+
+	if (UpdateTimer <= 0.0f)
+	{
+		UpdateTimer = UpdateInterval;
+
+		UpdateModes();
+	}
+
+	SET_DWORD_STAT(STAT_ShooterMovementFull, NumFull);
+	SET_DWORD_STAT(STAT_ShooterMovementSimplified, NumSimplified);
+}
+
+void UShooterMovementLODSubsystem::UpdateModes()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterMovementLOD);
+
+	NumFull = NumSimplified = 0;
+
+	// gather the player views
+	TArray<TPair<FVector, FVector>, TInlineAllocator<4>> Views;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			Views.Emplace(ViewLocation, ViewRotation.Vector());
+		}
+	}
+
+	const bool bEnabled = ShooterMovementLOD::CVarEnable.GetValueOnGameThread() && Views.Num() > 0;
+
+	for (int32 i = NPCs.Num() - 1; i >= 0; --i)
+	{
+		AShooterNPC* NPC = NPCs[i].Get();
+
+		if (!NPC)
+		{
+			NPCs.RemoveAtSwap(i);
+			continue;
+		}
+
+		if (NPC->IsDead() || NPC->IsDormant())
+		{
+			continue;
+		}
+
+		// simplified NPCs need to get a bit closer than the limits before switching back, and the other way around
+		const float Margin = NPC->IsMovementSimplified() ? -Hysteresis : Hysteresis;
+		const float FullDistanceSquared = FMath::Square(FMath::Max(0.0f, FullDistance + Margin));
+		const float OnScreenFullDistanceSquared = FMath::Square(FMath::Max(0.0f, OnScreenFullDistance + Margin));
+
+		bool bRelevant = !bEnabled;
+
+		for (int32 ViewIndex = 0; ViewIndex < Views.Num() && !bRelevant; ++ViewIndex)
+		{
+			const FVector ToNPC = NPC->GetActorLocation() - Views[ViewIndex].Key;
+			const float DistanceSquared = ToNPC.SizeSquared();
+
+			bRelevant = DistanceSquared <= FullDistanceSquared
+				|| (DistanceSquared <= OnScreenFullDistanceSquared && FVector::DotProduct(ToNPC.GetSafeNormal(), Views[ViewIndex].Value) >= OnScreenCosine);
+		}
+
+		NPC->SetSimplifiedMovement(!bRelevant);
+
+		if (NPC->IsMovementSimplified())
+		{
+			++NumSimplified;
+
+		} else {
+
+			++NumFull;
+		}
+	}
+}
+
+namespace ShooterMovementLOD
+{
+	/** Ticks the movement of every NPC in each mode and reports the cost per NPC */
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const UShooterMovementLODSubsystem* MovementLOD = World ? World->GetSubsystem<UShooterMovementLODSubsystem>() : nullptr;
+
+		TArray<AShooterNPC*> NPCs;
+
+		if (MovementLOD)
+		{
+			MovementLOD->GetNPCs(NPCs);
+		}
+
+		if (NPCs.Num() == 0)
+		{
+			Ar.Log(TEXT("Shooter.AI.MovementBenchmark needs a game world with live NPCs"));
+			return;
+		}
+
+		const int32 NumFrames = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 30;
+		const float DeltaTime = 1.0f / 60.0f;
+
+		// remember where everyone was so the benchmark doesn't move them
+		TArray<FTransform> Transforms;
+		TArray<bool> WasSimplified;
+
+		for (const AShooterNPC* NPC : NPCs)
+		{
+			Transforms.Add(NPC->GetActorTransform());
+			WasSimplified.Add(NPC->IsMovementSimplified());
+		}
+
+		for (const bool bSimplified : { false, true })
+		{
+			for (int32 i = 0; i < NPCs.Num(); ++i)
+			{
+				NPCs[i]->SetActorTransform(Transforms[i], false, nullptr, ETeleportType::TeleportPhysics);
+				NPCs[i]->SetSimplifiedMovement(bSimplified);
+			}
+
+			int32 NumInMode = 0;
+
+			for (const AShooterNPC* NPC : NPCs)
+			{
+				NumInMode += NPC->IsMovementSimplified() == bSimplified ? 1 : 0;
+			}
+
+			// walk every NPC forward, ticking its movement by hand
+			const double StartTime = FPlatformTime::Seconds();
+
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				for (AShooterNPC* NPC : NPCs)
+				{
+					UCharacterMovementComponent* Movement = NPC->GetCharacterMovement();
+
+					NPC->AddMovementInput(NPC->GetActorForwardVector());
+					Movement->TickComponent(DeltaTime, LEVELTICK_All, &Movement->PrimaryComponentTick);
+				}
+			}
+
+			const double TotalTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+			Ar.Logf(TEXT("%s: %d of %d NPCs in mode, %.4f ms per NPC per tick (%.3f ms over %d frames)"),
+				bSimplified ? TEXT("NavWalking") : TEXT("Walking"), NumInMode, NPCs.Num(), TotalTime / (NumFrames * NPCs.Num()), TotalTime, NumFrames);
+		}
+
+		// put everyone back
+		for (int32 i = 0; i < NPCs.Num(); ++i)
+		{
+			NPCs[i]->SetActorTransform(Transforms[i], false, nullptr, ETeleportType::TeleportPhysics);
+			NPCs[i]->SetSimplifiedMovement(WasSimplified[i]);
+			NPCs[i]->GetCharacterMovement()->StopMovementImmediately();
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchmarkCommand(
+		TEXT("Shooter.AI.MovementBenchmark"),
+		TEXT("Ticks every NPC's movement in full walking and in NavWalking mode and reports the cost per NPC. Usage: Shooter.AI.MovementBenchmark [Frames]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&RunBenchmark));
+}
@@ -0,0 +1,81 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterMovementLOD.generated.h"
+
+class AShooterNPC;
+
+/**
+ *  Movement LOD for NPCs
+ *  NPCs the players can't see, or that are far away, move in NavWalking mode, which follows the navmesh
+ *  without floor sweeps or step-up checks. They go back to full walking physics as soon as they become relevant
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterMovementLODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** NPCs managed by the LOD */
+	TArray<TWeakObjectPtr<AShooterNPC>> NPCs;
+
+	/** Time left until the next update */
+	float UpdateTimer = 0.0f;
+
+	/** NPC counts per mode on the last update */
+	int32 NumFull = 0;
+	int32 NumSimplified = 0;
+
+protected:
+
+	/** NPCs closer than this to a view always use full walking, even off screen */
+	UPROPERTY(Config)
+	float FullDistance = 1500.0f;
+
+	/** On screen NPCs closer than this use full walking */
+	UPROPERTY(Config)
+	float OnScreenFullDistance = 5000.0f;
+
+	/** Extra distance an NPC has to cover before switching back to NavWalking, so it doesn't flicker between modes */
+	UPROPERTY(Config)
+	float Hysteresis = 300.0f;
+
+	/** Cosine of the half angle of the view cone that counts as on screen */
+	UPROPERTY(Config)
+	float OnScreenCosine = 0.5f;
+
+	/** Time between updates */
+	UPROPERTY(Config)
+	float UpdateInterval = 0.2f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Switches NPCs between full walking and NavWalking */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Adds an NPC to the LOD */
+	void RegisterNPC(AShooterNPC* NPC);
+
+	/** Removes an NPC from the LOD */
+	void UnregisterNPC(AShooterNPC* NPC);
+
+	/** Returns the live, awake NPCs */
+	void GetNPCs(TArray<AShooterNPC*>& OutNPCs) const;
+
+	/** Returns the NPC counts per mode on the last update */
+	int32 GetNumFull() const { return NumFull; }
+	int32 GetNumSimplified() const { return NumSimplified; }
+
+protected:
+
+	/** Picks the movement mode of every NPC */
+	void UpdateModes();
+};
@@ -4,18 +4,47 @@
 #include "Variant_Shooter/AI/ShooterNPC.h"
 #include "ShooterWeapon.h"
 #include "Components/SkeletalMeshComponent.h"
-#include "Camera/CameraComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Engine/World.h"
 #include "ShooterGameMode.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "EngineUtils.h"
+#include "ShooterCharacter.h"
+#include "ShooterProjectile.h"
+#include "ShooterAimSolver.h"
+#include "ShooterAIController.h"
+#include "ShooterDormancy.h"
+#include "ShooterMovementLOD.h"
+#include "ShooterHitbox.h"
+#include "ShooterVisibility.h"
+#include "MeritoBrainDamage.h"
+
+AShooterNPC::AShooterNPC(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer
+		.DoNotCreateDefaultSubobject(AMeritoBrainDamageCharacter::FirstPersonMeshComponentName)
+		.DoNotCreateDefaultSubobject(AMeritoBrainDamageCharacter::FirstPersonCameraComponentName))
+{
+	// NPC logic runs from the StateTree, timers and weapon callbacks. Blueprints that implement Tick re-enable this
+	PrimaryActorTick.bCanEverTick = false;
+
+	// without a first person view, the world mesh must be visible to the owner too
+	GetMesh()->SetOwnerNoSee(false);
+	GetMesh()->FirstPersonPrimitiveType = EFirstPersonPrimitiveType::None;
+
+	// create the hitboxes
+	Hitboxes = CreateDefaultSubobject<UShooterHitboxComponent>(TEXT("Hitboxes"));
+}
 
 void AShooterNPC::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// seed our own aim variance stream
+	AimRandomStream.Initialize(FShooterRandomStream::MakeSeed(this));
+
 	// spawn the weapon
 	FActorSpawnParameters SpawnParams;
 	SpawnParams.Owner = this;
@@ -23,6 +52,24 @@ void AShooterNPC::BeginPlay()
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
 	Weapon = GetWorld()->SpawnActor<AShooterWeapon>(WeaponClass, GetActorTransform(), SpawnParams);
+
+	// let the dormancy system park us when we're far from the players
+	if (UShooterDormancySubsystem* Dormancy = GetWorld()->GetSubsystem<UShooterDormancySubsystem>())
+	{
+		Dormancy->RegisterNPC(this);
+	}
+
+	// let the animation budget pick how we're animated
+	if (UShooterAnimBudgetSubsystem* AnimBudget = GetWorld()->GetSubsystem<UShooterAnimBudgetSubsystem>())
+	{
+		AnimBudget->RegisterNPC(this);
+	}
+
+	// let the movement LOD simplify our movement when nobody's looking
+	if (UShooterMovementLODSubsystem* MovementLOD = GetWorld()->GetSubsystem<UShooterMovementLODSubsystem>())
+	{
+		MovementLOD->RegisterNPC(this);
+	}
 }
 
 void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -31,6 +78,27 @@ void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 	// clear the death timer
 	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+
+	// stop solving our aim
+	if (UShooterAimSolverSubsystem* AimSolver = GetWorld()->GetSubsystem<UShooterAimSolverSubsystem>())
+	{
+		AimSolver->UnregisterShooter(this);
+	}
+
+	if (UShooterDormancySubsystem* Dormancy = GetWorld()->GetSubsystem<UShooterDormancySubsystem>())
+	{
+		Dormancy->UnregisterNPC(this);
+	}
+
+	if (UShooterAnimBudgetSubsystem* AnimBudget = GetWorld()->GetSubsystem<UShooterAnimBudgetSubsystem>())
+	{
+		AnimBudget->UnregisterNPC(this);
+	}
+
+	if (UShooterMovementLODSubsystem* MovementLOD = GetWorld()->GetSubsystem<UShooterMovementLODSubsystem>())
+	{
+		MovementLOD->UnregisterNPC(this);
+	}
 }
 
 float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -53,6 +121,17 @@ float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEve
 	return Damage;
 }
 
+FVector AShooterNPC::GetPawnViewLocation() const
+{
+	// use the eye socket on the world mesh if we have one
+	if (GetMesh()->DoesSocketExist(EyeSocketName))
+	{
+		return GetMesh()->GetSocketLocation(EyeSocketName);
+	}
+
+	return Super::GetPawnViewLocation();
+}
+
 void AShooterNPC::AttachWeaponMeshes(AShooterWeapon* WeaponToAttach)
 {
 	const FAttachmentTransformRules AttachmentRule(EAttachmentRule::SnapToTarget, false);
@@ -60,8 +139,13 @@ void AShooterNPC::AttachWeaponMeshes(AShooterWeapon* WeaponToAttach)
 	// attach the weapon actor
 	WeaponToAttach->AttachToActor(this, AttachmentRule);
 
-	// attach the weapon meshes
-	WeaponToAttach->GetFirstPersonMesh()->AttachToComponent(GetFirstPersonMesh(), AttachmentRule, FirstPersonWeaponSocket);
+	// attach the weapon meshes. Weapons made for the player still carry a first person mesh, so hide it
+	if (USkeletalMeshComponent* WeaponFirstPersonMesh = WeaponToAttach->GetFirstPersonMesh())
+	{
+		WeaponFirstPersonMesh->AttachToComponent(GetMesh(), AttachmentRule, FirstPersonWeaponSocket);
+		WeaponFirstPersonMesh->SetVisibility(false);
+	}
+
 	WeaponToAttach->GetThirdPersonMesh()->AttachToComponent(GetMesh(), AttachmentRule, FirstPersonWeaponSocket);
 }
 
@@ -82,8 +166,34 @@ void AShooterNPC::UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize)
 
 FVector AShooterNPC::GetWeaponTargetLocation()
 {
-	// start aiming from the camera location
-	const FVector AimSource = GetFirstPersonCameraComponent()->GetComponentLocation();
+	// start aiming from the eyes
+	const FVector AimSource = GetPawnViewLocation();
+
+	// use the aim solved for this frame if we have one
+	if (bHasSolvedAim)
+	{
+		bHasSolvedAim = false;
+
+		// the shot used the solved spread, so commit the draws it made
+		AimRandomStream = SolvedAimRandomStream;
+
+		if (bSolvedAimSkipsTrace)
+		{
+			return SolvedAimPoint;
+		}
+
+		// extend the solved aim to our max range and check for obstructions
+		const FVector SolvedAimEnd = AimSource + (SolvedAimPoint - AimSource).GetSafeNormal() * AimRange;
+
+		FHitResult SolvedHit;
+
+		FCollisionQueryParams SolvedQueryParams;
+		SolvedQueryParams.AddIgnoredActor(this);
+
+		GetWorld()->LineTraceSingleByChannel(SolvedHit, AimSource, SolvedAimEnd, UShooterVisibilitySubsystem::GetTraceChannel(GetWorld()), SolvedQueryParams);
+
+		return SolvedHit.bBlockingHit ? SolvedHit.ImpactPoint : SolvedHit.TraceEnd;
+	}
 
 	FVector AimDir, AimTarget = FVector::ZeroVector;
 
@@ -94,30 +204,30 @@ FVector AShooterNPC::GetWeaponTargetLocation()
 		AimTarget = CurrentAimTarget->GetActorLocation();
 
 		// apply a vertical offset to target head/feet
-		AimTarget.Z += FMath::RandRange(MinAimOffsetZ, MaxAimOffsetZ);
+		AimTarget.Z += AimRandomStream.FRandRange(MinAimOffsetZ, MaxAimOffsetZ);
 
 		// get the aim direction and apply randomness in a cone
 		AimDir = (AimTarget - AimSource).GetSafeNormal();
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(AimDir, AimVarianceHalfAngle);
+		AimDir = AimRandomStream.VRandCone(AimDir, FMath::DegreesToRadians(AimVarianceHalfAngle));
 
 		
 	} else {
 
-		// no aim target, so just use the camera facing
-		AimDir = UKismetMathLibrary::RandomUnitVectorInConeInDegrees(GetFirstPersonCameraComponent()->GetForwardVector(), AimVarianceHalfAngle);
+		// no aim target, so just use the aim facing
+		AimDir = AimRandomStream.VRandCone(GetBaseAimRotation().Vector(), FMath::DegreesToRadians(AimVarianceHalfAngle));
 
 	}
 
 	// calculate the unobstructed aim target location
 	AimTarget = AimSource + (AimDir * AimRange);
 
-	// run a visibility trace to see if there's obstructions
+	// run a visibility trace to see if there's obstructions. Only the simplified blockers when the map has them
 	FHitResult OutHit;
 
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
 
-	GetWorld()->LineTraceSingleByChannel(OutHit, AimSource, AimTarget, ECC_Visibility, QueryParams);
+	GetWorld()->LineTraceSingleByChannel(OutHit, AimSource, AimTarget, UShooterVisibilitySubsystem::GetTraceChannel(GetWorld()), QueryParams);
 
 	// return either the impact point or the trace end
 	return OutHit.bBlockingHit ? OutHit.ImpactPoint : OutHit.TraceEnd;
@@ -159,12 +269,21 @@ void AShooterNPC::Die()
 	// raise the dead flag
 	bIsDead = true;
 
+	// stop solving our aim
+	if (UShooterAimSolverSubsystem* AimSolver = GetWorld()->GetSubsystem<UShooterAimSolverSubsystem>())
+	{
+		AimSolver->UnregisterShooter(this);
+	}
+
 	// increment the team score
 	if (AShooterGameMode* GM = Cast<AShooterGameMode>(GetWorld()->GetAuthGameMode()))
 	{
 		GM->IncrementTeamScore(TeamByte);
 	}
 
+	// the ragdoll needs our own mesh pose
+	SetAnimMode(EShooterAnimMode::Full);
+
 	// disable capsule collision
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
@@ -194,6 +313,12 @@ void AShooterNPC::StartShooting(AActor* ActorToShoot)
 	// raise the flag
 	bIsShooting = true;
 
+	// let the aim solver lead our target from now on
+	if (UShooterAimSolverSubsystem* AimSolver = GetWorld()->GetSubsystem<UShooterAimSolverSubsystem>())
+	{
+		AimSolver->RegisterShooter(this);
+	}
+
 	// signal the weapon
 	Weapon->StartFiring();
 }
@@ -203,6 +328,378 @@ void AShooterNPC::StopShooting()
 	// lower the flag
 	bIsShooting = false;
 
+	// drop any pending solved aim
+	bHasSolvedAim = false;
+
+	if (UShooterAimSolverSubsystem* AimSolver = GetWorld()->GetSubsystem<UShooterAimSolverSubsystem>())
+	{
+		AimSolver->UnregisterShooter(this);
+	}
+
 	// signal the weapon
 	Weapon->StopFiring();
 }
+
+bool AShooterNPC::IsFiringWeapon() const
+{
+	return bIsShooting && !bIsDead && !bIsDormant && Weapon && Weapon->IsFiring();
+}
+
+EShooterAnimState AShooterNPC::GetSharedAnimState() const
+{
+	if (bIsShooting)
+	{
+		return EShooterAnimState::Shoot;
+	}
+
+	return GetVelocity().SizeSquared2D() > FMath::Square(10.0f) ? EShooterAnimState::Run : EShooterAnimState::Idle;
+}
+
+UAnimSequence* AShooterNPC::GetSharedAnimation(EShooterAnimState State) const
+{
+	switch (State)
+	{
+	case EShooterAnimState::Run:
+		return SharedRunAnimation;
+
+	case EShooterAnimState::Shoot:
+		return SharedShootAnimation;
+
+	default:
+		return SharedIdleAnimation;
+	}
+}
+
+void AShooterNPC::SetAnimMode(EShooterAnimMode Mode, USkeletalMeshComponent* Leader)
+{
+	// ignore if nothing changes
+	if (Mode == AnimMode && Leader == AnimLeader.Get())
+	{
+		return;
+	}
+
+	AnimMode = Mode;
+	AnimLeader = Leader;
+
+	// followers skip their own evaluation and copy the leader's bones
+	GetMesh()->SetLeaderPoseComponent(Mode == EShooterAnimMode::Shared ? Leader : nullptr);
+
+	// instanced NPCs hide the skeletal mesh and stop ticking it
+	const bool bShowMesh = Mode != EShooterAnimMode::Instanced;
+
+	GetMesh()->SetVisibility(bShowMesh);
+	GetMesh()->SetComponentTickEnabled(bShowMesh && !bIsDormant);
+
+	if (Weapon && Weapon->GetThirdPersonMesh())
+	{
+		Weapon->GetThirdPersonMesh()->SetVisibility(bShowMesh);
+	}
+}
+
+bool AShooterNPC::IsMovementSimplified() const
+{
+	return GetCharacterMovement()->MovementMode == MOVE_NavWalking;
+}
+
+void AShooterNPC::SetSimplifiedMovement(bool bSimplified)
+{
+	// ignore if dead, dormant or already in the requested mode
+	if (bIsDead || bIsDormant || bSimplified == IsMovementSimplified())
+	{
+		return;
+	}
+
+	if (bSimplified)
+	{
+		// only switch from the ground, falling NPCs keep full physics until they land
+		if (GetCharacterMovement()->MovementMode == MOVE_Walking)
+		{
+			GetCharacterMovement()->SetMovementMode(MOVE_NavWalking);
+		}
+
+		return;
+	}
+
+	// restore the capsule collision first so the correction sees the world
+	GetCharacterMovement()->SetMovementMode(MOVE_Walking);
+
+	CorrectNavWalkingPosition();
+}
+
+void AShooterNPC::CorrectNavWalkingPosition()
+{
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	UCapsuleComponent* Capsule = GetCapsuleComponent();
+
+	FVector Location = GetActorLocation();
+	FRotator Rotation = GetActorRotation();
+
+	// NavWalking ignores world collision, so push out of anything we walked into
+	GetWorld()->FindTeleportSpot(this, Location, Rotation);
+
+	// the navmesh floats above the real floor, so sweep down to it
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterNavWalkingCorrection), false, this);
+	FCollisionResponseParams ResponseParams;
+	Movement->InitCollisionParams(QueryParams, ResponseParams);
+
+	const FVector SweepStart = Location + FVector(0.0f, 0.0f, Movement->MaxStepHeight);
+	const FVector SweepEnd = Location - FVector(0.0f, 0.0f, Movement->MaxStepHeight * 2.0f);
+
+	FHitResult Hit;
+
+	if (GetWorld()->SweepSingleByChannel(Hit, SweepStart, SweepEnd, FQuat::Identity, Capsule->GetCollisionObjectType(), Capsule->GetCollisionShape(), QueryParams, ResponseParams)
+		&& !Hit.bStartPenetrating)
+	{
+		// stay just above the floor, like the walking floor check does
+		Location = Hit.Location + FVector(0.0f, 0.0f, UCharacterMovementComponent::MIN_FLOOR_DIST);
+	}
+
+	SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void AShooterNPC::SetSpawnProfile(TSubclassOf<AShooterWeapon> InWeaponClass, uint8 InTeamByte)
+{
+	WeaponClass = InWeaponClass;
+	TeamByte = InTeamByte;
+}
+
+void AShooterNPC::EnterDormancy()
+{
+	// ignore if already dormant or dead
+	if (bIsDormant || bIsDead)
+	{
+		return;
+	}
+
+	if (bIsShooting)
+	{
+		StopShooting();
+	}
+
+	// dormant NPCs never shoot, so make sure the aim solver lets go of us
+	if (UShooterAimSolverSubsystem* AimSolver = GetWorld()->GetSubsystem<UShooterAimSolverSubsystem>())
+	{
+		AimSolver->UnregisterShooter(this);
+	}
+
+	// come back with our own pose and full movement, the budgets reassign them
+	SetAnimMode(EShooterAnimMode::Full);
+	SetSimplifiedMovement(false);
+
+	bIsDormant = true;
+
+	// stop moving and animating
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->Deactivate();
+	GetMesh()->SetComponentTickEnabled(false);
+
+	// hide the character and its weapon
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	if (Weapon)
+	{
+		Weapon->SetActorHiddenInGame(true);
+	}
+
+	// put the AI to sleep
+	if (AShooterAIController* AIController = Cast<AShooterAIController>(GetController()))
+	{
+		AIController->SetDormant(true);
+	}
+}
+
+void AShooterNPC::ExitDormancy(const FVector& Location, const FRotator& Rotation, float HP)
+{
+	// ignore if not dormant
+	if (!bIsDormant)
+	{
+		return;
+	}
+
+	bIsDormant = false;
+	CurrentHP = HP;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	// show the character and its weapon
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	if (Weapon)
+	{
+		Weapon->SetActorHiddenInGame(false);
+	}
+
+	// resume moving and animating
+	GetMesh()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->Activate(true);
+
+	// wake up the AI
+	if (AShooterAIController* AIController = Cast<AShooterAIController>(GetController()))
+	{
+		AIController->SetControlRotation(Rotation);
+		AIController->SetDormant(false);
+	}
+}
+
+void AShooterNPC::CacheLineOfSight(AActor* Target, bool bClear)
+{
+	LineOfSightTarget = Target;
+	LineOfSightTime = GetWorld()->GetTimeSeconds();
+	bLineOfSightClear = bClear;
+}
+
+bool AShooterNPC::HasCachedLineOfSight(const AActor* Target) const
+{
+	bool bClear = false;
+	return GetCachedLineOfSight(Target, bClear) && bClear;
+}
+
+bool AShooterNPC::GetCachedLineOfSight(const AActor* Target, bool& bOutClear) const
+{
+	if (!Target || LineOfSightTarget.Get() != Target || GetWorld()->GetTimeSeconds() - LineOfSightTime > MaxLineOfSightCacheAge)
+	{
+		return false;
+	}
+
+	bOutClear = bLineOfSightClear;
+	return true;
+}
+
+void AShooterNPC::FillAimRequest(FShooterAimRequest& OutRequest) const
+{
+	OutRequest.Source = GetPawnViewLocation();
+	OutRequest.Forward = GetBaseAimRotation().Vector();
+	OutRequest.AimRange = AimRange;
+	OutRequest.VarianceHalfAngle = AimVarianceHalfAngle;
+	OutRequest.MinOffsetZ = MinAimOffsetZ;
+	OutRequest.MaxOffsetZ = MaxAimOffsetZ;
+	OutRequest.RandomStream = AimRandomStream;
+
+	OutRequest.bHasTarget = IsValid(CurrentAimTarget);
+
+	if (OutRequest.bHasTarget)
+	{
+		OutRequest.TargetLocation = CurrentAimTarget->GetActorLocation();
+		OutRequest.TargetVelocity = CurrentAimTarget->GetVelocity();
+		OutRequest.bHasLineOfSight = HasCachedLineOfSight(CurrentAimTarget);
+	}
+
+	// lead by the speed of our weapon's projectiles
+	const AShooterProjectile* ProjectileCDO = Weapon ? Weapon->GetProjectileDefaultObject() : nullptr;
+	OutRequest.ProjectileSpeed = ProjectileCDO ? ProjectileCDO->GetProjectileSpeed() : 0.0f;
+}
+
+void AShooterNPC::ApplyAimResult(const FShooterAimResult& Result, const FShooterRandomStream& RandomStream)
+{
+	SolvedAimPoint = Result.AimPoint;
+	bSolvedAimSkipsTrace = Result.bSkipTrace;
+	bHasSolvedAim = true;
+
+	// solves that no shot uses are thrown away and redone from the same state, so only shots consume random numbers
+	SolvedAimRandomStream = RandomStream;
+}
+
+namespace ShooterNPCFootprint
+{
+	/** Per-character component footprint */
+	struct FFootprint
+	{
+		int32 Components = 0;
+		int32 TickingComponents = 0;
+		SIZE_T Bytes = 0;
+
+		/** Adds the components of the given actor */
+		void Add(const AActor* Actor)
+		{
+			if (!Actor)
+			{
+				return;
+			}
+
+			Bytes += Actor->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+
+			for (const UActorComponent* Component : Actor->GetComponents())
+			{
+				++Components;
+				Bytes += Component->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+
+				if (Component->PrimaryComponentTick.IsTickFunctionRegistered() && Component->PrimaryComponentTick.IsTickFunctionEnabled())
+				{
+					++TickingComponents;
+				}
+			}
+		}
+	};
+
+	/** Adds the character and all of its attached actors, such as weapons */
+	static FFootprint Measure(const AActor* Character)
+	{
+		FFootprint Footprint;
+		Footprint.Add(Character);
+
+		TArray<AActor*> AttachedActors;
+		Character->GetAttachedActors(AttachedActors);
+
+		for (const AActor* Attached : AttachedActors)
+		{
+			Footprint.Add(Attached);
+		}
+
+		return Footprint;
+	}
+
+	static void Report(UWorld* World)
+	{
+		FFootprint NPCTotal, PlayerTotal;
+		int32 NumNPCs = 0, NumPlayers = 0;
+
+		for (TActorIterator<AShooterNPC> It(World); It; ++It)
+		{
+			const FFootprint Footprint = Measure(*It);
+			NPCTotal.Components += Footprint.Components;
+			NPCTotal.TickingComponents += Footprint.TickingComponents;
+			NPCTotal.Bytes += Footprint.Bytes;
+			++NumNPCs;
+		}
+
+		for (TActorIterator<AShooterCharacter> It(World); It; ++It)
+		{
+			const FFootprint Footprint = Measure(*It);
+			PlayerTotal.Components += Footprint.Components;
+			PlayerTotal.TickingComponents += Footprint.TickingComponents;
+			PlayerTotal.Bytes += Footprint.Bytes;
+			++NumPlayers;
+		}
+
+		if (NumNPCs == 0)
+		{
+			UE_LOG(LogMeritoBrainDamage, Display, TEXT("NPC footprint: no NPCs in world"));
+			return;
+		}
+
+		const float NPCComponents = float(NPCTotal.Components) / NumNPCs;
+		const float NPCTicking = float(NPCTotal.TickingComponents) / NumNPCs;
+		const float NPCKB = float(NPCTotal.Bytes) / NumNPCs / 1024.0f;
+
+		UE_LOG(LogMeritoBrainDamage, Display, TEXT("NPC footprint: %d NPCs, per NPC (with weapon): %.1f components, %.1f ticking, %.1f KB"), NumNPCs, NPCComponents, NPCTicking, NPCKB);
+
+		// the player character carries the full first person setup, so use it as the baseline
+		if (NumPlayers > 0)
+		{
+			const float PlayerComponents = float(PlayerTotal.Components) / NumPlayers;
+			const float PlayerTicking = float(PlayerTotal.TickingComponents) / NumPlayers;
+			const float PlayerKB = float(PlayerTotal.Bytes) / NumPlayers / 1024.0f;
+
+			UE_LOG(LogMeritoBrainDamage, Display, TEXT("NPC footprint: first person baseline: %.1f components, %.1f ticking, %.1f KB. Saved per NPC: %.1f components, %.1f ticking, %.1f KB"),
+				PlayerComponents, PlayerTicking, PlayerKB,
+				PlayerComponents - NPCComponents, PlayerTicking - NPCTicking, PlayerKB - NPCKB);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorld ReportCommand(
+		TEXT("Shooter.NPCFootprint"),
+		TEXT("Logs the average component count, ticking component count and memory of each NPC compared to the first person player character"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&Report));
+}
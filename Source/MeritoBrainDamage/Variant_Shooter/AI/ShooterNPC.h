@@ -5,22 +5,34 @@
 #include "CoreMinimal.h"
 #include "MeritoBrainDamageCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterAnimBudget.h"
+#include "ShooterRandom.h"
 #include "ShooterNPC.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnDeathDelegate);
 
 class AShooterWeapon;
+class UShooterHitboxComponent;
+struct FShooterAimRequest;
+struct FShooterAimResult;
 
 /**
  *  A simple AI-controlled shooter game NPC
  *  Executes its behavior through a StateTree managed by its AI Controller
  *  Holds and manages a weapon
+ *  Skips the first person mesh and camera. Aims and checks line of sight from an eye socket on the world mesh instead
+ *  Belongs to a team through IGenericTeamAgentInterface
  */
 UCLASS(abstract)
-class MERITOBRAINDAMAGE_API AShooterNPC : public AMeritoBrainDamageCharacter, public IShooterWeaponHolder
+class MERITOBRAINDAMAGE_API AShooterNPC : public AMeritoBrainDamageCharacter, public IShooterWeaponHolder, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
+	/** Bone capsules used to find the body zone of hits */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterHitboxComponent* Hitboxes;
+
 public:
 
 	/** Current HP for this character. It dies if it reaches zero through damage */
@@ -56,6 +68,10 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category ="Weapons")
 	FName ThirdPersonWeaponSocket = FName("HandGrip_R");
 
+	/** Socket on the third person mesh used as the eyes for aiming and line of sight checks */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Aim")
+	FName EyeSocketName = FName("head");
+
 	/** Max range for aiming calculations */
 	UPROPERTY(EditAnywhere, Category="Aim")
 	float AimRange = 10000.0f;
@@ -72,15 +88,71 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Aim")
 	float MaxAimOffsetZ = -60.0f;
 
+	/** Looping idle played by the shared pose leaders when this NPC is outside the full animation budget */
+	UPROPERTY(EditAnywhere, Category="Animation Budget")
+	TObjectPtr<UAnimSequence> SharedIdleAnimation;
+
+	/** Looping run played by the shared pose leaders */
+	UPROPERTY(EditAnywhere, Category="Animation Budget")
+	TObjectPtr<UAnimSequence> SharedRunAnimation;
+
+	/** Looping shoot played by the shared pose leaders */
+	UPROPERTY(EditAnywhere, Category="Animation Budget")
+	TObjectPtr<UAnimSequence> SharedShootAnimation;
+
+	/** Static mesh with a vertex animation texture material, drawn as an instance when far away. Custom data 0 is the state, 1 is the phase */
+	UPROPERTY(EditAnywhere, Category="Animation Budget")
+	TObjectPtr<UStaticMesh> VertexAnimationMesh;
+
+	/** Current animation mode assigned by the budget */
+	EShooterAnimMode AnimMode = EShooterAnimMode::Full;
+
+	/** Leader we copy the pose from in shared mode */
+	TWeakObjectPtr<USkeletalMeshComponent> AnimLeader;
+
+	/** Max age of a cached line of sight result for the aim solver to trust it */
+	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
+	float MaxLineOfSightCacheAge = 0.25f;
+
 	/** Actor currently being targeted */
 	TObjectPtr<AActor> CurrentAimTarget;
 
+	/** Random stream used for aim variance */
+	FShooterRandomStream AimRandomStream;
+
+	/** Aim point solved by the aim solver for the next shot */
+	FVector SolvedAimPoint = FVector::ZeroVector;
+
+	/** Aim random stream as advanced by the last solve. Only committed when a shot uses the solved aim */
+	FShooterRandomStream SolvedAimRandomStream;
+
+	/** If true, the solved aim point is valid */
+	bool bHasSolvedAim = false;
+
+	/** If true, line of sight to the solved aim point is already known to be clear */
+	bool bSolvedAimSkipsTrace = false;
+
+	/** Target of the last line of sight check */
+	TWeakObjectPtr<AActor> LineOfSightTarget;
+
+	/** Game time of the last line of sight check */
+	float LineOfSightTime = -1.0f;
+
+	/** Result of the last line of sight check */
+	bool bLineOfSightClear = false;
+
 	/** If true, this character is currently shooting its weapon */
 	bool bIsShooting = false;
 
 	/** If true, this character has already died */
 	bool bIsDead = false;
 
+	/** If true, this character is hidden and idle while its state lives on as a dormant entity */
+	bool bIsDormant = false;
+
+	/** Encounter wave this character belongs to, INDEX_NONE if it wasn't spawned by one. Carried through dormancy */
+	int32 WaveId = INDEX_NONE;
+
 	/** Deferred destruction on death timer */
 	FTimerHandle DeathTimer;
 
@@ -89,6 +161,11 @@ public:
 	/** Delegate called when this NPC dies */
 	FPawnDeathDelegate OnPawnDeath;
 
+public:
+
+	/** Constructor */
+	AShooterNPC(const FObjectInitializer& ObjectInitializer);
+
 protected:
 
 	/** Gameplay initialization */
@@ -102,6 +179,69 @@ public:
 	/** Handle incoming damage */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+	/** Returns the eye socket location on the world mesh. Used for aiming, AI sight and line of sight checks */
+	virtual FVector GetPawnViewLocation() const override;
+
+	/** Returns the team byte for this character */
+	uint8 GetTeamByte() const { return TeamByte; };
+
+	/** Returns the type of weapon this character spawns with */
+	TSubclassOf<AShooterWeapon> GetWeaponClass() const { return WeaponClass; };
+
+	/** Returns true if this character has died */
+	bool IsDead() const { return bIsDead; };
+
+	/** Returns true if this character is parked in the dormant actor pool */
+	bool IsDormant() const { return bIsDormant; };
+
+	/** Returns the encounter wave this character belongs to, INDEX_NONE if none */
+	int32 GetWaveId() const { return WaveId; };
+
+	/** Sets the encounter wave this character belongs to */
+	void SetWaveId(int32 InWaveId) { WaveId = InWaveId; };
+
+	/** Returns true if this character is shooting and its weapon has a shot pending, so a solved aim will be used */
+	bool IsFiringWeapon() const;
+
+	/** Returns the common state used to pick a shared pose leader */
+	EShooterAnimState GetSharedAnimState() const;
+
+	/** Returns the shared animation for a state, if one is set */
+	UAnimSequence* GetSharedAnimation(EShooterAnimState State) const;
+
+	/** Returns the vertex animation mesh, if one is set */
+	UStaticMesh* GetVertexAnimationMesh() const { return VertexAnimationMesh; };
+
+	/** Returns the current animation mode */
+	EShooterAnimMode GetAnimMode() const { return AnimMode; };
+
+	/** Switches the world mesh between its own anim instance, a shared leader pose and being hidden for instancing */
+	void SetAnimMode(EShooterAnimMode Mode, USkeletalMeshComponent* Leader = nullptr);
+
+	/** Returns true if movement runs in simplified NavWalking mode */
+	bool IsMovementSimplified() const;
+
+	/** Switches between full walking physics and NavWalking. Switching back corrects the position against the world geometry */
+	void SetSimplifiedMovement(bool bSimplified);
+
+	/** Sets the weapon and team of a deferred spawned character. Must be called before it finishes spawning */
+	void SetSpawnProfile(TSubclassOf<AShooterWeapon> InWeaponClass, uint8 InTeamByte);
+
+	/** Hides the character and stops its movement, weapon and AI so it can wait in the actor pool */
+	void EnterDormancy();
+
+	/** Brings a pooled character back at a new location with the dormant entity's HP */
+	void ExitDormancy(const FVector& Location, const FRotator& Rotation, float HP);
+
+public:
+
+	//~Begin IGenericTeamAgentInterface interface
+
+	/** Returns the team this character belongs to, used by AI perception to filter by affiliation */
+	virtual FGenericTeamId GetGenericTeamId() const override { return FGenericTeamId(TeamByte); };
+
+	//~End IGenericTeamAgentInterface interface
+
 public:
 
 	//~Begin IShooterWeaponHolder interface
@@ -143,6 +283,9 @@ protected:
 	/** Called after death to destroy the actor */
 	void DeferredDestruction();
 
+	/** Pushes the capsule out of geometry and down onto the real floor after NavWalking */
+	void CorrectNavWalkingPosition();
+
 public:
 
 	/** Signals this character to start shooting at the passed actor */
@@ -150,4 +293,19 @@ public:
 
 	/** Signals this character to stop shooting */
 	void StopShooting();
+
+	/** Stores the result of a line of sight check so other systems can reuse it */
+	void CacheLineOfSight(AActor* Target, bool bClear);
+
+	/** Returns true if there's a recent, clear line of sight result for the given target */
+	bool HasCachedLineOfSight(const AActor* Target) const;
+
+	/** Returns true if there's a recent line of sight result for the given target, and outputs whether it was clear */
+	bool GetCachedLineOfSight(const AActor* Target, bool& bOutClear) const;
+
+	/** Fills an aim solver snapshot on the game thread */
+	void FillAimRequest(FShooterAimRequest& OutRequest) const;
+
+	/** Receives the aim solver result and the advanced random stream, which is held until a shot uses the result */
+	void ApplyAimResult(const FShooterAimResult& Result, const FShooterRandomStream& RandomStream);
 };
@@ -0,0 +1,251 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterNoise.h"
+#include "ShooterAIController.h"
+#include "ShooterInfluence.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "Perception/AIPerceptionSystem.h"
+#include "Perception/AISense_Hearing.h"
+#include "Perception/AISenseConfig_Hearing.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Noise Delivery"), STAT_ShooterNoiseDelivery, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Noises Reported"), STAT_ShooterNoisesReported, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Noise Events Delivered"), STAT_ShooterNoiseEvents, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Noise Stimuli Delivered"), STAT_ShooterNoiseStimuli, STATGROUP_Shooter);
+
+bool UShooterNoiseSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterNoiseSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterNoiseSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterNoiseSubsystem::RegisterListener(AShooterAIController* Controller)
+{
+	Controllers.AddUnique(Controller);
+}
+
+void UShooterNoiseSubsystem::UnregisterListener(AShooterAIController* Controller)
+{
+	Controllers.RemoveSwap(Controller);
+}
+
+void UShooterNoiseSubsystem::ReportNoise(AActor* NoiseMaker, float Loudness, APawn* Instigator, const FVector& Location, float MaxRange, FName Tag)
+{
+	if (!NoiseMaker)
+	{
+		return;
+	}
+
+	// gunfire also marks the area as dangerous for the instigator's enemies
+	UShooterInfluenceSubsystem::ReportGunfire(Instigator ? static_cast<AActor*>(Instigator) : NoiseMaker, Location, Loudness);
+
+	UShooterNoiseSubsystem* NoiseSubsystem = NoiseMaker->GetWorld()->GetSubsystem<UShooterNoiseSubsystem>();
+
+	// no aggregator in this world, so let the engine hearing sense handle it
+	if (!NoiseSubsystem)
+	{
+		NoiseMaker->MakeNoise(Loudness, Instigator, Location, MaxRange, Tag);
+		return;
+	}
+
+	// hearing stimuli are reported for the instigator when there is one
+	NoiseSubsystem->AddNoise(Loudness, Instigator ? static_cast<AActor*>(Instigator) : NoiseMaker, Location, MaxRange, Tag);
+}
+
+void UShooterNoiseSubsystem::AddNoise(float Loudness, AActor* Source, const FVector& Location, float MaxRange, FName Tag)
+{
+	INC_DWORD_STAT(STAT_ShooterNoisesReported);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const double MergeRadiusSq = FMath::Square(MergeRadius);
+
+	// merge into an open event from the same instigator and tag nearby
+	for (FShooterPendingNoise& Pending : PendingNoises)
+	{
+		if (Pending.Source.Get() == Source
+			&& Pending.Tag == Tag
+			&& FVector::DistSquared(Pending.Location, Location) <= MergeRadiusSq)
+		{
+			Pending.LoudnessSq += FMath::Square(Loudness);
+			Pending.MaxRange = (Pending.MaxRange > 0.0f && MaxRange > 0.0f) ? FMath::Max(Pending.MaxRange, MaxRange) : 0.0f;
+			++Pending.NumReports;
+			return;
+		}
+	}
+
+	FShooterPendingNoise& NewNoise = PendingNoises.AddDefaulted_GetRef();
+	NewNoise.Source = Source;
+	NewNoise.Tag = Tag;
+	NewNoise.Location = Location;
+	NewNoise.LoudnessSq = FMath::Square(Loudness);
+	NewNoise.MaxRange = MaxRange;
+	NewNoise.FirstReportTime = Now;
+	NewNoise.NumReports = 1;
+}
+
+void UShooterNoiseSubsystem::Tick(float DeltaTime)
+{
+	if (PendingNoises.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShooterNoiseDelivery);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	bool bGridBuilt = false;
+
+	for (int32 i = PendingNoises.Num() - 1; i >= 0; --i)
+	{
+		// keep merging until the window closes
+		if (Now - PendingNoises[i].FirstReportTime < MergeWindow)
+		{
+			continue;
+		}
+
+		// only snapshot the listeners on frames where we actually deliver
+		if (!bGridBuilt)
+		{
+			BuildListenerGrid();
+			bGridBuilt = true;
+		}
+
+		DeliverNoise(PendingNoises[i]);
+		PendingNoises.RemoveAtSwap(i, EAllowShrinking::No);
+	}
+}
+
+void UShooterNoiseSubsystem::BuildListenerGrid()
+{
+	Controllers.RemoveAllSwap([](const TWeakObjectPtr<AShooterAIController>& Controller) { return !Controller.IsValid(); });
+
+	Listeners.Reset();
+	MaxHearingRange = 0.0f;
+
+	for (TPair<uint8, FShooterNoiseTeam>& Team : ListenerGrid)
+	{
+		Team.Value.AffiliationFlags = 0;
+		Team.Value.Cells.Reset();
+	}
+
+	const FAISenseID HearingID = UAISense::GetSenseID<UAISense_Hearing>();
+
+	for (const TWeakObjectPtr<AShooterAIController>& Controller : Controllers)
+	{
+		const APawn* Pawn = Controller->GetPawn();
+		UAIPerceptionComponent* Perception = Controller->GetShooterPerception();
+		const UAISenseConfig_Hearing* HearingConfig = Perception ? Cast<const UAISenseConfig_Hearing>(Perception->GetSenseConfig(HearingID)) : nullptr;
+
+		if (!Pawn || !HearingConfig || !Perception->IsActive())
+		{
+			continue;
+		}
+
+		FShooterNoiseListener& Listener = Listeners.AddDefaulted_GetRef();
+		Listener.Perception = Perception;
+		Listener.Location = Pawn->GetPawnViewLocation();
+		Listener.HearingRange = HearingConfig->HearingRange;
+		Listener.AffiliationFlags = HearingConfig->DetectionByAffiliation.GetAsFlags();
+
+		MaxHearingRange = FMath::Max(MaxHearingRange, Listener.HearingRange);
+
+		FShooterNoiseTeam& Team = ListenerGrid.FindOrAdd(Controller->GetGenericTeamId().GetId());
+		Team.AffiliationFlags |= Listener.AffiliationFlags;
+		Team.Cells.FindOrAdd(GetCell(Listener.Location.X, Listener.Location.Y)).Add(Listeners.Num() - 1);
+	}
+}
+
+void UShooterNoiseSubsystem::DeliverNoise(const FShooterPendingNoise& Noise)
+{
+	INC_DWORD_STAT(STAT_ShooterNoiseEvents);
+
+	UAIPerceptionSystem* PerceptionSystem = UAIPerceptionSystem::GetCurrent(GetWorld());
+	const UAISense* HearingSense = PerceptionSystem ? PerceptionSystem->GetSenseInstance(UAISense::GetSenseID<UAISense_Hearing>()) : nullptr;
+
+	if (!HearingSense)
+	{
+		return;
+	}
+
+	// combine the merged reports as if their energy added up
+	const float Loudness = FMath::Sqrt(Noise.LoudnessSq);
+
+	AActor* Source = Noise.Source.Get();
+
+	if (!Source)
+	{
+		return;
+	}
+
+	const FGenericTeamId SourceTeam = FGenericTeamId::GetTeamIdentifier(Source);
+
+	// the largest distance any listener could hear this from
+	float SearchRadius = MaxHearingRange * Loudness;
+
+	if (Noise.MaxRange > 0.0f)
+	{
+		SearchRadius = FMath::Min(SearchRadius, Noise.MaxRange * Loudness);
+	}
+
+	const FIntPoint MinCell = GetCell(Noise.Location.X - SearchRadius, Noise.Location.Y - SearchRadius);
+	const FIntPoint MaxCell = GetCell(Noise.Location.X + SearchRadius, Noise.Location.Y + SearchRadius);
+
+	for (const TPair<uint8, FShooterNoiseTeam>& Team : ListenerGrid)
+	{
+		// skip the whole grid of a team that can't hear this source, usually the source's own team
+		if (!FAISenseAffiliationFilter::ShouldSenseTeam(FGenericTeamId(Team.Key), SourceTeam, Team.Value.AffiliationFlags))
+		{
+			continue;
+		}
+
+		for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+		{
+			for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+			{
+				const TArray<int32>* Cell = Team.Value.Cells.Find(FIntPoint(CellX, CellY));
+
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (const int32 ListenerIndex : *Cell)
+				{
+					const FShooterNoiseListener& Listener = Listeners[ListenerIndex];
+					UAIPerceptionComponent* Perception = Listener.Perception.Get();
+
+					if (!Perception || !FAISenseAffiliationFilter::ShouldSenseTeam(FGenericTeamId(Team.Key), SourceTeam, Listener.AffiliationFlags))
+					{
+						continue;
+					}
+
+					// same range rules as the engine hearing sense, scaled by loudness
+					const double DistSq = FVector::DistSquared(Noise.Location, Listener.Location);
+
+					if (DistSq > FMath::Square(Listener.HearingRange * Loudness)
+						|| (Noise.MaxRange > 0.0f && DistSq > FMath::Square(Noise.MaxRange * Loudness)))
+					{
+						continue;
+					}
+
+					Perception->RegisterStimulus(Source, FAIStimulus(*HearingSense, Loudness, Noise.Location, Listener.Location, FAIStimulus::SensingSucceeded, Noise.Tag));
+
+					INC_DWORD_STAT(STAT_ShooterNoiseStimuli);
+				}
+			}
+		}
+	}
+}
+
+FIntPoint UShooterNoiseSubsystem::GetCell(double X, double Y) const
+{
+	return FIntPoint(FMath::FloorToInt32(X / GridCellSize), FMath::FloorToInt32(Y / GridCellSize));
+}
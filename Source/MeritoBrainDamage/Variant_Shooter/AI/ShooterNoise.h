@@ -0,0 +1,139 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterNoise.generated.h"
+
+class AShooterAIController;
+class UAIPerceptionComponent;
+
+/**
+ *  A noise waiting to be delivered, possibly merged from several reports
+ */
+struct FShooterPendingNoise
+{
+	/** Actor the stimulus is reported for. The instigator, or the noise maker if there's none */
+	TWeakObjectPtr<AActor> Source;
+
+	/** Noise tag */
+	FName Tag;
+
+	/** Location of the first report */
+	FVector Location = FVector::ZeroVector;
+
+	/** Sum of the squared loudness of all merged reports */
+	float LoudnessSq = 0.0f;
+
+	/** Largest max range of all merged reports. Zero means unlimited */
+	float MaxRange = 0.0f;
+
+	/** Game time of the first report */
+	float FirstReportTime = 0.0f;
+
+	/** Number of merged reports */
+	int32 NumReports = 0;
+};
+
+/**
+ *  Hearing listener snapshot, rebuilt when noises are delivered
+ */
+struct FShooterNoiseListener
+{
+	/** Perception component to deliver to */
+	TWeakObjectPtr<UAIPerceptionComponent> Perception;
+
+	/** Listener location */
+	FVector Location = FVector::ZeroVector;
+
+	/** Hearing range from the listener's hearing config */
+	float HearingRange = 0.0f;
+
+	/** Affiliation flags from the listener's hearing config */
+	uint8 AffiliationFlags = 0;
+};
+
+/**
+ *  Hearing listeners for one team, bucketed by grid cell
+ */
+struct FShooterNoiseTeam
+{
+	/** Combined affiliation flags of all listeners on the team */
+	uint8 AffiliationFlags = 0;
+
+	/** Listener indices by grid cell */
+	TMap<FIntPoint, TArray<int32>> Cells;
+};
+
+/**
+ *  Merges gameplay noises before they reach AI hearing
+ *  Noises with the same instigator and tag inside a short space and time window become a single event
+ *  with combined loudness, delivered to hearing listeners found through a team-aware spatial grid
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterNoiseSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Registered AI controllers */
+	TArray<TWeakObjectPtr<AShooterAIController>> Controllers;
+
+	/** Noises waiting for their merge window to close */
+	TArray<FShooterPendingNoise> PendingNoises;
+
+	/** Listener snapshots for the current delivery */
+	TArray<FShooterNoiseListener> Listeners;
+
+	/** Listener grid by team ID */
+	TMap<uint8, FShooterNoiseTeam> ListenerGrid;
+
+	/** Largest hearing range among the listeners */
+	float MaxHearingRange = 0.0f;
+
+protected:
+
+	/** Noises from the same instigator and tag closer than this are merged */
+	float MergeRadius = 300.0f;
+
+	/** Time window during which noises are merged */
+	float MergeWindow = 0.2f;
+
+	/** Size of the listener grid cells */
+	float GridCellSize = 2000.0f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Delivers the noises whose merge window has closed */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Adds a hearing listener */
+	void RegisterListener(AShooterAIController* Controller);
+
+	/** Removes a hearing listener */
+	void UnregisterListener(AShooterAIController* Controller);
+
+	/** Reports a noise through the aggregator, or through the engine if there's no aggregator in this world */
+	static void ReportNoise(AActor* NoiseMaker, float Loudness, APawn* Instigator, const FVector& Location, float MaxRange, FName Tag);
+
+protected:
+
+	/** Merges a noise into a pending event or starts a new one */
+	void AddNoise(float Loudness, AActor* Source, const FVector& Location, float MaxRange, FName Tag);
+
+	/** Rebuilds the listener snapshots and grid */
+	void BuildListenerGrid();
+
+	/** Sends a merged noise to every listener that can hear it */
+	void DeliverNoise(const FShooterPendingNoise& Noise);
+
+	/** Returns the grid cell for a location */
+	FIntPoint GetCell(double X, double Y) const;
+};
@@ -0,0 +1,508 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterSightSense.h"
+#include "ShooterVisibility.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "Engine/World.h"
+#include "Math/VectorRegister.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shooter Sight Update"), STAT_ShooterSightUpdate, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Candidates"), STAT_ShooterSightCandidates, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Cone Passes"), STAT_ShooterSightConePasses, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Traces"), STAT_ShooterSightTraces, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shooter Sight Queued"), STAT_ShooterSightQueued, STATGROUP_Shooter);
+
+UAISense_ShooterSight::UAISense_ShooterSight(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// every pawn is a potential sight target
+	bAutoRegisterAllPawnsAsSources = true;
+
+	// only notify when a target is gained or lost, same as the engine sight sense
+	NotifyType = EAISenseNotifyType::OnPerceptionChange;
+
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		OnNewListenerDelegate.BindUObject(this, &UAISense_ShooterSight::OnNewListenerImpl);
+		OnListenerUpdateDelegate.BindUObject(this, &UAISense_ShooterSight::OnListenerUpdateImpl);
+		OnListenerRemovedDelegate.BindUObject(this, &UAISense_ShooterSight::OnListenerRemovedImpl);
+
+		TraceDelegate.BindUObject(this, &UAISense_ShooterSight::OnTraceDone);
+	}
+}
+
+float UAISense_ShooterSight::Update()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSightUpdate);
+
+	BuildGrid();
+
+	AIPerception::FListenerMap& ListenersMap = *GetListeners();
+
+	for (TPair<FPerceptionListenerID, FPerceptionListener>& ListenerPair : ListenersMap)
+	{
+		const FPerceptionListener& Listener = ListenerPair.Value;
+
+		if (!Listener.HasSense(GetSenseID()))
+		{
+			continue;
+		}
+
+		if (const FDigestedListener* Digest = DigestedListeners.Find(Listener.GetListenerID()))
+		{
+			GatherCandidates(Listener, *Digest);
+			TestCandidates(Listener, *Digest);
+		}
+	}
+
+	IssueTraces();
+
+	SET_DWORD_STAT(STAT_ShooterSightQueued, QueryQueue.Num());
+
+	// update every frame, the trace budget limits the actual work
+	return 0.0f;
+}
+
+void UAISense_ShooterSight::BuildGrid()
+{
+	// drop destroyed sources
+	Sources.RemoveAllSwap([](const TWeakObjectPtr<AActor>& Source) { return !Source.IsValid(); });
+
+	const int32 NumSources = Sources.Num();
+
+	SourceX.SetNumUninitialized(NumSources, EAllowShrinking::No);
+	SourceY.SetNumUninitialized(NumSources, EAllowShrinking::No);
+	SourceZ.SetNumUninitialized(NumSources, EAllowShrinking::No);
+	SourceTeams.SetNumUninitialized(NumSources, EAllowShrinking::No);
+
+	// empty the cells but keep their allocations, as the sources rarely move far in a frame
+	for (TPair<FIntPoint, TArray<int32>>& Cell : Grid)
+	{
+		Cell.Value.Reset();
+	}
+
+	for (int32 i = 0; i < NumSources; ++i)
+	{
+		const AActor* Source = Sources[i].Get();
+		const FVector Location = Source->GetActorLocation();
+
+		SourceX[i] = float(Location.X);
+		SourceY[i] = float(Location.Y);
+		SourceZ[i] = float(Location.Z);
+		SourceTeams[i] = FGenericTeamId::GetTeamIdentifier(Source);
+
+		Grid.FindOrAdd(GetCell(SourceX[i], SourceY[i])).Add(i);
+	}
+
+	// drop the cells everybody left, so the grid doesn't keep every cell ever visited
+	for (TMap<FIntPoint, TArray<int32>>::TIterator It = Grid.CreateIterator(); It; ++It)
+	{
+		if (It->Value.IsEmpty())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UAISense_ShooterSight::GatherCandidates(const FPerceptionListener& Listener, const FDigestedListener& Digest)
+{
+	CandidateIndices.Reset();
+	CandidateX.Reset();
+	CandidateY.Reset();
+	CandidateZ.Reset();
+
+	const AActor* BodyActor = Listener.GetBodyActor();
+	const FVector& ListenerLocation = Listener.CachedLocation;
+
+	// visit every cell the lose sight radius touches
+	const float SearchRadius = FMath::Sqrt(Digest.LoseSightRadiusSq);
+	const FIntPoint MinCell = GetCell(float(ListenerLocation.X) - SearchRadius, float(ListenerLocation.Y) - SearchRadius);
+	const FIntPoint MaxCell = GetCell(float(ListenerLocation.X) + SearchRadius, float(ListenerLocation.Y) + SearchRadius);
+
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			const TArray<int32>* Cell = Grid.Find(FIntPoint(CellX, CellY));
+
+			if (!Cell)
+			{
+				continue;
+			}
+
+			for (const int32 SourceIndex : *Cell)
+			{
+				// skip ourselves and anyone the affiliation filter rejects
+				if (Sources[SourceIndex].Get() == BodyActor
+					|| !FAISenseAffiliationFilter::ShouldSenseTeam(Listener.TeamIdentifier, SourceTeams[SourceIndex], Digest.AffiliationFlags))
+				{
+					continue;
+				}
+
+				CandidateIndices.Add(SourceIndex);
+				CandidateX.Add(SourceX[SourceIndex]);
+				CandidateY.Add(SourceY[SourceIndex]);
+				CandidateZ.Add(SourceZ[SourceIndex]);
+			}
+		}
+	}
+
+	// pad to the vector width with far away points that always fail the range test
+	while (CandidateX.Num() % 4 != 0)
+	{
+		CandidateX.Add(UE_BIG_NUMBER);
+		CandidateY.Add(UE_BIG_NUMBER);
+		CandidateZ.Add(UE_BIG_NUMBER);
+	}
+
+	INC_DWORD_STAT_BY(STAT_ShooterSightCandidates, CandidateIndices.Num());
+}
+
+void UAISense_ShooterSight::TestCandidates(const FPerceptionListener& Listener, const FDigestedListener& Digest)
+{
+	const int32 NumPadded = CandidateX.Num();
+
+	CandidateDistSq.SetNumUninitialized(NumPadded, EAllowShrinking::No);
+	CandidatePassed.SetNumZeroed(NumPadded, EAllowShrinking::No);
+
+	const FVector& Location = Listener.CachedLocation;
+	const FVector& Direction = Listener.CachedDirection;
+
+	const VectorRegister4Float ListenerX = VectorSetFloat1(float(Location.X));
+	const VectorRegister4Float ListenerY = VectorSetFloat1(float(Location.Y));
+	const VectorRegister4Float ListenerZ = VectorSetFloat1(float(Location.Z));
+	const VectorRegister4Float DirX = VectorSetFloat1(float(Direction.X));
+	const VectorRegister4Float DirY = VectorSetFloat1(float(Direction.Y));
+	const VectorRegister4Float DirZ = VectorSetFloat1(float(Direction.Z));
+	const VectorRegister4Float MaxDistSq = VectorSetFloat1(Digest.LoseSightRadiusSq);
+	const VectorRegister4Float ConeCosSq = VectorSetFloat1(FMath::Square(Digest.PeripheralVisionCos));
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const bool bNarrowCone = Digest.PeripheralVisionCos >= 0.0f;
+
+	// test four candidates at a time
+	for (int32 i = 0; i < NumPadded; i += 4)
+	{
+		const VectorRegister4Float DeltaX = VectorSubtract(VectorLoad(&CandidateX[i]), ListenerX);
+		const VectorRegister4Float DeltaY = VectorSubtract(VectorLoad(&CandidateY[i]), ListenerY);
+		const VectorRegister4Float DeltaZ = VectorSubtract(VectorLoad(&CandidateZ[i]), ListenerZ);
+
+		// squared distance and the dot product against the view direction
+		const VectorRegister4Float DistSq = VectorMultiplyAdd(DeltaZ, DeltaZ, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaX, DeltaX)));
+		const VectorRegister4Float Dot = VectorMultiplyAdd(DeltaZ, DirZ, VectorMultiplyAdd(DeltaY, DirY, VectorMultiply(DeltaX, DirX)));
+
+		// compare the squared dot against the squared cosine to avoid a square root
+		const VectorRegister4Float InFront = VectorCompareGE(Dot, Zero);
+		const VectorRegister4Float DotSq = VectorMultiply(Dot, Dot);
+		const VectorRegister4Float ConeLimit = VectorMultiply(ConeCosSq, DistSq);
+
+		const VectorRegister4Float InCone = bNarrowCone
+			? VectorBitwiseAnd(InFront, VectorCompareGE(DotSq, ConeLimit))
+			: VectorBitwiseOr(InFront, VectorCompareLE(DotSq, ConeLimit));
+
+		const VectorRegister4Float InRange = VectorCompareLE(DistSq, MaxDistSq);
+
+		const int32 Mask = VectorMaskBits(VectorBitwiseAnd(InCone, InRange));
+
+		VectorStore(DistSq, &CandidateDistSq[i]);
+
+		CandidatePassed[i] = (Mask & 1) != 0;
+		CandidatePassed[i + 1] = (Mask & 2) != 0;
+		CandidatePassed[i + 2] = (Mask & 4) != 0;
+		CandidatePassed[i + 3] = (Mask & 8) != 0;
+	}
+
+	// queue traces for the survivors and drop the visible targets that left the cone
+	FPerceptionListener* MutableListener = GetListeners()->Find(Listener.GetListenerID());
+
+	CandidateKeys.Reset();
+
+	for (int32 i = 0; i < CandidateIndices.Num(); ++i)
+	{
+		AActor* Target = Sources[CandidateIndices[i]].Get();
+		const FObjectKey TargetKey(Target);
+		const bool bVisible = Digest.VisibleTargets.Contains(TargetKey);
+
+		CandidateKeys.Add(TargetKey);
+
+		// the vector test used the lose sight radius, so targets we're not already seeing need the shorter sight radius
+		const bool bPassed = CandidatePassed[i] && (bVisible || CandidateDistSq[i] <= Digest.SightRadiusSq);
+
+		if (bPassed)
+		{
+			INC_DWORD_STAT(STAT_ShooterSightConePasses);
+
+			bool bAlreadyPending = false;
+			PendingPairs.Add(TPair<FPerceptionListenerID, FObjectKey>(Listener.GetListenerID(), TargetKey), &bAlreadyPending);
+
+			if (!bAlreadyPending)
+			{
+				QueryQueue.Add({ Listener.GetListenerID(), Target, TargetKey });
+			}
+
+		} else if (bVisible && MutableListener) {
+
+			DeliverStimulus(*MutableListener, *Target, false);
+		}
+	}
+
+	// visible targets that teleported out of the candidate cells or were destroyed aren't candidates anymore
+	if (MutableListener && Digest.VisibleTargets.Num() > 0)
+	{
+		LostTargets.Reset();
+
+		for (const FObjectKey& TargetKey : Digest.VisibleTargets)
+		{
+			if (!CandidateKeys.Contains(TargetKey))
+			{
+				LostTargets.Add(TargetKey);
+			}
+		}
+
+		for (const FObjectKey& TargetKey : LostTargets)
+		{
+			LoseTarget(*MutableListener, TargetKey);
+		}
+	}
+}
+
+void UAISense_ShooterSight::IssueTraces()
+{
+	UWorld* World = GetWorld();
+
+	if (!World)
+	{
+		return;
+	}
+
+	// only the simplified blockers when the map has them
+	const ECollisionChannel TraceChannel = UShooterVisibilitySubsystem::GetTraceChannel(World);
+
+	int32 NumIssued = 0;
+	int32 NumConsumed = 0;
+
+	while (NumConsumed < QueryQueue.Num() && NumIssued < MaxTracesPerFrame)
+	{
+		const FSightQuery& Query = QueryQueue[NumConsumed++];
+
+		const FPerceptionListener* Listener = GetListeners()->Find(Query.ListenerID);
+		const AActor* Target = Query.Target.Get();
+
+		// the listener or target went away while queued
+		if (!Listener || !Target)
+		{
+			PendingPairs.Remove(TPair<FPerceptionListenerID, FObjectKey>(Query.ListenerID, Query.TargetKey));
+			continue;
+		}
+
+		// places that can never see each other fail right away, without using up the trace budget
+		if (!UShooterVisibilitySubsystem::CanPossiblySee(World, Listener->CachedLocation, Target->GetActorLocation()))
+		{
+			PendingPairs.Remove(TPair<FPerceptionListenerID, FObjectKey>(Query.ListenerID, Query.TargetKey));
+
+			if (FPerceptionListener* MutableListener = GetListeners()->Find(Query.ListenerID))
+			{
+				DeliverStimulus(*MutableListener, *Query.Target.Get(), false);
+			}
+
+			continue;
+		}
+
+		// ignore both ends. Any blocking hit in between means the target is obstructed
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterSight), true, Listener->GetBodyActor());
+		QueryParams.AddIgnoredActor(Target);
+
+		const uint32 QueryID = NextQueryID++;
+		InFlightQueries.Add(QueryID, Query);
+
+		World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Listener->CachedLocation, Target->GetActorLocation(), TraceChannel, QueryParams, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, QueryID);
+
+		++NumIssued;
+	}
+
+	QueryQueue.RemoveAt(0, NumConsumed, EAllowShrinking::No);
+
+	SET_DWORD_STAT(STAT_ShooterSightTraces, NumIssued);
+}
+
+void UAISense_ShooterSight::OnTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	FSightQuery Query;
+
+	if (!InFlightQueries.RemoveAndCopyValue(TraceDatum.UserData, Query))
+	{
+		return;
+	}
+
+	AActor* Target = Query.Target.Get();
+
+	PendingPairs.Remove(TPair<FPerceptionListenerID, FObjectKey>(Query.ListenerID, Query.TargetKey));
+
+	FPerceptionListener* Listener = GetListeners()->Find(Query.ListenerID);
+
+	if (!Listener || !Target)
+	{
+		return;
+	}
+
+	const bool bBlocked = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+
+	DeliverStimulus(*Listener, *Target, !bBlocked);
+}
+
+void UAISense_ShooterSight::DeliverStimulus(FPerceptionListener& Listener, AActor& Target, bool bSensed)
+{
+	FDigestedListener* Digest = DigestedListeners.Find(Listener.GetListenerID());
+
+	if (!Digest)
+	{
+		return;
+	}
+
+	const FObjectKey TargetKey(&Target);
+
+	if (bSensed)
+	{
+		Digest->VisibleTargets.Add(TargetKey);
+
+	} else if (Digest->VisibleTargets.Remove(TargetKey) == 0) {
+
+		// nothing to report, we never saw this target
+		return;
+	}
+
+	Listener.RegisterStimulus(&Target, FAIStimulus(*this, 1.0f, Target.GetActorLocation(), Listener.CachedLocation, bSensed ? FAIStimulus::SensingSucceeded : FAIStimulus::SensingFailed));
+}
+
+void UAISense_ShooterSight::LoseTarget(FPerceptionListener& Listener, const FObjectKey& TargetKey)
+{
+	if (AActor* Target = Cast<AActor>(TargetKey.ResolveObjectPtr()))
+	{
+		DeliverStimulus(Listener, *Target, false);
+
+	} else if (FDigestedListener* Digest = DigestedListeners.Find(Listener.GetListenerID())) {
+
+		// destroyed targets are removed from the perception by the engine, so only forget them here
+		Digest->VisibleTargets.Remove(TargetKey);
+	}
+}
+
+void UAISense_ShooterSight::RegisterSource(AActor& SourceActor)
+{
+	Sources.AddUnique(&SourceActor);
+}
+
+void UAISense_ShooterSight::UnregisterSource(AActor& SourceActor)
+{
+	Sources.RemoveSwap(&SourceActor);
+
+	const FObjectKey SourceKey(&SourceActor);
+
+	// every listener that was seeing the source loses sight of it
+	for (TPair<FPerceptionListenerID, FDigestedListener>& Digest : DigestedListeners)
+	{
+		if (Digest.Value.VisibleTargets.Contains(SourceKey))
+		{
+			if (FPerceptionListener* Listener = GetListeners()->Find(Digest.Key))
+			{
+				DeliverStimulus(*Listener, SourceActor, false);
+
+			} else {
+
+				Digest.Value.VisibleTargets.Remove(SourceKey);
+			}
+		}
+	}
+
+	// and its queued or in flight traces must not report it again
+	QueryQueue.RemoveAll([&SourceKey](const FSightQuery& Query) { return Query.TargetKey == SourceKey; });
+
+	for (TMap<uint32, FSightQuery>::TIterator It = InFlightQueries.CreateIterator(); It; ++It)
+	{
+		if (It->Value.TargetKey == SourceKey)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (TSet<TPair<FPerceptionListenerID, FObjectKey>>::TIterator It = PendingPairs.CreateIterator(); It; ++It)
+	{
+		if (It->Value == SourceKey)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UAISense_ShooterSight::OnListenerForgetsActor(const FPerceptionListener& Listener, AActor& ActorToForget)
+{
+	if (FDigestedListener* Digest = DigestedListeners.Find(Listener.GetListenerID()))
+	{
+		Digest->VisibleTargets.Remove(FObjectKey(&ActorToForget));
+	}
+}
+
+void UAISense_ShooterSight::OnListenerForgetsAll(const FPerceptionListener& Listener)
+{
+	if (FDigestedListener* Digest = DigestedListeners.Find(Listener.GetListenerID()))
+	{
+		Digest->VisibleTargets.Reset();
+	}
+}
+
+void UAISense_ShooterSight::OnNewListenerImpl(const FPerceptionListener& NewListener)
+{
+	OnListenerUpdateImpl(NewListener);
+}
+
+void UAISense_ShooterSight::OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener)
+{
+	const UAIPerceptionComponent* PerceptionComponent = UpdatedListener.Listener.Get();
+	const UAISenseConfig_ShooterSight* Config = PerceptionComponent ? Cast<const UAISenseConfig_ShooterSight>(PerceptionComponent->GetSenseConfig(GetSenseID())) : nullptr;
+
+	if (!Config || !UpdatedListener.HasSense(GetSenseID()))
+	{
+		OnListenerRemovedImpl(UpdatedListener);
+		return;
+	}
+
+	// keep the visible set across config updates
+	FDigestedListener& Digest = DigestedListeners.FindOrAdd(UpdatedListener.GetListenerID());
+
+	Digest.SightRadiusSq = FMath::Square(Config->SightRadius);
+	Digest.LoseSightRadiusSq = FMath::Square(FMath::Max(Config->LoseSightRadius, Config->SightRadius));
+	Digest.PeripheralVisionCos = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(Config->PeripheralVisionAngleDegrees, 0.0f, 180.0f)));
+	Digest.AffiliationFlags = Config->DetectionByAffiliation.GetAsFlags();
+}
+
+void UAISense_ShooterSight::OnListenerRemovedImpl(const FPerceptionListener& RemovedListener)
+{
+	DigestedListeners.Remove(RemovedListener.GetListenerID());
+
+	// queued and in flight queries for this listener are discarded when they come up
+}
+
+FIntPoint UAISense_ShooterSight::GetCell(float X, float Y) const
+{
+	return FIntPoint(FMath::FloorToInt32(X / GridCellSize), FMath::FloorToInt32(Y / GridCellSize));
+}
+
+////////////////////////////////////////////////////////////////////
+
+UAISenseConfig_ShooterSight::UAISenseConfig_ShooterSight(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	DebugColor = FColor::Green;
+	Implementation = UAISense_ShooterSight::StaticClass();
+
+	// only detect enemies by default
+	DetectionByAffiliation.bDetectEnemies = true;
+	DetectionByAffiliation.bDetectNeutrals = false;
+	DetectionByAffiliation.bDetectFriendlies = false;
+}
+
+TSubclassOf<UAISense> UAISenseConfig_ShooterSight::GetSenseImplementation() const
+{
+	return Implementation;
+}
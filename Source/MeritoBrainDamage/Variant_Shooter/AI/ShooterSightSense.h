@@ -0,0 +1,198 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Perception/AISense.h"
+#include "Perception/AISenseConfig.h"
+#include "WorldCollision.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterSightSense.generated.h"
+
+/**
+ *  Batched sight sense for shooter AI
+ *  Keeps all sight sources in a spatial grid and tests every listener against its nearby candidates
+ *  with vectorized cone and range checks. Surviving pairs are traced asynchronously under a per-frame budget
+ *  Delivers the same FAIStimulus data as the engine sight sense
+ */
+UCLASS(ClassGroup=AI, config=Game)
+class MERITOBRAINDAMAGE_API UAISense_ShooterSight : public UAISense
+{
+	GENERATED_BODY()
+
+	/** Cached sense properties for a listener */
+	struct FDigestedListener
+	{
+		/** Squared sight radius for new targets */
+		float SightRadiusSq = 0.0f;
+
+		/** Squared sight radius for targets already seen */
+		float LoseSightRadiusSq = 0.0f;
+
+		/** Cosine of the peripheral vision half angle */
+		float PeripheralVisionCos = 0.0f;
+
+		/** Affiliation flags from the sense config */
+		uint8 AffiliationFlags = 0;
+
+		/** Targets this listener currently sees */
+		TSet<FObjectKey> VisibleTargets;
+	};
+
+	/** A listener/target pair waiting for a visibility trace */
+	struct FSightQuery
+	{
+		/** Listener to deliver the result to */
+		FPerceptionListenerID ListenerID;
+
+		/** Target being traced to */
+		TWeakObjectPtr<AActor> Target;
+
+		/** Key for the target, still valid after it's destroyed */
+		FObjectKey TargetKey;
+	};
+
+	/** Registered sight sources */
+	TArray<TWeakObjectPtr<AActor>> Sources;
+
+	/** Per-frame source snapshot, split by component so it can be loaded into vector registers */
+	TArray<float> SourceX;
+	TArray<float> SourceY;
+	TArray<float> SourceZ;
+	TArray<FGenericTeamId> SourceTeams;
+
+	/** Spatial grid of source indices, rebuilt every update */
+	TMap<FIntPoint, TArray<int32>> Grid;
+
+	/** Scratch candidate buffers, padded to a multiple of the vector width */
+	TArray<int32> CandidateIndices;
+	TArray<float> CandidateX;
+	TArray<float> CandidateY;
+	TArray<float> CandidateZ;
+	TArray<float> CandidateDistSq;
+	TArray<uint8> CandidatePassed;
+
+	/** Scratch set of this listener's candidate keys, used to find visible targets that are no longer candidates */
+	TSet<FObjectKey> CandidateKeys;
+
+	/** Scratch list of visible targets to drop */
+	TArray<FObjectKey> LostTargets;
+
+	/** Digested listener properties */
+	TMap<FPerceptionListenerID, FDigestedListener> DigestedListeners;
+
+	/** Pairs waiting for a trace slot, oldest first */
+	TArray<FSightQuery> QueryQueue;
+
+	/** Pairs currently queued or in flight, so they're not queued twice */
+	TSet<TPair<FPerceptionListenerID, FObjectKey>> PendingPairs;
+
+	/** Traces in flight, by user data ID */
+	TMap<uint32, FSightQuery> InFlightQueries;
+
+	/** Next trace user data ID */
+	uint32 NextQueryID = 1;
+
+	/** Delegate called when an async trace completes */
+	FTraceDelegate TraceDelegate;
+
+protected:
+
+	/** Size of the spatial grid cells */
+	UPROPERTY(EditDefaultsOnly, config, Category="AI Perception", meta = (ClampMin = 100, Units = "cm"))
+	float GridCellSize = 1000.0f;
+
+	/** Max number of visibility traces to start each frame. Remaining pairs wait in the queue */
+	UPROPERTY(EditDefaultsOnly, config, Category="AI Perception", meta = (ClampMin = 1))
+	int32 MaxTracesPerFrame = 32;
+
+public:
+
+	/** Constructor */
+	UAISense_ShooterSight(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Runs the batched cone tests and starts the budgeted traces */
+	virtual float Update() override;
+
+	/** Adds a sight source */
+	virtual void RegisterSource(AActor& SourceActor) override;
+
+	/** Removes a sight source */
+	virtual void UnregisterSource(AActor& SourceActor) override;
+
+	/** Drops the visible state of a forgotten actor */
+	virtual void OnListenerForgetsActor(const FPerceptionListener& Listener, AActor& ActorToForget) override;
+
+	/** Drops the visible state of all actors for a listener */
+	virtual void OnListenerForgetsAll(const FPerceptionListener& Listener) override;
+
+protected:
+
+	/** Listener delegate handlers */
+	void OnNewListenerImpl(const FPerceptionListener& NewListener);
+	void OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener);
+	void OnListenerRemovedImpl(const FPerceptionListener& RemovedListener);
+
+	/** Snapshots the source locations and rebuilds the spatial grid */
+	void BuildGrid();
+
+	/** Collects the grid candidates around a listener that pass the affiliation filter */
+	void GatherCandidates(const FPerceptionListener& Listener, const FDigestedListener& Digest);
+
+	/** Runs the vectorized cone and range tests on the gathered candidates */
+	void TestCandidates(const FPerceptionListener& Listener, const FDigestedListener& Digest);
+
+	/** Starts queued traces up to the frame budget */
+	void IssueTraces();
+
+	/** Handles a completed visibility trace */
+	void OnTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	/** Sends a stimulus to a listener and updates its visible set */
+	void DeliverStimulus(FPerceptionListener& Listener, AActor& Target, bool bSensed);
+
+	/** Drops a target from a listener's visible set, sending a lose sight stimulus if the target still exists */
+	void LoseTarget(FPerceptionListener& Listener, const FObjectKey& TargetKey);
+
+	/** Returns the grid cell for a location */
+	FIntPoint GetCell(float X, float Y) const;
+};
+
+/**
+ *  Configuration for the batched shooter sight sense
+ */
+UCLASS(meta = (DisplayName = "AI Shooter Sight config"))
+class MERITOBRAINDAMAGE_API UAISenseConfig_ShooterSight : public UAISenseConfig
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Sense implementation */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category="Sense", NoClear, config)
+	TSubclassOf<UAISense_ShooterSight> Implementation;
+
+	/** Max distance to start seeing a target */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, Units = "cm"))
+	float SightRadius = 3000.0f;
+
+	/** Max distance to keep seeing a target already seen */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, Units = "cm"))
+	float LoseSightRadius = 3500.0f;
+
+	/** Peripheral vision half angle */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config, meta = (UIMin = 0.0, ClampMin = 0.0, UIMax = 180.0, ClampMax = 180.0, Units = "deg"))
+	float PeripheralVisionAngleDegrees = 90.0f;
+
+	/** Which teams this sense detects */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Sense", config)
+	FAISenseAffiliationFilter DetectionByAffiliation;
+
+public:
+
+	/** Constructor */
+	UAISenseConfig_ShooterSight(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Returns the sense implementation class */
+	virtual TSubclassOf<UAISense> GetSenseImplementation() const override;
+};
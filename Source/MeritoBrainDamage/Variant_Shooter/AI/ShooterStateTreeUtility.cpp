@@ -4,10 +4,18 @@
 #include "Variant_Shooter/AI/ShooterStateTreeUtility.h"
 #include "StateTreeExecutionContext.h"
 #include "ShooterNPC.h"
-#include "Camera/CameraComponent.h"
 #include "AIController.h"
 #include "Perception/AIPerceptionComponent.h"
 #include "ShooterAIController.h"
+#include "ShooterTeamKnowledge.h"
+#include "ShooterAIBatch.h"
+#include "ShooterSightSense.h"
+#include "ShooterCoverDatabase.h"
+#include "ShooterVisibility.h"
+#include "ShooterInfluence.h"
+#include "ShooterFlowField.h"
+#include "ShooterEQSBroker.h"
+#include "EnvironmentQuery/EnvQuery.h"
 #include "StateTreeAsyncExecutionContext.h"
 
 bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionContext& Context) const
@@ -32,15 +40,30 @@ bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionCo
 		return !InstanceData.bMustHaveLineOfSight;
 	}
 
+	// reuse a recent result from the batched AI update or an earlier check
+	bool bCachedClear = false;
+
+	if (InstanceData.Character->GetCachedLineOfSight(InstanceData.Target, bCachedClear))
+	{
+		return bCachedClear == InstanceData.bMustHaveLineOfSight;
+	}
+
 	// get the target's bounding box
 	FVector CenterOfMass, Extent;
 	InstanceData.Target->GetActorBounds(true, CenterOfMass, Extent, false);
 
+	// skip the traces if the character and target are in places that can never see each other
+	if (!UShooterVisibilitySubsystem::CanPossiblySee(InstanceData.Character->GetWorld(), InstanceData.Character->GetPawnViewLocation(), CenterOfMass))
+	{
+		InstanceData.Character->CacheLineOfSight(InstanceData.Target, false);
+		return !InstanceData.bMustHaveLineOfSight;
+	}
+
 	// divide the vertical extent by the number of line of sight checks we'll do
 	const float ExtentZOffset = Extent.Z * 2.0f / InstanceData.NumberOfVerticalLineOfSightChecks;
 
-	// get the character's camera location as the source for the line checks
-	const FVector Start = InstanceData.Character->GetFirstPersonCameraComponent()->GetComponentLocation();
+	// get the character's eye location as the source for the line checks
+	const FVector Start = InstanceData.Character->GetPawnViewLocation();
 
 	// ignore the character and target. We want to ensure there's an unobstructed trace not counting them
 	FCollisionQueryParams QueryParams;
@@ -49,22 +72,31 @@ bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionCo
 
 	FHitResult OutHit;
 
+	// only the simplified blockers when the map has them
+	const ECollisionChannel TraceChannel = UShooterVisibilitySubsystem::GetTraceChannel(InstanceData.Character->GetWorld());
+
 	// run a number of vertically offset line traces to the target location
 	for (int32 i = 0; i < InstanceData.NumberOfVerticalLineOfSightChecks - 1; ++i)
 	{
 		// calculate the endpoint for the trace
 		const FVector End = CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i);
 
-		InstanceData.Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
+		InstanceData.Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, QueryParams);
 
 		// is the trace unobstructed?
 		if (!OutHit.bBlockingHit)
 		{
+			// share the result with the aim solver
+			InstanceData.Character->CacheLineOfSight(InstanceData.Target, true);
+
 			// we only need one unobstructed trace, so terminate early
 			return InstanceData.bMustHaveLineOfSight;
 		}
 	}
 
+	// share the result with the aim solver
+	InstanceData.Character->CacheLineOfSight(InstanceData.Target, false);
+
 	// no line of sight found
 	return !InstanceData.bMustHaveLineOfSight;
 }
@@ -78,6 +110,38 @@ FText FStateTreeLineOfSightToTargetCondition::GetDescription(const FGuid& ID, FS
 
 ////////////////////////////////////////////////////////////////////
 
+bool FStateTreeDangerCondition::TestCondition(FStateTreeExecutionContext& Context) const
+{
+	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (!IsValid(InstanceData.Character))
+	{
+		return !InstanceData.bMustBeDangerous;
+	}
+
+	const UShooterInfluenceSubsystem* Influence = InstanceData.Character->GetWorld()->GetSubsystem<UShooterInfluenceSubsystem>();
+
+	// no influence map means nowhere is known to be dangerous
+	if (!Influence)
+	{
+		return !InstanceData.bMustBeDangerous;
+	}
+
+	const FVector Location = InstanceData.bUseCharacterLocation ? InstanceData.Character->GetActorLocation() : InstanceData.Location;
+	const bool bDangerous = Influence->GetDanger(InstanceData.Character->GetTeamByte(), Location) >= InstanceData.DangerThreshold;
+
+	return bDangerous == InstanceData.bMustBeDangerous;
+}
+
+#if WITH_EDITOR
+FText FStateTreeDangerCondition::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Is Location Dangerous</b>");
+}
+#endif
+
+////////////////////////////////////////////////////////////////////
+
 EStateTreeRunStatus FStateTreeFaceActorTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
 {
 	// have we transitioned from another state?
@@ -87,7 +151,7 @@ EStateTreeRunStatus FStateTreeFaceActorTask::EnterState(FStateTreeExecutionConte
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// set the AI Controller's focus
-		InstanceData.Controller->SetFocus(InstanceData.ActorToFaceTowards);
+		UShooterAIBatchSubsystem::SetFocus(InstanceData.Controller, InstanceData.ActorToFaceTowards);
 	}
 
 	return EStateTreeRunStatus::Running;
@@ -102,7 +166,7 @@ void FStateTreeFaceActorTask::ExitState(FStateTreeExecutionContext& Context, con
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// clear the AI Controller's focus
-		InstanceData.Controller->ClearFocus(EAIFocusPriority::Gameplay);
+		UShooterAIBatchSubsystem::ClearFocus(InstanceData.Controller);
 	}
 }
 
@@ -124,7 +188,7 @@ EStateTreeRunStatus FStateTreeFaceLocationTask::EnterState(FStateTreeExecutionCo
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// set the AI Controller's focus
-		InstanceData.Controller->SetFocalPoint(InstanceData.FaceLocation);
+		UShooterAIBatchSubsystem::SetFocalPoint(InstanceData.Controller, InstanceData.FaceLocation);
 	}
 
 	return EStateTreeRunStatus::Running;
@@ -139,7 +203,7 @@ void FStateTreeFaceLocationTask::ExitState(FStateTreeExecutionContext& Context,
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// clear the AI Controller's focus
-		InstanceData.Controller->ClearFocus(EAIFocusPriority::Gameplay);
+		UShooterAIBatchSubsystem::ClearFocus(InstanceData.Controller);
 	}
 }
 
@@ -185,7 +249,7 @@ EStateTreeRunStatus FStateTreeShootAtTargetTask::EnterState(FStateTreeExecutionC
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// tell the character to shoot the target
-		InstanceData.Character->StartShooting(InstanceData.Target);
+		UShooterAIBatchSubsystem::StartShooting(InstanceData.Character, InstanceData.Target);
 	}
 
 	return EStateTreeRunStatus::Running;
@@ -200,7 +264,7 @@ void FStateTreeShootAtTargetTask::ExitState(FStateTreeExecutionContext& Context,
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
 		// tell the character to stop shooting
-		InstanceData.Character->StopShooting();
+		UShooterAIBatchSubsystem::StopShooting(InstanceData.Character);
 	}
 }
 
@@ -228,7 +292,8 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 
 				if (FInstanceDataType* LambdaInstanceData = StrongContext.GetInstanceDataPtr<FInstanceDataType>())
 				{
-					if (SensedActor->ActorHasTag(LambdaInstanceData->SenseTag))
+					// only react to actors on a hostile team
+					if (LambdaInstanceData->Controller->GetTeamAttitudeTowards(*SensedActor) == ETeamAttitude::Hostile)
 					{
 						bool bDirectLOS = false;
 
@@ -239,9 +304,17 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 						const float DirDot = FVector::DotProduct(StimulusDir, LambdaInstanceData->Character->GetActorForwardVector());
 						const float MaxDot = FMath::Cos(FMath::DegreesToRadians(LambdaInstanceData->DirectLineOfSightCone));
 
-						// is the direction within our perception cone?
-						if (DirDot >= MaxDot)
+						// the shooter sight sense already ran the cone test and a visibility trace, so trust a successful stimulus
+						if (Stimulus.Type == UAISense::GetSenseID<UAISense_ShooterSight>() && Stimulus.WasSuccessfullySensed())
 						{
+							bDirectLOS = true;
+
+							// share the result with the aim solver
+							LambdaInstanceData->Character->CacheLineOfSight(SensedActor, true);
+
+						// is the direction within our perception cone, and could the stimulus be seen from here at all?
+						} else if (DirDot >= MaxDot && UShooterVisibilitySubsystem::CanPossiblySee(LambdaInstanceData->Character->GetWorld(), LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation())) {
+
 							// run a line trace between the character and the sensed actor
 							FCollisionQueryParams QueryParams;
 							QueryParams.AddIgnoredActor(LambdaInstanceData->Character);
@@ -250,7 +323,10 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 							FHitResult OutHit;
 
 							// we have direct line of sight if this trace is unobstructed
-							bDirectLOS = !LambdaInstanceData->Character->GetWorld()->LineTraceSingleByChannel(OutHit, LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation(), ECC_Visibility, QueryParams);
+							bDirectLOS = !LambdaInstanceData->Character->GetWorld()->LineTraceSingleByChannel(OutHit, LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation(), UShooterVisibilitySubsystem::GetTraceChannel(LambdaInstanceData->Character->GetWorld()), QueryParams);
+
+							// share the result with the aim solver
+							LambdaInstanceData->Character->CacheLineOfSight(SensedActor, bDirectLOS);
 
 						}
 
@@ -334,7 +410,7 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 
 					// clear the target on the controller
 					LambdaInstanceData->Controller->ClearCurrentTarget();
-					LambdaInstanceData->Controller->ClearFocus(EAIFocusPriority::Gameplay);
+					UShooterAIBatchSubsystem::ClearFocus(LambdaInstanceData->Controller);
 				}
 
 			}
@@ -363,4 +439,329 @@ FText FStateTreeSenseEnemiesTask::GetDescription(const FGuid& ID, FStateTreeData
 {
 	return FText::FromString("<b>Sense Enemies</b>");
 }
-#endif // WITH_EDITOR
\ No newline at end of file
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+void FStateTreeTeamKnowledgeEvaluator::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (!IsValid(InstanceData.Character))
+	{
+		return;
+	}
+
+	const UShooterTeamKnowledgeSubsystem* TeamKnowledge = InstanceData.Character->GetWorld()->GetSubsystem<UShooterTeamKnowledgeSubsystem>();
+
+	if (!TeamKnowledge)
+	{
+		return;
+	}
+
+	const uint8 Team = InstanceData.Character->GetTeamByte();
+
+	// pick the closest enemy any team member can see
+	AActor* NewTarget = TeamKnowledge->FindBestTarget(Team, InstanceData.Character->GetActorLocation());
+
+	// sync the controller if the target changed
+	if (InstanceData.bUpdateControllerTarget && IsValid(InstanceData.Controller) && NewTarget != InstanceData.TargetActor)
+	{
+		if (NewTarget)
+		{
+			InstanceData.Controller->SetCurrentTarget(NewTarget);
+
+		} else {
+
+			InstanceData.Controller->ClearCurrentTarget();
+			UShooterAIBatchSubsystem::ClearFocus(InstanceData.Controller);
+		}
+	}
+
+	InstanceData.TargetActor = NewTarget;
+	InstanceData.bHasTarget = NewTarget != nullptr;
+
+	// only investigate while there's no target to engage
+	const FShooterTeamKnowledge* Knowledge = TeamKnowledge->GetTeamKnowledge(Team);
+
+	InstanceData.bHasInvestigateLocation = !InstanceData.bHasTarget && Knowledge && Knowledge->bHasInvestigateLocation;
+	InstanceData.InvestigateLocation = InstanceData.bHasInvestigateLocation ? Knowledge->InvestigateLocation : FVector::ZeroVector;
+}
+
+void FStateTreeTeamKnowledgeEvaluator::TreeStop(FStateTreeExecutionContext& Context) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (InstanceData.bUpdateControllerTarget && IsValid(InstanceData.Controller))
+	{
+		InstanceData.Controller->ClearCurrentTarget();
+	}
+
+	InstanceData.TargetActor = nullptr;
+	InstanceData.bHasTarget = false;
+	InstanceData.bHasInvestigateLocation = false;
+}
+
+#if WITH_EDITOR
+FText FStateTreeTeamKnowledgeEvaluator::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Team Knowledge</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeFindCoverTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	InstanceData.bFoundCover = false;
+
+	if (!IsValid(InstanceData.Character) || !IsValid(InstanceData.Target))
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	UShooterCoverSubsystem* Cover = InstanceData.Character->GetWorld()->GetSubsystem<UShooterCoverSubsystem>();
+
+	if (!Cover || !Cover->GetDatabase())
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	FShooterCoverQuery Query;
+	Query.Origin = InstanceData.Character->GetActorLocation();
+	Query.SearchRadius = InstanceData.SearchRadius;
+	Query.ThreatLocation = InstanceData.Target->GetActorLocation();
+	Query.MinThreatDistance = InstanceData.MinTargetDistance;
+	Query.MaxThreatDistance = InstanceData.MaxTargetDistance;
+	Query.MinProtectionDot = InstanceData.MinProtectionDot;
+	Query.bRequireFullHeight = InstanceData.bRequireFullHeight;
+
+	const int32 PointIndex = Cover->FindCover(Query, InstanceData.Character);
+
+	if (PointIndex == INDEX_NONE)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// hold the point so other NPCs pick a different one
+	Cover->ClaimCover(InstanceData.Character, PointIndex);
+
+	const FShooterCoverPoint& Point = Cover->GetDatabase()->GetPoint(PointIndex);
+
+	InstanceData.CoverLocation = FVector(Point.Location);
+	InstanceData.CoverFacing = UShooterCoverDatabase::GetProtectedDirection(Point).Rotation();
+	InstanceData.bFoundCover = true;
+
+	return EStateTreeRunStatus::Running;
+}
+
+void FStateTreeFindCoverTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (!InstanceData.bFoundCover || !IsValid(InstanceData.Character))
+	{
+		return;
+	}
+
+	// release the claim when leaving the state
+	if (UShooterCoverSubsystem* Cover = InstanceData.Character->GetWorld()->GetSubsystem<UShooterCoverSubsystem>())
+	{
+		Cover->ReleaseCover(InstanceData.Character);
+	}
+
+	InstanceData.bFoundCover = false;
+}
+
+#if WITH_EDITOR
+FText FStateTreeFindCoverTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Find Cover</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeFlowFieldChaseTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	InstanceData.bUsingPath = false;
+
+	return UpdateChase(InstanceData);
+}
+
+EStateTreeRunStatus FStateTreeFlowFieldChaseTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	return UpdateChase(InstanceData);
+}
+
+EStateTreeRunStatus FStateTreeFlowFieldChaseTask::UpdateChase(FInstanceDataType& InstanceData) const
+{
+	if (!IsValid(InstanceData.Character) || !IsValid(InstanceData.Target))
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	const FVector Location = InstanceData.Character->GetActorLocation();
+
+	if (FVector::DistSquared2D(Location, InstanceData.Target->GetActorLocation()) <= FMath::Square(InstanceData.AcceptanceRadius))
+	{
+		return EStateTreeRunStatus::Succeeded;
+	}
+
+	UShooterFlowFieldSubsystem* FlowFields = InstanceData.Character->GetWorld()->GetSubsystem<UShooterFlowFieldSubsystem>();
+
+	if (FlowFields)
+	{
+		// keep the shared field alive while anyone is chasing
+		FlowFields->RequestFlowField(InstanceData.Target);
+
+		FVector Direction;
+
+		if (FlowFields->GetFlowDirection(InstanceData.Target, Location, Direction))
+		{
+			// leave the regular path once we're back on the field
+			if (InstanceData.bUsingPath && IsValid(InstanceData.Controller))
+			{
+				UShooterAIBatchSubsystem::StopMovement(InstanceData.Controller);
+			}
+
+			InstanceData.bUsingPath = false;
+			InstanceData.Character->AddMovementInput(Direction);
+
+			return EStateTreeRunStatus::Running;
+		}
+	}
+
+	// the field isn't built yet or doesn't reach us, so path to the target. Path again if it moved away from the goal
+	const FVector TargetLocation = InstanceData.Target->GetActorLocation();
+
+	const bool bGoalMoved = FVector::DistSquared2D(InstanceData.PathGoal, TargetLocation) > FMath::Square(InstanceData.AcceptanceRadius);
+
+	if ((!InstanceData.bUsingPath || bGoalMoved) && IsValid(InstanceData.Controller))
+	{
+		UShooterAIBatchSubsystem::MoveToLocation(InstanceData.Controller, TargetLocation, InstanceData.AcceptanceRadius);
+		InstanceData.bUsingPath = true;
+		InstanceData.PathGoal = TargetLocation;
+	}
+
+	return EStateTreeRunStatus::Running;
+}
+
+void FStateTreeFlowFieldChaseTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (InstanceData.bUsingPath && IsValid(InstanceData.Controller))
+	{
+		UShooterAIBatchSubsystem::StopMovement(InstanceData.Controller);
+	}
+
+	InstanceData.bUsingPath = false;
+}
+
+#if WITH_EDITOR
+FText FStateTreeFlowFieldChaseTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Chase (Flow Field)</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeSharedEQSQueryTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	InstanceData.RequestId = INDEX_NONE;
+	InstanceData.bFinished = false;
+	InstanceData.bSucceeded = false;
+
+	if (!IsValid(InstanceData.Controller) || !InstanceData.QueryTemplate)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	UShooterEQSBroker* Broker = InstanceData.Controller->GetWorld()->GetSubsystem<UShooterEQSBroker>();
+
+	if (!Broker)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// the broker never calls back from inside RunQuery, so the result always arrives on a later frame
+	InstanceData.RequestId = Broker->RunQuery(InstanceData.QueryTemplate, InstanceData.Controller, InstanceData.RunMode,
+		FShooterEQSResultDelegate::CreateLambda([WeakContext = Context.MakeWeakExecutionContext()](TSharedPtr<FEnvQueryResult> Result, int32 ItemIndex)
+		{
+			// get the instance data inside the lambda
+			FInstanceDataType* LambdaInstanceData = WeakContext.MakeStrongExecutionContext().GetInstanceDataPtr<FInstanceDataType>();
+
+			if (!LambdaInstanceData)
+			{
+				return;
+			}
+
+			LambdaInstanceData->RequestId = INDEX_NONE;
+			LambdaInstanceData->bFinished = true;
+
+			// each squad member gets its own item of the shared result
+			if (Result.IsValid() && Result->IsSuccessful() && Result->Items.IsValidIndex(ItemIndex))
+			{
+				LambdaInstanceData->ResultLocation = Result->GetItemAsLocation(ItemIndex);
+				LambdaInstanceData->ResultActor = Result->GetItemAsActor(ItemIndex);
+				LambdaInstanceData->bSucceeded = true;
+			}
+		}));
+
+	return InstanceData.RequestId != INDEX_NONE ? EStateTreeRunStatus::Running : EStateTreeRunStatus::Failed;
+}
+
+EStateTreeRunStatus FStateTreeSharedEQSQueryTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (!InstanceData.bFinished)
+	{
+		return EStateTreeRunStatus::Running;
+	}
+
+	return InstanceData.bSucceeded ? EStateTreeRunStatus::Succeeded : EStateTreeRunStatus::Failed;
+}
+
+void FStateTreeSharedEQSQueryTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// stop waiting, the shared query keeps running for the rest of the squad
+	if (InstanceData.RequestId != INDEX_NONE && IsValid(InstanceData.Controller))
+	{
+		if (UShooterEQSBroker* Broker = InstanceData.Controller->GetWorld()->GetSubsystem<UShooterEQSBroker>())
+		{
+			Broker->AbortRequest(InstanceData.RequestId);
+		}
+	}
+
+	InstanceData.RequestId = INDEX_NONE;
+}
+
+#if WITH_EDITOR
+FText FStateTreeSharedEQSQueryTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Run Shared EQS Query</b>");
+}
+#endif // WITH_EDITOR
@@ -5,12 +5,15 @@
 #include "CoreMinimal.h"
 #include "StateTreeTaskBase.h"
 #include "StateTreeConditionBase.h"
+#include "StateTreeEvaluatorBase.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
 
 #include "ShooterStateTreeUtility.generated.h"
 
 class AShooterNPC;
 class AAIController;
 class AShooterAIController;
+class UEnvQuery;
 
 /**
  *  Instance data struct for the FStateTreeLineOfSightToTargetCondition condition
@@ -69,6 +72,63 @@ struct FStateTreeLineOfSightToTargetCondition : public FStateTreeConditionCommon
 
 ////////////////////////////////////////////////////////////////////
 
+/**
+ *  Instance data struct for the FStateTreeDangerCondition condition
+ */
+USTRUCT()
+struct FStateTreeDangerConditionInstanceData
+{
+	GENERATED_BODY()
+
+	/** Character whose team the danger is evaluated for */
+	UPROPERTY(EditAnywhere, Category = "Context")
+	AShooterNPC* Character;
+
+	/** Location to sample */
+	UPROPERTY(EditAnywhere, Category = "Condition")
+	FVector Location = FVector::ZeroVector;
+
+	/** If true, the character's location is sampled instead of the location input */
+	UPROPERTY(EditAnywhere, Category = "Condition")
+	bool bUseCharacterLocation = true;
+
+	/** Danger at or above this value counts as dangerous */
+	UPROPERTY(EditAnywhere, Category = "Condition", meta = (ClampMin = 0))
+	float DangerThreshold = 0.5f;
+
+	/** If true, the condition passes if the location is dangerous */
+	UPROPERTY(EditAnywhere, Category = "Condition")
+	bool bMustBeDangerous = true;
+};
+STATETREE_POD_INSTANCEDATA(FStateTreeDangerConditionInstanceData);
+
+/**
+ *  StateTree condition to check the influence map danger for the character's team at a location
+ */
+USTRUCT(DisplayName = "Is Location Dangerous", Category="Shooter")
+struct FStateTreeDangerCondition : public FStateTreeConditionCommonBase
+{
+	GENERATED_BODY()
+
+	/** Set the instance data type */
+	using FInstanceDataType = FStateTreeDangerConditionInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Default constructor */
+	FStateTreeDangerCondition() = default;
+
+	/** Tests the StateTree condition */
+	virtual bool TestCondition(FStateTreeExecutionContext& Context) const override;
+
+#if WITH_EDITOR
+	/** Provides the description string */
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif
+
+};
+
+////////////////////////////////////////////////////////////////////
+
 /**
  *  Instance data struct for the Face Towards Actor StateTree task
  */
@@ -270,10 +330,6 @@ struct FStateTreeSenseEnemiesInstanceData
 	UPROPERTY(EditAnywhere, Category = Output)
 	bool bHasInvestigateLocation = false;
 
-	/** Tag required on sensed actors */
-	UPROPERTY(EditAnywhere, Category = Parameter)
-	FName SenseTag = FName("Player");
-
 	/** Line of sight cone half angle to consider a full sense */
 	UPROPERTY(EditAnywhere, Category = Parameter)
 	float DirectLineOfSightCone = 85.0f;
@@ -306,4 +362,273 @@ struct FStateTreeSenseEnemiesTask : public FStateTreeTaskCommonBase
 #endif // WITH_EDITOR
 };
 
-////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Team Knowledge StateTree evaluator
+ */
+USTRUCT()
+struct FStateTreeTeamKnowledgeInstanceData
+{
+	GENERATED_BODY()
+
+	/** AI Controller for the NPC */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterAIController> Controller;
+
+	/** NPC reading the team knowledge */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterNPC> Character;
+
+	/** Closest enemy currently visible to the team */
+	UPROPERTY(EditAnywhere, Category = Output)
+	TObjectPtr<AActor> TargetActor;
+
+	/** Location the team should investigate */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector InvestigateLocation = FVector::ZeroVector;
+
+	/** True if the team has a visible target */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bHasTarget = false;
+
+	/** True if the team has a location to investigate and no target */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bHasInvestigateLocation = false;
+
+	/** If true, the controller's target and focus are kept in sync with the team target */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	bool bUpdateControllerTarget = true;
+};
+
+/**
+ *  StateTree evaluator that reads the target and investigate location from the shared team knowledge
+ *  Replaces per-NPC sensing so perception is only processed once per team
+ */
+USTRUCT(meta=(DisplayName="Team Knowledge", Category="Shooter"))
+struct FStateTreeTeamKnowledgeEvaluator : public FStateTreeEvaluatorCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeTeamKnowledgeInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Reads the team knowledge */
+	virtual void Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+	/** Clears the controller target when the tree stops */
+	virtual void TreeStop(FStateTreeExecutionContext& Context) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Find Cover StateTree task
+ */
+USTRUCT()
+struct FStateTreeFindCoverInstanceData
+{
+	GENERATED_BODY()
+
+	/** NPC looking for cover */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterNPC> Character;
+
+	/** Actor to take cover from */
+	UPROPERTY(EditAnywhere, Category = Input)
+	TObjectPtr<AActor> Target;
+
+	/** Max distance from the NPC to the cover */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float SearchRadius = 1500.0f;
+
+	/** Min distance from the cover to the target */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float MinTargetDistance = 300.0f;
+
+	/** Max distance from the cover to the target */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float MaxTargetDistance = 2500.0f;
+
+	/** Min dot product between the cover's protected direction and the direction to the target */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = -1, ClampMax = 1))
+	float MinProtectionDot = 0.5f;
+
+	/** If true, only full height cover is accepted */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	bool bRequireFullHeight = false;
+
+	/** Location of the cover found */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector CoverLocation = FVector::ZeroVector;
+
+	/** Rotation facing the cover's protected direction */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FRotator CoverFacing = FRotator::ZeroRotator;
+
+	/** True if cover was found */
+	UPROPERTY(EditAnywhere, Category = Output)
+	bool bFoundCover = false;
+};
+
+/**
+ *  StateTree task to find and claim a cover point from the baked cover database
+ *  Fails if the map has no cover database or no cover matches
+ */
+USTRUCT(meta=(DisplayName="Find Cover", Category="Shooter"))
+struct FStateTreeFindCoverTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeFindCoverInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs when the owning state is ended */
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Chase (Flow Field) StateTree task
+ */
+USTRUCT()
+struct FStateTreeFlowFieldChaseInstanceData
+{
+	GENERATED_BODY()
+
+	/** NPC doing the chasing */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterNPC> Character;
+
+	/** Controller of the NPC, used for the pathfinding fallback */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AAIController> Controller;
+
+	/** Actor to chase */
+	UPROPERTY(EditAnywhere, Category = Input)
+	TObjectPtr<AActor> Target;
+
+	/** Distance to the target at which the chase succeeds */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float AcceptanceRadius = 300.0f;
+
+	/** True while the NPC is moving along a regular path because the field can't guide it */
+	bool bUsingPath = false;
+
+	/** Target location the regular path was requested to */
+	FVector PathGoal = FVector::ZeroVector;
+};
+
+/**
+ *  StateTree task to chase a target by following its shared flow field
+ *  Any number of NPCs chasing the same target share one field instead of requesting a path each
+ *  Falls back to a regular move if the NPC is outside the field
+ */
+USTRUCT(meta=(DisplayName="Chase (Flow Field)", Category="Shooter"))
+struct FStateTreeFlowFieldChaseTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeFlowFieldChaseInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+	/** Runs when the owning state is ended */
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Steers the NPC along the field */
+	EStateTreeRunStatus UpdateChase(FInstanceDataType& InstanceData) const;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Run Shared EQS Query StateTree task
+ */
+USTRUCT()
+struct FStateTreeSharedEQSQueryInstanceData
+{
+	GENERATED_BODY()
+
+	/** Controller running the query */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterAIController> Controller;
+
+	/** Query to run */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	TObjectPtr<UEnvQuery> QueryTemplate;
+
+	/** How the query picks its result */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	TEnumAsByte<EEnvQueryRunMode::Type> RunMode = EEnvQueryRunMode::SingleResult;
+
+	/** Location of the item handed to this NPC. The first requester gets the best one, the rest of the squad the next best */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector ResultLocation = FVector::ZeroVector;
+
+	/** Item handed to this NPC, if the query returns actors */
+	UPROPERTY(EditAnywhere, Category = Output)
+	TObjectPtr<AActor> ResultActor;
+
+	/** Broker request being waited on */
+	int32 RequestId = INDEX_NONE;
+
+	/** Set once the broker handed out a result */
+	bool bFinished = false;
+
+	/** Set if the result had any items */
+	bool bSucceeded = false;
+};
+
+/**
+ *  StateTree task to run an environment query through the shooter EQS broker
+ *  Squad members querying around the same target and location share a single query, and each takes a different item of its result
+ */
+USTRUCT(meta=(DisplayName="Run Shared EQS Query", Category="Shooter"))
+struct FStateTreeSharedEQSQueryTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeSharedEQSQueryInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+	/** Runs when the owning state is ended */
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
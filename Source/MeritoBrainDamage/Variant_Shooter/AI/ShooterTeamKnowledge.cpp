@@ -0,0 +1,180 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterTeamKnowledge.h"
+#include "ShooterNPC.h"
+#include "GameFramework/Controller.h"
+#include "Engine/World.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Team Knowledge Update"), STAT_ShooterTeamKnowledge, STATGROUP_Shooter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Team Known Enemies"), STAT_ShooterTeamKnownEnemies, STATGROUP_Shooter);
+
+bool UShooterTeamKnowledgeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterTeamKnowledgeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterTeamKnowledgeSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterTeamKnowledgeSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTeamKnowledge);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	int32 NumKnownEnemies = 0;
+
+	for (TPair<uint8, FShooterTeamKnowledge>& Team : Teams)
+	{
+		FShooterTeamKnowledge& Knowledge = Team.Value;
+
+		// forget destroyed enemies and those nobody has sensed in a while
+		Knowledge.Enemies.RemoveAllSwap([this, Now](const FShooterKnownEnemy& Enemy)
+		{
+			return !Enemy.Actor.IsValid() || Now - Enemy.LastSensedTime > ForgetTime;
+		});
+
+		// the sight senses only report changes, so an enemy stays visible while a member still watches it
+		for (FShooterKnownEnemy& Enemy : Knowledge.Enemies)
+		{
+			Enemy.Watchers.RemoveAllSwap(&UShooterTeamKnowledgeSubsystem::IsWatcherGone);
+			Enemy.bVisible = Enemy.Watchers.Num() > 0;
+
+			if (Enemy.bVisible)
+			{
+				Enemy.LastKnownLocation = Enemy.Actor->GetActorLocation();
+				Enemy.LastSeenTime = Now;
+				Enemy.LastSensedTime = Now;
+			}
+		}
+
+		// expire the investigate location
+		if (Knowledge.bHasInvestigateLocation && Now - Knowledge.InvestigateTime > InvestigateTime)
+		{
+			Knowledge.bHasInvestigateLocation = false;
+			Knowledge.InvestigateStrength = 0.0f;
+		}
+
+		NumKnownEnemies += Knowledge.Enemies.Num();
+	}
+
+	SET_DWORD_STAT(STAT_ShooterTeamKnownEnemies, NumKnownEnemies);
+}
+
+void UShooterTeamKnowledgeSubsystem::ReportEnemySensed(uint8 Team, const AController* Member, AActor* Enemy, const FVector& Location, float Strength, bool bDirectLineOfSight)
+{
+	if (!IsValid(Enemy))
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	FShooterTeamKnowledge& Knowledge = Teams.FindOrAdd(Team);
+
+	FShooterKnownEnemy* KnownEnemy = FindEnemy(Knowledge, Enemy);
+
+	if (!KnownEnemy)
+	{
+		KnownEnemy = &Knowledge.Enemies.AddDefaulted_GetRef();
+		KnownEnemy->Actor = Enemy;
+	}
+
+	KnownEnemy->LastKnownLocation = Location;
+	KnownEnemy->LastSensedTime = Now;
+
+	if (bDirectLineOfSight)
+	{
+		KnownEnemy->LastSeenTime = Now;
+		KnownEnemy->bVisible = true;
+		KnownEnemy->Watchers.AddUnique(Member);
+
+	} else if (Strength >= Knowledge.InvestigateStrength || !Knowledge.bHasInvestigateLocation) {
+
+		// partial sense. Keep the strongest one for the team to investigate
+		Knowledge.InvestigateLocation = Location;
+		Knowledge.InvestigateStrength = Strength;
+		Knowledge.InvestigateTime = Now;
+		Knowledge.bHasInvestigateLocation = true;
+	}
+}
+
+void UShooterTeamKnowledgeSubsystem::ReportEnemyLost(uint8 Team, const AController* Member, AActor* Enemy)
+{
+	if (FShooterTeamKnowledge* Knowledge = Teams.Find(Team))
+	{
+		if (FShooterKnownEnemy* KnownEnemy = FindEnemy(*Knowledge, Enemy))
+		{
+			// this member lost sight, but it's still visible if someone else sees it
+			KnownEnemy->Watchers.RemoveSwap(Member);
+			KnownEnemy->bVisible = KnownEnemy->Watchers.Num() > 0;
+		}
+	}
+}
+
+void UShooterTeamKnowledgeSubsystem::ReportEnemyForgotten(uint8 Team, const AController* Member, AActor* Enemy)
+{
+	ReportEnemyLost(Team, Member, Enemy);
+}
+
+bool UShooterTeamKnowledgeSubsystem::IsEnemyVisibleToTeam(uint8 Team, const AActor* Enemy) const
+{
+	if (const FShooterTeamKnowledge* Knowledge = Teams.Find(Team))
+	{
+		for (const FShooterKnownEnemy& KnownEnemy : Knowledge->Enemies)
+		{
+			if (KnownEnemy.Actor.Get() == Enemy)
+			{
+				return KnownEnemy.bVisible;
+			}
+		}
+	}
+
+	return false;
+}
+
+AActor* UShooterTeamKnowledgeSubsystem::FindBestTarget(uint8 Team, const FVector& FromLocation) const
+{
+	const FShooterTeamKnowledge* Knowledge = Teams.Find(Team);
+
+	if (!Knowledge)
+	{
+		return nullptr;
+	}
+
+	AActor* BestTarget = nullptr;
+	double BestDistSq = TNumericLimits<double>::Max();
+
+	for (const FShooterKnownEnemy& KnownEnemy : Knowledge->Enemies)
+	{
+		if (KnownEnemy.bVisible && KnownEnemy.Actor.IsValid())
+		{
+			const double DistSq = FVector::DistSquared(FromLocation, KnownEnemy.LastKnownLocation);
+
+			if (DistSq < BestDistSq)
+			{
+				BestDistSq = DistSq;
+				BestTarget = KnownEnemy.Actor.Get();
+			}
+		}
+	}
+
+	return BestTarget;
+}
+
+bool UShooterTeamKnowledgeSubsystem::IsWatcherGone(const TWeakObjectPtr<const AController>& Watcher)
+{
+	const AController* Controller = Watcher.Get();
+	const AShooterNPC* NPC = Controller ? Cast<AShooterNPC>(Controller->GetPawn()) : nullptr;
+
+	// dead and dormant members don't see anything
+	return !Controller || !Controller->GetPawn() || (NPC && (NPC->IsDead() || NPC->IsDormant()));
+}
+
+FShooterKnownEnemy* UShooterTeamKnowledgeSubsystem::FindEnemy(FShooterTeamKnowledge& Knowledge, const AActor* Enemy)
+{
+	return Knowledge.Enemies.FindByPredicate([Enemy](const FShooterKnownEnemy& KnownEnemy) { return KnownEnemy.Actor.Get() == Enemy; });
+}
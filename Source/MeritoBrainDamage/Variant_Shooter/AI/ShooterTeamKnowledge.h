@@ -0,0 +1,112 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterTeamKnowledge.generated.h"
+
+class AController;
+
+/**
+ *  An enemy known to a team, merged from the perception of all its members
+ */
+struct FShooterKnownEnemy
+{
+	/** The enemy actor */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Last location the enemy was sensed at */
+	FVector LastKnownLocation = FVector::ZeroVector;
+
+	/** Team members currently seeing the enemy with direct line of sight */
+	TArray<TWeakObjectPtr<const AController>, TInlineAllocator<4>> Watchers;
+
+	/** Game time the enemy was last seen with direct line of sight by any team member */
+	float LastSeenTime = -1.0f;
+
+	/** Game time the enemy was last sensed in any way */
+	float LastSensedTime = -1.0f;
+
+	/** True while any team member sees the enemy with direct line of sight */
+	bool bVisible = false;
+};
+
+/**
+ *  Shared threat table for one team
+ */
+struct FShooterTeamKnowledge
+{
+	/** Enemies currently known to the team */
+	TArray<FShooterKnownEnemy> Enemies;
+
+	/** Strongest recent partial sense the team should investigate */
+	FVector InvestigateLocation = FVector::ZeroVector;
+
+	/** Strength of the stimulus that set the investigate location */
+	float InvestigateStrength = 0.0f;
+
+	/** Game time the investigate location was set */
+	float InvestigateTime = -1.0f;
+
+	/** True if the investigate location is valid */
+	bool bHasInvestigateLocation = false;
+};
+
+/**
+ *  Merges the perception of every AI controller on a team into one shared threat table
+ *  Updated once per frame, so AI cost grows with the number of targets instead of NPCs x targets
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterTeamKnowledgeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Threat tables by team */
+	TMap<uint8, FShooterTeamKnowledge> Teams;
+
+protected:
+
+	/** Time after the last sense for an enemy to be forgotten */
+	float ForgetTime = 10.0f;
+
+	/** Time after which an investigate location expires */
+	float InvestigateTime = 15.0f;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Refreshes the visible enemies and expires stale knowledge for all teams */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Reports an enemy sensed by a team member. With direct line of sight, the member keeps seeing it until it reports losing it */
+	void ReportEnemySensed(uint8 Team, const AController* Member, AActor* Enemy, const FVector& Location, float Strength, bool bDirectLineOfSight);
+
+	/** Reports that a team member lost sight of an enemy. It stays visible to the team while other members see it */
+	void ReportEnemyLost(uint8 Team, const AController* Member, AActor* Enemy);
+
+	/** Reports that a team member has forgotten an enemy. The team keeps it until nobody has sensed it for a while */
+	void ReportEnemyForgotten(uint8 Team, const AController* Member, AActor* Enemy);
+
+	/** Returns true if any member of the team currently sees the enemy */
+	bool IsEnemyVisibleToTeam(uint8 Team, const AActor* Enemy) const;
+
+	/** Returns the team's threat table, or nullptr if the team knows nothing */
+	const FShooterTeamKnowledge* GetTeamKnowledge(uint8 Team) const { return Teams.Find(Team); }
+
+	/** Returns the closest visible enemy to the given location, or nullptr */
+	AActor* FindBestTarget(uint8 Team, const FVector& FromLocation) const;
+
+protected:
+
+	/** Returns true if the member can no longer be watching anything */
+	static bool IsWatcherGone(const TWeakObjectPtr<const AController>& Watcher);
+
+	/** Returns the known enemy entry for the actor, or nullptr */
+	static FShooterKnownEnemy* FindEnemy(FShooterTeamKnowledge& Knowledge, const AActor* Enemy);
+};
@@ -0,0 +1,423 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterVisibility.h"
+#include "ShooterBakeUtils.h"
+#include "ShooterVisibilityBlockers.h"
+#include "NavigationSystem.h"
+#include "Components/StaticMeshComponent.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/AssetManager.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/PackageName.h"
+#include "Misc/OutputDevice.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("PVS Checks"), STAT_ShooterPVSChecks, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("PVS Rejected Traces"), STAT_ShooterPVSRejected, STATGROUP_Shooter);
+
+namespace ShooterVisibility
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.AI.PVS"),
+		true,
+		TEXT("If true, AI line of sight checks between baked cells that can never see each other are rejected without tracing."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<bool> CVarBlockers(
+		TEXT("Shooter.AI.VisibilityChannel"),
+		true,
+		TEXT("If true, AI line of sight and aim traces use the AI visibility channel, which only hits the map's simplified blockers.\n")
+		TEXT("Maps without generated blockers always use the visibility channel."),
+		ECVF_Default);
+}
+
+void UShooterVisibilityData::Serialize(FArchive& Ar)
+{
+	// the payload may be reloaded, so release the mapped bits first
+	if (Ar.IsLoading() && Bits)
+	{
+		VisibilityBits.Unlock();
+		Bits = nullptr;
+	}
+
+	Super::Serialize(Ar);
+
+	CellIds.BulkSerialize(Ar);
+	VisibilityBits.Serialize(Ar, this);
+}
+
+void UShooterVisibilityData::PostLoad()
+{
+	Super::PostLoad();
+
+	// keep the payload locked for the lifetime of the asset so lookups are a plain memory read
+	if (!Bits && VisibilityBits.GetBulkDataSize() > 0)
+	{
+		Bits = static_cast<const uint64*>(VisibilityBits.LockReadOnly());
+	}
+}
+
+void UShooterVisibilityData::BeginDestroy()
+{
+	if (Bits)
+	{
+		VisibilityBits.Unlock();
+		Bits = nullptr;
+	}
+
+	Super::BeginDestroy();
+}
+
+void UShooterVisibilityData::Build(const FVector& InGridOrigin, float InCellSize, float InCellHeight, const FIntVector& InGridSize, TArray<int32>&& InCellIds, int32 InNumCells, const TArray<uint64>& InBits)
+{
+	if (Bits)
+	{
+		VisibilityBits.Unlock();
+		Bits = nullptr;
+	}
+
+	GridOrigin = InGridOrigin;
+	CellSize = InCellSize;
+	CellHeight = InCellHeight;
+	GridSize = InGridSize;
+	CellIds = MoveTemp(InCellIds);
+	NumCells = InNumCells;
+	WordsPerRow = FMath::DivideAndRoundUp(NumCells, 64);
+
+	check(InBits.Num() == NumCells * WordsPerRow);
+
+	// store the bits out of line so cooked builds can map them straight from the package file
+	VisibilityBits.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(VisibilityBits.Realloc(InBits.Num() * sizeof(uint64)), InBits.GetData(), InBits.Num() * sizeof(uint64));
+	VisibilityBits.Unlock();
+
+	VisibilityBits.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload | BULKDATA_MemoryMappedPayload);
+}
+
+int32 UShooterVisibilityData::GetGridIndex(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt32((Location.X - GridOrigin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt32((Location.Y - GridOrigin.Y) / CellSize);
+	const int32 Z = FMath::FloorToInt32((Location.Z - GridOrigin.Z) / CellHeight);
+
+	if (X < 0 || Y < 0 || Z < 0 || X >= GridSize.X || Y >= GridSize.Y || Z >= GridSize.Z)
+	{
+		return INDEX_NONE;
+	}
+
+	return X + (Y + Z * GridSize.Y) * GridSize.X;
+}
+
+int32 UShooterVisibilityData::GetCellId(const FVector& Location) const
+{
+	const int32 GridIndex = GetGridIndex(Location);
+
+	return CellIds.IsValidIndex(GridIndex) ? CellIds[GridIndex] : INDEX_NONE;
+}
+
+bool UShooterVisibilityData::AreCellsVisible(int32 CellA, int32 CellB) const
+{
+	// without data nothing can be rejected
+	if (!Bits || CellA < 0 || CellB < 0 || CellA >= NumCells || CellB >= NumCells)
+	{
+		return true;
+	}
+
+	return (Bits[CellA * WordsPerRow + (CellB >> 6)] >> (CellB & 63)) & 1;
+}
+
+bool UShooterVisibilityData::CanPossiblySee(const FVector& From, const FVector& To) const
+{
+	return AreCellsVisible(GetCellId(From), GetCellId(To));
+}
+
+////////////////////////////////////////////////////////////////////
+
+bool UShooterVisibilitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterVisibilitySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const FSoftObjectPath AssetPath = ShooterBake::GetBakeAssetPath(&InWorld, TEXT("Visibility"), TEXT("PVS"));
+
+	// maps without a bake always trace
+	if (FPackageName::DoesPackageExist(AssetPath.GetLongPackageName()))
+	{
+		UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetPath, FStreamableDelegate::CreateUObject(this, &UShooterVisibilitySubsystem::OnVisibilityDataLoaded, AssetPath));
+
+	} else {
+
+		UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("No visibility data for this map at %s"), *AssetPath.ToString());
+	}
+
+	const FSoftObjectPath BlockerPath = ShooterBake::GetBakeAssetPath(&InWorld, TEXT("Visibility"), TEXT("Blockers"));
+
+	// maps without blockers keep tracing the visibility channel
+	if (FPackageName::DoesPackageExist(BlockerPath.GetLongPackageName()))
+	{
+		UAssetManager::GetStreamableManager().RequestAsyncLoad(BlockerPath, FStreamableDelegate::CreateUObject(this, &UShooterVisibilitySubsystem::OnBlockerDataLoaded, BlockerPath));
+
+	} else {
+
+		UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("No visibility blockers for this map at %s"), *BlockerPath.ToString());
+	}
+}
+
+void UShooterVisibilitySubsystem::OnVisibilityDataLoaded(FSoftObjectPath AssetPath)
+{
+	VisibilityData = Cast<UShooterVisibilityData>(AssetPath.ResolveObject());
+
+	if (VisibilityData)
+	{
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("Loaded visibility data %s with %d cells"), *AssetPath.ToString(), VisibilityData->GetNumCells());
+	}
+}
+
+void UShooterVisibilitySubsystem::OnBlockerDataLoaded(FSoftObjectPath AssetPath)
+{
+	BlockerData = Cast<UShooterVisibilityBlockerData>(AssetPath.ResolveObject());
+
+	if (!BlockerData)
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	BlockerActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+
+	if (!BlockerActor)
+	{
+		BlockerData = nullptr;
+		return;
+	}
+
+	USceneComponent* Root = NewObject<USceneComponent>(BlockerActor);
+	Root->SetMobility(EComponentMobility::Static);
+	BlockerActor->SetRootComponent(Root);
+	Root->RegisterComponent();
+
+	// one body per cluster, so the scene's acceleration structure can skip the far away shapes. The shapes are already in world space
+	for (const FShooterVisibilityBlockerCluster& Cluster : BlockerData->GetClusters())
+	{
+		UShooterVisibilityBlockerComponent* Blockers = NewObject<UShooterVisibilityBlockerComponent>(BlockerActor);
+		Blockers->SetupAttachment(Root);
+		Blockers->RegisterComponent();
+		Blockers->SetGeometry(Cluster.Geometry);
+	}
+
+	const int32 NumFullDetail = SetupFullDetailBlockers();
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Loaded visibility blockers %s with %d boxes and %d convexes in %d clusters from %d meshes, %d meshes at full detail"),
+		*AssetPath.ToString(), BlockerData->GetNumBoxes(), BlockerData->GetNumConvexes(), BlockerData->GetClusters().Num(), BlockerData->GetNumSourceMeshes(), NumFullDetail);
+}
+
+int32 UShooterVisibilitySubsystem::SetupFullDetailBlockers() const
+{
+	int32 NumFullDetail = 0;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		// pawns and the actors they own, such as weapons and projectiles, keep their own responses
+		if (It->IsA<APawn>() || It->GetOwner())
+		{
+			continue;
+		}
+
+		// the proxies only cover static geometry, so movable actors such as doors block with their own collision
+		const bool bMovable = !It->IsRootComponentStatic();
+
+		TInlineComponentArray<UStaticMeshComponent*> MeshComponents(*It);
+
+		for (UStaticMeshComponent* MeshComponent : MeshComponents)
+		{
+			if (UShooterVisibilityBlockerData::BlocksVisibility(MeshComponent) && (bMovable || UShooterVisibilityBlockerData::NeedsFullDetail(MeshComponent)))
+			{
+				MeshComponent->SetCollisionResponseToChannel(ShooterVisibility::AIVisibilityChannel, ECR_Block);
+				++NumFullDetail;
+			}
+		}
+	}
+
+	return NumFullDetail;
+}
+
+bool UShooterVisibilitySubsystem::CanPossiblySee(const FVector& From, const FVector& To)
+{
+	if (!VisibilityData || !ShooterVisibility::CVarEnable.GetValueOnGameThread())
+	{
+		return true;
+	}
+
+	++NumChecks;
+	INC_DWORD_STAT(STAT_ShooterPVSChecks);
+
+	if (VisibilityData->CanPossiblySee(From, To))
+	{
+		return true;
+	}
+
+	++NumRejected;
+	INC_DWORD_STAT(STAT_ShooterPVSRejected);
+
+	return false;
+}
+
+bool UShooterVisibilitySubsystem::CanPossiblySee(const UWorld* World, const FVector& From, const FVector& To)
+{
+	UShooterVisibilitySubsystem* Visibility = World ? World->GetSubsystem<UShooterVisibilitySubsystem>() : nullptr;
+
+	return !Visibility || Visibility->CanPossiblySee(From, To);
+}
+
+ECollisionChannel UShooterVisibilitySubsystem::GetTraceChannel(const UWorld* World)
+{
+	const UShooterVisibilitySubsystem* Visibility = World ? World->GetSubsystem<UShooterVisibilitySubsystem>() : nullptr;
+
+	if (Visibility && Visibility->BlockerActor && ShooterVisibility::CVarBlockers.GetValueOnGameThread())
+	{
+		return ShooterVisibility::AIVisibilityChannel;
+	}
+
+	return ECC_Visibility;
+}
+
+void UShooterVisibilitySubsystem::ResetCounts()
+{
+	NumChecks = 0;
+	NumRejected = 0;
+}
+
+namespace ShooterVisibility
+{
+	/** Logs how many AI line of sight traces the visibility data rejected */
+	static void ReportVisibility(const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterVisibilitySubsystem* Visibility = World ? World->GetSubsystem<UShooterVisibilitySubsystem>() : nullptr;
+
+		if (!Visibility)
+		{
+			return;
+		}
+
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			Visibility->ResetCounts();
+			return;
+		}
+
+		const UShooterVisibilityData* Data = Visibility->GetVisibilityData();
+
+		if (!Data)
+		{
+			UE_LOG(LogMeritoBrainDamage, Log, TEXT("PVS: no visibility data loaded for this map"));
+			return;
+		}
+
+		const int64 NumChecks = Visibility->GetNumChecks();
+		const int64 NumRejected = Visibility->GetNumRejected();
+
+		UE_LOG(LogMeritoBrainDamage, Log, TEXT("PVS: %d cells, %lld checks, %lld traces rejected (%.1f%%)"),
+			Data->GetNumCells(), NumChecks, NumRejected, NumChecks > 0 ? 100.0 * NumRejected / NumChecks : 0.0);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Shooter.AI.PVSStats"),
+		TEXT("Logs the AI line of sight traces rejected by the baked visibility data. Pass 'reset' to clear the counts"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportVisibility));
+}
+
+namespace ShooterVisibility
+{
+	/** Times random eye to eye traces over the navmesh on the visibility channel and on the AI visibility channel */
+	static void BenchmarkTraces(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+
+		if (!NavSys)
+		{
+			Ar.Logf(TEXT("Visibility trace benchmark: this world has no navigation system"));
+			return;
+		}
+
+		const int32 NumPairs = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+		const FVector EyeOffset(0.0f, 0.0f, 160.0f);
+
+		// the same random pairs are traced on both channels
+		TArray<TPair<FVector, FVector>> Pairs;
+		Pairs.Reserve(NumPairs);
+
+		for (int32 i = 0; i < NumPairs; ++i)
+		{
+			FNavLocation From, To;
+
+			if (NavSys->GetRandomPoint(From) && NavSys->GetRandomPoint(To))
+			{
+				Pairs.Emplace(From.Location + EyeOffset, To.Location + EyeOffset);
+			}
+		}
+
+		if (Pairs.Num() == 0)
+		{
+			Ar.Logf(TEXT("Visibility trace benchmark: could not sample the navmesh"));
+			return;
+		}
+
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterVisibilityBenchmark), false);
+
+		auto RunTraces = [World, &Pairs, &QueryParams](ECollisionChannel Channel, TBitArray<>& OutBlocked)
+		{
+			OutBlocked.Init(false, Pairs.Num());
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+
+			for (int32 i = 0; i < Pairs.Num(); ++i)
+			{
+				OutBlocked[i] = World->LineTraceTestByChannel(Pairs[i].Key, Pairs[i].Value, Channel, QueryParams);
+			}
+
+			return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0 / Pairs.Num();
+		};
+
+		TBitArray<> VisibilityBlocked, BlockerBlocked;
+
+		const double VisibilityMicroseconds = RunTraces(ECC_Visibility, VisibilityBlocked);
+		const double BlockerMicroseconds = RunTraces(AIVisibilityChannel, BlockerBlocked);
+
+		int32 NumVisibilityBlocked = 0;
+		int32 NumBlockerBlocked = 0;
+		int32 NumDisagreements = 0;
+
+		for (int32 i = 0; i < Pairs.Num(); ++i)
+		{
+			NumVisibilityBlocked += VisibilityBlocked[i] ? 1 : 0;
+			NumBlockerBlocked += BlockerBlocked[i] ? 1 : 0;
+			NumDisagreements += VisibilityBlocked[i] != BlockerBlocked[i] ? 1 : 0;
+		}
+
+		const UShooterVisibilitySubsystem* Visibility = World->GetSubsystem<UShooterVisibilitySubsystem>();
+
+		if (!Visibility || !Visibility->GetBlockerData())
+		{
+			Ar.Logf(TEXT("Visibility trace benchmark: no blockers loaded for this map, so the AI visibility channel hits nothing"));
+		}
+
+		Ar.Logf(TEXT("Visibility trace benchmark: %d pairs"), Pairs.Num());
+		Ar.Logf(TEXT("  Visibility:    %.3f us per trace, %.1f%% blocked"), VisibilityMicroseconds, 100.0 * NumVisibilityBlocked / Pairs.Num());
+		Ar.Logf(TEXT("  AI Visibility: %.3f us per trace, %.1f%% blocked"), BlockerMicroseconds, 100.0 * NumBlockerBlocked / Pairs.Num());
+		Ar.Logf(TEXT("  Speedup %.2fx, results differ on %.1f%% of the pairs"), BlockerMicroseconds > 0.0 ? VisibilityMicroseconds / BlockerMicroseconds : 0.0, 100.0 * NumDisagreements / Pairs.Num());
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchmarkCommand(
+		TEXT("Shooter.AI.VisibilityTraceBenchmark"),
+		TEXT("Times random eye height traces across the navmesh on the visibility and AI visibility channels. Usage: Shooter.AI.VisibilityTraceBenchmark [Pairs]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&BenchmarkTraces));
+}
@@ -0,0 +1,167 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/EngineTypes.h"
+#include "Serialization/BulkData.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterVisibility.generated.h"
+
+class UShooterVisibilityBlockerData;
+
+namespace ShooterVisibility
+{
+	/** Trace channel that only hits the simplified AI visibility blockers */
+	static constexpr ECollisionChannel AIVisibilityChannel = ECC_GameTraceChannel2;
+
+	/** Collision profile of the AI visibility blockers */
+	static constexpr const TCHAR* BlockerProfileName = TEXT("AIVisibilityBlocker");
+}
+
+/**
+ *  Potentially visible sets baked offline for a map by the ShooterVisibilityBake commandlet
+ *  The navigable space is split into grid cells, and each pair of cells stores one bit telling if anything
+ *  in one cell could possibly see into the other. The bit matrix is stored as a memory mapped bulk payload
+ */
+UCLASS(BlueprintType)
+class MERITOBRAINDAMAGE_API UShooterVisibilityData : public UDataAsset
+{
+	GENERATED_BODY()
+
+	/** Compact cell ID for every grid cell, INDEX_NONE for cells without navmesh */
+	TArray<int32> CellIds;
+
+	/** Cell to cell visibility bits, one row of words per cell */
+	FByteBulkData VisibilityBits;
+
+	/** Locked visibility bits */
+	const uint64* Bits = nullptr;
+
+protected:
+
+	/** Min corner of the grid */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	FVector GridOrigin = FVector::ZeroVector;
+
+	/** Horizontal size of the grid cells */
+	UPROPERTY(VisibleAnywhere, Category="Visibility", meta = (Units = "cm"))
+	float CellSize = 400.0f;
+
+	/** Vertical size of the grid cells */
+	UPROPERTY(VisibleAnywhere, Category="Visibility", meta = (Units = "cm"))
+	float CellHeight = 300.0f;
+
+	/** Number of grid cells on each axis */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	FIntVector GridSize = FIntVector::ZeroValue;
+
+	/** Number of cells with navmesh */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	int32 NumCells = 0;
+
+	/** Number of 64 bit words per visibility row */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	int32 WordsPerRow = 0;
+
+public:
+
+	/** Serializes the cell table and the visibility payload */
+	virtual void Serialize(FArchive& Ar) override;
+
+	/** Maps the visibility payload */
+	virtual void PostLoad() override;
+
+	/** Releases the visibility payload */
+	virtual void BeginDestroy() override;
+
+	/** Replaces the baked data */
+	void Build(const FVector& InGridOrigin, float InCellSize, float InCellHeight, const FIntVector& InGridSize, TArray<int32>&& InCellIds, int32 InNumCells, const TArray<uint64>& InBits);
+
+	/** Returns the compact cell ID for a location, or INDEX_NONE if it's outside the baked cells */
+	int32 GetCellId(const FVector& Location) const;
+
+	/** Returns false only if nothing in one cell can see into the other */
+	bool AreCellsVisible(int32 CellA, int32 CellB) const;
+
+	/** Returns false only if the two locations are in baked cells that can't see each other */
+	bool CanPossiblySee(const FVector& From, const FVector& To) const;
+
+	/** Returns the number of cells with navmesh */
+	int32 GetNumCells() const { return NumCells; }
+
+	/** Returns the size of the grid cells */
+	FVector GetCellExtent() const { return FVector(CellSize, CellSize, CellHeight); }
+
+	/** Returns the grid index for a location, or INDEX_NONE if outside the grid */
+	int32 GetGridIndex(const FVector& Location) const;
+};
+
+/**
+ *  Loads the potentially visible sets for the current map and rejects AI line of sight checks between cells that can never see each other
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterVisibilitySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Visibility data for the current map */
+	UPROPERTY()
+	TObjectPtr<UShooterVisibilityData> VisibilityData;
+
+	/** Simplified line of sight blockers for the current map */
+	UPROPERTY()
+	TObjectPtr<UShooterVisibilityBlockerData> BlockerData;
+
+	/** Actor holding the blocker collision, one component per cluster */
+	UPROPERTY()
+	TObjectPtr<AActor> BlockerActor;
+
+	/** Checks made since the last reset */
+	int64 NumChecks = 0;
+
+	/** Checks rejected since the last reset */
+	int64 NumRejected = 0;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Starts loading the visibility data and the line of sight blockers */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Returns the loaded visibility data, if any */
+	const UShooterVisibilityData* GetVisibilityData() const { return VisibilityData; }
+
+	/** Returns false if a trace between the two locations can be skipped because it will always be blocked. Game thread only */
+	bool CanPossiblySee(const FVector& From, const FVector& To);
+
+	/** Returns false if a line of sight trace between the two locations can be skipped. Always true if the world has no visibility data */
+	static bool CanPossiblySee(const UWorld* World, const FVector& From, const FVector& To);
+
+	/** Returns the loaded line of sight blockers, if any */
+	const UShooterVisibilityBlockerData* GetBlockerData() const { return BlockerData; }
+
+	/** Returns the channel AI line of sight traces should use. The AI visibility channel once the map's blockers are spawned, the visibility channel otherwise. Game thread only */
+	static ECollisionChannel GetTraceChannel(const UWorld* World);
+
+	/** Returns the check counts since the last reset */
+	int64 GetNumChecks() const { return NumChecks; }
+	int64 GetNumRejected() const { return NumRejected; }
+
+	/** Resets the check counts */
+	void ResetCounts();
+
+protected:
+
+	/** Called when the visibility data finishes loading */
+	void OnVisibilityDataLoaded(FSoftObjectPath AssetPath);
+
+	/** Called when the line of sight blockers finish loading. Spawns their collision */
+	void OnBlockerDataLoaded(FSoftObjectPath AssetPath);
+
+	/** Makes the meshes the blockers couldn't simplify, and the meshes of movable actors, block the AI visibility channel with their own collision. Returns how many */
+	int32 SetupFullDetailBlockers() const;
+};
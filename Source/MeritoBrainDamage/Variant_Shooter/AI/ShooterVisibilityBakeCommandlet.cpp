@@ -0,0 +1,359 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterVisibilityBakeCommandlet.h"
+#include "ShooterVisibility.h"
+#include "ShooterBakeUtils.h"
+#include "ShooterSightSense.h"
+#include "AIController.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "Perception/AISenseConfig_Sight.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "UObject/UObjectHash.h"
+#include "UObject/UObjectIterator.h"
+#include "MeritoBrainDamage.h"
+
+UShooterVisibilityBakeCommandlet::UShooterVisibilityBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Bakes the AI potentially visible sets for the shooter maps");
+	HelpUsage = TEXT("-run=ShooterVisibilityBake [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]");
+}
+
+int32 UShooterVisibilityBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	int32 NumFailed = 0;
+
+	for (const FString& MapPath : ShooterBake::GetBakeMapPaths(Params))
+	{
+		UWorld* World = ShooterBake::LoadBakeWorld(MapPath);
+
+		if (!World)
+		{
+			++NumFailed;
+			continue;
+		}
+
+		UShooterVisibilityData* VisibilityData = ShooterBake::FindOrCreateBakeAsset<UShooterVisibilityData>(ShooterBake::GetBakeAssetPath(MapPath, TEXT("Visibility"), TEXT("PVS")));
+
+		if (!VisibilityData || !BakeVisibility(World, VisibilityData) || !ShooterBake::SaveBakeAsset(VisibilityData))
+		{
+			++NumFailed;
+		}
+
+		ShooterBake::UnloadBakeWorld(World);
+	}
+
+	return NumFailed > 0 ? 1 : 0;
+
+#else
+
+	UE_LOG(LogMeritoBrainDamage, Error, TEXT("Visibility bake: requires an editor build"));
+	return 1;
+
+#endif // WITH_EDITOR
+}
+
+bool UShooterVisibilityBakeCommandlet::BakeVisibility(UWorld* World, UShooterVisibilityData* VisibilityData) const
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	const ARecastNavMesh* NavMesh = NavSys ? Cast<ARecastNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate)) : nullptr;
+
+	if (!NavMesh)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Visibility bake: %s has no recast navmesh"), *World->GetName());
+		return false;
+	}
+
+	// the grid covers the navmesh
+	FBox Bounds(ForceInit);
+
+	for (int32 TileIndex = 0; TileIndex < NavMesh->GetNavMeshTilesCount(); ++TileIndex)
+	{
+		FRecastDebugGeometry Geometry;
+		NavMesh->GetDebugGeometryForTile(Geometry, TileIndex);
+
+		for (const FVector& Vertex : Geometry.MeshVerts)
+		{
+			Bounds += Vertex;
+		}
+	}
+
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Visibility bake: %s has an empty navmesh"), *World->GetName());
+		return false;
+	}
+
+	// leave room above the top floor for the eye heights
+	const float MaxEyeHeight = FMath::Max(EyeHeights);
+	const int32 EyeLayers = FMath::CeilToInt32(MaxEyeHeight / CellHeight);
+
+	const FVector GridOrigin = Bounds.Min - FVector(0.0f, 0.0f, 50.0f);
+	const FVector BoundsSize = Bounds.Max - GridOrigin;
+
+	const FIntVector GridSize(
+		FMath::CeilToInt32(BoundsSize.X / CellSize) + 1,
+		FMath::CeilToInt32(BoundsSize.Y / CellSize) + 1,
+		FMath::CeilToInt32(BoundsSize.Z / CellHeight) + 1 + EyeLayers);
+
+	const int64 NumGridCells = int64(GridSize.X) * GridSize.Y * GridSize.Z;
+
+	if (NumGridCells > MaxGridCells)
+	{
+		UE_LOG(LogMeritoBrainDamage, Error, TEXT("Visibility bake: %s needs %lld grid cells, more than the limit of %d. Increase the cell size"), *World->GetName(), NumGridCells, MaxGridCells);
+		return false;
+	}
+
+	auto GetGridIndex = [&GridSize](int32 X, int32 Y, int32 Z)
+	{
+		return X + (Y + Z * GridSize.Y) * GridSize.X;
+	};
+
+	// find the cells with navmesh and the eye points to cast from inside them
+	TArray<int32> CellIds;
+	CellIds.Init(INDEX_NONE, static_cast<int32>(NumGridCells));
+
+	TArray<FIntVector> CellCoords;
+	TArray<TArray<FVector>> CellEyes;
+
+	const FVector ProjectExtent(CellSize * 0.5f, CellSize * 0.5f, CellHeight * 0.5f);
+	const FVector2D SampleOffsets[] = { FVector2D(0.5f, 0.5f), FVector2D(0.2f, 0.2f), FVector2D(0.8f, 0.2f), FVector2D(0.2f, 0.8f), FVector2D(0.8f, 0.8f) };
+
+	for (int32 Z = 0; Z < GridSize.Z; ++Z)
+	{
+		for (int32 Y = 0; Y < GridSize.Y; ++Y)
+		{
+			for (int32 X = 0; X < GridSize.X; ++X)
+			{
+				const FVector CellMin = GridOrigin + FVector(X * CellSize, Y * CellSize, Z * CellHeight);
+
+				TArray<FVector> Eyes;
+
+				for (const FVector2D& Offset : SampleOffsets)
+				{
+					const FVector SamplePoint = CellMin + FVector(Offset.X * CellSize, Offset.Y * CellSize, CellHeight * 0.5f);
+
+					FNavLocation NavLocation;
+
+					// the projected point has to stay inside this cell, or it belongs to a neighbor
+					if (!NavSys->ProjectPointToNavigation(SamplePoint, NavLocation, ProjectExtent)
+						|| NavLocation.Location.Z < CellMin.Z || NavLocation.Location.Z >= CellMin.Z + CellHeight)
+					{
+						continue;
+					}
+
+					for (const float EyeHeight : EyeHeights)
+					{
+						Eyes.Add(NavLocation.Location + FVector(0.0f, 0.0f, EyeHeight));
+					}
+				}
+
+				if (Eyes.Num() > 0)
+				{
+					CellIds[GetGridIndex(X, Y, Z)] = CellCoords.Add(FIntVector(X, Y, Z));
+					CellEyes.Add(MoveTemp(Eyes));
+				}
+			}
+		}
+	}
+
+	const int32 NumCells = CellCoords.Num();
+	const int32 WordsPerRow = FMath::DivideAndRoundUp(NumCells, 64);
+
+	// eyes and bounds centers sit above the navmesh, so the empty cells above a floor map to the floor cell
+	for (int32 CellId = 0; CellId < NumCells; ++CellId)
+	{
+		const FIntVector& Coords = CellCoords[CellId];
+
+		for (int32 Layer = 1; Layer <= EyeLayers && Coords.Z + Layer < GridSize.Z; ++Layer)
+		{
+			int32& AboveId = CellIds[GetGridIndex(Coords.X, Coords.Y, Coords.Z + Layer)];
+
+			if (AboveId == INDEX_NONE)
+			{
+				AboveId = CellId;
+			}
+		}
+	}
+
+	// only static geometry can make a pair of cells permanently invisible
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterVisibilityBake), false);
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (!It->IsRootComponentStatic())
+		{
+			QueryParams.AddIgnoredActor(*It);
+		}
+	}
+
+	TArray<uint64> Bits;
+	Bits.SetNumZeroed(NumCells * WordsPerRow);
+
+	// cell centers can be a cell diagonal further apart than the eyes inside them
+	const FVector CellExtent(CellSize, CellSize, CellHeight);
+	const float MaxSightRadius = GetMaxSightRadius();
+	const double MaxViewDistanceSq = FMath::Square(MaxSightRadius + CellExtent.Size());
+
+	// each worker only writes its own row, the lower triangle is mirrored afterwards
+	ParallelFor(NumCells, [&](int32 CellA)
+	{
+		uint64* Row = &Bits[CellA * WordsPerRow];
+
+		for (int32 CellB = CellA; CellB < NumCells; ++CellB)
+		{
+			const FIntVector Delta = CellCoords[CellA] - CellCoords[CellB];
+
+			// neighbors always see each other, there's no room for a wall between their samples to be trusted
+			bool bVisible = FMath::Abs(Delta.X) <= 1 && FMath::Abs(Delta.Y) <= 1 && FMath::Abs(Delta.Z) <= 1;
+
+			if (!bVisible && (FVector(Delta) * CellExtent).SizeSquared() <= MaxViewDistanceSq)
+			{
+				for (int32 i = 0; i < CellEyes[CellA].Num() && !bVisible; ++i)
+				{
+					for (int32 j = 0; j < CellEyes[CellB].Num() && !bVisible; ++j)
+					{
+						bVisible = !World->LineTraceTestByChannel(CellEyes[CellA][i], CellEyes[CellB][j], ECC_Visibility, QueryParams);
+					}
+				}
+			}
+
+			if (bVisible)
+			{
+				Row[CellB >> 6] |= uint64(1) << (CellB & 63);
+			}
+		}
+
+	}, EParallelForFlags::Unbalanced);
+
+	// makes every visible pair visible both ways
+	auto MirrorRows = [&Bits, NumCells, WordsPerRow]()
+	{
+		for (int32 CellA = 0; CellA < NumCells; ++CellA)
+		{
+			for (int32 CellB = 0; CellB < NumCells; ++CellB)
+			{
+				if ((Bits[CellA * WordsPerRow + (CellB >> 6)] >> (CellB & 63)) & 1)
+				{
+					Bits[CellB * WordsPerRow + (CellA >> 6)] |= uint64(1) << (CellA & 63);
+				}
+			}
+		}
+	};
+
+	MirrorRows();
+
+	// a handful of eyes per cell can miss sightlines through narrow gaps, so each cell also sees whatever its neighbors see
+	if (DilationRadius > 0)
+	{
+		TArray<uint64> DilatedBits = Bits;
+
+		ParallelFor(NumCells, [&](int32 CellA)
+		{
+			uint64* Row = &DilatedBits[CellA * WordsPerRow];
+			const FIntVector& Coords = CellCoords[CellA];
+
+			for (int32 Z = FMath::Max(Coords.Z - DilationRadius, 0); Z <= FMath::Min(Coords.Z + DilationRadius, GridSize.Z - 1); ++Z)
+			{
+				for (int32 Y = FMath::Max(Coords.Y - DilationRadius, 0); Y <= FMath::Min(Coords.Y + DilationRadius, GridSize.Y - 1); ++Y)
+				{
+					for (int32 X = FMath::Max(Coords.X - DilationRadius, 0); X <= FMath::Min(Coords.X + DilationRadius, GridSize.X - 1); ++X)
+					{
+						const int32 NeighborId = CellIds[GetGridIndex(X, Y, Z)];
+
+						if (NeighborId == INDEX_NONE || NeighborId == CellA)
+						{
+							continue;
+						}
+
+						const uint64* NeighborRow = &Bits[NeighborId * WordsPerRow];
+
+						for (int32 Word = 0; Word < WordsPerRow; ++Word)
+						{
+							Row[Word] |= NeighborRow[Word];
+						}
+					}
+				}
+			}
+		});
+
+		Bits = MoveTemp(DilatedBits);
+
+		// the dilated rows aren't symmetric anymore
+		MirrorRows();
+	}
+
+	int64 NumVisiblePairs = 0;
+
+	for (int32 CellA = 0; CellA < NumCells; ++CellA)
+	{
+		for (int32 CellB = CellA; CellB < NumCells; ++CellB)
+		{
+			NumVisiblePairs += (Bits[CellA * WordsPerRow + (CellB >> 6)] >> (CellB & 63)) & 1;
+		}
+	}
+
+	VisibilityData->Build(GridOrigin, CellSize, CellHeight, GridSize, MoveTemp(CellIds), NumCells, Bits);
+
+	const int64 NumPairs = int64(NumCells) * (NumCells + 1) / 2;
+
+	UE_LOG(LogMeritoBrainDamage, Display, TEXT("Visibility bake: %s has %d cells, %lld of %lld cell pairs potentially visible (%.1f%%) within %.0f cm, %lld bytes"),
+		*World->GetName(), NumCells, NumVisiblePairs, NumPairs, NumPairs > 0 ? 100.0 * NumVisiblePairs / NumPairs : 0.0, MaxSightRadius, int64(Bits.Num()) * sizeof(uint64));
+
+	return true;
+}
+
+float UShooterVisibilityBakeCommandlet::GetMaxSightRadius()
+{
+	// the sense config defaults carry any radius set in the config files
+	const UAISenseConfig_ShooterSight* ShooterSightDefaults = GetDefault<UAISenseConfig_ShooterSight>();
+	const UAISenseConfig_Sight* SightDefaults = GetDefault<UAISenseConfig_Sight>();
+
+	float MaxRadius = FMath::Max3(ShooterSightDefaults->SightRadius, ShooterSightDefaults->LoseSightRadius, FMath::Max(SightDefaults->SightRadius, SightDefaults->LoseSightRadius));
+
+	// the controllers set their radii up in BP, and the loaded map has pulled in every controller class it spawns
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		if (!It->IsChildOf(AAIController::StaticClass()) || It->HasAnyClassFlags(CLASS_NewerVersionExists))
+		{
+			continue;
+		}
+
+		TArray<UObject*> Subobjects;
+		GetObjectsWithOuter(It->GetDefaultObject(), Subobjects);
+
+		for (const UObject* Subobject : Subobjects)
+		{
+			const UAIPerceptionComponent* Perception = Cast<UAIPerceptionComponent>(Subobject);
+
+			if (!Perception)
+			{
+				continue;
+			}
+
+			for (auto ConfigIt = Perception->GetSensesConfigIterator(); ConfigIt; ++ConfigIt)
+			{
+				if (const UAISenseConfig_ShooterSight* ShooterSightConfig = Cast<UAISenseConfig_ShooterSight>(*ConfigIt))
+				{
+					MaxRadius = FMath::Max3(MaxRadius, ShooterSightConfig->SightRadius, ShooterSightConfig->LoseSightRadius);
+
+				} else if (const UAISenseConfig_Sight* SightConfig = Cast<UAISenseConfig_Sight>(*ConfigIt)) {
+
+					MaxRadius = FMath::Max3(MaxRadius, SightConfig->SightRadius, SightConfig->LoseSightRadius);
+				}
+			}
+		}
+	}
+
+	return MaxRadius;
+}
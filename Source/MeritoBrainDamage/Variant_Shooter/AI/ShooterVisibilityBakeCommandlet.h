@@ -0,0 +1,53 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ShooterVisibilityBakeCommandlet.generated.h"
+
+class UWorld;
+class UShooterVisibilityData;
+
+/**
+ *  Bakes cell to cell potentially visible sets for each map from its navmesh
+ *  Usage: UnrealEditor-Cmd <Project> -run=ShooterVisibilityBake [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterVisibilityBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Horizontal size of the visibility cells */
+	float CellSize = 400.0f;
+
+	/** Vertical size of the visibility cells */
+	float CellHeight = 300.0f;
+
+	/** Heights above the navmesh the visibility rays are cast from and to, roughly crouched and standing eyes */
+	TArray<float> EyeHeights = { 60.0f, 160.0f };
+
+	/** Number of neighbor cells each visibility row is dilated by, covering sightlines the sampled eyes missed */
+	int32 DilationRadius = 1;
+
+	/** Upper limit on the number of grid cells, so a huge map doesn't exhaust memory */
+	int32 MaxGridCells = 1 << 20;
+
+public:
+
+	/** Constructor */
+	UShooterVisibilityBakeCommandlet();
+
+	/** Bakes every requested map */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+
+	/** Computes the visibility data for a loaded world */
+	bool BakeVisibility(UWorld* World, UShooterVisibilityData* VisibilityData) const;
+
+	/** Returns the largest lose sight radius of the sight sense defaults and every loaded AI controller class */
+	static float GetMaxSightRadius();
+};
@@ -0,0 +1,121 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterVisibilityBlockers.h"
+#include "ShooterVisibility.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+void UShooterVisibilityBlockerData::Build(TArray<FShooterVisibilityBlockerCluster>&& InClusters, int32 InNumSourceMeshes)
+{
+	Clusters = MoveTemp(InClusters);
+	NumSourceMeshes = InNumSourceMeshes;
+}
+
+int32 UShooterVisibilityBlockerData::GetNumBoxes() const
+{
+	int32 NumBoxes = 0;
+
+	for (const FShooterVisibilityBlockerCluster& Cluster : Clusters)
+	{
+		NumBoxes += Cluster.Geometry.BoxElems.Num();
+	}
+
+	return NumBoxes;
+}
+
+int32 UShooterVisibilityBlockerData::GetNumConvexes() const
+{
+	int32 NumConvexes = 0;
+
+	for (const FShooterVisibilityBlockerCluster& Cluster : Clusters)
+	{
+		NumConvexes += Cluster.Geometry.ConvexElems.Num();
+	}
+
+	return NumConvexes;
+}
+
+bool UShooterVisibilityBlockerData::BlocksVisibility(const UPrimitiveComponent* Component)
+{
+	return Component && Component->IsCollisionEnabled() && Component->GetCollisionResponseToChannel(ECC_Visibility) == ECR_Block;
+}
+
+bool UShooterVisibilityBlockerData::NeedsFullDetail(const UStaticMeshComponent* MeshComponent)
+{
+	const UStaticMesh* Mesh = MeshComponent ? MeshComponent->GetStaticMesh() : nullptr;
+
+	if (!Mesh)
+	{
+		return false;
+	}
+
+	const UBodySetup* BodySetup = Mesh->GetBodySetup();
+
+	// complex as simple meshes trace their triangles, so their simple shapes are missing or stale
+	if (BodySetup && BodySetup->CollisionTraceFlag == CTF_UseComplexAsSimple)
+	{
+		return true;
+	}
+
+	if (BodySetup && BodySetup->AggGeom.GetElementCount() > 0)
+	{
+		return false;
+	}
+
+	// without simple collision only props may become a bounding box. A wall with a door or a room shell would seal its openings
+	FVector Scale = MeshComponent->GetComponentScale().GetAbs();
+
+	if (const UInstancedStaticMeshComponent* InstancedComponent = Cast<UInstancedStaticMeshComponent>(MeshComponent))
+	{
+		for (int32 Instance = 0; Instance < InstancedComponent->GetInstanceCount(); ++Instance)
+		{
+			FTransform InstanceTransform;
+			InstancedComponent->GetInstanceTransform(Instance, InstanceTransform, true);
+
+			Scale = Scale.ComponentMax(InstanceTransform.GetScale3D().GetAbs());
+		}
+	}
+
+	return (Mesh->GetBoundingBox().GetSize() * Scale).GetMax() > MaxBoundsFallbackSize;
+}
+
+UShooterVisibilityBlockerComponent::UShooterVisibilityBlockerComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	// only AI visibility traces should ever see these shapes
+	SetCollisionProfileName(ShooterVisibility::BlockerProfileName);
+	SetGenerateOverlapEvents(false);
+	SetCanEverAffectNavigation(false);
+	SetHiddenInGame(true);
+	SetMobility(EComponentMobility::Static);
+
+	CastShadow = false;
+}
+
+void UShooterVisibilityBlockerComponent::SetGeometry(const FKAggregateGeom& Geometry)
+{
+	BlockerBodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+	BlockerBodySetup->BodySetupGuid = FGuid::NewGuid();
+	BlockerBodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	BlockerBodySetup->AggGeom = Geometry;
+
+	// convexes are cooked here, the same way procedural mesh collision is
+	BlockerBodySetup->CreatePhysicsMeshes();
+
+	RecreatePhysicsState();
+	UpdateBounds();
+}
+
+FBoxSphereBounds UShooterVisibilityBlockerComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!BlockerBodySetup || BlockerBodySetup->AggGeom.GetElementCount() == 0)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.0f);
+	}
+
+	return BlockerBodySetup->AggGeom.CalcAABB(LocalToWorld);
+}
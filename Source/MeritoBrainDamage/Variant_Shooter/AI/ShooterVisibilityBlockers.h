@@ -0,0 +1,101 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/AggregateGeom.h"
+#include "ShooterVisibilityBlockers.generated.h"
+
+class UBodySetup;
+class UPrimitiveComponent;
+class UStaticMeshComponent;
+
+/**
+ *  Blocker shapes of one area of the map. Each cluster gets its own body, so traces only test the shapes of the clusters they cross
+ */
+USTRUCT()
+struct FShooterVisibilityBlockerCluster
+{
+	GENERATED_BODY()
+
+	/** Blocker shapes in world space */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	FKAggregateGeom Geometry;
+};
+
+/**
+ *  Simplified AI line of sight blockers generated offline for a map by the ShooterVisibilityProxy commandlet
+ *  Every static mesh that blocks visibility is reduced to its simple collision boxes and convexes, or to its bounding
+ *  box if it's a prop without any, and stored in world space. Meshes that can't be reduced, such as complex as simple
+ *  walls with openings or room shells, keep blocking AI visibility traces with their own collision, and so do the meshes
+ *  of movable actors such as doors, which the baked shapes can't follow. Actors spawned during play don't block AI sight
+ */
+UCLASS(BlueprintType)
+class MERITOBRAINDAMAGE_API UShooterVisibilityBlockerData : public UDataAsset
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Blocker shapes, grouped by area */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	TArray<FShooterVisibilityBlockerCluster> Clusters;
+
+	/** Number of meshes the shapes were generated from */
+	UPROPERTY(VisibleAnywhere, Category="Visibility")
+	int32 NumSourceMeshes = 0;
+
+public:
+
+	/** Meshes without simple collision larger than this on any axis keep their own collision instead of becoming a bounding box */
+	static constexpr float MaxBoundsFallbackSize = 300.0f;
+
+	/** Replaces the generated shapes */
+	void Build(TArray<FShooterVisibilityBlockerCluster>&& InClusters, int32 InNumSourceMeshes);
+
+	/** Returns the blocker shapes, grouped by area */
+	const TArray<FShooterVisibilityBlockerCluster>& GetClusters() const { return Clusters; }
+
+	/** Returns the total number of boxes and convexes */
+	int32 GetNumBoxes() const;
+	int32 GetNumConvexes() const;
+
+	/** Returns the number of meshes the shapes were generated from */
+	int32 GetNumSourceMeshes() const { return NumSourceMeshes; }
+
+	/** Returns true if a component blocks the regular visibility channel */
+	static bool BlocksVisibility(const UPrimitiveComponent* Component);
+
+	/** Returns true if a mesh can't be reduced to simple shapes, so it has to block AI visibility traces with its own collision */
+	static bool NeedsFullDetail(const UStaticMeshComponent* MeshComponent);
+};
+
+/**
+ *  Invisible, query only collision built from one cluster of the AI visibility blockers of a map
+ *  Every cluster is its own entry in the scene's acceleration structure, so a trace only runs narrow phase on nearby shapes
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterVisibilityBlockerComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+	/** Body built from the blocker shapes */
+	UPROPERTY(Transient)
+	TObjectPtr<UBodySetup> BlockerBodySetup;
+
+public:
+
+	/** Constructor */
+	UShooterVisibilityBlockerComponent(const FObjectInitializer& ObjectInitializer);
+
+	/** Rebuilds the body from the given shapes */
+	void SetGeometry(const FKAggregateGeom& Geometry);
+
+	/** Returns the body built from the blocker shapes */
+	virtual UBodySetup* GetBodySetup() override { return BlockerBodySetup; }
+
+	/** Bounds of the blocker shapes */
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+};
@@ -0,0 +1,218 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterVisibilityProxyCommandlet.h"
+#include "ShooterVisibilityBlockers.h"
+#include "ShooterBakeUtils.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "MeritoBrainDamage.h"
+
+UShooterVisibilityProxyCommandlet::UShooterVisibilityProxyCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Generates the simplified AI line of sight blockers for the shooter maps");
+	HelpUsage = TEXT("-run=ShooterVisibilityProxy [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]");
+}
+
+int32 UShooterVisibilityProxyCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	int32 NumFailed = 0;
+
+	for (const FString& MapPath : ShooterBake::GetBakeMapPaths(Params))
+	{
+		UWorld* World = ShooterBake::LoadBakeWorld(MapPath);
+
+		if (!World)
+		{
+			++NumFailed;
+			continue;
+		}
+
+		UShooterVisibilityBlockerData* BlockerData = ShooterBake::FindOrCreateBakeAsset<UShooterVisibilityBlockerData>(ShooterBake::GetBakeAssetPath(MapPath, TEXT("Visibility"), TEXT("Blockers")));
+
+		if (!BlockerData || !GenerateBlockers(World, BlockerData) || !ShooterBake::SaveBakeAsset(BlockerData))
+		{
+			++NumFailed;
+		}
+
+		ShooterBake::UnloadBakeWorld(World);
+	}
+
+	return NumFailed > 0 ? 1 : 0;
+
+#else
+
+	UE_LOG(LogMeritoBrainDamage, Error, TEXT("Visibility proxies: requires an editor build"));
+	return 1;
+
+#endif // WITH_EDITOR
+}
+
+bool UShooterVisibilityProxyCommandlet::GenerateBlockers(UWorld* World, UShooterVisibilityBlockerData* BlockerData) const
+{
+	// shapes grouped by the cluster their mesh is centered in
+	TMap<FIntVector, FShooterVisibilityBlockerCluster> ClusterMap;
+
+	int32 NumSourceMeshes = 0;
+	int32 NumSkipped = 0;
+	int32 NumFullDetail = 0;
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		// only static geometry gets proxies, same as the visibility bake
+		if (!It->IsRootComponentStatic())
+		{
+			continue;
+		}
+
+		TInlineComponentArray<UStaticMeshComponent*> MeshComponents(*It);
+
+		for (const UStaticMeshComponent* MeshComponent : MeshComponents)
+		{
+			const UStaticMesh* Mesh = MeshComponent->GetStaticMesh();
+
+			// only meshes that blocked AI sight before get a proxy
+			if (!Mesh || !UShooterVisibilityBlockerData::BlocksVisibility(MeshComponent))
+			{
+				continue;
+			}
+
+			// meshes that can't be simplified keep blocking with their own collision, the visibility subsystem sets that up when the blockers load
+			if (UShooterVisibilityBlockerData::NeedsFullDetail(MeshComponent))
+			{
+				++NumFullDetail;
+				continue;
+			}
+
+			TArray<FTransform, TInlineAllocator<1>> Transforms;
+
+			if (const UInstancedStaticMeshComponent* InstancedComponent = Cast<UInstancedStaticMeshComponent>(MeshComponent))
+			{
+				for (int32 Instance = 0; Instance < InstancedComponent->GetInstanceCount(); ++Instance)
+				{
+					InstancedComponent->GetInstanceTransform(Instance, Transforms.AddDefaulted_GetRef(), true);
+				}
+
+			} else {
+
+				Transforms.Add(MeshComponent->GetComponentTransform());
+			}
+
+			const FVector MeshSize = Mesh->GetBoundingBox().GetSize();
+
+			for (const FTransform& Transform : Transforms)
+			{
+				// small clutter doesn't hide anybody
+				if ((MeshSize * Transform.GetScale3D().GetAbs()).GetMax() < MinBlockerSize)
+				{
+					++NumSkipped;
+					continue;
+				}
+
+				const FVector Center = Mesh->GetBoundingBox().TransformBy(Transform).GetCenter();
+				const FIntVector ClusterCell(FMath::FloorToInt32(Center.X / ClusterSize), FMath::FloorToInt32(Center.Y / ClusterSize), FMath::FloorToInt32(Center.Z / ClusterSize));
+
+				AddMeshBlockers(Mesh, Transform, ClusterMap.FindOrAdd(ClusterCell).Geometry);
+				++NumSourceMeshes;
+			}
+		}
+	}
+
+	TArray<FShooterVisibilityBlockerCluster> Clusters;
+	ClusterMap.GenerateValueArray(Clusters);
+
+	Clusters.RemoveAllSwap([](const FShooterVisibilityBlockerCluster& Cluster) { return Cluster.Geometry.GetElementCount() == 0; });
+
+	if (Clusters.Num() == 0)
+	{
+		UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Visibility proxies: %s has no static meshes blocking visibility"), *World->GetName());
+		return false;
+	}
+
+	BlockerData->Build(MoveTemp(Clusters), NumSourceMeshes);
+
+	UE_LOG(LogMeritoBrainDamage, Display, TEXT("Visibility proxies: %s has %d boxes and %d convexes in %d clusters from %d meshes, %d small meshes skipped, %d meshes kept at full detail"),
+		*World->GetName(), BlockerData->GetNumBoxes(), BlockerData->GetNumConvexes(), BlockerData->GetClusters().Num(), NumSourceMeshes, NumSkipped, NumFullDetail);
+
+	return true;
+}
+
+void UShooterVisibilityProxyCommandlet::AddMeshBlockers(const UStaticMesh* Mesh, const FTransform& Transform, FKAggregateGeom& OutGeometry) const
+{
+	const FVector Scale = Transform.GetScale3D().GetAbs();
+
+	// boxes keep their rotation, and the placement scale is applied along their own axes
+	auto AddBox = [&Transform, &Scale, &OutGeometry](const FKBoxElem& LocalBox)
+	{
+		const FTransform BoxTransform = LocalBox.GetTransform() * Transform;
+
+		FKBoxElem& Box = OutGeometry.BoxElems.Add_GetRef(FKBoxElem(LocalBox.X * Scale.X, LocalBox.Y * Scale.Y, LocalBox.Z * Scale.Z));
+		Box.Center = BoxTransform.GetLocation();
+		Box.Rotation = BoxTransform.Rotator();
+	};
+
+	const UBodySetup* BodySetup = Mesh->GetBodySetup();
+
+	// no simple collision, so fall back to the bounding box. Only props get here, larger meshes keep their own collision
+	if (!BodySetup || BodySetup->AggGeom.GetElementCount() == 0)
+	{
+		const FBox Bounds = Mesh->GetBoundingBox();
+
+		FKBoxElem Box(Bounds.GetSize().X, Bounds.GetSize().Y, Bounds.GetSize().Z);
+		Box.Center = Bounds.GetCenter();
+
+		AddBox(Box);
+		return;
+	}
+
+	const FKAggregateGeom& SimpleGeometry = BodySetup->AggGeom;
+
+	for (const FKBoxElem& Box : SimpleGeometry.BoxElems)
+	{
+		AddBox(Box);
+	}
+
+	// round shapes are rare on props, so their bounding boxes are close enough
+	for (const FKSphereElem& Sphere : SimpleGeometry.SphereElems)
+	{
+		FKBoxElem Box(Sphere.Radius * 2.0f);
+		Box.Center = Sphere.Center;
+
+		AddBox(Box);
+	}
+
+	for (const FKSphylElem& Sphyl : SimpleGeometry.SphylElems)
+	{
+		FKBoxElem Box(Sphyl.Radius * 2.0f, Sphyl.Radius * 2.0f, Sphyl.Length + Sphyl.Radius * 2.0f);
+		Box.Center = Sphyl.Center;
+		Box.Rotation = Sphyl.Rotation;
+
+		AddBox(Box);
+	}
+
+	// convexes are moved to world space vertex by vertex and cooked again when loaded
+	for (const FKConvexElem& LocalConvex : SimpleGeometry.ConvexElems)
+	{
+		const FTransform ConvexTransform = LocalConvex.GetTransform() * Transform;
+
+		FKConvexElem& Convex = OutGeometry.ConvexElems.AddDefaulted_GetRef();
+		Convex.VertexData.Reserve(LocalConvex.VertexData.Num());
+
+		for (const FVector& Vertex : LocalConvex.VertexData)
+		{
+			Convex.VertexData.Add(ConvexTransform.TransformPosition(Vertex));
+		}
+
+		Convex.UpdateElemBox();
+	}
+}
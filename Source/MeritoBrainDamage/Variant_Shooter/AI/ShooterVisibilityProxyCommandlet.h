@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ShooterVisibilityProxyCommandlet.generated.h"
+
+class UWorld;
+class UStaticMesh;
+class UShooterVisibilityBlockerData;
+struct FKAggregateGeom;
+
+/**
+ *  Generates the simplified AI line of sight blockers for each map from its static meshes
+ *  Usage: UnrealEditor-Cmd <Project> -run=ShooterVisibilityProxy [-Maps=Lvl_Classroom+Lvl_Computer_Classroom]
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterVisibilityProxyCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Meshes smaller than this on every axis don't block sight, so small clutter is left out */
+	float MinBlockerSize = 30.0f;
+
+	/** Size of the areas the shapes are grouped by. Each area becomes one body */
+	float ClusterSize = 1000.0f;
+
+public:
+
+	/** Constructor */
+	UShooterVisibilityProxyCommandlet();
+
+	/** Generates the blockers for every requested map */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+
+	/** Computes the blockers for a loaded world */
+	bool GenerateBlockers(UWorld* World, UShooterVisibilityBlockerData* BlockerData) const;
+
+	/** Adds the simple collision of a mesh placed with the given transform, or its bounding box if it has none */
+	void AddMeshBlockers(const UStaticMesh* Mesh, const FTransform& Transform, FKAggregateGeom& OutGeometry) const;
+};
@@ -6,6 +6,7 @@
 #include "EnhancedInputComponent.h"
 #include "Components/InputComponent.h"
 #include "Components/PawnNoiseEmitterComponent.h"
+#include "ShooterHitbox.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/World.h"
@@ -19,9 +20,15 @@
 
 AShooterCharacter::AShooterCharacter()
 {
+	// the character is driven by input and events. Blueprints that implement Tick re-enable this
+	PrimaryActorTick.bCanEverTick = false;
+
 	// create the noise emitter component
 	PawnNoiseEmitter = CreateDefaultSubobject<UPawnNoiseEmitterComponent>(TEXT("Pawn Noise Emitter"));
 
+	// create the hitboxes
+	Hitboxes = CreateDefaultSubobject<UShooterHitboxComponent>(TEXT("Hitboxes"));
+
 	// configure movement
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 600.0f, 0.0f);
 }
@@ -202,10 +209,16 @@ void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
 	// attach the weapon actor
 	Weapon->AttachToActor(this, AttachmentRule);
 
-	// attach the weapon meshes
-	Weapon->GetFirstPersonMesh()->AttachToComponent(GetFirstPersonMesh(), AttachmentRule, FirstPersonWeaponSocket);
-	Weapon->GetThirdPersonMesh()->AttachToComponent(GetMesh(), AttachmentRule, FirstPersonWeaponSocket);
-	
+	// NPC weapons have no first person mesh, so only their third person mesh gets attached
+	if (USkeletalMeshComponent* WeaponFirstPersonMesh = Weapon->GetFirstPersonMesh())
+	{
+		WeaponFirstPersonMesh->AttachToComponent(GetFirstPersonMesh(), AttachmentRule, FirstPersonWeaponSocket);
+	}
+
+	if (USkeletalMeshComponent* WeaponThirdPersonMesh = Weapon->GetThirdPersonMesh())
+	{
+		WeaponThirdPersonMesh->AttachToComponent(GetMesh(), AttachmentRule, FirstPersonWeaponSocket);
+	}
 }
 
 void AShooterCharacter::PlayFiringMontage(UAnimMontage* Montage)
@@ -287,9 +300,16 @@ void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
 	// update the bullet counter
 	OnBulletCountUpdated.Broadcast(Weapon->GetMagazineSize(), Weapon->GetBulletCount());
 
-	// set the character mesh AnimInstances
-	GetFirstPersonMesh()->SetAnimInstanceClass(Weapon->GetFirstPersonAnimInstanceClass());
-	GetMesh()->SetAnimInstanceClass(Weapon->GetThirdPersonAnimInstanceClass());
+	// set the character mesh AnimInstances. Keep the current ones if the weapon doesn't provide them
+	if (const TSubclassOf<UAnimInstance>& FirstPersonAnimClass = Weapon->GetFirstPersonAnimInstanceClass())
+	{
+		GetFirstPersonMesh()->SetAnimInstanceClass(FirstPersonAnimClass);
+	}
+
+	if (const TSubclassOf<UAnimInstance>& ThirdPersonAnimClass = Weapon->GetThirdPersonAnimInstanceClass())
+	{
+		GetMesh()->SetAnimInstanceClass(ThirdPersonAnimClass);
+	}
 }
 
 void AShooterCharacter::OnWeaponDeactivated(AShooterWeapon* Weapon)
@@ -5,12 +5,14 @@
 #include "CoreMinimal.h"
 #include "MeritoBrainDamageCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "GenericTeamAgentInterface.h"
 #include "ShooterCharacter.generated.h"
 
 class AShooterWeapon;
 class UInputAction;
 class UInputComponent;
 class UPawnNoiseEmitterComponent;
+class UShooterHitboxComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBulletCountUpdatedDelegate, int32, MagazineSize, int32, Bullets);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent);
@@ -19,9 +21,10 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent
  *  A player controllable first person shooter character
  *  Manages a weapon inventory through the IShooterWeaponHolder interface
  *  Manages health and death
+ *  Belongs to a team through IGenericTeamAgentInterface
  */
 UCLASS(abstract)
-class MERITOBRAINDAMAGE_API AShooterCharacter : public AMeritoBrainDamageCharacter, public IShooterWeaponHolder
+class MERITOBRAINDAMAGE_API AShooterCharacter : public AMeritoBrainDamageCharacter, public IShooterWeaponHolder, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 	
@@ -29,6 +32,10 @@ class MERITOBRAINDAMAGE_API AShooterCharacter : public AMeritoBrainDamageCharact
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UPawnNoiseEmitterComponent* PawnNoiseEmitter;
 
+	/** Bone capsules used to find the body zone of hits */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterHitboxComponent* Hitboxes;
+
 protected:
 	/** Pause Input Action */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
@@ -179,6 +186,15 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	TArray<AShooterWeapon*> GetOwnedWeapons() const { return OwnedWeapons; }
 
+public:
+
+	//~Begin IGenericTeamAgentInterface interface
+
+	/** Returns the team this character belongs to, used by AI perception to filter by affiliation */
+	virtual FGenericTeamId GetGenericTeamId() const override { return FGenericTeamId(TeamByte); };
+
+	//~End IGenericTeamAgentInterface interface
+
 public:
 
 	//~Begin IShooterWeaponHolder interface
@@ -3,11 +3,20 @@
 #include "Variant_Shooter/ShooterGameMode.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
+#include "ShooterEncounter.h"
 
 void AShooterGameMode::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// start the map's encounter
+	if (Encounter)
+	{
+		if (UShooterEncounterSubsystem* Director = GetWorld()->GetSubsystem<UShooterEncounterSubsystem>())
+		{
+			Director->StartEncounter(Encounter);
+		}
+	}
 }
 
 void AShooterGameMode::IncrementTeamScore(uint8 TeamByte)
@@ -6,6 +6,8 @@
 #include "GameFramework/GameModeBase.h"
 #include "ShooterGameMode.generated.h"
 
+class UShooterEncounterData;
+
 /**
  * Simple GameMode for a first person shooter game
  * Keeps track of team scores
@@ -20,6 +22,10 @@ protected:
 	/** Map of scores by team ID */
 	TMap<uint8, int32> TeamScores;
 
+	/** Encounter the director runs when play begins, if any */
+	UPROPERTY(EditAnywhere, Category="Encounter")
+	TObjectPtr<UShooterEncounterData> Encounter;
+
 protected:
 
 	/** Gameplay initialization */
@@ -130,3 +130,9 @@ void AShooterPlayerController::OnPawnDamaged(float LifePercent)
 		BulletCounterUI->BP_Damaged(LifePercent);
 	}
 }
+
+FGenericTeamId AShooterPlayerController::GetGenericTeamId() const
+{
+	// the team belongs to the pawn, so it carries over across respawns
+	return FGenericTeamId::GetTeamIdentifier(GetPawn());
+}
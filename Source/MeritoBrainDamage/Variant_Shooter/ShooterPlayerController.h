@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "GenericTeamAgentInterface.h"
 #include "ShooterPlayerController.generated.h"
 
 class UInputMappingContext;
@@ -14,9 +15,10 @@ class UShooterHUD;
  *  Simple PlayerController for a first person shooter game
  *  Manages input mappings
  *  Respawns the player pawn when it's destroyed
+ *  Reports the possessed pawn's team through IGenericTeamAgentInterface
  */
 UCLASS(abstract)
-class MERITOBRAINDAMAGE_API AShooterPlayerController : public APlayerController
+class MERITOBRAINDAMAGE_API AShooterPlayerController : public APlayerController, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 	
@@ -74,4 +76,13 @@ protected:
 	/** Called when the possessed pawn is damaged */
 	UFUNCTION()
 	void OnPawnDamaged(float LifePercent);
+
+public:
+
+	//~Begin IGenericTeamAgentInterface interface
+
+	/** Returns the team of the possessed pawn */
+	virtual FGenericTeamId GetGenericTeamId() const override;
+
+	//~End IGenericTeamAgentInterface interface
 };
@@ -0,0 +1,139 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterRandom.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Crc.h"
+
+namespace ShooterRandom
+{
+	static TAutoConsoleVariable<int32> CVarForceSeed(
+		TEXT("Shooter.RNG.ForceSeed"),
+		0,
+		TEXT("If not zero, weapon and NPC random streams are seeded from this value and their owner's name instead of randomly, so every shot can be reproduced.\n")
+		TEXT("Applies to streams seeded after it's set, so set it before loading the map."),
+		ECVF_Default);
+
+	/** Advances a splitmix64 sequence. Used to spread a seed over the generator state */
+	static uint64 SplitMix(uint64& Value)
+	{
+		uint64 Result = (Value += 0x9E3779B97F4A7C15ull);
+		Result = (Result ^ (Result >> 30)) * 0xBF58476D1CE4E5B9ull;
+		Result = (Result ^ (Result >> 27)) * 0x94D049BB133111EBull;
+		return Result ^ (Result >> 31);
+	}
+}
+
+void FShooterRandomStream::Initialize(uint64 InSeed)
+{
+	InitialSeed = InSeed;
+
+	uint64 Mixer = InSeed;
+
+	const uint64 Low = ShooterRandom::SplitMix(Mixer);
+	const uint64 High = ShooterRandom::SplitMix(Mixer);
+
+	State[0] = static_cast<uint32>(Low);
+	State[1] = static_cast<uint32>(Low >> 32);
+	State[2] = static_cast<uint32>(High);
+	State[3] = static_cast<uint32>(High >> 32);
+
+	// an all zero state would only ever return zero
+	if ((State[0] | State[1] | State[2] | State[3]) == 0)
+	{
+		State[0] = 1;
+	}
+}
+
+FVector FShooterRandomStream::VRand()
+{
+	const float Z = 2.0f * GetFraction() - 1.0f;
+	const float Phi = UE_TWO_PI * GetFraction();
+	const float Radius = FMath::Sqrt(FMath::Max(0.0f, 1.0f - Z * Z));
+
+	float SinPhi, CosPhi;
+	FMath::SinCos(&SinPhi, &CosPhi, Phi);
+
+	return FVector(Radius * CosPhi, Radius * SinPhi, Z);
+}
+
+FVector FShooterRandomStream::VRandCone(const FVector& Direction, float HalfAngleRadians)
+{
+	const FVector Forward = Direction.GetSafeNormal();
+
+	FVector Right, Up;
+	Forward.FindBestAxisVectors(Right, Up);
+
+	// uniform over the cone's cap
+	const float CosTheta = 1.0f - GetFraction() * (1.0f - FMath::Cos(HalfAngleRadians));
+	const float SinTheta = FMath::Sqrt(FMath::Max(0.0f, 1.0f - CosTheta * CosTheta));
+	const float Phi = UE_TWO_PI * GetFraction();
+
+	float SinPhi, CosPhi;
+	FMath::SinCos(&SinPhi, &CosPhi, Phi);
+
+	return Forward * CosTheta + (Right * CosPhi + Up * SinPhi) * SinTheta;
+}
+
+void FShooterRandomStream::FillCone(const FVector& Direction, float HalfAngleRadians, TArrayView<FVector> OutDirections)
+{
+	const FVector3f Forward(Direction.GetSafeNormal());
+
+	FVector3f Right, Up;
+	Forward.FindBestAxisVectors(Right, Up);
+
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float OneMinusCosHalfAngle = VectorSetFloat1(1.0f - FMath::Cos(HalfAngleRadians));
+	const VectorRegister4Float TwoPi = VectorSetFloat1(UE_TWO_PI);
+
+	for (int32 First = 0; First < OutDirections.Num(); First += 4)
+	{
+		const int32 NumLanes = FMath::Min(4, OutDirections.Num() - First);
+
+		// draw in the same order as VRandCone so both produce the same sequence
+		alignas(16) float ThetaFractions[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		alignas(16) float PhiFractions[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			ThetaFractions[Lane] = GetFraction();
+			PhiFractions[Lane] = GetFraction();
+		}
+
+		const VectorRegister4Float CosTheta = VectorSubtract(One, VectorMultiply(VectorLoadAligned(ThetaFractions), OneMinusCosHalfAngle));
+		const VectorRegister4Float SinTheta = VectorSqrt(VectorMax(VectorZeroFloat(), VectorSubtract(One, VectorMultiply(CosTheta, CosTheta))));
+		const VectorRegister4Float Phi = VectorMultiply(VectorLoadAligned(PhiFractions), TwoPi);
+
+		VectorRegister4Float SinPhi, CosPhi;
+		VectorSinCos(&SinPhi, &CosPhi, &Phi);
+
+		// weights of the forward, right and up axes
+		const VectorRegister4Float RightWeight = VectorMultiply(CosPhi, SinTheta);
+		const VectorRegister4Float UpWeight = VectorMultiply(SinPhi, SinTheta);
+
+		alignas(16) float X[4], Y[4], Z[4];
+
+		VectorStoreAligned(VectorMultiplyAdd(VectorSetFloat1(Forward.X), CosTheta, VectorMultiplyAdd(VectorSetFloat1(Right.X), RightWeight, VectorMultiply(VectorSetFloat1(Up.X), UpWeight))), X);
+		VectorStoreAligned(VectorMultiplyAdd(VectorSetFloat1(Forward.Y), CosTheta, VectorMultiplyAdd(VectorSetFloat1(Right.Y), RightWeight, VectorMultiply(VectorSetFloat1(Up.Y), UpWeight))), Y);
+		VectorStoreAligned(VectorMultiplyAdd(VectorSetFloat1(Forward.Z), CosTheta, VectorMultiplyAdd(VectorSetFloat1(Right.Z), RightWeight, VectorMultiply(VectorSetFloat1(Up.Z), UpWeight))), Z);
+
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			OutDirections[First + Lane] = FVector(X[Lane], Y[Lane], Z[Lane]);
+		}
+	}
+}
+
+uint64 FShooterRandomStream::MakeSeed(const UObject* Owner)
+{
+	// the name keeps streams of different owners apart
+	const uint32 NameHash = Owner ? FCrc::StrCrc32(*Owner->GetName()) : 0;
+	const int32 ForcedSeed = ShooterRandom::CVarForceSeed.GetValueOnGameThread();
+
+	if (ForcedSeed != 0)
+	{
+		return (static_cast<uint64>(static_cast<uint32>(ForcedSeed)) << 32) | NameHash;
+	}
+
+	return (FPlatformTime::Cycles64() ^ (static_cast<uint64>(FMath::Rand()) << 32)) ^ NameHash;
+}
@@ -0,0 +1,89 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Small, fast random stream for weapon spread and aim variance, based on xoshiro128**
+ *  Each weapon and NPC owns one, so the shots it fires only depend on its own seed. Seeding every stream
+ *  through MakeSeed lets the Shooter.RNG.ForceSeed console variable reproduce every shot of a session
+ */
+struct MERITOBRAINDAMAGE_API FShooterRandomStream
+{
+private:
+
+	/** Generator state. Never all zero */
+	uint32 State[4];
+
+	/** Seed the stream was started from */
+	uint64 InitialSeed = 0;
+
+	/** Rotates the bits of a value left */
+	static FORCEINLINE uint32 RotateLeft(uint32 Value, int32 Shift)
+	{
+		return (Value << Shift) | (Value >> (32 - Shift));
+	}
+
+public:
+
+	/** Constructor. Starts from seed zero */
+	FShooterRandomStream()
+	{
+		Initialize(0);
+	}
+
+	/** Constructor. Starts from the given seed */
+	explicit FShooterRandomStream(uint64 InSeed)
+	{
+		Initialize(InSeed);
+	}
+
+	/** Restarts the stream from a seed */
+	void Initialize(uint64 InSeed);
+
+	/** Returns the seed the stream was started from */
+	uint64 GetInitialSeed() const { return InitialSeed; }
+
+	/** Returns the next 32 random bits */
+	FORCEINLINE uint32 GetUnsignedInt()
+	{
+		const uint32 Result = RotateLeft(State[1] * 5, 7) * 9;
+		const uint32 T = State[1] << 9;
+
+		State[2] ^= State[0];
+		State[3] ^= State[1];
+		State[1] ^= State[2];
+		State[0] ^= State[3];
+
+		State[2] ^= T;
+		State[3] = RotateLeft(State[3], 11);
+
+		return Result;
+	}
+
+	/** Returns a random float in the [0, 1) range */
+	FORCEINLINE float GetFraction()
+	{
+		// use the top 24 bits, which fit the float mantissa exactly
+		return (GetUnsignedInt() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/** Returns a random float in the [Min, Max) range */
+	FORCEINLINE float FRandRange(float Min, float Max)
+	{
+		return Min + (Max - Min) * GetFraction();
+	}
+
+	/** Returns a random unit vector */
+	FVector VRand();
+
+	/** Returns a random unit vector inside a cone, uniformly distributed over its cap */
+	FVector VRandCone(const FVector& Direction, float HalfAngleRadians);
+
+	/** Fills the output with random unit vectors inside a cone, four at a time. Draws the same numbers as calling VRandCone for each */
+	void FillCone(const FVector& Direction, float HalfAngleRadians, TArrayView<FVector> OutDirections);
+
+	/** Returns a seed for an object's stream. Random unless Shooter.RNG.ForceSeed is set, in which case it only depends on the forced seed and the object's name */
+	static uint64 MakeSeed(const UObject* Owner);
+};
@@ -0,0 +1,230 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterTickCensus.h"
+#include "ShooterCharacter.h"
+#include "ShooterGameMode.h"
+#include "ShooterPlayerController.h"
+#include "ShooterNPC.h"
+#include "ShooterAIController.h"
+#include "ShooterWeapon.h"
+#include "ShooterPickup.h"
+#include "ShooterProjectile.h"
+#include "Components/ActorComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/UObjectIterator.h"
+#include "MeritoBrainDamage.h"
+
+namespace ShooterTickCensus
+{
+	/** Call count and time for one class */
+	struct FTickRecord
+	{
+		int64 Calls = 0;
+		uint64 Cycles = 0;
+	};
+
+	/** Instrumented ticks recorded since the last reset */
+	static TMap<FName, FTickRecord> Records;
+
+	/** Registered tick functions found on a class's instances */
+	struct FClassCensus
+	{
+		int32 Actors = 0;
+		int32 TickingActors = 0;
+		TMap<FName, int32> TickingComponents;
+	};
+
+	/** Returns true if the class belongs to the shooter variant */
+	static bool IsShooterClass(const UClass* Class)
+	{
+		return Class->IsChildOf<AShooterCharacter>()
+			|| Class->IsChildOf<AShooterNPC>()
+			|| Class->IsChildOf<AShooterAIController>()
+			|| Class->IsChildOf<AShooterPlayerController>()
+			|| Class->IsChildOf<AShooterGameMode>()
+			|| Class->IsChildOf<AShooterWeapon>()
+			|| Class->IsChildOf<AShooterPickup>()
+			|| Class->IsChildOf<AShooterProjectile>();
+	}
+
+	/** Returns true if instances of this class are expected to never have their actor tick enabled */
+	static bool ShouldBeTickFree(const AActor* Actor)
+	{
+		// projectiles only tick while they're still growing
+		if (const AShooterProjectile* Projectile = Cast<AShooterProjectile>(Actor))
+		{
+			return !Projectile->IsGrowing();
+		}
+
+		return Actor->IsA<AShooterCharacter>()
+			|| Actor->IsA<AShooterNPC>()
+			|| Actor->IsA<AShooterWeapon>()
+			|| Actor->IsA<AShooterPickup>();
+	}
+
+	/** Returns true if the tick function is registered and enabled */
+	static bool IsTicking(const FTickFunction& TickFunction)
+	{
+		return TickFunction.IsTickFunctionRegistered() && TickFunction.IsTickFunctionEnabled();
+	}
+
+	static void Census(const TArray<FString>& Args, UWorld* World)
+	{
+		const bool bAllClasses = Args.Contains(TEXT("all"));
+
+		TMap<FName, FClassCensus> Classes;
+		int32 TotalActorTicks = 0, TotalComponentTicks = 0;
+
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			AActor* Actor = *It;
+
+			if (!bAllClasses && !IsShooterClass(Actor->GetClass()))
+			{
+				continue;
+			}
+
+			FClassCensus& ClassCensus = Classes.FindOrAdd(Actor->GetClass()->GetFName());
+			++ClassCensus.Actors;
+
+			if (IsTicking(Actor->PrimaryActorTick))
+			{
+				++ClassCensus.TickingActors;
+				++TotalActorTicks;
+			}
+
+			for (const UActorComponent* Component : Actor->GetComponents())
+			{
+				if (IsTicking(Component->PrimaryComponentTick))
+				{
+					++ClassCensus.TickingComponents.FindOrAdd(Component->GetClass()->GetFName());
+					++TotalComponentTicks;
+				}
+			}
+		}
+
+		UE_LOG(LogMeritoBrainDamage, Display, TEXT("Tick census: %d actor ticks and %d component ticks registered across %d classes"), TotalActorTicks, TotalComponentTicks, Classes.Num());
+
+		for (const TPair<FName, FClassCensus>& Pair : Classes)
+		{
+			const FTickRecord* Record = Records.Find(Pair.Key);
+
+			UE_LOG(LogMeritoBrainDamage, Display, TEXT("  %s: %d actors, %d ticking, %lld native ticks, %.3f ms"),
+				*Pair.Key.ToString(), Pair.Value.Actors, Pair.Value.TickingActors,
+				Record ? Record->Calls : 0ll, Record ? FPlatformTime::ToMilliseconds64(Record->Cycles) : 0.0);
+
+			for (const TPair<FName, int32>& Component : Pair.Value.TickingComponents)
+			{
+				UE_LOG(LogMeritoBrainDamage, Display, TEXT("      %s: %d ticking"), *Component.Key.ToString(), Component.Value);
+			}
+		}
+	}
+
+	static void Verify(UWorld* World)
+	{
+		int32 NumOffenders = 0;
+
+		for (TActorIterator<AActor> It(World); It; ++It)
+		{
+			if (ShouldBeTickFree(*It) && IsTicking(It->PrimaryActorTick))
+			{
+				UE_LOG(LogMeritoBrainDamage, Error, TEXT("Tick census: %s (%s) is ticking but should be event driven"), *It->GetName(), *It->GetClass()->GetName());
+				++NumOffenders;
+			}
+		}
+
+		if (NumOffenders == 0)
+		{
+			UE_LOG(LogMeritoBrainDamage, Display, TEXT("Tick census: all event driven shooter actors are tick free"));
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs CensusCommand(
+		TEXT("Shooter.TickCensus"),
+		TEXT("Logs registered tick functions for shooter classes, with native tick counts and time since the last reset. Pass 'all' to include every class"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&Census));
+
+	static FAutoConsoleCommand ResetCommand(
+		TEXT("Shooter.TickCensus.Reset"),
+		TEXT("Clears the recorded native tick counts and times"),
+		FConsoleCommandDelegate::CreateStatic(&FShooterTickCensus::Reset));
+
+	static FAutoConsoleCommandWithWorld VerifyCommand(
+		TEXT("Shooter.TickCensus.Verify"),
+		TEXT("Logs an error for every shooter actor that should be event driven but has its actor tick enabled"),
+		FConsoleCommandWithWorldDelegate::CreateStatic(&Verify));
+}
+
+void FShooterTickCensus::RecordTick(const UClass* TickingClass, uint64 Cycles)
+{
+	check(IsInGameThread());
+
+	ShooterTickCensus::FTickRecord& Record = ShooterTickCensus::Records.FindOrAdd(TickingClass->GetFName());
+	++Record.Calls;
+	Record.Cycles += Cycles;
+}
+
+void FShooterTickCensus::Reset()
+{
+	ShooterTickCensus::Records.Reset();
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShooterTickFreeClassesTest, "MeritoBrainDamage.Shooter.TickCensus.TickFreeClasses", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FShooterTickFreeClassesTest::RunTest(const FString& Parameters)
+{
+	int32 NumChecked = 0;
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		const UClass* Class = *It;
+
+		// skip classes replaced by a recompile and Blueprint skeletons
+		if (Class->HasAnyClassFlags(CLASS_NewerVersionExists) || Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		const AActor* DefaultActor = Cast<AActor>(Class->GetDefaultObject(false));
+
+		if (!DefaultActor)
+		{
+			continue;
+		}
+
+		// projectiles may tick while growing, but only once BeginPlay finds they need to
+		if (DefaultActor->IsA<AShooterProjectile>())
+		{
+			TestFalse(FString::Printf(TEXT("%s starts with its actor tick enabled"), *Class->GetName()), DefaultActor->PrimaryActorTick.bStartWithTickEnabled);
+			++NumChecked;
+			continue;
+		}
+
+		if (!ShooterTickCensus::ShouldBeTickFree(DefaultActor))
+		{
+			continue;
+		}
+
+		// Blueprint subclasses implementing Event Tick opt back into ticking
+		if (!Class->HasAnyClassFlags(CLASS_Native) && Class->IsFunctionImplementedInScript(FName(TEXT("ReceiveTick"))))
+		{
+			continue;
+		}
+
+		TestFalse(FString::Printf(TEXT("%s can tick but should be event driven"), *Class->GetName()), DefaultActor->PrimaryActorTick.bCanEverTick);
+		++NumChecked;
+	}
+
+	// the native character, NPC, weapon, pickup and projectile classes are always loaded
+	TestTrue(TEXT("All native shooter classes were checked"), NumChecked >= 5);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
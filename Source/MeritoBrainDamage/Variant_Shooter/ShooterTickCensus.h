@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ *  Collects tick call counts and cumulative tick time for shooter gameplay classes
+ *  Native Tick overrides report themselves through SHOOTER_TICK_CENSUS_SCOPE
+ *  Registered tick functions are inspected on demand through the Shooter.TickCensus console commands
+ */
+class MERITOBRAINDAMAGE_API FShooterTickCensus
+{
+public:
+
+	/** Records a tick of the given class. Game thread only */
+	static void RecordTick(const UClass* TickingClass, uint64 Cycles);
+
+	/** Clears all recorded tick counts and times */
+	static void Reset();
+};
+
+/**
+ *  Times the enclosing scope and records it as one tick of the given class
+ */
+class FShooterTickCensusScope
+{
+	const UClass* TickingClass;
+	uint64 StartCycles;
+
+public:
+
+	explicit FShooterTickCensusScope(const UClass* InTickingClass)
+		: TickingClass(InTickingClass)
+		, StartCycles(FPlatformTime::Cycles64())
+	{
+	}
+
+	~FShooterTickCensusScope()
+	{
+		FShooterTickCensus::RecordTick(TickingClass, FPlatformTime::Cycles64() - StartCycles);
+	}
+};
+
+/** Records the enclosing Tick override in the tick census */
+#define SHOOTER_TICK_CENSUS_SCOPE() FShooterTickCensusScope ShooterTickCensusScope(GetClass())
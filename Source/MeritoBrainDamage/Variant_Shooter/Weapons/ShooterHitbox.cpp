@@ -0,0 +1,283 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterHitbox.h"
+#include "GameFramework/Character.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkinnedAsset.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitbox Trace"), STAT_ShooterHitboxTrace, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hitbox Traces"), STAT_ShooterHitboxTraces, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hitbox Misses"), STAT_ShooterHitboxMisses, STATGROUP_Shooter);
+
+namespace ShooterHitbox
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.Damage.Hitboxes"),
+		true,
+		TEXT("If true, hits on characters are refined against their hitbox capsules to apply zone damage multipliers."),
+		ECVF_Default);
+
+	/** Keeps the capsule math away from divisions by zero */
+	static constexpr float Epsilon = 1.e-6f;
+
+	/** Adds a capsule definition */
+	static void AddHitbox(TArray<FShooterHitboxDefinition>& Hitboxes, FName StartBone, FName EndBone, float Radius, EShooterHitZone Zone, float DamageMultiplier)
+	{
+		FShooterHitboxDefinition& Hitbox = Hitboxes.AddDefaulted_GetRef();
+		Hitbox.StartBone = StartBone;
+		Hitbox.EndBone = EndBone;
+		Hitbox.Radius = Radius;
+		Hitbox.Zone = Zone;
+		Hitbox.DamageMultiplier = DamageMultiplier;
+	}
+
+	/** Returns the dot products of four pairs of vectors */
+	FORCEINLINE VectorRegister4Float Dot(const VectorRegister4Float& AX, const VectorRegister4Float& AY, const VectorRegister4Float& AZ, const VectorRegister4Float& BX, const VectorRegister4Float& BY, const VectorRegister4Float& BZ)
+	{
+		return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+	}
+
+	/** Clamps four values to the 0 to 1 range */
+	FORCEINLINE VectorRegister4Float Saturate(const VectorRegister4Float& Value)
+	{
+		return VectorMin(VectorMax(Value, VectorZeroFloat()), VectorOneFloat());
+	}
+}
+
+UShooterHitboxComponent::UShooterHitboxComponent()
+{
+	// capsules are updated on demand when hit
+	PrimaryComponentTick.bCanEverTick = false;
+
+	// default to eight capsules for the mannequin skeleton
+	ShooterHitbox::AddHitbox(Hitboxes, FName("neck_01"), FName("head"), 14.0f, EShooterHitZone::Head, 2.0f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("pelvis"), FName("spine_05"), 22.0f, EShooterHitZone::Torso, 1.0f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("upperarm_l"), FName("hand_l"), 7.0f, EShooterHitZone::Arm, 0.75f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("upperarm_r"), FName("hand_r"), 7.0f, EShooterHitZone::Arm, 0.75f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("thigh_l"), FName("calf_l"), 10.0f, EShooterHitZone::Leg, 0.75f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("thigh_r"), FName("calf_r"), 10.0f, EShooterHitZone::Leg, 0.75f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("calf_l"), FName("foot_l"), 7.0f, EShooterHitZone::Leg, 0.75f);
+	ShooterHitbox::AddHitbox(Hitboxes, FName("calf_r"), FName("foot_r"), 7.0f, EShooterHitZone::Leg, 0.75f);
+}
+
+bool UShooterHitboxComponent::ResolveBones(const USkeletalMeshComponent* Mesh)
+{
+	const USkinnedAsset* Asset = Mesh ? Mesh->GetSkinnedAsset() : nullptr;
+
+	if (!Asset)
+	{
+		return false;
+	}
+
+	// skip if the mesh hasn't changed
+	if (ResolvedAsset.Get() == Asset)
+	{
+		return true;
+	}
+
+	ResolvedAsset = Asset;
+
+	// pad the arrays to whole vector lanes
+	const int32 NumLanes = Align(Hitboxes.Num(), 4);
+
+	for (TArray<float>* Array : { &StartX, &StartY, &StartZ, &EndX, &EndY, &EndZ })
+	{
+		Array->SetNumZeroed(NumLanes);
+	}
+
+	RadiusSquared.Init(-1.0f, NumLanes);
+	StartBoneIndices.Init(INDEX_NONE, Hitboxes.Num());
+	EndBoneIndices.Init(INDEX_NONE, Hitboxes.Num());
+
+	for (int32 i = 0; i < Hitboxes.Num(); ++i)
+	{
+		StartBoneIndices[i] = Mesh->GetBoneIndex(Hitboxes[i].StartBone);
+		EndBoneIndices[i] = Hitboxes[i].EndBone.IsNone() ? StartBoneIndices[i] : Mesh->GetBoneIndex(Hitboxes[i].EndBone);
+
+		// capsules with missing bones stay disabled
+		if (StartBoneIndices[i] != INDEX_NONE && EndBoneIndices[i] != INDEX_NONE)
+		{
+			RadiusSquared[i] = FMath::Square(Hitboxes[i].Radius);
+
+		} else {
+
+			UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("%s: hitbox %d bones not found on %s"), *GetNameSafe(GetOwner()), i, *Asset->GetName());
+		}
+	}
+
+	return true;
+}
+
+void UShooterHitboxComponent::UpdateHitboxes()
+{
+	// only copy the bones once per frame, however many shots land
+	if (UpdatedFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	const USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+
+	if (!ResolveBones(Mesh))
+	{
+		return;
+	}
+
+	UpdatedFrame = GFrameCounter;
+
+	for (int32 i = 0; i < Hitboxes.Num(); ++i)
+	{
+		if (RadiusSquared[i] < 0.0f)
+		{
+			continue;
+		}
+
+		const FVector Start = Mesh->GetBoneTransform(StartBoneIndices[i]).GetLocation();
+		const FVector End = EndBoneIndices[i] == StartBoneIndices[i] ? Start : Mesh->GetBoneTransform(EndBoneIndices[i]).GetLocation();
+
+		StartX[i] = Start.X;
+		StartY[i] = Start.Y;
+		StartZ[i] = Start.Z;
+
+		EndX[i] = End.X;
+		EndY[i] = End.Y;
+		EndZ[i] = End.Z;
+	}
+}
+
+bool UShooterHitboxComponent::TraceHitboxes(const FVector& Start, const FVector& End, FShooterHitboxHit& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterHitboxTrace);
+	INC_DWORD_STAT(STAT_ShooterHitboxTraces);
+
+	UpdateHitboxes();
+
+	if (UpdatedFrame != GFrameCounter)
+	{
+		return false;
+	}
+
+	// shot segment, broadcast to every lane
+	const FVector3f Direction(End - Start);
+
+	const VectorRegister4Float D1X = VectorSetFloat1(Direction.X);
+	const VectorRegister4Float D1Y = VectorSetFloat1(Direction.Y);
+	const VectorRegister4Float D1Z = VectorSetFloat1(Direction.Z);
+
+	const VectorRegister4Float P0X = VectorSetFloat1(static_cast<float>(Start.X));
+	const VectorRegister4Float P0Y = VectorSetFloat1(static_cast<float>(Start.Y));
+	const VectorRegister4Float P0Z = VectorSetFloat1(static_cast<float>(Start.Z));
+
+	const VectorRegister4Float A = VectorSetFloat1(FMath::Max(Direction.SizeSquared(), ShooterHitbox::Epsilon));
+	const VectorRegister4Float Epsilon = VectorSetFloat1(ShooterHitbox::Epsilon);
+
+	int32 BestIndex = INDEX_NONE;
+	float BestTime = 2.0f;
+
+	for (int32 i = 0; i < RadiusSquared.Num(); i += 4)
+	{
+		// capsule axes and the offset from their start to the shot start
+		const VectorRegister4Float Q0X = VectorLoad(&StartX[i]);
+		const VectorRegister4Float Q0Y = VectorLoad(&StartY[i]);
+		const VectorRegister4Float Q0Z = VectorLoad(&StartZ[i]);
+
+		const VectorRegister4Float D2X = VectorSubtract(VectorLoad(&EndX[i]), Q0X);
+		const VectorRegister4Float D2Y = VectorSubtract(VectorLoad(&EndY[i]), Q0Y);
+		const VectorRegister4Float D2Z = VectorSubtract(VectorLoad(&EndZ[i]), Q0Z);
+
+		const VectorRegister4Float RX = VectorSubtract(P0X, Q0X);
+		const VectorRegister4Float RY = VectorSubtract(P0Y, Q0Y);
+		const VectorRegister4Float RZ = VectorSubtract(P0Z, Q0Z);
+
+		const VectorRegister4Float B = ShooterHitbox::Dot(D1X, D1Y, D1Z, D2X, D2Y, D2Z);
+		const VectorRegister4Float C = ShooterHitbox::Dot(D1X, D1Y, D1Z, RX, RY, RZ);
+		const VectorRegister4Float E = VectorMax(ShooterHitbox::Dot(D2X, D2Y, D2Z, D2X, D2Y, D2Z), Epsilon);
+		const VectorRegister4Float F = ShooterHitbox::Dot(D2X, D2Y, D2Z, RX, RY, RZ);
+
+		// closest points between the shot (S) and the capsule axis (T), clamped to both segments
+		const VectorRegister4Float Denominator = VectorMax(VectorSubtract(VectorMultiply(A, E), VectorMultiply(B, B)), Epsilon);
+
+		VectorRegister4Float S = ShooterHitbox::Saturate(VectorDivide(VectorSubtract(VectorMultiply(B, F), VectorMultiply(C, E)), Denominator));
+		const VectorRegister4Float T = ShooterHitbox::Saturate(VectorDivide(VectorMultiplyAdd(B, S, F), E));
+		S = ShooterHitbox::Saturate(VectorDivide(VectorSubtract(VectorMultiply(B, T), C), A));
+
+		// squared distance between the closest points
+		const VectorRegister4Float DX = VectorSubtract(VectorMultiplyAdd(D1X, S, RX), VectorMultiply(D2X, T));
+		const VectorRegister4Float DY = VectorSubtract(VectorMultiplyAdd(D1Y, S, RY), VectorMultiply(D2Y, T));
+		const VectorRegister4Float DZ = VectorSubtract(VectorMultiplyAdd(D1Z, S, RZ), VectorMultiply(D2Z, T));
+
+		const int32 HitMask = VectorMaskBits(VectorCompareLE(ShooterHitbox::Dot(DX, DY, DZ, DX, DY, DZ), VectorLoad(&RadiusSquared[i])));
+
+		if (HitMask == 0)
+		{
+			continue;
+		}
+
+		// keep the capsule the shot reaches first
+		alignas(16) float Times[4];
+		VectorStoreAligned(S, Times);
+
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			if ((HitMask & (1 << Lane)) && Times[Lane] < BestTime)
+			{
+				BestTime = Times[Lane];
+				BestIndex = i + Lane;
+			}
+		}
+	}
+
+	if (BestIndex == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_ShooterHitboxMisses);
+		return false;
+	}
+
+	OutHit.Zone = Hitboxes[BestIndex].Zone;
+	OutHit.DamageMultiplier = Hitboxes[BestIndex].DamageMultiplier;
+	OutHit.Time = BestTime;
+
+	return true;
+}
+
+float UShooterHitboxComponent::GetDamageMultiplier(const AActor* HitActor, const FVector& HitLocation, const FVector& ShotDirection, EShooterHitZone* OutZone)
+{
+	if (OutZone)
+	{
+		*OutZone = EShooterHitZone::None;
+	}
+
+	UShooterHitboxComponent* HitboxComponent = HitActor && ShooterHitbox::CVarEnable.GetValueOnGameThread() ? HitActor->FindComponentByClass<UShooterHitboxComponent>() : nullptr;
+
+	if (!HitboxComponent || HitboxComponent->GetNumHitboxes() == 0)
+	{
+		return 1.0f;
+	}
+
+	// the shot hit the outer collision, so follow it through the whole character.
+	// Start a little outside to catch limbs that stick out of the collision capsule
+	float Radius, HalfHeight;
+	HitActor->GetSimpleCollisionCylinder(Radius, HalfHeight);
+
+	const FVector Direction = ShotDirection.GetSafeNormal();
+	const FVector Start = HitLocation - Direction * Radius;
+	const FVector End = HitLocation + Direction * 2.0f * FMath::Max(Radius, HalfHeight);
+
+	FShooterHitboxHit Hit;
+
+	if (!HitboxComponent->TraceHitboxes(Start, End, Hit))
+	{
+		return HitboxComponent->MissDamageMultiplier;
+	}
+
+	if (OutZone)
+	{
+		*OutZone = Hit.Zone;
+	}
+
+	return Hit.DamageMultiplier;
+}
@@ -0,0 +1,135 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterHitbox.generated.h"
+
+class USkeletalMeshComponent;
+class USkinnedAsset;
+
+/**
+ *  Body zone a hitbox belongs to
+ */
+UENUM(BlueprintType)
+enum class EShooterHitZone : uint8
+{
+	None,
+	Head,
+	Torso,
+	Arm,
+	Leg
+};
+
+/**
+ *  Capsule following one or two bones of the character mesh
+ */
+USTRUCT(BlueprintType)
+struct FShooterHitboxDefinition
+{
+	GENERATED_BODY()
+
+	/** Bone at the start of the capsule */
+	UPROPERTY(EditAnywhere, Category="Hitbox")
+	FName StartBone;
+
+	/** Bone at the end of the capsule. Makes a sphere around the start bone if not set */
+	UPROPERTY(EditAnywhere, Category="Hitbox")
+	FName EndBone;
+
+	/** Radius of the capsule */
+	UPROPERTY(EditAnywhere, Category="Hitbox", meta = (ClampMin = 1, Units = "cm"))
+	float Radius = 10.0f;
+
+	/** Body zone of the capsule */
+	UPROPERTY(EditAnywhere, Category="Hitbox")
+	EShooterHitZone Zone = EShooterHitZone::Torso;
+
+	/** Damage multiplier for hits on this capsule */
+	UPROPERTY(EditAnywhere, Category="Hitbox", meta = (ClampMin = 0))
+	float DamageMultiplier = 1.0f;
+};
+
+/**
+ *  Hitbox a shot went through
+ */
+struct FShooterHitboxHit
+{
+	/** Body zone that was hit */
+	EShooterHitZone Zone = EShooterHitZone::None;
+
+	/** Damage multiplier of the zone */
+	float DamageMultiplier = 1.0f;
+
+	/** Distance along the shot to the hitbox, from 0 at the start to 1 at the end */
+	float Time = 1.0f;
+};
+
+/**
+ *  Small set of capsules following the bones of a character mesh
+ *  Shots that hit the character's collision are refined against the capsules to find the body zone and its damage
+ *  multiplier, without tracing against the physics asset. The capsules are stored as separate coordinate arrays so
+ *  the shot can be tested against four of them at a time, and are only updated from the bones the first time
+ *  they're hit in a frame
+ */
+UCLASS(ClassGroup=(Shooter), meta=(BlueprintSpawnableComponent))
+class MERITOBRAINDAMAGE_API UShooterHitboxComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+	/** Capsule segment start points */
+	TArray<float> StartX;
+	TArray<float> StartY;
+	TArray<float> StartZ;
+
+	/** Capsule segment end points */
+	TArray<float> EndX;
+	TArray<float> EndY;
+	TArray<float> EndZ;
+
+	/** Squared capsule radii. Padding lanes are negative so they never hit */
+	TArray<float> RadiusSquared;
+
+	/** Bone indices for each capsule's start and end */
+	TArray<int32> StartBoneIndices;
+	TArray<int32> EndBoneIndices;
+
+	/** Mesh asset the bone indices were resolved for */
+	TWeakObjectPtr<const USkinnedAsset> ResolvedAsset;
+
+	/** Frame the capsules were last updated on */
+	uint64 UpdatedFrame = MAX_uint64;
+
+protected:
+
+	/** Capsules, defaulting to eight for the mannequin skeleton */
+	UPROPERTY(EditAnywhere, Category="Hitbox")
+	TArray<FShooterHitboxDefinition> Hitboxes;
+
+	/** Damage multiplier for shots that hit the character's collision but miss every capsule */
+	UPROPERTY(EditAnywhere, Category="Hitbox", meta = (ClampMin = 0))
+	float MissDamageMultiplier = 1.0f;
+
+public:
+
+	/** Constructor */
+	UShooterHitboxComponent();
+
+	/** Tests a shot segment against the capsules. Returns true and the nearest capsule hit, if any */
+	bool TraceHitboxes(const FVector& Start, const FVector& End, FShooterHitboxHit& OutHit);
+
+	/** Returns the damage multiplier for a shot that hit an actor's collision at a location, or 1 if the actor has no hitboxes */
+	static float GetDamageMultiplier(const AActor* HitActor, const FVector& HitLocation, const FVector& ShotDirection, EShooterHitZone* OutZone = nullptr);
+
+	/** Returns the number of capsules */
+	int32 GetNumHitboxes() const { return Hitboxes.Num(); }
+
+protected:
+
+	/** Copies the capsules out of the bone transforms, once per frame */
+	void UpdateHitboxes();
+
+	/** Looks up the bone indices for the capsules. Returns false if the owner has no usable mesh */
+	bool ResolveBones(const USkeletalMeshComponent* Mesh);
+};
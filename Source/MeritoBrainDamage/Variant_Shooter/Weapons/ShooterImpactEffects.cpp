@@ -0,0 +1,288 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterImpactEffects.h"
+#include "NiagaraFunctionLibrary.h"
+#include "NiagaraComponentPool.h"
+#include "Components/DecalComponent.h"
+#include "Components/AudioComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "GameFramework/PlayerController.h"
+#include "Sound/SoundBase.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Impact Effects"), STAT_ShooterImpactEffects, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impacts Queued"), STAT_ShooterImpactsQueued, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impacts Spawned"), STAT_ShooterImpactsSpawned, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impacts Culled"), STAT_ShooterImpactsCulled, STATGROUP_Shooter);
+
+namespace ShooterImpactEffects
+{
+	static TAutoConsoleVariable<bool> CVarEnable(
+		TEXT("Shooter.FX.ImpactEffects"),
+		true,
+		TEXT("If true, projectile and hitscan impacts spawn their native impact effects."),
+		ECVF_Default);
+
+	/** Returns the physical material of a hit, falling back to the simple physical material of the hit body when the query didn't return one */
+	static const UPhysicalMaterial* GetSurface(const FHitResult& Hit)
+	{
+		if (const UPhysicalMaterial* Surface = Hit.PhysMaterial.Get())
+		{
+			return Surface;
+		}
+
+		// the element index is a collision shape index, not a material slot, so don't look up the component materials with it
+		const UPrimitiveComponent* Component = Hit.GetComponent();
+		const FBodyInstance* Body = Component ? Component->GetBodyInstance(Hit.BoneName) : nullptr;
+
+		return Body ? Body->GetSimplePhysicalMaterial() : nullptr;
+	}
+}
+
+const FShooterImpactEffect& UShooterImpactEffectData::FindEffect(const UPhysicalMaterial* Surface) const
+{
+	const FShooterImpactEffect* Effect = Surface ? SurfaceEffects.Find(Surface) : nullptr;
+	return Effect ? *Effect : DefaultEffect;
+}
+
+bool UShooterImpactEffectSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UShooterImpactEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterImpactEffectSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterImpactEffectSubsystem::Deinitialize()
+{
+	Queue.Reset();
+	Decals.Reset();
+	AudioComponents.Reset();
+	ProxyActor = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UShooterImpactEffectSubsystem::AddImpact(const UShooterImpactEffectData* Effects, const FHitResult& Hit)
+{
+	if (!Effects || !ShooterImpactEffects::CVarEnable.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	FShooterImpactRecord& Impact = Queue.AddDefaulted_GetRef();
+	Impact.Location = Hit.ImpactPoint;
+	Impact.Normal = Hit.ImpactNormal;
+	Impact.Surface = ShooterImpactEffects::GetSurface(Hit);
+	Impact.Effects = Effects;
+	Impact.Time = GetWorld()->GetTimeSeconds();
+
+	INC_DWORD_STAT(STAT_ShooterImpactsQueued);
+}
+
+void UShooterImpactEffectSubsystem::QueueImpact(const UObject* WorldContextObject, const UShooterImpactEffectData* Effects, const FHitResult& Hit)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+
+	if (UShooterImpactEffectSubsystem* ImpactEffects = World ? World->GetSubsystem<UShooterImpactEffectSubsystem>() : nullptr)
+	{
+		ImpactEffects->AddImpact(Effects, Hit);
+	}
+}
+
+void UShooterImpactEffectSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterImpactEffects);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// hide expired decals
+	for (FShooterPooledDecal& Decal : Decals)
+	{
+		if (Decal.ExpireTime > 0.0 && Decal.ExpireTime <= Now)
+		{
+			Decal.ExpireTime = 0.0;
+			Decal.Component->SetVisibility(false);
+		}
+	}
+
+	if (Queue.Num() == 0)
+	{
+		return;
+	}
+
+	// gather the player views
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	const float CullDistanceSquared = FMath::Square(CullDistance);
+
+	int32 NumSpawned = 0;
+	int32 NumProcessed = 0;
+
+	// oldest first, dropping the ones nobody would see
+	for (; NumProcessed < Queue.Num() && NumSpawned < MaxImpactsPerFrame; ++NumProcessed)
+	{
+		const FShooterImpactRecord& Impact = Queue[NumProcessed];
+
+		const bool bVisible = Now - Impact.Time <= MaxImpactAge && ViewLocations.ContainsByPredicate([&Impact, CullDistanceSquared](const FVector& ViewLocation)
+		{
+			return FVector::DistSquared(ViewLocation, Impact.Location) <= CullDistanceSquared;
+		});
+
+		if (!bVisible)
+		{
+			INC_DWORD_STAT(STAT_ShooterImpactsCulled);
+			continue;
+		}
+
+		SpawnEffect(Impact);
+		++NumSpawned;
+	}
+
+	Queue.RemoveAt(0, NumProcessed, EAllowShrinking::No);
+
+	INC_DWORD_STAT_BY(STAT_ShooterImpactsSpawned, NumSpawned);
+}
+
+void UShooterImpactEffectSubsystem::SpawnEffect(const FShooterImpactRecord& Impact)
+{
+	const UShooterImpactEffectData* Effects = Impact.Effects.Get();
+
+	if (!Effects)
+	{
+		return;
+	}
+
+	const FShooterImpactEffect& Effect = Effects->FindEffect(Impact.Surface.Get());
+
+	// the Niagara component pool hands the component back once the system finishes
+	if (Effect.Particles)
+	{
+		UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), Effect.Particles, Impact.Location, Impact.Normal.Rotation(), FVector::OneVector, true, true, ENCPoolMethod::AutoRelease);
+	}
+
+	if (Effect.Sound)
+	{
+		PlaySound(Effect.Sound, Impact.Location);
+	}
+
+	if (Effect.DecalMaterial)
+	{
+		PlaceDecal(Effect, Impact);
+	}
+}
+
+void UShooterImpactEffectSubsystem::PlaceDecal(const FShooterImpactEffect& Effect, const FShooterImpactRecord& Impact)
+{
+	// fill the pool up to its size, then reuse the oldest decal
+	if (Decals.Num() < DecalPoolSize)
+	{
+		AActor* Owner = GetProxyActor();
+
+		if (!Owner)
+		{
+			return;
+		}
+
+		UDecalComponent* Component = NewObject<UDecalComponent>(Owner);
+		Component->SetUsingAbsoluteLocation(true);
+		Component->SetUsingAbsoluteRotation(true);
+		Component->SetupAttachment(Owner->GetRootComponent());
+		Component->RegisterComponent();
+
+		FShooterPooledDecal& Decal = Decals.AddDefaulted_GetRef();
+		Decal.Component = Component;
+
+		NextDecal = Decals.Num() - 1;
+	}
+
+	FShooterPooledDecal& Decal = Decals[NextDecal];
+	NextDecal = (NextDecal + 1) % FMath::Max(DecalPoolSize, 1);
+
+	// project into the surface, with a random roll so repeated hits don't look stamped
+	FRotator Rotation = (-Impact.Normal).Rotation();
+	Rotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
+
+	Decal.Component->SetDecalMaterial(Effect.DecalMaterial);
+	Decal.Component->DecalSize = Effect.DecalSize;
+	Decal.Component->SetWorldLocationAndRotation(Impact.Location, Rotation);
+	Decal.Component->SetVisibility(true);
+	Decal.Component->MarkRenderStateDirty();
+
+	Decal.ExpireTime = Impact.Time + Effect.DecalLifetime;
+}
+
+void UShooterImpactEffectSubsystem::PlaySound(USoundBase* Sound, const FVector& Location)
+{
+	UAudioComponent* FreeComponent = nullptr;
+
+	for (UAudioComponent* Component : AudioComponents)
+	{
+		if (!Component->IsPlaying())
+		{
+			FreeComponent = Component;
+			break;
+		}
+	}
+
+	// add to the pool until it's full, then skip sounds while every component is busy
+	if (!FreeComponent && AudioComponents.Num() < AudioPoolSize)
+	{
+		if (AActor* Owner = GetProxyActor())
+		{
+			FreeComponent = NewObject<UAudioComponent>(Owner);
+			FreeComponent->bAutoActivate = false;
+			FreeComponent->bAutoDestroy = false;
+			FreeComponent->SetUsingAbsoluteLocation(true);
+			FreeComponent->SetupAttachment(Owner->GetRootComponent());
+			FreeComponent->RegisterComponent();
+
+			AudioComponents.Add(FreeComponent);
+		}
+	}
+
+	if (FreeComponent)
+	{
+		FreeComponent->SetWorldLocation(Location);
+		FreeComponent->SetSound(Sound);
+		FreeComponent->Play();
+	}
+}
+
+AActor* UShooterImpactEffectSubsystem::GetProxyActor()
+{
+	if (!ProxyActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		ProxyActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+
+		if (ProxyActor)
+		{
+			USceneComponent* Root = NewObject<USceneComponent>(ProxyActor);
+			ProxyActor->SetRootComponent(Root);
+			Root->RegisterComponent();
+		}
+	}
+
+	return ProxyActor;
+}
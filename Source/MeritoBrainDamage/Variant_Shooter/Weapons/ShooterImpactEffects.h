@@ -0,0 +1,190 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterImpactEffects.generated.h"
+
+class UNiagaraSystem;
+class USoundBase;
+class UMaterialInterface;
+class UPhysicalMaterial;
+class UDecalComponent;
+class UAudioComponent;
+
+/**
+ *  Particles, sound and decal played where a shot hits one kind of surface
+ */
+USTRUCT(BlueprintType)
+struct FShooterImpactEffect
+{
+	GENERATED_BODY()
+
+	/** Particles spawned at the impact */
+	UPROPERTY(EditAnywhere, Category="Impact")
+	TObjectPtr<UNiagaraSystem> Particles;
+
+	/** Sound played at the impact */
+	UPROPERTY(EditAnywhere, Category="Impact")
+	TObjectPtr<USoundBase> Sound;
+
+	/** Decal left on the surface */
+	UPROPERTY(EditAnywhere, Category="Impact")
+	TObjectPtr<UMaterialInterface> DecalMaterial;
+
+	/** Size of the decal. X is the projection depth */
+	UPROPERTY(EditAnywhere, Category="Impact", meta = (Units = "cm"))
+	FVector DecalSize = FVector(5.0f, 10.0f, 10.0f);
+
+	/** Time the decal stays before it's hidden. It may be reused sooner if the pool runs out */
+	UPROPERTY(EditAnywhere, Category="Impact", meta = (ClampMin = 0, Units = "s"))
+	float DecalLifetime = 10.0f;
+};
+
+/**
+ *  Impact effects for each physical material, shared by the projectiles and weapons that use it
+ */
+UCLASS(BlueprintType)
+class MERITOBRAINDAMAGE_API UShooterImpactEffectData : public UDataAsset
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Effect for surfaces without an entry of their own */
+	UPROPERTY(EditAnywhere, Category="Impact")
+	FShooterImpactEffect DefaultEffect;
+
+	/** Effects for each physical material */
+	UPROPERTY(EditAnywhere, Category="Impact")
+	TMap<TObjectPtr<UPhysicalMaterial>, FShooterImpactEffect> SurfaceEffects;
+
+public:
+
+	/** Returns the effect for a surface */
+	const FShooterImpactEffect& FindEffect(const UPhysicalMaterial* Surface) const;
+};
+
+/**
+ *  Impact waiting for its effect to be spawned
+ */
+struct FShooterImpactRecord
+{
+	/** Impact point */
+	FVector Location = FVector::ZeroVector;
+
+	/** Surface normal at the impact point */
+	FVector Normal = FVector::UpVector;
+
+	/** Surface that was hit */
+	TWeakObjectPtr<const UPhysicalMaterial> Surface;
+
+	/** Effects to pick from */
+	TWeakObjectPtr<const UShooterImpactEffectData> Effects;
+
+	/** Time the impact was queued */
+	double Time = 0.0;
+};
+
+/**
+ *  Pooled decal and when it stops being visible
+ */
+USTRUCT()
+struct FShooterPooledDecal
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UDecalComponent> Component;
+
+	/** Game time the decal is hidden at */
+	double ExpireTime = 0.0;
+};
+
+/**
+ *  Native impact effects
+ *  Projectiles and hitscan weapons only queue an impact record when they hit something. Once per frame, the queued
+ *  impacts near a player are turned into effects picked by physical material, up to a spawn budget. Decals and audio
+ *  components come from fixed pools and particles use the Niagara component pool, so nothing is created per hit
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterImpactEffectSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Impacts waiting for their effects */
+	TArray<FShooterImpactRecord> Queue;
+
+	/** Decal pool, reused oldest first */
+	UPROPERTY()
+	TArray<FShooterPooledDecal> Decals;
+
+	/** Audio component pool */
+	UPROPERTY()
+	TArray<TObjectPtr<UAudioComponent>> AudioComponents;
+
+	/** Actor owning the pooled components */
+	UPROPERTY()
+	TObjectPtr<AActor> ProxyActor;
+
+	/** Next decal to reuse */
+	int32 NextDecal = 0;
+
+protected:
+
+	/** Max impacts turned into effects each frame */
+	UPROPERTY(Config)
+	int32 MaxImpactsPerFrame = 16;
+
+	/** Impacts older than this are dropped instead of spawned late */
+	UPROPERTY(Config)
+	float MaxImpactAge = 0.15f;
+
+	/** Impacts farther than this from every player view are dropped */
+	UPROPERTY(Config)
+	float CullDistance = 6000.0f;
+
+	/** Number of pooled decals */
+	UPROPERTY(Config)
+	int32 DecalPoolSize = 64;
+
+	/** Number of pooled audio components. Impact sounds are skipped while they're all playing */
+	UPROPERTY(Config)
+	int32 AudioPoolSize = 12;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Spawns the queued effects and hides expired decals */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+
+	/** Releases the pools */
+	virtual void Deinitialize() override;
+
+	/** Queues the effect for a hit */
+	void AddImpact(const UShooterImpactEffectData* Effects, const FHitResult& Hit);
+
+	/** Queues the effect for a hit, if the world has an impact effect subsystem */
+	static void QueueImpact(const UObject* WorldContextObject, const UShooterImpactEffectData* Effects, const FHitResult& Hit);
+
+protected:
+
+	/** Spawns the particles, sound and decal for one impact */
+	void SpawnEffect(const FShooterImpactRecord& Impact);
+
+	/** Places the next pooled decal */
+	void PlaceDecal(const FShooterImpactEffect& Effect, const FShooterImpactRecord& Impact);
+
+	/** Plays a sound on a free pooled audio component */
+	void PlaySound(USoundBase* Sound, const FVector& Location);
+
+	/** Returns the actor owning the pooled components, spawning it if needed */
+	AActor* GetProxyActor();
+};
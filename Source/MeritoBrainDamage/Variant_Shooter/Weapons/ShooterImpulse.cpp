@@ -0,0 +1,175 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterImpulse.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MeritoBrainDamage.h"
+
+DECLARE_CYCLE_STAT(TEXT("Impulse Flush"), STAT_ShooterImpulseFlush, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impulses Added"), STAT_ShooterImpulsesAdded, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impulses Merged"), STAT_ShooterImpulsesMerged, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impulse Bodies Applied"), STAT_ShooterImpulseBodies, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impulse Wakes Skipped"), STAT_ShooterImpulseWakesSkipped, STATGROUP_Shooter);
+
+namespace ShooterImpulse
+{
+	static TAutoConsoleVariable<bool> CVarBatch(
+		TEXT("Shooter.Physics.BatchImpulses"),
+		true,
+		TEXT("If true, projectile and explosion impulses are summed per body and applied once before the physics step.\n")
+		TEXT("If false, each hit applies its impulse right away."),
+		ECVF_Default);
+}
+
+bool UShooterImpulseSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterImpulseSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// apply the frame's impulses right before the scene steps
+	if (FPhysScene* PhysScene = InWorld.GetPhysicsScene())
+	{
+		PreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UShooterImpulseSubsystem::OnPhysScenePreTick);
+	}
+}
+
+void UShooterImpulseSubsystem::Deinitialize()
+{
+	if (PreTickHandle.IsValid())
+	{
+		if (FPhysScene* PhysScene = GetWorld()->GetPhysicsScene())
+		{
+			PhysScene->OnPhysScenePreTick.Remove(PreTickHandle);
+		}
+
+		PreTickHandle.Reset();
+	}
+
+	Pending.Reset();
+	PendingIndices.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShooterImpulseSubsystem::AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName, bool bAllowWake)
+{
+	INC_DWORD_STAT(STAT_ShooterImpulsesAdded);
+
+	const TPair<TObjectKey<UPrimitiveComponent>, FName> Key(Component, BoneName);
+
+	FShooterPendingImpulse* Entry = nullptr;
+
+	if (const int32* Index = PendingIndices.Find(Key))
+	{
+		Entry = &Pending[*Index];
+		INC_DWORD_STAT(STAT_ShooterImpulsesMerged);
+
+	} else {
+
+		PendingIndices.Add(Key, Pending.Num());
+
+		Entry = &Pending.AddDefaulted_GetRef();
+		Entry->Component = Component;
+		Entry->BoneName = BoneName;
+	}
+
+	Entry->Impulse += Impulse;
+	Entry->Moment += Location ^ Impulse;
+	Entry->bAllowWake |= bAllowWake;
+}
+
+void UShooterImpulseSubsystem::AddImpulse(const UObject* WorldContextObject, UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName, bool bAllowWake)
+{
+	if (!Component || !Component->IsSimulatingPhysics(BoneName))
+	{
+		return;
+	}
+
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	UShooterImpulseSubsystem* ImpulseSubsystem = World ? World->GetSubsystem<UShooterImpulseSubsystem>() : nullptr;
+
+	// no batching in this world, so push the body right away
+	if (!ImpulseSubsystem || !ImpulseSubsystem->PreTickHandle.IsValid() || !ShooterImpulse::CVarBatch.GetValueOnGameThread())
+	{
+		const FBodyInstance* Body = Component->GetBodyInstance(BoneName);
+
+		if (bAllowWake || (Body && Body->IsInstanceAwake()))
+		{
+			Component->AddImpulseAtLocation(Impulse, Location, BoneName);
+		}
+
+		return;
+	}
+
+	ImpulseSubsystem->AddImpulseAtLocation(Component, Impulse, Location, BoneName, bAllowWake);
+}
+
+void UShooterImpulseSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime)
+{
+	Flush();
+}
+
+void UShooterImpulseSubsystem::Flush()
+{
+	if (Pending.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShooterImpulseFlush);
+
+	int32 NumApplied = 0;
+	int32 NumSkipped = 0;
+
+	// one write lock for the whole batch instead of one per hit
+	FPhysicsCommand::ExecuteWrite(GetWorld()->GetPhysicsScene(), [this, &NumApplied, &NumSkipped]()
+	{
+		for (const FShooterPendingImpulse& Entry : Pending)
+		{
+			UPrimitiveComponent* Component = Entry.Component.Get();
+			FBodyInstance* Body = Component ? Component->GetBodyInstance(Entry.BoneName) : nullptr;
+
+			if (!Body || !Body->IsValidBodyInstance())
+			{
+				continue;
+			}
+
+			const FPhysicsActorHandle& Handle = Body->GetPhysicsActorHandle();
+
+			if (!FPhysicsInterface::IsDynamic(Handle))
+			{
+				continue;
+			}
+
+			// impulses that may not wake the body are dropped while it sleeps
+			if (!Entry.bAllowWake && FPhysicsInterface::IsSleeping(Handle))
+			{
+				++NumSkipped;
+				continue;
+			}
+
+			// the summed moments were taken around the origin, so move them to the center of mass
+			const FVector CenterOfMass = FPhysicsInterface::GetComTransform_AssumesLocked(Handle).GetLocation();
+
+			FPhysicsInterface::AddImpulse_AssumesLocked(Handle, Entry.Impulse);
+			FPhysicsInterface::AddAngularImpulseInRadians_AssumesLocked(Handle, Entry.Moment - (CenterOfMass ^ Entry.Impulse));
+
+			++NumApplied;
+		}
+	});
+
+	INC_DWORD_STAT_BY(STAT_ShooterImpulseBodies, NumApplied);
+	INC_DWORD_STAT_BY(STAT_ShooterImpulseWakesSkipped, NumSkipped);
+
+	Pending.Reset();
+	PendingIndices.Reset();
+}
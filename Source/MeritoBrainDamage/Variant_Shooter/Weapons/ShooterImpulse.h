@@ -0,0 +1,85 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterImpulse.generated.h"
+
+class UPrimitiveComponent;
+class FPhysScene_Chaos;
+
+/**
+ *  Impulses added to one body during the frame
+ */
+struct FShooterPendingImpulse
+{
+	/** Component owning the body */
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+
+	/** Bone of the body, or none for the root body */
+	FName BoneName;
+
+	/** Sum of the impulses */
+	FVector Impulse = FVector::ZeroVector;
+
+	/** Sum of the moments of the impulses around the world origin. Turned into an angular impulse around the center of mass when applied */
+	FVector Moment = FVector::ZeroVector;
+
+	/** If true, at least one of the impulses may wake the body */
+	bool bAllowWake = false;
+};
+
+/**
+ *  Accumulates the physics impulses of projectile hits, pellets and explosions
+ *  Impulses are summed per body during the frame and applied right before the physics step, all under a single
+ *  physics scene lock, so a burst of pellets or an explosion touches each body once instead of once per hit
+ */
+UCLASS(Config=Game)
+class MERITOBRAINDAMAGE_API UShooterImpulseSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/** Impulses waiting for the next physics step */
+	TArray<FShooterPendingImpulse> Pending;
+
+	/** Index of each body's entry in the pending list */
+	TMap<TPair<TObjectKey<UPrimitiveComponent>, FName>, int32> PendingIndices;
+
+	/** Handle of the physics scene pre tick delegate */
+	FDelegateHandle PreTickHandle;
+
+protected:
+
+	/** Max sleeping bodies a single explosion can wake. The farthest ones stay asleep */
+	UPROPERTY(Config)
+	int32 MaxExplosionWakes = 8;
+
+public:
+
+	/** Only run in game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Hooks into the physics scene */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Unhooks from the physics scene */
+	virtual void Deinitialize() override;
+
+	/** Adds an impulse at a location to a body. If bAllowWake is false, the impulse is dropped if the body is asleep */
+	void AddImpulseAtLocation(UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None, bool bAllowWake = true);
+
+	/** Applies all the pending impulses */
+	void Flush();
+
+	/** Returns the max sleeping bodies a single explosion can wake */
+	int32 GetMaxExplosionWakes() const { return MaxExplosionWakes; }
+
+	/** Adds an impulse through the world's impulse subsystem, or directly if batching is off or unavailable */
+	static void AddImpulse(const UObject* WorldContextObject, UPrimitiveComponent* Component, const FVector& Impulse, const FVector& Location, FName BoneName = NAME_None, bool bAllowWake = true);
+
+protected:
+
+	/** Called by the physics scene before it steps */
+	void OnPhysScenePreTick(FPhysScene_Chaos* PhysScene, float DeltaTime);
+};
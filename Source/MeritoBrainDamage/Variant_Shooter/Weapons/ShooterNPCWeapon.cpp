@@ -0,0 +1,13 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterNPCWeapon.h"
+#include "Components/SkeletalMeshComponent.h"
+
+AShooterNPCWeapon::AShooterNPCWeapon(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.DoNotCreateDefaultSubobject(AShooterWeapon::FirstPersonMeshComponentName))
+{
+	// nobody ever looks through an NPC's eyes, so the world mesh is visible to everyone
+	GetThirdPersonMesh()->bOwnerNoSee = false;
+	GetThirdPersonMesh()->SetFirstPersonPrimitiveType(EFirstPersonPrimitiveType::None);
+}
@@ -0,0 +1,22 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterWeapon.h"
+#include "ShooterNPCWeapon.generated.h"
+
+/**
+ *  Weapon variant for AI-controlled characters
+ *  Skips the first person mesh entirely and shoots from the third person mesh muzzle
+ */
+UCLASS(abstract)
+class MERITOBRAINDAMAGE_API AShooterNPCWeapon : public AShooterWeapon
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Constructor */
+	AShooterNPCWeapon(const FObjectInitializer& ObjectInitializer);
+};
@@ -7,12 +7,14 @@
 #include "Components/StaticMeshComponent.h"
 #include "ShooterWeaponHolder.h"
 #include "ShooterWeapon.h"
+#include "ShooterWeaponRegistry.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
 
 AShooterPickup::AShooterPickup()
 {
- 	PrimaryActorTick.bCanEverTick = true;
+	// pickups are driven entirely by overlaps and timers
+	PrimaryActorTick.bCanEverTick = false;
 
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -42,6 +44,14 @@ void AShooterPickup::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
 
+	// in game worlds the mesh is streamed in through the weapon registry on BeginPlay
+	const UWorld* World = GetWorld();
+	if (World && World->IsGameWorld())
+	{
+		return;
+	}
+
+	// editor preview
 	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
 	{
 		// set the mesh
@@ -53,10 +63,38 @@ void AShooterPickup::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (FWeaponTableRow* WeaponData = WeaponType.GetRow<FWeaponTableRow>(FString()))
+	UShooterWeaponRegistry* Registry = UShooterWeaponRegistry::Get(this);
+
+	if (!Registry)
+	{
+		return;
+	}
+
+	// resolve our weapon row once through the shared registry
+	WeaponRegistryIndex = Registry->FindOrRegister(WeaponType);
+
+	if (const FShooterWeaponRegistryEntry* Entry = Registry->GetEntry(WeaponRegistryIndex))
 	{
 		// copy the weapon class
-		WeaponClass = WeaponData->WeaponToSpawn;
+		WeaponClass = Entry->WeaponClass;
+
+		// set the mesh once it's been streamed in, unless the level already saved it
+		if (!Mesh->GetStaticMesh())
+		{
+			Registry->RequestMesh(WeaponRegistryIndex, FSimpleDelegate::CreateUObject(this, &AShooterPickup::OnRegistryMeshLoaded));
+		}
+	}
+}
+
+void AShooterPickup::OnRegistryMeshLoaded()
+{
+	if (const UShooterWeaponRegistry* Registry = UShooterWeaponRegistry::Get(this))
+	{
+		if (const FShooterWeaponRegistryEntry* Entry = Registry->GetEntry(WeaponRegistryIndex))
+		{
+			// set the mesh
+			Mesh->SetStaticMesh(Entry->StaticMesh.Get());
+		}
 	}
 }
 
@@ -81,9 +119,6 @@ void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor*
 		// disable collision
 		SetActorEnableCollision(false);
 
-		// disable ticking
-		SetActorTickEnabled(false);
-
 		// schedule the respawn
 		GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
 	}
@@ -102,7 +137,4 @@ void AShooterPickup::FinishRespawn()
 {
 	// enable collision
 	SetActorEnableCollision(true);
-
-	// enable tick
-	SetActorTickEnabled(true);
 }
@@ -53,6 +53,9 @@ protected:
 
 	/** Type to weapon to grant on pickup. Set from the weapon data table. */
 	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Index of this pickup's weapon in the weapon registry. Resolved on BeginPlay */
+	int32 WeaponRegistryIndex = INDEX_NONE;
 	
 	/** Time to wait before respawning this pickup */
 	UPROPERTY(EditAnywhere, Category="Pickup", meta = (ClampMin = 0, ClampMax = 120, Units = "s"))
@@ -83,6 +86,9 @@ protected:
 
 protected:
 
+	/** Called when the weapon registry has finished streaming this pickup's mesh */
+	void OnRegistryMeshLoaded();
+
 	/** Called when it's time to respawn this pickup */
 	void RespawnPickup();
 
@@ -12,10 +12,18 @@
 #include "Engine/OverlapResult.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "ShooterTickCensus.h"
+#include "ShooterNoise.h"
+#include "ShooterInfluence.h"
+#include "ShooterHitbox.h"
+#include "ShooterImpactEffects.h"
+#include "ShooterImpulse.h"
 
 AShooterProjectile::AShooterProjectile()
 {
+	// projectiles only tick while they're growing towards their max size
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	// create the collision component and assign it as the root
 	RootComponent = CollisionComponent = CreateDefaultSubobject<USphereComponent>(TEXT("Collision Component"));
@@ -25,6 +33,9 @@ AShooterProjectile::AShooterProjectile()
 	CollisionComponent->SetCollisionResponseToAllChannels(ECR_Block);
 	CollisionComponent->CanCharacterStepUpOn = ECanBeCharacterBase::ECB_No;
 
+	// sweep hits only carry a physical material when asked for it, and the impact effects pick their surface from it
+	CollisionComponent->bReturnMaterialOnMove = true;
+
 	// create the projectile movement component. No need to attach it because it's not a Scene Component
 	ProjectileMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("Projectile Movement"));
 
@@ -45,6 +56,9 @@ void AShooterProjectile::BeginPlay()
 
 	// Save the size we spawned at
 	InitialScale = GetActorScale3D();
+
+	// only tick if there's any growing to do
+	SetActorTickEnabled(IsGrowing());
 }
 
 void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -69,7 +83,7 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
 	// make AI perception noise
-	MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
+	UShooterNoiseSubsystem::ReportNoise(this, NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
 
 	if (bExplodeOnHit)
 	{
@@ -84,6 +98,9 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 
 	}
 
+	// queue the native impact effect. It's spawned with the rest of the frame's impacts
+	UShooterImpactEffectSubsystem::QueueImpact(this, ImpactEffects, Hit);
+
 	// pass control to BP for any extra effects
 	BP_OnProjectileHit(Hit);
 
@@ -101,6 +118,8 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 
 void AShooterProjectile::Tick(float DeltaTime)
 {
+	SHOOTER_TICK_CENSUS_SCOPE();
+
 	Super::Tick(DeltaTime);
 
 	// Calculate how big we want to be
@@ -115,11 +134,25 @@ void AShooterProjectile::Tick(float DeltaTime)
 
 		// Apply the scale to the whole actor (Collision + Mesh + VFX)
 		SetActorScale3D(NewScale);
+
+	} else {
+
+		// we're done growing, so stop ticking
+		SetActorScale3D(TargetScale);
+		SetActorTickEnabled(false);
 	}
 }
 
+bool AShooterProjectile::IsGrowing() const
+{
+	return !GetActorScale3D().Equals(InitialScale * MaxSizeMultiplier, 0.01f);
+}
+
 void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 {
+	// let the AI know the area is dangerous
+	UShooterInfluenceSubsystem::ReportExplosion(GetWorld(), ExplosionCenter, ExplosionRadius);
+
 	// do a sphere overlap check look for nearby actors to damage
 	TArray<FOverlapResult> Overlaps;
 
@@ -140,28 +173,50 @@ void AShooterProjectile::ExplosionCheck(const FVector& ExplosionCenter)
 
 	GetWorld()->OverlapMultiByObjectType(Overlaps, ExplosionCenter, FQuat::Identity, ObjectParams, OverlapShape, QueryParams);
 
-	TArray<AActor*> DamagedActors;
+	TArray<const FOverlapResult*> DamagedOverlaps;
 
 	// process the overlap results
 	for (const FOverlapResult& CurrentOverlap : Overlaps)
 	{
 		// overlaps may return the same actor multiple times per each component overlapped
-		// ensure we only damage each actor once by adding it to a damaged list
-		if (DamagedActors.Find(CurrentOverlap.GetActor()) == INDEX_NONE)
+		// ensure we only damage each actor once by keeping its first overlap only
+		if (!DamagedOverlaps.ContainsByPredicate([&CurrentOverlap](const FOverlapResult* Overlap) { return Overlap->GetActor() == CurrentOverlap.GetActor(); }))
 		{
-			DamagedActors.Add(CurrentOverlap.GetActor());
+			DamagedOverlaps.Add(&CurrentOverlap);
+		}
+	}
+
+	// closest first, so the sleeping bodies that get woken up are the ones nearest the blast
+	DamagedOverlaps.Sort([&ExplosionCenter](const FOverlapResult& A, const FOverlapResult& B)
+	{
+		return FVector::DistSquared(A.GetActor()->GetActorLocation(), ExplosionCenter) < FVector::DistSquared(B.GetActor()->GetActorLocation(), ExplosionCenter);
+	});
 
-			// apply physics force away from the explosion
-			const FVector& ExplosionDir = CurrentOverlap.GetActor()->GetActorLocation() - GetActorLocation();
+	const UShooterImpulseSubsystem* ImpulseSubsystem = GetWorld()->GetSubsystem<UShooterImpulseSubsystem>();
+	int32 WakesLeft = ImpulseSubsystem ? ImpulseSubsystem->GetMaxExplosionWakes() : MAX_int32;
 
-			// push and/or damage the overlapped actor
-			ProcessHit(CurrentOverlap.GetActor(), CurrentOverlap.GetComponent(), GetActorLocation(), ExplosionDir.GetSafeNormal());
+	for (const FOverlapResult* CurrentOverlap : DamagedOverlaps)
+	{
+		UPrimitiveComponent* OverlapComp = CurrentOverlap->GetComponent();
+
+		// sleeping bodies past the wake cap don't get pushed
+		bool bAllowWake = true;
+
+		if (OverlapComp && OverlapComp->IsSimulatingPhysics() && !OverlapComp->IsAnyRigidBodyAwake())
+		{
+			bAllowWake = WakesLeft > 0;
+			--WakesLeft;
 		}
-			
+
+		// apply physics force away from the explosion
+		const FVector& ExplosionDir = CurrentOverlap->GetActor()->GetActorLocation() - GetActorLocation();
+
+		// push and/or damage the overlapped actor
+		ProcessHit(CurrentOverlap->GetActor(), OverlapComp, GetActorLocation(), ExplosionDir.GetSafeNormal(), bAllowWake);
 	}
 }
 
-void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection)
+void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection, bool bAllowWake)
 {
 	// have we hit a character?
 	if (ACharacter* HitCharacter = Cast<ACharacter>(HitActor))
@@ -169,16 +224,25 @@ void AShooterProjectile::ProcessHit(AActor* HitActor, UPrimitiveComponent* HitCo
 		// ignore the owner of this projectile
 		if (HitCharacter != GetOwner() || bDamageOwner)
 		{
+			float Damage = HitDamage;
+
+			// direct hits are refined against the character's hitboxes to find the zone multiplier
+			if (!bExplodeOnHit)
+			{
+				const FVector ShotDirection = ProjectileMovement->Velocity.IsNearlyZero() ? HitDirection : ProjectileMovement->Velocity;
+				Damage *= UShooterHitboxComponent::GetDamageMultiplier(HitCharacter, HitLocation, ShotDirection);
+			}
+
 			// apply damage to the character
-			UGameplayStatics::ApplyDamage(HitCharacter, HitDamage, GetInstigator()->GetController(), this, HitDamageType);
+			UGameplayStatics::ApplyDamage(HitCharacter, Damage, GetInstigator()->GetController(), this, HitDamageType);
 		}
 	}
 
 	// have we hit a physics object?
-	if (HitComp->IsSimulatingPhysics())
+	if (HitComp && HitComp->IsSimulatingPhysics())
 	{
-		// give some physics impulse to the object
-		HitComp->AddImpulseAtLocation(HitDirection * PhysicsForce, HitLocation);
+		// give some physics impulse to the object. It's merged with the frame's other impulses on the same body
+		UShooterImpulseSubsystem::AddImpulse(this, HitComp, HitDirection * PhysicsForce, HitLocation, NAME_None, bAllowWake);
 	}
 }
 
@@ -187,3 +251,13 @@ void AShooterProjectile::OnDeferredDestruction()
 	// destroy this actor
 	Destroy();
 }
+
+float AShooterProjectile::GetProjectileSpeed() const
+{
+	return ProjectileMovement ? ProjectileMovement->InitialSpeed : 0.0f;
+}
+
+float AShooterProjectile::GetProjectileGravityScale() const
+{
+	return ProjectileMovement ? ProjectileMovement->ProjectileGravityScale : 0.0f;
+}
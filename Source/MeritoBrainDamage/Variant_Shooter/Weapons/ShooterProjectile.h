@@ -10,6 +10,7 @@ class USphereComponent;
 class UProjectileMovementComponent;
 class ACharacter;
 class UPrimitiveComponent;
+class UShooterImpactEffectData;
 
 /**
  *  Simple projectile class for a first person shooter game
@@ -53,6 +54,10 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
 	TSubclassOf<UDamageType> HitDamageType;
 
+	/** Native impact effects, picked by the physical material that was hit. Spawned in batches by the impact effect subsystem */
+	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
+	TObjectPtr<UShooterImpactEffectData> ImpactEffects;
+
 	/** If true, the projectile can damage the character that shot it */
 	UPROPERTY(EditAnywhere, Category="Projectile|Hit")
 	bool bDamageOwner = false;
@@ -103,16 +108,19 @@ protected:
 	virtual void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 
 public:
-	// Override Tick
+	// Override Tick. Only enabled while the projectile is growing
 	virtual void Tick(float DeltaTime) override;
 
+	/** Returns true if the projectile hasn't reached its max size yet */
+	bool IsGrowing() const;
+
 protected:
 
 	/** Looks up actors within the explosion radius and damages them */
 	void ExplosionCheck(const FVector& ExplosionCenter);
 
-	/** Processes a projectile hit for the given actor */
-	void ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection);
+	/** Processes a projectile hit for the given actor. If bAllowWake is false, a sleeping physics body isn't pushed */
+	void ProcessHit(AActor* HitActor, UPrimitiveComponent* HitComp, const FVector& HitLocation, const FVector& HitDirection, bool bAllowWake = true);
 
 	/** Passes control to Blueprint to implement any effects on hit. */
 	UFUNCTION(BlueprintImplementableEvent, Category="Projectile", meta = (DisplayName = "On Projectile Hit"))
@@ -124,4 +132,23 @@ protected:
 public:
 	UFUNCTION(BlueprintPure, Category = "Projectile")
 	float GetHitDamage() const { return HitDamage; }
+
+	/** Returns the type of damage applied on hit */
+	TSubclassOf<UDamageType> GetHitDamageType() const { return HitDamageType; }
+
+	/** Returns the native impact effects of this projectile */
+	const UShooterImpactEffectData* GetImpactEffects() const { return ImpactEffects; }
+
+	/** Returns the physics force applied on hit */
+	float GetPhysicsForce() const { return PhysicsForce; }
+
+	/** Returns the explosion radius, or zero if this projectile doesn't explode */
+	UFUNCTION(BlueprintPure, Category = "Projectile")
+	float GetExplosionRadius() const { return bExplodeOnHit ? ExplosionRadius : 0.0f; }
+
+	/** Returns the initial speed of the projectile */
+	float GetProjectileSpeed() const;
+
+	/** Returns the gravity scale applied to the projectile */
+	float GetProjectileGravityScale() const;
 };
@@ -6,6 +6,7 @@
 #include "Engine/World.h"
 #include "ShooterProjectile.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterNoise.h"
 #include "Components/SceneComponent.h"
 #include "TimerManager.h"
 #include "Animation/AnimInstance.h"
@@ -13,21 +14,46 @@
 #include "GameFramework/Pawn.h"
 #include "Kismet/GameplayStatics.h"
 #include "NiagaraFunctionLibrary.h"
+#include "GameFramework/Character.h"
+#include "ShooterHitbox.h"
+#include "ShooterImpactEffects.h"
+#include "ShooterImpulse.h"
+#include "MeritoBrainDamage.h"
 
-AShooterWeapon::AShooterWeapon()
+DECLARE_CYCLE_STAT(TEXT("Pellet Fire"), STAT_ShooterPelletFire, STATGROUP_Shooter);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pellets Traced"), STAT_ShooterPelletsTraced, STATGROUP_Shooter);
+
+namespace ShooterWeapon
+{
+	/** Hitscan pellets trace against the projectile channel so they hit whatever a projectile would */
+	static constexpr ECollisionChannel PelletTraceChannel = ECC_GameTraceChannel1;
+
+	/** Angle between consecutive pellets of the even pattern */
+	static const float GoldenAngle = UE_PI * (3.0f - FMath::Sqrt(5.0f));
+}
+
+FName AShooterWeapon::FirstPersonMeshComponentName(TEXT("First Person Mesh"));
+
+AShooterWeapon::AShooterWeapon(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
 {
-	PrimaryActorTick.bCanEverTick = true;
+	// weapons are driven entirely by input, timers and their owner
+	PrimaryActorTick.bCanEverTick = false;
 
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 
 	// create the first person mesh
-	FirstPersonMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("First Person Mesh"));
-	FirstPersonMesh->SetupAttachment(RootComponent);
+	FirstPersonMesh = CreateOptionalDefaultSubobject<USkeletalMeshComponent>(FirstPersonMeshComponentName);
 
-	FirstPersonMesh->SetCollisionProfileName(FName("NoCollision"));
-	FirstPersonMesh->SetFirstPersonPrimitiveType(EFirstPersonPrimitiveType::FirstPerson);
-	FirstPersonMesh->bOnlyOwnerSee = true;
+	if (FirstPersonMesh)
+	{
+		FirstPersonMesh->SetupAttachment(RootComponent);
+
+		FirstPersonMesh->SetCollisionProfileName(FName("NoCollision"));
+		FirstPersonMesh->SetFirstPersonPrimitiveType(EFirstPersonPrimitiveType::FirstPerson);
+		FirstPersonMesh->bOnlyOwnerSee = true;
+	}
 
 	// create the third person mesh
 	ThirdPersonMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Third Person Mesh"));
@@ -52,6 +78,17 @@ void AShooterWeapon::BeginPlay()
 	WeaponOwner = Cast<IShooterWeaponHolder>(GetOwner());
 	PawnOwner = Cast<APawn>(GetOwner());
 
+	// seed our own random stream so our shots don't depend on anyone else's
+	RandomStream.Initialize(FShooterRandomStream::MakeSeed(this));
+
+	UE_LOG(LogMeritoBrainDamage, Verbose, TEXT("%s random seed %llu"), *GetName(), RandomStream.GetInitialSeed());
+
+	// cache our slot in the weapon stats table
+	if (UShooterWeaponRegistry* Registry = UShooterWeaponRegistry::Get(this))
+	{
+		StatsIndex = Registry->FindOrAddWeaponStats(GetClass());
+	}
+
 	// fill the first ammo clip
 	// CurrentBullets = MagazineSize;
 
@@ -143,14 +180,21 @@ void AShooterWeapon::Fire()
 		return;
 	}
 	
-	// fire a projectile at the target
-	FireProjectile(WeaponOwner->GetWeaponTargetLocation());
+	// fire a projectile or a spread of pellets at the target
+	if (PelletCount > 1)
+	{
+		FirePellets(WeaponOwner->GetWeaponTargetLocation());
+
+	} else {
+
+		FireProjectile(WeaponOwner->GetWeaponTargetLocation());
+	}
 
 	// update the time of our last shot
 	TimeOfLastShot = GetWorld()->GetTimeSeconds();
 
 	// make noise so the AI perception system can hear us
-	MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	UShooterNoiseSubsystem::ReportNoise(this, ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
 
 	// are we full auto?
 	if (bFullAuto)
@@ -185,18 +229,157 @@ void AShooterWeapon::FireProjectile(const FVector& TargetLocation)
 
 	AShooterProjectile* Projectile = GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, ProjectileTransform, SpawnParams);
 
+	FinishShot();
+}
+
+void AShooterWeapon::FirePellets(const FVector& TargetLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterPelletFire);
+
+	// aim variance moves the whole pattern, the spread is applied around it
+	const FTransform CenterTransform = CalculateProjectileSpawnTransform(TargetLocation);
+
+	TArray<FVector, TInlineAllocator<16>> Directions;
+	CalculatePelletDirections(CenterTransform.GetRotation().GetForwardVector(), Directions);
+
+	if (bHitscanPellets)
+	{
+		TracePellets(CenterTransform.GetLocation(), Directions);
+
+	} else {
+
+		// spawn a projectile per pellet
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.TransformScaleMethod = ESpawnActorScaleMethod::OverrideRootScale;
+		SpawnParams.Owner = GetOwner();
+		SpawnParams.Instigator = PawnOwner;
+
+		for (const FVector& Direction : Directions)
+		{
+			GetWorld()->SpawnActor<AShooterProjectile>(ProjectileClass, FTransform(Direction.Rotation(), CenterTransform.GetLocation()), SpawnParams);
+		}
+	}
+
+	// one sound, muzzle flash and recoil for the whole shot
+	FinishShot();
+}
+
+void AShooterWeapon::TracePellets(const FVector& Start, TConstArrayView<FVector> Directions)
+{
+	const AShooterProjectile* ProjectileCDO = GetProjectileDefaultObject();
+
+	if (!ProjectileCDO)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_ShooterPelletsTraced, Directions.Num());
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterPellets), false, this);
+	QueryParams.AddIgnoredActor(GetOwner());
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	TArray<FHitResult> Hits;
+
+	// damage per victim, so each one gets a single damage event however many pellets hit it
+	TArray<TPair<TWeakObjectPtr<AActor>, float>, TInlineAllocator<8>> VictimDamage;
+
+	for (const FVector& Direction : Directions)
+	{
+		FHitResult Hit;
+
+		if (!GetWorld()->LineTraceSingleByChannel(Hit, Start, Start + Direction * PelletRange, ShooterWeapon::PelletTraceChannel, QueryParams))
+		{
+			continue;
+		}
+
+		Hits.Add(Hit);
+
+		// queue the impact effect for this frame's batch
+		UShooterImpactEffectSubsystem::QueueImpact(this, ProjectileCDO->GetImpactEffects(), Hit);
+
+		// refine character hits against their hitboxes and add up the damage
+		if (ACharacter* HitCharacter = Cast<ACharacter>(Hit.GetActor()))
+		{
+			const float Damage = ProjectileCDO->GetHitDamage() * UShooterHitboxComponent::GetDamageMultiplier(HitCharacter, Hit.ImpactPoint, Direction);
+
+			if (TPair<TWeakObjectPtr<AActor>, float>* Found = VictimDamage.FindByPredicate([HitCharacter](const TPair<TWeakObjectPtr<AActor>, float>& Pair) { return Pair.Key == HitCharacter; }))
+			{
+				Found->Value += Damage;
+
+			} else {
+
+				VictimDamage.Emplace(HitCharacter, Damage);
+			}
+		}
+
+		// push physics objects. Pellets hitting the same body are merged into a single impulse
+		UShooterImpulseSubsystem::AddImpulse(this, Hit.GetComponent(), Direction * ProjectileCDO->GetPhysicsForce(), Hit.ImpactPoint, Hit.BoneName);
+	}
+
+	AController* InstigatorController = PawnOwner ? PawnOwner->GetController() : nullptr;
+
+	for (const TPair<TWeakObjectPtr<AActor>, float>& Victim : VictimDamage)
+	{
+		if (AActor* VictimActor = Victim.Key.Get())
+		{
+			UGameplayStatics::ApplyDamage(VictimActor, Victim.Value, InstigatorController, this, ProjectileCDO->GetHitDamageType());
+		}
+	}
+
+	// let Blueprint play the impact effects in one go
+	if (Hits.Num() > 0)
+	{
+		BP_OnPelletsHit(Hits);
+	}
+}
+
+void AShooterWeapon::CalculatePelletDirections(const FVector& AimDirection, TArray<FVector, TInlineAllocator<16>>& OutDirections)
+{
+	OutDirections.SetNumUninitialized(PelletCount);
+
+	const float SpreadRadians = FMath::DegreesToRadians(PelletSpread);
+
+	// draw the whole random pattern in one batch
+	if (PelletPattern == EShooterPelletPattern::Random)
+	{
+		RandomStream.FillCone(AimDirection, SpreadRadians, OutDirections);
+		return;
+	}
+
+	// basis around the aim direction
+	FVector Right, Up;
+	AimDirection.FindBestAxisVectors(Right, Up);
+
+	for (int32 i = 0; i < PelletCount; ++i)
+	{
+		// sunflower pattern: equal area rings with consecutive pellets a golden angle apart
+		const float Angle = SpreadRadians * FMath::Sqrt((i + 0.5f) / PelletCount);
+		const float Roll = i * ShooterWeapon::GoldenAngle;
+
+		float SinAngle, CosAngle, SinRoll, CosRoll;
+		FMath::SinCos(&SinAngle, &CosAngle, Angle);
+		FMath::SinCos(&SinRoll, &CosRoll, Roll);
+
+		OutDirections[i] = AimDirection * CosAngle + (Right * CosRoll + Up * SinRoll) * SinAngle;
+	}
+}
+
+void AShooterWeapon::FinishShot()
+{
 	// Play the shooting sound
 	if (FireSound)
 	{
 		UGameplayStatics::PlaySoundAtLocation(this, FireSound, GetActorLocation());
 	}
 
-	if (MuzzleFlash && FirstPersonMesh)
+	if (MuzzleFlash)
 	{
 		// Spawn the VFX attached to the Muzzle Socket
 		UNiagaraFunctionLibrary::SpawnSystemAttached(
 			MuzzleFlash,
-			FirstPersonMesh,
+			GetMuzzleMesh(),
 			MuzzleSocketName,
 			FVector::ZeroVector,
 			FRotator::ZeroRotator,
@@ -251,16 +434,16 @@ void AShooterWeapon::AddAmmo(int32 Amount)
 	}
 }
 
-FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation) const
+FTransform AShooterWeapon::CalculateProjectileSpawnTransform(const FVector& TargetLocation)
 {
 	// find the muzzle location
-	const FVector MuzzleLoc = FirstPersonMesh->GetSocketLocation(MuzzleSocketName);
+	const FVector MuzzleLoc = GetMuzzleMesh()->GetSocketLocation(MuzzleSocketName);
 
 	// calculate the spawn location ahead of the muzzle
 	const FVector SpawnLoc = MuzzleLoc + ((TargetLocation - MuzzleLoc).GetSafeNormal() * MuzzleOffset);
 
 	// find the aim rotation vector while applying some variance to the target 
-	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (UKismetMathLibrary::RandomUnitVector() * AimVariance));
+	const FRotator AimRot = UKismetMathLibrary::FindLookAtRotation(SpawnLoc, TargetLocation + (RandomStream.VRand() * AimVariance));
 
 	// return the built transform
 	return FTransform(AimRot, SpawnLoc, FVector::OneVector);
@@ -276,6 +459,15 @@ const TSubclassOf<UAnimInstance>& AShooterWeapon::GetThirdPersonAnimInstanceClas
 	return ThirdPersonAnimInstanceClass;
 }
 
+FShooterWeaponStats AShooterWeapon::GetWeaponStats() const
+{
+	if (const UShooterWeaponRegistry* Registry = UShooterWeaponRegistry::Get(this))
+	{
+		return Registry->GetWeaponStats(StatsIndex);
+	}
+
+	return FShooterWeaponStats();
+}
 
 AShooterProjectile* AShooterWeapon::GetProjectileDefaultObject() const
 {
@@ -7,6 +7,8 @@
 #include "NiagaraSystem.h"
 #include "ShooterWeaponHolder.h"
 #include "Animation/AnimInstance.h"
+#include "ShooterWeaponRegistry.h"
+#include "ShooterRandom.h"
 #include "ShooterWeapon.generated.h"
 
 
@@ -16,6 +18,19 @@ class USkeletalMeshComponent;
 class UAnimMontage;
 class UAnimInstance;
 
+/**
+ *  How the pellets of a multi-pellet shot are spread around the aim direction
+ */
+UENUM(BlueprintType)
+enum class EShooterPelletPattern : uint8
+{
+	/** Pellets are scattered randomly inside the spread cone */
+	Random,
+
+	/** Pellets fill the spread cone evenly in a fixed sunflower pattern */
+	Even
+};
+
 /**
  *  Base class for a simple first person shooter weapon
  *  Provides both first person and third person perspective meshes
@@ -72,6 +87,26 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 99999))
 	int32 MagazineSize = 10;
 
+	/** Number of pellets fired by each trigger pull. Each pull still uses a single bullet */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (ClampMin = 1, ClampMax = 64))
+	int32 PelletCount = 1;
+
+	/** Spread pattern of the pellets */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (EditCondition = "PelletCount > 1"))
+	EShooterPelletPattern PelletPattern = EShooterPelletPattern::Even;
+
+	/** Cone half-angle the pellets are spread over */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (ClampMin = 0, ClampMax = 45, Units = "Degrees", EditCondition = "PelletCount > 1"))
+	float PelletSpread = 6.0f;
+
+	/** If true, pellets are resolved with traces and their damage is applied right away, instead of spawning a projectile per pellet */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (EditCondition = "PelletCount > 1"))
+	bool bHitscanPellets = true;
+
+	/** Max range of hitscan pellets */
+	UPROPERTY(EditAnywhere, Category="Pellets", meta = (ClampMin = 0, ClampMax = 100000, Units = "cm", EditCondition = "PelletCount > 1 && bHitscanPellets"))
+	float PelletRange = 5000.0f;
+
 	/** Number of bullets in the current magazine */
 	int32 CurrentBullets = 0;
 
@@ -124,6 +159,12 @@ protected:
 	/** Timer to handle full auto refiring */
 	FTimerHandle RefireTimer;
 
+	/** Random stream for aim variance and pellet spread */
+	FShooterRandomStream RandomStream;
+
+	/** Index of this weapon class in the precomputed stats table */
+	int32 StatsIndex = INDEX_NONE;
+
 	/** Cast pawn pointer to the owner for AI perception system interactions */
 	TObjectPtr<APawn> PawnOwner;
 
@@ -141,8 +182,11 @@ protected:
 
 public:	
 
+	/** Name of the first person mesh component. Use with DoNotCreateDefaultSubobject to skip it in subclasses */
+	static FName FirstPersonMeshComponentName;
+
 	/** Constructor */
-	AShooterWeapon();
+	AShooterWeapon(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
 protected:
 	
@@ -188,12 +232,31 @@ protected:
 	/** Fire a projectile towards the target location */
 	virtual void FireProjectile(const FVector& TargetLocation);
 
-	/** Calculates the spawn transform for projectiles shot by this weapon */
-	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation) const;
+	/** Fires every pellet of a multi-pellet shot towards the target location */
+	virtual void FirePellets(const FVector& TargetLocation);
+
+	/** Traces the pellets and applies their damage, one damage event per victim */
+	void TracePellets(const FVector& Start, TConstArrayView<FVector> Directions);
+
+	/** Plays the shot sound, FX and animation once, then consumes the bullet */
+	void FinishShot();
+
+	/** Calculates the pellet directions around the aim direction */
+	void CalculatePelletDirections(const FVector& AimDirection, TArray<FVector, TInlineAllocator<16>>& OutDirections);
+
+	/** Passes control to Blueprint to implement impact effects for hitscan pellets. Called once per shot with every pellet hit */
+	UFUNCTION(BlueprintImplementableEvent, Category="Weapon", meta = (DisplayName = "On Pellets Hit"))
+	void BP_OnPelletsHit(const TArray<FHitResult>& Hits);
+
+	/** Calculates the spawn transform for projectiles shot by this weapon. Draws the aim variance from the weapon's random stream */
+	FTransform CalculateProjectileSpawnTransform(const FVector& TargetLocation);
+
+	/** Returns the mesh that owns the muzzle socket. First person if available, third person otherwise */
+	USkeletalMeshComponent* GetMuzzleMesh() const { return FirstPersonMesh ? FirstPersonMesh : ThirdPersonMesh; }
 
 public:
 
-	/** Returns the first person mesh */
+	/** Returns the first person mesh. May be null on weapon variants without a first person view */
 	UFUNCTION(BlueprintPure, Category="Weapon")
 	USkeletalMeshComponent* GetFirstPersonMesh() const { return FirstPersonMesh; };
 
@@ -209,6 +272,9 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Weapon")
 	FText GetWeaponName() const { return WeaponName; }
 
+	/** Returns true while the trigger is held, so another shot is pending */
+	bool IsFiring() const { return bIsFiring; }
+
 	// ** Getter for the refire rate */
 	UFUNCTION(BlueprintPure, Category = "Weapon")
 	float GetRefireRate() const { return RefireRate; }
@@ -217,6 +283,10 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Weapon")
 	TSubclassOf<AShooterProjectile> GetProjectileClass() const { return ProjectileClass; }
 
+	/** Returns the precomputed UI stats for this weapon class */
+	UFUNCTION(BlueprintPure, Category = "Weapon")
+	FShooterWeaponStats GetWeaponStats() const;
+
 	/** Returns the Default Object (CDO) of the projectile. Useful for reading UI stats like Damage. */
 	UFUNCTION(BlueprintPure, Category = "Weapon")
 	AShooterProjectile* GetProjectileDefaultObject() const;
@@ -230,6 +300,15 @@ public:
 	/** Returns the third person anim instance class */
 	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimInstanceClass() const;
 
+	/** Returns the number of pellets fired by each trigger pull */
+	int32 GetPelletCount() const { return PelletCount; }
+
+	/** Returns true if the pellets are traced instead of spawned as projectiles */
+	bool UsesHitscanPellets() const { return PelletCount > 1 && bHitscanPellets; }
+
+	/** Returns the max range of hitscan pellets */
+	float GetPelletRange() const { return PelletRange; }
+
 	/** Returns the magazine size */
 	UFUNCTION(BlueprintPure, Category = "Weapon")
 	int32 GetMagazineSize() const { return MagazineSize; };
@@ -241,6 +320,9 @@ public:
 	/** Returns the crosshair scale */
 	FVector2D GetCrosshairScale() const { return CrosshairScale; };
 
+	/** Returns the seed of the weapon's random stream, to reproduce its shots through Shooter.RNG.ForceSeed */
+	uint64 GetRandomSeed() const { return RandomStream.GetInitialSeed(); }
+
 	/** Returns the priority for sorting */
 	int32 GetWeaponSlotPriority() const { return WeaponSlotPriority; }
 };
@@ -0,0 +1,309 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "ShooterWeaponRegistry.h"
+#include "ShooterPickup.h"
+#include "ShooterWeapon.h"
+#include "ShooterProjectile.h"
+#include "Engine/AssetManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+#include "UObject/UObjectIterator.h"
+#include "MeritoBrainDamage.h"
+
+namespace ShooterWeaponStats
+{
+	/** Projectile drop at which we consider a shot to no longer be effective */
+	static constexpr float MaxEffectiveDrop = 50.0f;
+
+	/** Flight time to assume for projectiles that live forever */
+	static constexpr float MaxFlightTime = 3.0f;
+
+	/** Shortest time between shots used for DPS, to avoid dividing by zero refire rates */
+	static constexpr float MinRefireRate = 1.0f / 60.0f;
+}
+
+void UShooterWeaponRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// precompute stats for every concrete weapon class already loaded. Others are added when first requested
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+
+		if (Class->IsChildOf(AShooterWeapon::StaticClass())
+			&& !Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists)
+			&& !Class->GetName().StartsWith(TEXT("SKEL_"))
+			&& !Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			FindOrAddWeaponStats(Class);
+		}
+	}
+}
+
+void UShooterWeaponRegistry::Deinitialize()
+{
+	// release the loaded meshes
+	for (const TSharedPtr<FStreamableHandle>& Handle : LoadHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->CancelHandle();
+		}
+	}
+
+	LoadHandles.Empty();
+	PendingMeshCallbacks.Empty();
+	LoadingMeshes.Empty();
+	FailedMeshes.Empty();
+	TableRowIndices.Empty();
+	Entries.Empty();
+	WeaponStatsIndices.Empty();
+	WeaponStats.Empty();
+
+	Super::Deinitialize();
+}
+
+UShooterWeaponRegistry* UShooterWeaponRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+
+	return GameInstance ? GameInstance->GetSubsystem<UShooterWeaponRegistry>() : nullptr;
+}
+
+int32 UShooterWeaponRegistry::FindOrRegister(const FDataTableRowHandle& RowHandle)
+{
+	if (!RowHandle.DataTable || RowHandle.RowName.IsNone())
+	{
+		return INDEX_NONE;
+	}
+
+	// resolve the whole table the first time any of its rows is requested
+	if (!TableRowIndices.Contains(FObjectKey(RowHandle.DataTable)))
+	{
+		RegisterTable(RowHandle.DataTable);
+	}
+
+	const int32* FoundIndex = TableRowIndices.FindChecked(FObjectKey(RowHandle.DataTable)).Find(RowHandle.RowName);
+	return FoundIndex ? *FoundIndex : INDEX_NONE;
+}
+
+const FShooterWeaponRegistryEntry* UShooterWeaponRegistry::GetEntry(int32 Index) const
+{
+	return Entries.IsValidIndex(Index) ? &Entries[Index] : nullptr;
+}
+
+bool UShooterWeaponRegistry::GetEntryCopy(int32 Index, FShooterWeaponRegistryEntry& OutEntry) const
+{
+	if (const FShooterWeaponRegistryEntry* Entry = GetEntry(Index))
+	{
+		OutEntry = *Entry;
+		return true;
+	}
+
+	return false;
+}
+
+int32 UShooterWeaponRegistry::FindOrAddWeaponStats(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	if (!WeaponClass)
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* FoundIndex = WeaponStatsIndices.Find(FObjectKey(WeaponClass)))
+	{
+		return *FoundIndex;
+	}
+
+	const int32 NewIndex = WeaponStats.Add(CalculateWeaponStats(WeaponClass));
+	WeaponStatsIndices.Add(FObjectKey(WeaponClass), NewIndex);
+
+	return NewIndex;
+}
+
+const FShooterWeaponStats& UShooterWeaponRegistry::GetWeaponStats(int32 StatsIndex) const
+{
+	static const FShooterWeaponStats EmptyStats;
+
+	return WeaponStats.IsValidIndex(StatsIndex) ? WeaponStats[StatsIndex] : EmptyStats;
+}
+
+FShooterWeaponStats UShooterWeaponRegistry::GetWeaponStatsForClass(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	return GetWeaponStats(FindOrAddWeaponStats(WeaponClass));
+}
+
+FShooterWeaponStats UShooterWeaponRegistry::CalculateWeaponStats(TSubclassOf<AShooterWeapon> WeaponClass)
+{
+	FShooterWeaponStats Stats;
+	Stats.WeaponClass = WeaponClass;
+
+	const AShooterWeapon* WeaponCDO = WeaponClass->GetDefaultObject<AShooterWeapon>();
+
+	Stats.MagazineSize = WeaponCDO->GetMagazineSize();
+	Stats.RefireRate = WeaponCDO->GetRefireRate();
+
+	if (const AShooterProjectile* ProjectileCDO = WeaponCDO->GetProjectileDefaultObject())
+	{
+		// every pellet of a trigger pull can hit
+		Stats.Damage = ProjectileCDO->GetHitDamage() * WeaponCDO->GetPelletCount();
+		Stats.ExplosionRadius = ProjectileCDO->GetExplosionRadius();
+
+		// the projectile is effective until it expires or drops too far below the aim line
+		float FlightTime = ProjectileCDO->InitialLifeSpan > 0.0f ? ProjectileCDO->InitialLifeSpan : ShooterWeaponStats::MaxFlightTime;
+
+		const float Gravity = FMath::Abs(UPhysicsSettings::Get()->DefaultGravityZ * ProjectileCDO->GetProjectileGravityScale());
+
+		if (Gravity > UE_KINDA_SMALL_NUMBER)
+		{
+			FlightTime = FMath::Min(FlightTime, FMath::Sqrt(2.0f * ShooterWeaponStats::MaxEffectiveDrop / Gravity));
+		}
+
+		Stats.EffectiveRange = WeaponCDO->UsesHitscanPellets() ? WeaponCDO->GetPelletRange() : ProjectileCDO->GetProjectileSpeed() * FlightTime;
+	}
+
+	Stats.DamagePerSecond = Stats.Damage / FMath::Max(Stats.RefireRate, ShooterWeaponStats::MinRefireRate);
+
+	return Stats;
+}
+
+void UShooterWeaponRegistry::RequestMesh(int32 Index, FSimpleDelegate Callback)
+{
+	const FShooterWeaponRegistryEntry* Entry = GetEntry(Index);
+
+	if (!Entry || Entry->StaticMesh.IsNull())
+	{
+		return;
+	}
+
+	// is the mesh already in memory?
+	if (Entry->StaticMesh.IsValid())
+	{
+		Callback.ExecuteIfBound();
+		return;
+	}
+
+	// there's no point waiting for a mesh that already failed to load
+	const FSoftObjectPath MeshPath = Entry->StaticMesh.ToSoftObjectPath();
+
+	if (FailedMeshes.Contains(MeshPath))
+	{
+		return;
+	}
+
+	// wait for the batch load to complete
+	PendingMeshCallbacks.Emplace(Index, MoveTemp(Callback));
+
+	// the mesh was in memory when the table was registered and has been unloaded since, so stream it in again
+	if (!LoadingMeshes.Contains(MeshPath))
+	{
+		LoadMeshes(TArray<FSoftObjectPath>{ MeshPath });
+	}
+}
+
+void UShooterWeaponRegistry::RegisterTable(const UDataTable* Table)
+{
+	TMap<FName, int32>& RowIndices = TableRowIndices.Add(FObjectKey(Table));
+
+	TArray<FSoftObjectPath> MeshesToLoad;
+
+	Table->ForeachRow<FWeaponTableRow>(TEXT("UShooterWeaponRegistry::RegisterTable"), [&](const FName& RowName, const FWeaponTableRow& Row)
+	{
+		FShooterWeaponRegistryEntry& Entry = Entries.AddDefaulted_GetRef();
+
+		Entry.RowName = RowName;
+		Entry.WeaponClass = Row.WeaponToSpawn;
+		Entry.StaticMesh = Row.StaticMesh;
+
+		// copy the UI data so nothing has to walk the CDOs later
+		if (const AShooterWeapon* WeaponCDO = Row.WeaponToSpawn ? Row.WeaponToSpawn->GetDefaultObject<AShooterWeapon>() : nullptr)
+		{
+			Entry.Icon = WeaponCDO->GetWeaponIcon();
+			Entry.WeaponName = WeaponCDO->GetWeaponName();
+			Entry.StatsIndex = FindOrAddWeaponStats(Row.WeaponToSpawn);
+		}
+
+		RowIndices.Add(RowName, Entries.Num() - 1);
+
+		// queue the mesh for the batched load
+		if (!Row.StaticMesh.IsNull() && !Row.StaticMesh.IsValid())
+		{
+			MeshesToLoad.AddUnique(Row.StaticMesh.ToSoftObjectPath());
+		}
+	});
+
+	UE_LOG(LogMeritoBrainDamage, Log, TEXT("Weapon registry resolved %d rows from %s, streaming %d meshes"), RowIndices.Num(), *GetNameSafe(Table), MeshesToLoad.Num());
+
+	// stream all of the table's meshes in a single request
+	if (MeshesToLoad.Num() > 0)
+	{
+		LoadMeshes(MoveTemp(MeshesToLoad));
+	}
+}
+
+void UShooterWeaponRegistry::LoadMeshes(TArray<FSoftObjectPath>&& MeshesToLoad)
+{
+	LoadingMeshes.Append(MeshesToLoad);
+
+	// the completion callback gets its own copy of the paths, so it knows which pending callbacks it settles
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MeshesToLoad, FStreamableDelegate::CreateUObject(this, &UShooterWeaponRegistry::OnMeshBatchLoaded, MeshesToLoad));
+
+	if (Handle.IsValid())
+	{
+		LoadHandles.Add(Handle);
+
+	} else {
+
+		// the request failed outright and the callback will never run
+		OnMeshBatchLoaded(MoveTemp(MeshesToLoad));
+	}
+}
+
+void UShooterWeaponRegistry::OnMeshBatchLoaded(TArray<FSoftObjectPath> LoadedMeshes)
+{
+	for (const FSoftObjectPath& MeshPath : LoadedMeshes)
+	{
+		LoadingMeshes.Remove(MeshPath);
+
+		if (!MeshPath.ResolveObject())
+		{
+			FailedMeshes.Add(MeshPath);
+		}
+	}
+
+	// run every callback whose mesh is now available, and drop the ones whose mesh this batch failed to load.
+	// Others belong to a batch that's still loading
+	TArray<TPair<int32, FSimpleDelegate>> StillPending;
+	TArray<TPair<int32, FSimpleDelegate>> Settled;
+
+	for (TPair<int32, FSimpleDelegate>& Pending : PendingMeshCallbacks)
+	{
+		const TSoftObjectPtr<UStaticMesh>& StaticMesh = Entries[Pending.Key].StaticMesh;
+
+		if (StaticMesh.IsValid())
+		{
+			Settled.Add(MoveTemp(Pending));
+
+		} else if (LoadedMeshes.Contains(StaticMesh.ToSoftObjectPath())) {
+
+			UE_LOG(LogMeritoBrainDamage, Warning, TEXT("Weapon registry failed to load mesh %s for row %s"), *StaticMesh.ToString(), *Entries[Pending.Key].RowName.ToString());
+
+		} else {
+
+			StillPending.Add(MoveTemp(Pending));
+		}
+	}
+
+	PendingMeshCallbacks = MoveTemp(StillPending);
+
+	// callbacks can request more meshes, so only run them once the pending list is consistent
+	for (TPair<int32, FSimpleDelegate>& Callback : Settled)
+	{
+		Callback.Value.ExecuteIfBound();
+	}
+}
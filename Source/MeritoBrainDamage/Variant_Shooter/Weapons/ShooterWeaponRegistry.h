@@ -0,0 +1,179 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/DataTable.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterWeaponRegistry.generated.h"
+
+class AShooterWeapon;
+class UStaticMesh;
+class UTexture2D;
+struct FStreamableHandle;
+
+/**
+ *  Precomputed weapon stats for UI display
+ *  Derived values like DPS are calculated once per weapon class instead of on every widget refresh
+ */
+USTRUCT(BlueprintType)
+struct FShooterWeaponStats
+{
+	GENERATED_BODY()
+
+	/** Weapon class these stats were calculated for */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Damage dealt by a single trigger pull */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	float Damage = 0.0f;
+
+	/** Sustained damage per second, ignoring ammo limits */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	float DamagePerSecond = 0.0f;
+
+	/** Distance the projectile covers before dropping out of its lifetime or falling too far */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon", meta = (Units = "cm"))
+	float EffectiveRange = 0.0f;
+
+	/** Explosion damage radius. Zero for non explosive projectiles */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon", meta = (Units = "cm"))
+	float ExplosionRadius = 0.0f;
+
+	/** Time between shots */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon", meta = (Units = "s"))
+	float RefireRate = 0.0f;
+
+	/** Number of bullets in a magazine */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	int32 MagazineSize = 0;
+};
+
+/**
+ *  Compact, pre-resolved copy of a FWeaponTableRow plus the weapon class defaults the game needs at runtime
+ */
+USTRUCT(BlueprintType)
+struct FShooterWeaponRegistryEntry
+{
+	GENERATED_BODY()
+
+	/** Row this entry was resolved from */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	FName RowName;
+
+	/** Weapon class granted by this entry */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	TSubclassOf<AShooterWeapon> WeaponClass;
+
+	/** Pickup mesh. Loaded asynchronously together with the rest of its table */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	TSoftObjectPtr<UStaticMesh> StaticMesh;
+
+	/** UI icon copied from the weapon class defaults */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	TObjectPtr<UTexture2D> Icon;
+
+	/** Display name copied from the weapon class defaults */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	FText WeaponName;
+
+	/** Index of the weapon class in the stats table */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Weapon")
+	int32 StatsIndex = INDEX_NONE;
+};
+
+/**
+ *  Resolves weapon data table rows once per game instance
+ *  Pickups and UI reference weapons by registry index instead of doing string-keyed row lookups
+ *  Pickup meshes are streamed in one batched async request per data table
+ */
+UCLASS()
+class MERITOBRAINDAMAGE_API UShooterWeaponRegistry : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+	/** Resolved weapon entries */
+	UPROPERTY()
+	TArray<FShooterWeaponRegistryEntry> Entries;
+
+	/** Flat table of precomputed weapon stats */
+	UPROPERTY()
+	TArray<FShooterWeaponStats> WeaponStats;
+
+	/** Maps a weapon class to its index in the stats table */
+	TMap<FObjectKey, int32> WeaponStatsIndices;
+
+	/** Maps data table and row name to an index in the entries list */
+	TMap<FObjectKey, TMap<FName, int32>> TableRowIndices;
+
+	/** Keeps the batched mesh loads alive while the registry exists */
+	TArray<TSharedPtr<FStreamableHandle>> LoadHandles;
+
+	/** Callbacks waiting for a mesh that is still streaming in */
+	TArray<TPair<int32, FSimpleDelegate>> PendingMeshCallbacks;
+
+	/** Meshes requested by a batched load that hasn't completed yet */
+	TSet<FSoftObjectPath> LoadingMeshes;
+
+	/** Meshes that failed to load, so they aren't requested again */
+	TSet<FSoftObjectPath> FailedMeshes;
+
+public:
+
+	/** Subsystem initialization. Builds the stats table for every weapon class already in memory */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Subsystem cleanup */
+	virtual void Deinitialize() override;
+
+	/** Returns the registry for the world context's game instance, if any */
+	static UShooterWeaponRegistry* Get(const UObject* WorldContextObject);
+
+	/** Returns the registry index for the given row, resolving its whole table on first use. INDEX_NONE if the row is invalid */
+	int32 FindOrRegister(const FDataTableRowHandle& RowHandle);
+
+	/** Returns the entry at the given index, or nullptr */
+	const FShooterWeaponRegistryEntry* GetEntry(int32 Index) const;
+
+	/** Returns a copy of the entry at the given index */
+	UFUNCTION(BlueprintPure, Category="Weapon", meta = (DisplayName = "Get Weapon Registry Entry"))
+	bool GetEntryCopy(int32 Index, FShooterWeaponRegistryEntry& OutEntry) const;
+
+	/** Returns the number of registered weapons */
+	UFUNCTION(BlueprintPure, Category="Weapon")
+	int32 GetNumEntries() const { return Entries.Num(); }
+
+	/** Returns the stats table index for the given weapon class, computing its stats on first use */
+	int32 FindOrAddWeaponStats(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/** Returns the stats at the given table index */
+	UFUNCTION(BlueprintPure, Category="Weapon")
+	const FShooterWeaponStats& GetWeaponStats(int32 StatsIndex) const;
+
+	/** Returns the stats for the given weapon class, computing and caching them on first use */
+	UFUNCTION(BlueprintCallable, Category="Weapon")
+	FShooterWeaponStats GetWeaponStatsForClass(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/** Returns the full stats table */
+	UFUNCTION(BlueprintPure, Category="Weapon")
+	const TArray<FShooterWeaponStats>& GetAllWeaponStats() const { return WeaponStats; }
+
+	/** Runs the callback once the entry's mesh is loaded. Runs it right away if it already is. The callback is dropped if the mesh fails to load */
+	void RequestMesh(int32 Index, FSimpleDelegate Callback);
+
+protected:
+
+	/** Calculates the stats for a weapon class from its defaults and its projectile defaults */
+	static FShooterWeaponStats CalculateWeaponStats(TSubclassOf<AShooterWeapon> WeaponClass);
+
+	/** Resolves every row of the given table into registry entries and starts streaming their meshes */
+	void RegisterTable(const UDataTable* Table);
+
+	/** Starts a batched async load of the given meshes */
+	void LoadMeshes(TArray<FSoftObjectPath>&& MeshesToLoad);
+
+	/** Called when a batched mesh load completes, successfully or not */
+	void OnMeshBatchLoaded(TArray<FSoftObjectPath> LoadedMeshes);
+};